@@ -62,6 +62,7 @@
 #include "AAT.h"
 #include "../common/alloc.h"
 #include "../common/bailout.h"
+#include "../common/pool.h"
 
 
 // ---------------------------------------------------------------------------
@@ -93,8 +94,10 @@ typedef struct _aat_node_s aat_node_s;
 // ---------------------------------------------------------------------------
 
 typedef struct /* aat_tree_s */ {
-      cardinal entry_count;
-    aat_node_p root_node;
+         cardinal entry_count;
+       aat_node_p root_node;
+    aat_compare_f compare; // NULL if keys are ordered as integers
+           pool_t node_pool; // all nodes of the tree
 } aat_tree_s;
 
 
@@ -108,12 +111,31 @@ static aat_node_s *bottom = &_bottom;
 
 
 // ---------------------------------------------------------------------------
-// Temporary node pointers for use during node removal
+// Node removal state
 // ---------------------------------------------------------------------------
+//
+// Passed down  the recursion of a removal  so that removals from  different
+// trees do not share any state.
+
+typedef struct /* aat_removal_s */ {
+    aat_node_p previous;  // last node visited on the way down
+    aat_node_p candidate; // node that may hold the key to be removed
+} aat_removal_s;
+
+
+// ---------------------------------------------------------------------------
+// Key comparison macros
+// ---------------------------------------------------------------------------
+//
+// Both expand  to a value  less than,  equal to  or greater than zero.  Keys
+// of trees without a comparator are compared inline as unsigned integers.
 
-static aat_node_s *_aat_previous_node = NULL;
+#define AAT_COMPARE_INTEGER(_tree,_key1,_key2) \
+    (((uintptr_t) (_key1) > (uintptr_t) (_key2)) - \
+     ((uintptr_t) (_key1) < (uintptr_t) (_key2)))
 
-static aat_node_s *_aat_candidate_node = NULL;
+#define AAT_COMPARE_CALLBACK(_tree,_key1,_key2) \
+    ((_tree)->compare((_key1), (_key2)))
 
 
 // ===========================================================================
@@ -124,13 +146,25 @@ static fmacro aat_node_p aat_skew(aat_node_p node);
 
 static fmacro aat_node_p aat_split(aat_node_p node);
 
-static aat_node_p aat_insert(aat_node_p node, aat_key_t key, aat_data_t value,
-                             aat_status_t *status);
+static aat_node_p aat_search_integer(aat_tree_s *tree, aat_key_t key);
+
+static aat_node_p aat_insert_integer(aat_tree_s *tree, aat_node_p node,
+                                     aat_key_t key, aat_data_t value,
+                                     aat_status_t *status);
+
+static aat_node_p aat_remove_integer(aat_tree_s *tree, aat_node_p node,
+                                     aat_key_t key, aat_removal_s *removal,
+                                     aat_status_t *status);
 
-static aat_node_p aat_remove(aat_node_p node, aat_key_t key,
-                             aat_status_t *status);
+static aat_node_p aat_search_callback(aat_tree_s *tree, aat_key_t key);
 
-static void aat_remove_all(aat_node_p node);
+static aat_node_p aat_insert_callback(aat_tree_s *tree, aat_node_p node,
+                                      aat_key_t key, aat_data_t value,
+                                      aat_status_t *status);
+
+static aat_node_p aat_remove_callback(aat_tree_s *tree, aat_node_p node,
+                                      aat_key_t key, aat_removal_s *removal,
+                                      aat_status_t *status);
 
 
 // ===========================================================================
@@ -144,11 +178,34 @@ static void aat_remove_all(aat_node_p node);
 // Creates  and returns  a new tree object.  Returns  NULL  if the tree object
 // could not be created.
 //
+// Keys are ordered  as unsigned integers  and compared inline.  Integer keys
+// are stored by casting them to aat_key_t.
+//
 // The status of the operation  is passed back in <status>,  unless  NULL  was
 // passed in for <status>.
 
 aat_tree_t aat_new_tree(aat_status_t *status) {
     
+    return aat_new_tree_with_comparator(NULL, status);
+} // end aat_new_tree
+
+
+// ---------------------------------------------------------------------------
+// function:  aat_new_tree_with_comparator( compare, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new tree object  whose keys are ordered by function
+// <compare>.  Keys may then point to strings,  records or any other data the
+// comparison function understands.  If NULL is passed in for <compare>,  the
+// keys are ordered as unsigned integers  as they are by aat_new_tree().
+// Returns NULL if the tree object could not be created.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+aat_tree_t aat_new_tree_with_comparator(aat_compare_f compare,
+                                         aat_status_t *status) {
+    
     aat_tree_s *new_tree;
     
     new_tree = ALLOCATE(sizeof(aat_tree_s));
@@ -162,9 +219,12 @@ aat_tree_t aat_new_tree(aat_status_t *status) {
     // initialise new tree
     new_tree->entry_count = 0;
     new_tree->root_node = bottom;
+    new_tree->compare = compare;
+    pool_init(&new_tree->node_pool, sizeof(aat_node_s));
     
+    ASSIGN_BY_REF(status, AAT_STATUS_SUCCESS);
     return (aat_tree_t) new_tree;
-} // end aat_new_tree
+} // end aat_new_tree_with_comparator
 
 
 // ---------------------------------------------------------------------------
@@ -198,9 +258,20 @@ void aat_store_entry(aat_tree_t tree,
         ASSIGN_BY_REF(status, AAT_STATUS_INVALID_DATA);
         return;
     } // end if
-            
+    
+    // bail out if key is zero
+    if (key == NULL) {
+        ASSIGN_BY_REF(status, AAT_STATUS_INVALID_KEY);
+        return;
+    } // end if
+    
     // insert entry
-    new_root = aat_insert(this_tree->root_node, key, value, &r_status);
+    if (this_tree->compare == NULL)
+        new_root = aat_insert_integer(this_tree, this_tree->root_node,
+                                      key, value, &r_status);
+    else
+        new_root = aat_insert_callback(this_tree, this_tree->root_node,
+                                       key, value, &r_status);
     
     if (r_status == AAT_STATUS_SUCCESS) {
         this_tree->root_node = new_root;
@@ -237,26 +308,11 @@ aat_data_t aat_value_for_key(aat_tree_t tree,
         return NULL;
     } // end if
     
-    // set sentinel's key to search key
-    bottom->key = key;
-    
-    // start at the root
-    this_node = this_tree->root_node;
-    
-    // search until key found
-    while (key != this_node->key) {
-        
-        // move down left if key is less than key of current node
-        if (key < this_node->key)
-            this_node = this_node->left;
-        
-        // move down right if key is greater than key of current node
-        else if (key > this_node->key)
-            this_node = this_node->right;
-    } // end while
-    
-    // reset sentinel's key
-    bottom->key = 0;
+    // search for key
+    if (this_tree->compare == NULL)
+        this_node = aat_search_integer(this_tree, key);
+    else
+        this_node = aat_search_callback(this_tree, key);
     
     // check if bottom reached
     if (this_node != bottom) {
@@ -309,14 +365,20 @@ void aat_remove_entry(aat_tree_t tree,
     
     #define this_tree ((aat_tree_s *)tree)
     aat_node_s *new_root;
-    aat_status_t r_status;
+    aat_status_t r_status = AAT_STATUS_ENTRY_NOT_FOUND;
+    aat_removal_s removal = { bottom, bottom };
     
     // bail out if tree is NULL
     if (tree == NULL)
         return;
     
     // remove entry
-    new_root = aat_remove(this_tree->root_node, key, &r_status);
+    if (this_tree->compare == NULL)
+        new_root = aat_remove_integer(this_tree, this_tree->root_node,
+                                      key, &removal, &r_status);
+    else
+        new_root = aat_remove_callback(this_tree, this_tree->root_node,
+                                       key, &removal, &r_status);
     
     if (r_status == AAT_STATUS_SUCCESS) {
         this_tree->root_node = new_root;
@@ -344,8 +406,8 @@ aat_tree_t *aat_dispose_tree(aat_tree_t tree) {
     if (tree == NULL)
         return NULL;
         
-    // deallocate all nodes
-    aat_remove_all(this_tree->root_node);
+    // deallocate all nodes, slab by slab
+    pool_dispose(&this_tree->node_pool);
         
     // deallocate tree
     DEALLOCATE(tree);
@@ -364,13 +426,14 @@ aat_tree_t *aat_dispose_tree(aat_tree_t tree) {
 // ---------------------------------------------------------------------------
 //
 // Rotates <node> to the right if its left child has the same level as <node>.
-// NULL must not be passed in for <node>.
+// The bottom sentinel is returned unchanged.  NULL must not be passed in for
+// <node>.
 
 static fmacro aat_node_p aat_skew(aat_node_p node) {
     aat_node_s *temp_node;
     
     // rotate right if left child has same level
-    if (node->level == node->left->level) {
+    if ((node != bottom) && (node->level == node->left->level)) {
         temp_node = node;
         node = node->left;
         temp_node->left = node->right;
@@ -387,17 +450,18 @@ static fmacro aat_node_p aat_skew(aat_node_p node) {
 //
 // Rotates <node> left and promotes the level of its right child to become its
 // new parent if <node> has two consecutive right children with the same level
-// level as <node>.  NULL must not be passed in for <node>.
+// level as <node>.  The bottom sentinel is returned unchanged.  NULL must not
+// be passed in for <node>.
 
 static fmacro aat_node_p aat_split(aat_node_p node) {
     aat_node_s *temp_node;
     
     // rotate left if there are two right children on same level
-    if (node->level == node->right->right->level) {
+    if ((node != bottom) && (node->level == node->right->right->level)) {
         temp_node = node;
         node = node->right;
         temp_node->right = node->left;
-        node->right = temp_node;
+        node->left = temp_node;
         node->level++;
     } // end if
     
@@ -406,162 +470,205 @@ static fmacro aat_node_p aat_split(aat_node_p node) {
 
 
 // ---------------------------------------------------------------------------
-// private function:  aat_insert( node, key, status )
-// ---------------------------------------------------------------------------
-//
-// Recursively inserts  a new entry for <key> with <value> into the tree whose
-// root node is <node>.  Returns the new root node  of the resulting tree.  If
-// allocation fails  or  if a node with the same key already exists,  then  NO
-// entry will be inserted and NULL is returned.
-//
-// The status of the operation  is passed back  in <status>.  NULL must not be
-// passed in for <node> or <status>.
-
-static aat_node_p aat_insert(aat_node_p node, aat_key_t key, aat_data_t value,
-                             aat_status_t *status) {
-    aat_node_s *new_node;
-    
-    if (node == bottom) {
-        // allocate a new node
-        new_node = ALLOCATE(sizeof(aat_node_s));
-        
-        // bail out if allocation failed
-        if (new_node == NULL)
-            BAILOUT(allocation_failed);
-        
-        // initialise new node
-        new_node->level = 1;
-        new_node->key = key;
-        new_node->value = value;
-        new_node->left = bottom;
-        new_node->right = bottom;
-        
-        // link new node to the tree
-        node = new_node;
-    }
-    else if (node->key > key) {
-        node = aat_insert(node->left, key, value, status);
-        
-        // bail out if allocation failed
-        if (*status == AAT_STATUS_ALLOCATION_FAILED)
-            BAILOUT(allocation_failed);
-    }
-    else if (node->key < key) {
-        node = aat_insert(node->right, key, value, status);
-        
-        // bail out if allocation failed
-        if (*status == AAT_STATUS_ALLOCATION_FAILED)
-            BAILOUT(allocation_failed);
-    }
-    else /* key already exists */ {
-        BAILOUT(key_not_unique);
-    } // end if
-    
-    node = aat_skew(node);
-    node = aat_split(node);
-    
-    /* NORMAL TERMINATION */
-    
-    *status = AAT_STATUS_SUCCESS;
-    return node;
-    
-    /* ERROR HANDLING */
-    
-    ON_ERROR(allocation_failed) :
-    
-    *status = AAT_STATUS_ALLOCATION_FAILED;
-    return NULL;
-    
-    ON_ERROR(key_not_unique) :
-    
-    *status = AAT_STATUS_KEY_NOT_UNIQUE;
-    return NULL;
-} // end aat_insert
-
-
-// ---------------------------------------------------------------------------
-// private function:  aat_remove( node, key, status )
+// macro:  AAT_DEFINE_OPERATIONS( suffix, compare )
 // ---------------------------------------------------------------------------
 //
-// Recursively searches the tree  whose root node is <node>  for a node  whose
-// key is <key> and if found,  removes that node  and rebalances the resulting
-// tree,  then  returns  the new root  of the resulting tree.  If no node with
-// <key> exists,  then NULL is returned.
-//
-// The status of the operation  is passed back  in <status>.  NULL must not be
-// passed in for <node> or <status>.
-
-static aat_node_p aat_remove(aat_node_p node, aat_key_t key,
-                             aat_status_t *status) {
-    
-    // bail out if bottom reached
-    if (node == bottom) {
-        *status = AAT_STATUS_ENTRY_NOT_FOUND;
-        return NULL;
-    } // end if
-    
-    // move down recursively until key is found or bottom reached
-    _aat_previous_node = node;
-    
-    // move left if search key less than current node's key
-    if (key < node->key) {
-        node = aat_remove(node->left, key, status);
-    }
-    // mode right if search key not less than current node's key
-    else {
-        _aat_candidate_node = node;
-        node = aat_remove(node->right, key, status);
-    } // end if
-    
-    // remove entry
-    if ((node == _aat_previous_node) &&
-        (_aat_candidate_node != bottom) && (_aat_candidate_node->key == key)) {
-        
-        _aat_candidate_node->key = node->key;
-        _aat_candidate_node = bottom;
-        node = node->right;
-        
-        DEALLOCATE(_aat_previous_node);
-        *status = AAT_STATUS_SUCCESS;
-    }
-    // rebalance on the way back up
-    else if ((node->level-1 > node->left->level) ||
-             (node->level-1 < node->right->level)) {
-        
-        node->level = node->level--;
-        if (node->level < node->right->level)
-            node->right->level = node->level;
-        
-        node = aat_skew(node);
-        node = aat_skew(node->right);
-        node = aat_skew(node->right->right);
-        node = aat_split(node);
-        node = aat_split(node->right);
-    } // end if
-    
-    return node;
-} // end aat_remove
-
-
-// ---------------------------------------------------------------------------
-// private function:  aat_remove_all( node )
-// ---------------------------------------------------------------------------
-//
-// Recursively  removes  all nodes  from the tree  whose root node  is <node>.
-// NULL must not be passed in for <node>.
-
-static void aat_remove_all(aat_node_p node) {
-    
-    if (node == bottom)
-        return;
-    
-    aat_remove_all(node->left);
-    aat_remove_all(node->right);
-    
-    DEALLOCATE(node);
-    
-    return;
-} // end aat_remove_all
+// Defines the private functions  aat_search_<suffix>,  aat_insert_<suffix> and
+// aat_remove_<suffix>  with key comparison macro <compare>  expanded  inline.
+// The functions are generated  once per comparison  so that  trees  with
+// integer keys do not pay for an indirect call at every node visited.
+
+#define AAT_DEFINE_OPERATIONS(_suffix,_compare) \
+\
+/* ----------------------------------------------------------------------- */ \
+/* private function:  aat_search_<suffix>( tree, key )                      */ \
+/* ----------------------------------------------------------------------- */ \
+/*                                                                          */ \
+/* Searches <tree> for the node whose key is <key>  and returns it.  If no  */ \
+/* such node exists,  then the bottom sentinel is returned.                 */ \
+\
+static aat_node_p aat_search_##_suffix(aat_tree_s *tree, aat_key_t key) { \
+    aat_node_s *this_node; \
+    int order; \
+    \
+    /* set sentinel's key to search key */ \
+    bottom->key = key; \
+    \
+    /* start at the root */ \
+    this_node = tree->root_node; \
+    \
+    /* search until key found, at the latest in the sentinel */ \
+    while ((order = _compare(tree, key, this_node->key)) != 0) { \
+        \
+        /* move down left if key is less than key of current node */ \
+        if (order < 0) \
+            this_node = this_node->left; \
+        \
+        /* move down right if key is greater than key of current node */ \
+        else \
+            this_node = this_node->right; \
+    } /* end while */ \
+    \
+    /* reset sentinel's key */ \
+    bottom->key = NULL; \
+    \
+    return this_node; \
+} /* end aat_search_<suffix> */ \
+\
+\
+/* ----------------------------------------------------------------------- */ \
+/* private function:  aat_insert_<suffix>( tree, node, key, value, status ) */ \
+/* ----------------------------------------------------------------------- */ \
+/*                                                                          */ \
+/* Recursively inserts  a new entry for <key> with <value> into the subtree */ \
+/* of <tree> whose root node is <node>.  Returns the new root node  of the  */ \
+/* resulting subtree.  If allocation fails  or if a node with the same key  */ \
+/* already exists,  then NO entry is inserted and <node> is returned.       */ \
+/* The new node is taken from the node pool of <tree>.                      */ \
+/*                                                                          */ \
+/* The status of the operation is passed back in <status>.  NULL must not   */ \
+/* be passed in for <node> or <status>.                                     */ \
+\
+static aat_node_p aat_insert_##_suffix(aat_tree_s *tree, aat_node_p node, \
+                                       aat_key_t key, aat_data_t value, \
+                                       aat_status_t *status) { \
+    aat_node_s *new_node; \
+    int order; \
+    \
+    if (node == bottom) { \
+        /* allocate a new node */ \
+        new_node = pool_allocate(&tree->node_pool); \
+        \
+        /* bail out if allocation failed */ \
+        if (new_node == NULL) \
+            BAILOUT(allocation_failed); \
+        \
+        /* initialise new node */ \
+        new_node->level = 1; \
+        new_node->key = key; \
+        new_node->value = value; \
+        new_node->left = bottom; \
+        new_node->right = bottom; \
+        \
+        *status = AAT_STATUS_SUCCESS; \
+        return new_node; \
+    } /* end if */ \
+    \
+    order = _compare(tree, key, node->key); \
+    \
+    if (order < 0) \
+        node->left = aat_insert_##_suffix(tree, node->left, \
+                                          key, value, status); \
+    else if (order > 0) \
+        node->right = aat_insert_##_suffix(tree, node->right, \
+                                           key, value, status); \
+    else /* key already exists */ \
+        BAILOUT(key_not_unique); \
+    \
+    /* the subtree is unchanged if insertion failed further down */ \
+    if (*status != AAT_STATUS_SUCCESS) \
+        return node; \
+    \
+    node = aat_skew(node); \
+    node = aat_split(node); \
+    \
+    /* NORMAL TERMINATION */ \
+    \
+    return node; \
+    \
+    /* ERROR HANDLING */ \
+    \
+    ON_ERROR(allocation_failed) : \
+    \
+    *status = AAT_STATUS_ALLOCATION_FAILED; \
+    return node; \
+    \
+    ON_ERROR(key_not_unique) : \
+    \
+    *status = AAT_STATUS_KEY_NOT_UNIQUE; \
+    return node; \
+} /* end aat_insert_<suffix> */ \
+\
+\
+/* ----------------------------------------------------------------------- */ \
+/* private function:  aat_remove_<suffix>( tree, node, key, removal, ... ) */ \
+/* ----------------------------------------------------------------------- */ \
+/*                                                                          */ \
+/* Recursively searches the subtree of <tree> whose root node is <node> for */ \
+/* a node whose key is <key>  and if found,  removes that node,  rebalances */ \
+/* the subtree on the way back up  and returns its new root.  If no node    */ \
+/* with <key> exists,  then the subtree is returned unchanged.              */ \
+/* The removed node is returned to the node pool of <tree>.                 */ \
+/*                                                                          */ \
+/* The status is passed back in <status> only if the key was found.  Both   */ \
+/* fields of <removal> must be set to the bottom sentinel by the caller.    */ \
+\
+static aat_node_p aat_remove_##_suffix(aat_tree_s *tree, aat_node_p node, \
+                                       aat_key_t key, aat_removal_s *removal, \
+                                       aat_status_t *status) { \
+    \
+    /* bottom reached */ \
+    if (node == bottom) \
+        return node; \
+    \
+    /* move down recursively until bottom reached */ \
+    removal->previous = node; \
+    \
+    /* move left if search key less than current node's key */ \
+    if (_compare(tree, key, node->key) < 0) { \
+        node->left = aat_remove_##_suffix(tree, node->left, \
+                                          key, removal, status); \
+    } \
+    /* move right if search key not less than current node's key */ \
+    else { \
+        removal->candidate = node; \
+        node->right = aat_remove_##_suffix(tree, node->right, \
+                                           key, removal, status); \
+    } /* end if */ \
+    \
+    /* at the last node visited, move its entry into the candidate */ \
+    if ((node == removal->previous) && (removal->candidate != bottom) && \
+        (_compare(tree, key, removal->candidate->key) == 0)) { \
+        \
+        removal->candidate->key = node->key; \
+        removal->candidate->value = node->value; \
+        removal->candidate = bottom; \
+        node = node->right; \
+        \
+        pool_release(&tree->node_pool, removal->previous); \
+        *status = AAT_STATUS_SUCCESS; \
+    } \
+    /* rebalance on the way back up */ \
+    else if ((node->left->level + 1 < node->level) || \
+             (node->right->level + 1 < node->level)) { \
+        \
+        node->level--; \
+        if (node->right->level > node->level) \
+            node->right->level = node->level; \
+        \
+        node = aat_skew(node); \
+        node->right = aat_skew(node->right); \
+        node->right->right = aat_skew(node->right->right); \
+        node = aat_split(node); \
+        node->right = aat_split(node->right); \
+    } /* end if */ \
+    \
+    return node; \
+} /* end aat_remove_<suffix> */
+
+
+// ---------------------------------------------------------------------------
+// Operations on trees with integer keys, comparison inlined
+// ---------------------------------------------------------------------------
+
+AAT_DEFINE_OPERATIONS(integer, AAT_COMPARE_INTEGER)
+
+
+// ---------------------------------------------------------------------------
+// Operations on trees with a comparator, comparison by indirect call
+// ---------------------------------------------------------------------------
+
+AAT_DEFINE_OPERATIONS(callback, AAT_COMPARE_CALLBACK)
 
 
 // END OF FILE
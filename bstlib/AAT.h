@@ -84,6 +84,17 @@ typedef void *aat_key_t;
 typedef void *aat_data_t;
 
 
+// ---------------------------------------------------------------------------
+// Key comparison function type
+// ---------------------------------------------------------------------------
+//
+// A comparison function  returns a negative value  if <key1> sorts  before
+// <key2>,  zero if both keys are equal  and a positive value if <key1> sorts
+// after <key2>.  Any key must compare equal to itself.
+
+typedef int (*aat_compare_f)(aat_key_t key1, aat_key_t key2);
+
+
 // ---------------------------------------------------------------------------
 // Status codes
 // ---------------------------------------------------------------------------
@@ -106,12 +117,32 @@ typedef enum /* aat_status_t */ {
 // Creates  and returns  a new tree object.  Returns  NULL  if the tree object
 // could not be created.
 //
+// Keys are ordered  as unsigned integers  and compared inline.  Integer keys
+// are stored by casting them to aat_key_t.
+//
 // The status of the operation  is passed back in <status>,  unless  NULL  was
 // passed in for <status>.
 
 aat_tree_t aat_new_tree(aat_status_t *status);
 
 
+// ---------------------------------------------------------------------------
+// function:  aat_new_tree_with_comparator( compare, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new tree object  whose keys are ordered by function
+// <compare>.  Keys may then point to strings,  records or any other data the
+// comparison function understands.  If NULL is passed in for <compare>,  the
+// keys are ordered as unsigned integers  as they are by aat_new_tree().
+// Returns NULL if the tree object could not be created.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+aat_tree_t aat_new_tree_with_comparator(aat_compare_f compare,
+                                         aat_status_t *status);
+
+
 // ---------------------------------------------------------------------------
 // function:  aat_store_entry( tree, key, value, status )
 // ---------------------------------------------------------------------------
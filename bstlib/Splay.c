@@ -61,6 +61,7 @@
 
 #include "Splay.h"
 #include "../common/alloc.h"
+#include "../common/pool.h"
 
 
 // ---------------------------------------------------------------------------
@@ -93,6 +94,7 @@ typedef struct _splay_node_s splay_node_s;
 typedef struct /* splay_tree_s */ {
         cardinal entry_count;
     splay_node_p root_node;
+          pool_t node_pool; // all nodes of the tree
 } splay_tree_s;
 
 
@@ -111,13 +113,13 @@ static splay_node_s *bottom = &_bottom;
 
 static fmacro splay_node_p splay_top_down(splay_node_p node, splay_key_t key);
 
-static fmacro splay_node_p splay_insert(splay_node_p node, splay_key_t key,
-                                 splay_data_t value, splay_status_t *status);
+static fmacro splay_node_p splay_insert(splay_tree_s *tree, splay_node_p node,
+                                        splay_key_t key, splay_data_t value,
+                                        splay_status_t *status);
 
-static fmacro splay_node_p splay_remove(splay_node_p node, splay_key_t key,
-                                 splay_status_t *status);
-
-static void splay_remove_all(splay_node_p node);
+static fmacro splay_node_p splay_remove(splay_tree_s *tree, splay_node_p node,
+                                        splay_key_t key,
+                                        splay_status_t *status);
 
 
 // ===========================================================================
@@ -149,6 +151,7 @@ splay_tree_t splay_new_tree(splay_status_t *status) {
     // initialise new tree
     new_tree->entry_count = 0;
     new_tree->root_node = bottom;
+    pool_init(&new_tree->node_pool, sizeof(splay_node_s));
     
     return (splay_tree_t) new_tree;
 } // end splay_new_tree
@@ -187,7 +190,7 @@ void splay_store_entry(splay_tree_t tree,
     
     // insert entry
     this_tree->root_node = 
-        splay_insert(this_tree->root_node, key, value, &r_status);
+        splay_insert(this_tree, this_tree->root_node, key, value, &r_status);
     
     if (r_status == SPLAY_STATUS_SUCCESS)
         this_tree->entry_count++;
@@ -301,7 +304,7 @@ void splay_remove_entry(splay_tree_t tree,
     
     // remove entry
     this_tree->root_node =
-        splay_remove(this_tree->root_node, key, &r_status);
+        splay_remove(this_tree, this_tree->root_node, key, &r_status);
     
     if (r_status == SPLAY_STATUS_SUCCESS)
         this_tree->entry_count--;
@@ -327,8 +330,8 @@ splay_tree_t *splay_dispose_tree(splay_tree_t tree) {
     if (tree == NULL)
         return NULL;
     
-    // deallocate all nodes
-    splay_remove_all(this_tree->root_node);
+    // deallocate all nodes, slab by slab
+    pool_dispose(&this_tree->node_pool);
     
     // deallocate tree
     DEALLOCATE(tree);
@@ -383,7 +386,7 @@ static fmacro splay_node_p splay_top_down(splay_node_p node,
             } // end if
             
             // link right
-            left_subtree->left = node;
+            right_subtree->left = node;
             right_subtree = node;
             node = node->left;
         }
@@ -424,19 +427,21 @@ static fmacro splay_node_p splay_top_down(splay_node_p node,
 
 
 // ---------------------------------------------------------------------------
-// private function:  splay_insert( node, key, status )
+// private function:  splay_insert( tree, node, key, value, status )
 // ---------------------------------------------------------------------------
 //
 // Inserts a new entry for <key> with <value> into the tree whose root node is
 // <node>.  Returns the  new root node  of the  resulting tree.  If allocation
 // fails  or if a node with the same key already exists,  then  NO  entry will
-// be inserted and the  current root node  is returned.
+// be inserted and the  current root node  is returned.  The new node is taken
+// from the node pool of <tree>.
 //
 // The status of the operation  is passed back  in <status>.  NULL must not be
-// passed in for <node> or <status>.
+// passed in for <tree>, <node> or <status>.
 
-static fmacro splay_node_p splay_insert(splay_node_p node, splay_key_t key,
-                                 splay_data_t value, splay_status_t *status) {
+static fmacro splay_node_p splay_insert(splay_tree_s *tree, splay_node_p node,
+                                        splay_key_t key, splay_data_t value,
+                                        splay_status_t *status) {
     splay_node_s *new_node;
     
     node = splay_top_down(node, key);
@@ -448,7 +453,7 @@ static fmacro splay_node_p splay_insert(splay_node_p node, splay_key_t key,
     }
     else {
         // allocate new node
-        new_node = ALLOCATE(sizeof(splay_node_s));
+        new_node = pool_allocate(&tree->node_pool);
         
         // bail out if allocation failed
         if (new_node == NULL) {
@@ -479,18 +484,20 @@ static fmacro splay_node_p splay_insert(splay_node_p node, splay_key_t key,
 
 
 // ---------------------------------------------------------------------------
-// private function:  splay_remove( node, key, status )
+// private function:  splay_remove( tree, node, key, status )
 // ---------------------------------------------------------------------------
 //
 // Searches the tree whose root node is <node>  for a node  whose key is <key>
 // and if found,  removes that node  and  rebalances the resulting tree,  then
 // returns the new root  of the resulting tree.  If no node with <key> exists,
-// then the current root node is returned.
+// then the current root node is returned.  The removed node is returned to
+// the node pool of <tree>.
 //
 // The status of the operation  is passed back  in <status>.  NULL must not be
-// passed in for <node> or <status>.
+// passed in for <tree>, <node> or <status>.
 
-static fmacro splay_node_p splay_remove(splay_node_p node, splay_key_t key,
+static fmacro splay_node_p splay_remove(splay_tree_s *tree, splay_node_p node,
+                                        splay_key_t key,
                                         splay_status_t *status) {
     splay_node_s *new_root;
     
@@ -513,12 +520,12 @@ static fmacro splay_node_p splay_remove(splay_node_p node, splay_key_t key,
         new_root = node->right;
     }
     else {
-        new_root = splay_top_down(node, key);
+        new_root = splay_top_down(node->left, key);
         new_root->right = node->right;
     } // end if
     
-    // remove the node
-    DEALLOCATE(node);
+    // return the node to the pool
+    pool_release(&tree->node_pool, node);
     
     // pass status and new root to caller
     *status = SPLAY_STATUS_SUCCESS;
@@ -526,25 +533,4 @@ static fmacro splay_node_p splay_remove(splay_node_p node, splay_key_t key,
 } // end splay_remove
 
 
-// ---------------------------------------------------------------------------
-// private function:  splay_remove_all( node )
-// ---------------------------------------------------------------------------
-//
-// Recursively  removes  all nodes  from the tree  whose root node  is <node>.
-// NULL must not be passed in for <node>.
-
-static void splay_remove_all(splay_node_p node) {
-    
-    if (node == bottom)
-        return;
-    
-    splay_remove_all(node->left);
-    splay_remove_all(node->right);
-    
-    DEALLOCATE(node);
-    
-    return;
-} // end splay_remove_all
-
-
 // END OF FILE
@@ -0,0 +1,179 @@
+/*  General purpose fixed size object pool
+ *
+ *  @file pool.h
+ *  Slab allocator
+ *
+ *  This file ("pool.h") is hereby released into the public domain.
+ *
+ *  A pool hands out objects of one size from large slabs aligned to a cache
+ *  line  and recycles released objects  through a free list.  Objects  are
+ *  never returned to the system one by one,  all slabs of a pool are freed
+ *  together  when the pool is disposed of.  A pool is not thread safe,  it
+ *  is meant to be embedded in a data structure that owns all of its objects.
+ *
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include "alloc.h"
+
+
+// ---------------------------------------------------------------------------
+// Cache line size, slabs are aligned to it
+// ---------------------------------------------------------------------------
+
+#ifndef POOL_CACHE_LINE_SIZE
+#define POOL_CACHE_LINE_SIZE 64
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Slab size, including the cache line reserved for the slab header
+// ---------------------------------------------------------------------------
+
+#ifndef POOL_SLAB_SIZE
+#define POOL_SLAB_SIZE (16*1024)
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Slab header type, occupies the first cache line of each slab
+// ---------------------------------------------------------------------------
+
+typedef struct _pool_slab_s {
+    struct _pool_slab_s *next;  // slab allocated before this one
+                   void *block; // allocation to pass to DEALLOCATE
+} pool_slab_s;
+
+
+// ---------------------------------------------------------------------------
+// Pool type
+// ---------------------------------------------------------------------------
+
+typedef struct /* pool_t */ {
+         size_t object_size; // rounded up to a multiple of pointer size
+           void *free_list;  // released objects, linked through first word
+        uint8_t *unused;     // next never used object of the current slab
+        uint8_t *limit;      // end of the current slab
+    pool_slab_s *slabs;      // all slabs of the pool, most recent first
+} pool_t;
+
+
+// ---------------------------------------------------------------------------
+// function:  pool_init( pool, object_size )
+// ---------------------------------------------------------------------------
+//
+// Initialises <pool>  to hand out objects of <object_size> bytes.  No memory
+// is allocated until the first object is requested.  <object_size> must not
+// exceed POOL_SLAB_SIZE - POOL_CACHE_LINE_SIZE.
+
+static inline void pool_init(pool_t *pool, size_t object_size) {
+    if (object_size < sizeof(void *))
+        object_size = sizeof(void *);
+    
+    pool->object_size = (object_size + sizeof(void *) - 1) &
+                        ~(sizeof(void *) - 1);
+    pool->free_list = NULL;
+    pool->unused = NULL;
+    pool->limit = NULL;
+    pool->slabs = NULL;
+    
+    return;
+} // end pool_init
+
+
+// ---------------------------------------------------------------------------
+// function:  pool_allocate( pool )
+// ---------------------------------------------------------------------------
+//
+// Returns an object from <pool>,  recycling the most recently released object
+// if there is one,  otherwise carving a new object from the current slab and
+// allocating a new slab when the current one is exhausted.  Returns NULL  if
+// a new slab could not be allocated.
+
+static inline void *pool_allocate(pool_t *pool) {
+    void *block, *object;
+    pool_slab_s *slab;
+    
+    // recycle a released object
+    if (pool->free_list != NULL) {
+        object = pool->free_list;
+        pool->free_list = *(void **) object;
+        return object;
+    } // end if
+    
+    // allocate a new slab if the current one is exhausted
+    if ((pool->unused == NULL) ||
+        ((size_t) (pool->limit - pool->unused) < pool->object_size)) {
+        block = ALLOCATE(POOL_SLAB_SIZE + POOL_CACHE_LINE_SIZE);
+        
+        // bail out if allocation failed
+        if (block == NULL)
+            return NULL;
+        
+        // align slab to cache line
+        slab = (pool_slab_s *)
+            (((uintptr_t) block + POOL_CACHE_LINE_SIZE - 1) &
+             ~(uintptr_t) (POOL_CACHE_LINE_SIZE - 1));
+        
+        slab->block = block;
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        
+        // objects start at the second cache line of the slab
+        pool->unused = (uint8_t *) slab + POOL_CACHE_LINE_SIZE;
+        pool->limit = (uint8_t *) slab + POOL_SLAB_SIZE;
+    } // end if
+    
+    object = pool->unused;
+    pool->unused += pool->object_size;
+    
+    return object;
+} // end pool_allocate
+
+
+// ---------------------------------------------------------------------------
+// function:  pool_release( pool, object )
+// ---------------------------------------------------------------------------
+//
+// Returns <object> to the free list of <pool>  for reuse  by the next call to
+// pool_allocate().  <object> must have been obtained from <pool>.
+
+static inline void pool_release(pool_t *pool, void *object) {
+    *(void **) object = pool->free_list;
+    pool->free_list = object;
+    
+    return;
+} // end pool_release
+
+
+// ---------------------------------------------------------------------------
+// function:  pool_dispose( pool )
+// ---------------------------------------------------------------------------
+//
+// Frees all slabs of <pool>  at once,  invalidating every object obtained from
+// it,  and leaves <pool> empty but ready for reuse.
+
+static inline void pool_dispose(pool_t *pool) {
+    pool_slab_s *slab, *next_slab;
+    
+    slab = pool->slabs;
+    while (slab != NULL) {
+        next_slab = slab->next;
+        DEALLOCATE(slab->block);
+        slab = next_slab;
+    } // end while
+    
+    pool_init(pool, pool->object_size);
+    
+    return;
+} // end pool_dispose
+
+
+#endif /* POOL_H */
+
+// END OF FILE
@@ -51,6 +51,23 @@
  */
 
 
+// ---------------------------------------------------------------------------
+// Feature test macros
+// ---------------------------------------------------------------------------
+//
+// clock_gettime(),  its clock identifiers  and  truncate()  are POSIX.1-2008
+// interfaces  which system headers  do not declare  in strict C99 mode.
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
 #include "../common/alloc.h"
 #include "KVS.h"
 
@@ -67,6 +84,223 @@
 #error "Fatal error: KVS_MAX_STRING_SIZE must not exceed 32 bit."
 #endif
 
+#if (KVS_CHUNK_SIZE <= 0)
+#error "Fatal error: KVS_CHUNK_SIZE must be greater than zero."
+#endif
+
+#if (KVS_CHUNK_THRESHOLD > 0x0ffffffff)
+#error "Fatal error: KVS_CHUNK_THRESHOLD must not exceed 32 bit."
+#endif
+
+
+// ---------------------------------------------------------------------------
+// SIMD support for open addressing
+// ---------------------------------------------------------------------------
+//
+// Control bytes of open addressing tables are probed 16 at a time using SSE2
+// instructions where available.  Define KVS_NO_SSE2 to force the use of the
+// portable scalar implementation.
+
+#if defined(__SSE2__) && !defined(KVS_NO_SSE2)
+#include <emmintrin.h>
+#define KVS_USE_SSE2 1
+#else
+#define KVS_USE_SSE2 0
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Thread support for concurrent tables
+// ---------------------------------------------------------------------------
+//
+// Concurrent tables use POSIX threads mutexes  and  the atomic builtins of
+// GCC compatible compilers.  Define KVS_NO_THREADS to build without thread
+// support,  concurrent tables can then not be created.
+
+#if !defined(KVS_NO_THREADS)
+#include <pthread.h>
+#define KVS_USE_THREADS 1
+#else
+#define KVS_USE_THREADS 0
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Concurrency parameters
+// ---------------------------------------------------------------------------
+//
+// Writers to concurrent tables lock one of KVS_LOCK_STRIPES mutexes,  chosen
+// by bucket index.  Readers register in one of KVS_EPOCH_STRIPES epoch counter
+// stripes,  chosen by thread,  each on a cache line of its own.
+
+#ifndef KVS_CACHE_LINE_SIZE
+#define KVS_CACHE_LINE_SIZE 64
+#endif
+
+#ifndef KVS_LOCK_STRIPES
+#define KVS_LOCK_STRIPES 64
+#endif
+
+#ifndef KVS_EPOCH_STRIPES
+#define KVS_EPOCH_STRIPES 64
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Memory mapped snapshots
+// ---------------------------------------------------------------------------
+//
+// Snapshot files are opened by mapping them read-only into memory with POSIX
+// mmap().  Define KVS_NO_MMAP to read snapshot files into allocated memory
+// instead,  the file layout is the same either way.
+
+#if !defined(KVS_NO_MMAP)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define KVS_USE_MMAP 1
+#else
+#define KVS_USE_MMAP 0
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Write-ahead logs
+// ---------------------------------------------------------------------------
+//
+// Write-ahead logs are appended to with POSIX write() and synced with fsync().
+// Define KVS_NO_LOG to build without write-ahead logs,  logs can then still
+// be replayed,  but not attached to tables.
+
+#if !defined(KVS_NO_LOG)
+#include <fcntl.h>
+#include <unistd.h>
+#define KVS_USE_LOG 1
+#else
+#define KVS_USE_LOG 0
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Lookup statistics
+// ---------------------------------------------------------------------------
+//
+// Searches for a key count the lookups,  the entries compared  and  the hits
+// of the hot entry cache  in relaxed atomic counters of the table.  Define
+// KVS_STATS to build with these counters,  kvs_get_stats() otherwise passes
+// them back as zero.
+
+#if defined(KVS_STATS)
+#define KVS_USE_STATS 1
+#else
+#define KVS_USE_STATS 0
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Known table flags
+// ---------------------------------------------------------------------------
+
+#if KVS_USE_THREADS
+#define KVS_KNOWN_FLAGS \
+    (KVS_FLAG_OPEN_ADDRESSING | KVS_FLAG_INCREMENTAL_RESIZE | \
+     KVS_FLAG_INLINE_VALUES | KVS_FLAG_CONCURRENT | \
+     KVS_FLAG_POWER_OF_TWO_BUCKETS | KVS_FLAG_COMPACT | KVS_FLAG_FILTER | \
+     KVS_FLAG_DEDUP | KVS_FLAG_CHUNKED_VALUES)
+#else
+#define KVS_KNOWN_FLAGS \
+    (KVS_FLAG_OPEN_ADDRESSING | KVS_FLAG_INCREMENTAL_RESIZE | \
+     KVS_FLAG_INLINE_VALUES | KVS_FLAG_POWER_OF_TWO_BUCKETS | \
+     KVS_FLAG_COMPACT | KVS_FLAG_FILTER | KVS_FLAG_DEDUP | \
+     KVS_FLAG_CHUNKED_VALUES)
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Mutually exclusive table flags
+// ---------------------------------------------------------------------------
+//
+// Open addressing tables grow by rehashing all slots at once.
+
+#define KVS_OA_EXCLUDED_FLAGS \
+    (KVS_FLAG_INCREMENTAL_RESIZE | KVS_FLAG_CONCURRENT | \
+     KVS_FLAG_POWER_OF_TWO_BUCKETS)
+
+// Concurrent tables have a fixed bucket array and allocate from the heap,
+// their lookups take no locks and cannot see filter updates in order.
+
+#define KVS_CONCURRENT_EXCLUDED_FLAGS \
+    (KVS_FLAG_OPEN_ADDRESSING | KVS_FLAG_INCREMENTAL_RESIZE | \
+     KVS_FLAG_INLINE_VALUES | KVS_FLAG_COMPACT | KVS_FLAG_FILTER | \
+     KVS_FLAG_DEDUP)
+
+// Compact tables have a fixed bucket array of record indices.
+
+#define KVS_COMPACT_EXCLUDED_FLAGS \
+    (KVS_FLAG_OPEN_ADDRESSING | KVS_FLAG_INCREMENTAL_RESIZE | \
+     KVS_FLAG_INLINE_VALUES | KVS_FLAG_CONCURRENT | KVS_FLAG_DEDUP)
+
+// Shared values are kept apart from their entries.
+
+#define KVS_DEDUP_EXCLUDED_FLAGS (KVS_FLAG_INLINE_VALUES)
+
+// Chunked values are kept apart from their entries and are never shared.
+
+#define KVS_CHUNKED_EXCLUDED_FLAGS \
+    (KVS_FLAG_INLINE_VALUES | KVS_FLAG_COMPACT | KVS_FLAG_DEDUP)
+
+
+// ---------------------------------------------------------------------------
+// Open addressing control bytes and group width
+// ---------------------------------------------------------------------------
+//
+// Every slot of an open addressing table has a control byte.  The control byte
+// of a full slot holds the low seven bits of the key's hash value,  empty and
+// deleted slots are marked by control bytes with the high bit set.  Slots are
+// probed in aligned groups of KVS_OA_GROUP_WIDTH control bytes.
+
+#define KVS_OA_CTRL_EMPTY 0x80
+#define KVS_OA_CTRL_DELETED 0xFE
+
+#define KVS_OA_GROUP_WIDTH 16
+
+#define KVS_OA_NOT_FOUND (~(cardinal) 0)
+
+
+// ---------------------------------------------------------------------------
+// Slab size classes
+// ---------------------------------------------------------------------------
+//
+// Entries with inline values of up to KVS_INLINE_VALUE_LIMIT bytes are taken
+// from per-table slabs.  Block sizes are multiples of KVS_SLAB_CLASS_GRANULE,
+// every size class cuts its blocks from chunks of KVS_SLAB_CHUNK_SIZE bytes.
+
+#define KVS_SLAB_CLASS_GRANULE 16
+
+#define KVS_SLAB_CHUNK_SIZE (16*1024) /* 16 KBytes */
+
+#define KVS_SLAB_CLASS_INDEX(_size) \
+    (((_size) + KVS_SLAB_CLASS_GRANULE - 1) / KVS_SLAB_CLASS_GRANULE - 1)
+
+#define KVS_SLAB_CLASS_SIZE(_index) \
+    (((_index) + 1) * KVS_SLAB_CLASS_GRANULE)
+
+#define KVS_SLAB_CLASS_COUNT \
+    (KVS_SLAB_CLASS_INDEX(sizeof(kvs_entry_s) + KVS_INLINE_VALUE_LIMIT) + 1)
+
+
+// ---------------------------------------------------------------------------
+// Entry storage kinds
+// ---------------------------------------------------------------------------
+
+#define KVS_STORAGE_REFERENCE 0 /* value is owned by the client */
+#define KVS_STORAGE_COPY 1 /* value is a separate allocation */
+#define KVS_STORAGE_INLINE 2 /* value follows the entry */
+#define KVS_STORAGE_ARENA 3 /* value follows the entry in the table's arena */
+#define KVS_STORAGE_SHARED 4 /* value is shared in the table's value store */
+#define KVS_STORAGE_CHUNKED 5 /* value is a list of chunks */
+
 
 // ---------------------------------------------------------------------------
 // KVS table entry pointer type
@@ -82,1280 +316,10096 @@ typedef struct _kvs_entry_s *kvs_entry;
 // ---------------------------------------------------------------------------
 
 struct _kvs_entry_s {
-    kvs_key_t key; // unique 32 bit key
-     opaque_t value; // pointer to stored data
+    kvs_key_t key; // unique key
      cardinal size; // allocation size in bytes
+     opaque_t value; // pointer to stored data
     kvs_entry next;  // next entry in same bucket
+    kvs_entry clock_prev; // cache only: previous entry on the CLOCK ring
+    kvs_entry clock_next; // cache only: next entry on the CLOCK ring
+   kvs_time_t expires; // expiry deadline,  zero if the entry does not expire
+    kvs_entry timer_next; // next entry in the same timing wheel slot
+    kvs_entry *timer_link; // link to this entry,  NULL if not in the wheel
        word_t ref_count; // entry's reference count
       octet_t null_terminated; // must be true or false
       octet_t marked_for_removal; // must be true or false
+      octet_t storage; // KVS_STORAGE_REFERENCE, _COPY, _INLINE, _ARENA ...
+      octet_t referenced; // cache only: retrieved since the hand passed
+      octet_t data[0]; // inline value, if any
 };
 
 typedef struct _kvs_entry_s kvs_entry_s;
 
 
 // ---------------------------------------------------------------------------
-// KVS table type
+// KVS value chunk type
 // ---------------------------------------------------------------------------
+//
+// Values stored by copy in tables with chunked values  that are larger than
+// KVS_CHUNK_THRESHOLD bytes  are kept in a list of chunks of KVS_CHUNK_SIZE
+// bytes,  the last chunk holds the remainder.  The value field of the entry
+// then points to the first chunk.
 
-typedef struct /* kvs_table_s */ {
-     kvs_entry last_retrieved_entry;
-      cardinal entry_count;
-      cardinal bucket_count;
-     kvs_entry bucket[0];
-} kvs_table_s;
-
+struct _kvs_chunk_s; /* FORWARD */
 
-// ===========================================================================
-// P R I V A T E   F U N C T I O N   P R O T O T Y P E S   A N D   M A C R O S
-// ===========================================================================
+typedef struct _kvs_chunk_s *kvs_chunk;
 
-#define _kvs_set_status(_status_p,_code) \
-    { if (_status_p != NULL) *_status_p = _code; }
+struct _kvs_chunk_s {
+    kvs_chunk next; // next chunk of the same value,  NULL if last
+     cardinal size; // bytes of the value in this chunk
+      octet_t data[0]; // bytes of the value
+};
 
-static kvs_entry _kvs_find_entry
-    (kvs_table_t table, kvs_key_t key, kvs_status_t *status);
+typedef struct _kvs_chunk_s kvs_chunk_s;
 
-static fmacro cardinal _kvs_calc_null_terminated_data_size
-    (kvs_data_t data);
 
-static fmacro kvs_entry _kvs_new_entry_with_copy
-    (kvs_key_t key, kvs_data_t value, cardinal size,
-     bool null_terminated, kvs_status_t *status);
+// ---------------------------------------------------------------------------
+// Size of an entry built in an arena
+// ---------------------------------------------------------------------------
+//
+// Entries built in an arena are followed by their value  and  are padded to
+// the alignment of the entry type.
 
-static fmacro kvs_entry _kvs_new_entry_with_ref
-    (kvs_key_t key, kvs_data_t value, cardinal size,
-     bool null_terminated, kvs_status_t *status);
+#define KVS_ARENA_ENTRY_SIZE(_size) \
+    ((sizeof(kvs_entry_s) + (_size) + __alignof__(kvs_entry_s) - 1) & \
+     ~(size_t) (__alignof__(kvs_entry_s) - 1))
 
-static fmacro kvs_data_t _kvs_retrieve_copy
-    (kvs_entry_s *entry, kvs_status_t *status);
 
-static fmacro void _kvs_dispose_entry
-    (kvs_entry entry, kvs_status_t *status);
+// ---------------------------------------------------------------------------
+// KVS open addressing slot type
+// ---------------------------------------------------------------------------
+//
+// The key is duplicated in the slot so that a probe does not need to follow
+// the entry pointer unless the key matches.
 
+typedef struct /* kvs_slot_s */ {
+    kvs_key_t key; // key of the entry in this slot
+    kvs_entry entry; // entry in this slot, NULL if slot is not full
+} kvs_slot_s;
 
-// ===========================================================================
-// P U B L I C   F U N C T I O N   I M P L E M E N T A T I O N S
-// ===========================================================================
 
 // ---------------------------------------------------------------------------
-// function:  kvs_new_table( size, status )
+// KVS compact entry types
 // ---------------------------------------------------------------------------
 //
-// Creates  and returns  a new KVS table object with <size> number of buckets.
-// If  zero is passed in <size>,  then  the new table will be created with the
-// default table size  as  defined  by  KVS_DEFAULT_TABLE_SIZE.  Returns  NULL
-// if the KVS table object could not be created.
+// Compact tables keep their entries in fixed size records,  allocated in
+// chunks of KVS_COMPACT_CHUNK_SIZE records.  Records are numbered across
+// chunks from one,  index zero stands for no record.  Buckets and chains link
+// records by index,  and free records are linked through their next field.
+// Chunks never move,  pointers to records remain valid while the record is in
+// use.  The reference count of an entry is kept in the bits of its state above
+// the flags.
 
-// The status of the operation  is passed back in <status>,  unless  NULL  was
-// passed in for <status>.
+#define KVS_COMPACT_CHUNK_BITS 12
 
-kvs_table_t kvs_new_table(cardinal size, kvs_status_t *status) {
+#define KVS_COMPACT_CHUNK_SIZE (1 << KVS_COMPACT_CHUNK_BITS)
 
-    cardinal index, bucket_count;
-    kvs_table_s *new_table;
-    
-    // determine table size
-    if (size == 0) bucket_count = KVS_DEFAULT_TABLE_SIZE;
-    else bucket_count = size;
-    
-    // allocate table base
-    new_table =
-        ALLOCATE(sizeof(kvs_table_s) + sizeof(kvs_entry) * (bucket_count - 1));
-    
-    // exit if allocation failed
-    if (new_table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
-        return NULL;
-    } // end if
-    
-    // initialise table meta data
-    new_table->last_retrieved_entry = NULL;
-    new_table->entry_count = 0;
-    new_table->bucket_count = bucket_count;
-    
-    // initialise buckets with NULL pointers
-    for (index = 0; index < bucket_count; index++) {
-        new_table->bucket[index] = NULL;
-    } // end for
-    
-    // set status
-    _kvs_set_status(status, KVS_STATUS_SUCCESS);
-    
-    // return a reference to the new table
-    return (kvs_table_t) new_table;
-} // end kvs_new_table
+#define KVS_COMPACT_NULL_TERMINATED 0x1 /* value is null-terminated */
+#define KVS_COMPACT_MARKED 0x2 /* entry is marked for removal */
+#define KVS_COMPACT_COPY 0x4 /* value is owned by the table */
+#define KVS_COMPACT_REF_ONE 0x8 /* reference count of one */
+
+typedef struct /* kvs_compact_entry_s */ {
+    kvs_key_t key; // unique key,  zero if the record is free
+     uint32_t next; // index of next record in same bucket or free list
+     cardinal size; // size of the value in bytes
+     uint32_t state; // reference count times KVS_COMPACT_REF_ONE plus flags
+     opaque_t value; // pointer to stored data
+} kvs_compact_entry_s;
+
+typedef struct /* kvs_compact_s */ {
+             uint32_t *bucket; // bucket array of record indices
+  kvs_compact_entry_s **chunk; // chunks of records
+             cardinal chunk_count; // number of chunks allocated
+             cardinal chunk_capacity; // size of the chunk pointer array
+             uint32_t free_list; // first free record,  zero if none
+             uint32_t unused; // first record never used,  zero if none left
+} kvs_compact_s;
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_store_value( table, key, val, size, null_terminated, stat )
+// KVS slab allocator types
+// ---------------------------------------------------------------------------
+
+struct _kvs_slab_chunk_s; /* FORWARD */
+
+typedef struct _kvs_slab_chunk_s kvs_slab_chunk_s;
+
+struct _kvs_slab_chunk_s {
+    kvs_slab_chunk_s *next; // next chunk of the same slab
+                 void *align[0]; // pointer alignment for blocks
+              octet_t block[0]; // blocks of a single size class
+};
+
+typedef struct /* kvs_slab_class_s */ {
+         void *free_list; // released blocks, linked through first word
+      octet_t *next_free; // next unused block in current chunk
+      cardinal bytes_left; // unused bytes in current chunk
+} kvs_slab_class_s;
+
+typedef struct /* kvs_slab_s */ {
+    kvs_slab_chunk_s *chunk_list; // all chunks of all size classes
+    kvs_slab_class_s size_class[KVS_SLAB_CLASS_COUNT];
+} kvs_slab_s;
+
+
+// ---------------------------------------------------------------------------
+// Snapshot table marker
 // ---------------------------------------------------------------------------
 //
-// Adds a new entry  for key <key>  to table <table>.  The new entry is stored
-// by value.  Data is copied from the address passed in as <value>.  If <size>
-// is not zero, then <size> number of bytes are copied.  If <size> is zero and
-// <null_terminated> is true, then data will be copied up to and including the
-// first zero-value byte encountered.  If <size> is zero and <null_terminated>
-// is false,  then the operation will fail and no entry will be added.  If the
-// operation succeeds,  then the initial reference count of the new entry will
-// be set to one.
+// Tables opened from a snapshot file carry this flag.  It is not a public
+// flag and is rejected by kvs_new_table_with_flags().
+
+#define KVS_TABLE_SNAPSHOT (1u << 31)
+
+
+// ---------------------------------------------------------------------------
+// Cache table marker
+// ---------------------------------------------------------------------------
 //
-// Keys must be unique.  Existing entries are not replaced.  Duplicate entries
-// are not added.  The  status  of  the operation  is passed back in <status>,
-// unless NULL was passed in for <status>.
+// Tables created by kvs_new_cache() carry this flag.  It is not a public flag
+// and is rejected by kvs_new_table_with_flags().
 
-void kvs_store_value(kvs_table_t table,
-                       kvs_key_t key,
-                      kvs_data_t value,
-                        cardinal size,
-                       bool null_terminated,
-                    kvs_status_t *status) {
-    cardinal index;
-    kvs_table_s *this_table = (kvs_table_s *) table;
-    kvs_entry_s *new_entry = NULL;
-    kvs_entry_s *this_entry = NULL;
-    kvs_status_t _status;
-   
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return;
-    } // end if
-    
-    // key must not be zero
-    if (key == 0) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
-        return;
-    } // end if
-    
-    // value must not be NULL
-    if (value == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
-        return;
-    } // end if
-    
-    // size must not be NULL if data is not null-terminated
-    if ((size == 0) && (null_terminated == false)) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
-        return;
-    } // end if
-    
-    if /* size unknown */ (size == 0) {
-        if /* data is null-terminated */ (null_terminated) {
-            // calculate size
-            size = _kvs_calc_null_terminated_data_size(value);
-            if (size == 0) {
-                _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
-                return;
-            } // end if
-        }
-        else /* data is not null-terminated */ {
-            _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
-            return;
-        } // end if
-    } // end if
-    
-    // calculate the bucket index for key
-    index = key % this_table->bucket_count;
+#define KVS_TABLE_CACHE (1u << 30)
 
-    if /* bucket is empty */ (this_table->bucket[index] == NULL) {
-        
-        // create a new entry
-        new_entry =
-        _kvs_new_entry_with_copy(key, value, size, null_terminated, &_status);
+
+// ---------------------------------------------------------------------------
+// Frozen table marker
+// ---------------------------------------------------------------------------
+//
+// Tables returned by kvs_snapshot() carry this flag.  It is not a public flag
+// and is rejected by kvs_new_table_with_flags().  Like snapshot tables,  they
+// cannot be modified.
+
+#define KVS_TABLE_FROZEN (1u << 29)
+
+#define KVS_TABLE_READ_ONLY (KVS_TABLE_SNAPSHOT | KVS_TABLE_FROZEN)
+
+
+// ---------------------------------------------------------------------------
+// Snapshot file layout
+// ---------------------------------------------------------------------------
+//
+// A snapshot file consists of a header,  an array of bucket_count + 1 record
+// indices,  an array of entry_count records  and the value bytes.  The records
+// of bucket i are those from index start[i] up to but excluding start[i+1].
+// Buckets are selected by the seeded key hash of the table that was saved,
+// masked by bucket_count - 1.  All locations are byte offsets from the start
+// of the file,  values are aligned to KVS_SNAPSHOT_ALIGNMENT.  Integers are
+// stored in host byte order,  a snapshot can only be opened on a host with
+// the same byte order  which the magic number serves to detect.  The header
+// records the key size,  which must match the key width of the build.  If any
+// entry expires,  the records are followed by an array of entry_count expiry
+// deadlines,  64-bit counts of milliseconds of the real time clock,  zero for
+// entries that do not expire.  Version 1 headers end before expires_offset,
+// version 1 snapshots have no deadlines.
+
+#define KVS_SNAPSHOT_MAGIC 0x31504e5353564b00ULL /* "\0KVSSNP1" */
+
+#define KVS_SNAPSHOT_VERSION 2
+
+#define KVS_SNAPSHOT_ALIGNMENT 16
+
+#define KVS_SNAPSHOT_ALIGN(_offset) \
+    (((_offset) + KVS_SNAPSHOT_ALIGNMENT - 1) & \
+     ~(uint64_t) (KVS_SNAPSHOT_ALIGNMENT - 1))
+
+typedef struct /* kvs_snapshot_header_s */ {
+    uint64_t magic; // KVS_SNAPSHOT_MAGIC
+    uint32_t version; // KVS_SNAPSHOT_VERSION
+    uint32_t bucket_count; // always a power of two
+    uint32_t entry_count;
+    uint32_t key_size; // size of a key in bytes,  zero for four
+    uint64_t seed; // seed of the key hash
+    uint64_t start_offset; // offset of the record index array
+    uint64_t record_offset; // offset of the record array
+    uint64_t value_offset; // offset of the first value
+    uint64_t file_size; // total size of the file in bytes
+    uint64_t expires_offset; // offset of the deadlines,  zero if none
+    uint64_t reserved; // zero,  pads the header to the alignment
+} kvs_snapshot_header_s;
+
+typedef struct /* kvs_snapshot_record_s */ {
+    uint64_t value_offset; // offset of the value bytes
+    kvs_key_t key;
+    uint32_t size; // value size in bytes
+     octet_t null_terminated; // must be true or false
+     octet_t reserved[7];
+} kvs_snapshot_record_s;
+
+// The entries to be saved are gathered into items by iteration first,  so that
+// saving does not depend on the storage scheme of the table.  Entries whose
+// values are kept in chunks are pinned and their chunks written in place.
+
+typedef struct /* kvs_snapshot_item_s */ {
+     kvs_key_t key;
+      cardinal size; // value size in bytes,  zero if unknown
+          bool null_terminated;
+    kvs_time_t expires; // expiry deadline,  zero if the entry does not expire
+    kvs_data_t value; // value bytes in the table,  NULL if chunked
+     kvs_entry entry; // pinned entry of a chunked value,  NULL otherwise
+} kvs_snapshot_item_s;
+
+
+// ---------------------------------------------------------------------------
+// Write-ahead log record layout
+// ---------------------------------------------------------------------------
+//
+// A log file is a sequence of records,  each a header followed by <size>
+// value bytes.  Removal records carry no value.  The checksum covers the
+// header fields after it and the value bytes,  the first record that is
+// incomplete or fails its checksum marks the end of the log.  Integers are
+// stored in host byte order.  Keys are stored at the key width of the build,
+// a log can only be replayed by a build of the same key width.  The bytes of
+// a store of an entry that expires begin with its deadline,  a 64-bit count
+// of milliseconds of the real time clock,  followed by the value.
+
+#define KVS_LOG_RECORD_STORE 1
+
+#define KVS_LOG_RECORD_REMOVE 2
+
+#define KVS_LOG_RECORD_STORE_EXPIRING 3
+
+typedef struct /* kvs_log_record_s */ {
+    uint32_t checksum; // FNV-1a of the remaining header and the value
+   kvs_key_t key;
+    uint32_t size; // value size in bytes,  zero for removals
+     octet_t type; // KVS_LOG_RECORD_STORE,  _REMOVE or _STORE_EXPIRING
+     octet_t null_terminated; // must be true or false
+     octet_t reserved[2];
+} kvs_log_record_s;
+
+
+// ---------------------------------------------------------------------------
+// KVS write-ahead log type
+// ---------------------------------------------------------------------------
+//
+// Records are appended to a buffer  which is written to the file  when it is
+// full or when the log is synced.  With a commit window of zero,  the log is
+// synced after every record.  Otherwise a flusher thread syncs the log once
+// per window  if records have been appended,  or without thread support,  the
+// first record appended after the window has elapsed does so.
+
+typedef struct /* kvs_log_s */ {
+           int fd; // log file,  opened for appending
+       octet_t *buffer; // records not yet written
+      cardinal fill; // number of bytes in buffer
+      cardinal window; // commit window in microseconds
+      uint64_t last_sync; // time of the last sync in microseconds
+          bool dirty; // records have been appended since the last sync
+          bool failed; // a write or sync has failed,  the log is unusable
+          bool stop; // the flusher thread is to terminate
+          bool has_flusher; // a flusher thread is running
+#if KVS_USE_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t flusher;
+#endif
+} kvs_log_s;
+
+
+// ---------------------------------------------------------------------------
+// KVS timing wheel type
+// ---------------------------------------------------------------------------
+//
+// Expiry deadlines are kept in a hierarchical timing wheel of KVS_WHEEL_LEVELS
+// levels of KVS_WHEEL_SLOTS slots each,  one tick being a millisecond.  Slot i
+// of level l holds the entries due within the span of 64^l ticks that starts
+// at the next tick whose bits l*6 to l*6+5 equal i.  When the wheel reaches
+// the start of that span,  the slot is cascaded  into the levels below.  Every
+// level has a bitmap of its occupied slots,  from which the next tick at which
+// anything is due  is found without visiting empty slots.  Deadlines beyond
+// the span of the wheel are cascaded at its end and placed again.
+
+#define KVS_WHEEL_BITS 6
+
+#define KVS_WHEEL_SLOTS (1 << KVS_WHEEL_BITS)
+
+#define KVS_WHEEL_LEVELS 6
+
+#define KVS_WHEEL_SPAN ((kvs_time_t) 1 << (KVS_WHEEL_BITS * KVS_WHEEL_LEVELS))
+
+typedef struct /* kvs_wheel_s */ {
+    kvs_time_t now; // all deadlines up to and including now have been reaped
+      uint64_t occupied[KVS_WHEEL_LEVELS]; // bitmap of non-empty slots
+     kvs_entry slot[KVS_WHEEL_LEVELS][KVS_WHEEL_SLOTS]; // lists of entries
+} kvs_wheel_s;
+
+
+// ---------------------------------------------------------------------------
+// KVS filter type
+// ---------------------------------------------------------------------------
+//
+// The lookup filter is a blocked counting Bloom filter.  Every key selects one
+// block of a cache line  by the high bits of its hash  and  KVS_FILTER_PROBES
+// four bit counters within the block  by consecutive bytes of the low bits.
+// A key can only be in the table if all of its counters are non-zero.  A
+// counter that has reached its maximum is never decremented again,  so that a
+// removal cannot clear a counter still needed by another key.
+
+#define KVS_FILTER_PROBES 4
+
+#define KVS_FILTER_BLOCK_WORDS (KVS_CACHE_LINE_SIZE / sizeof(uint64_t))
+
+#define KVS_FILTER_BLOCK_COUNTERS (KVS_FILTER_BLOCK_WORDS * 16)
+
+#define KVS_FILTER_COUNTER_MAX 0xF
+
+typedef struct /* kvs_filter_s */ {
+      uint64_t *counter; // blocks of sixteen counters per word
+      cardinal block_mask; // number of blocks - 1,  a power of two
+          void *block; // unaligned allocation holding the counters
+      uint64_t rejections; // lookups rejected
+      uint64_t false_positives; // lookups passed that found no entry
+} kvs_filter_s;
+
+
+// ---------------------------------------------------------------------------
+// KVS value store types
+// ---------------------------------------------------------------------------
+//
+// Tables that deduplicate their values keep every distinct value  stored by
+// copy  once  in a value store,  a separately chained hash table of values
+// keyed by their content.  Every value counts the entries sharing it.  The
+// entries point to the data of their value,  which follows the value header.
+// The store doubles its buckets when it holds more values than buckets.
+
+#define KVS_VALUE_STORE_INITIAL_SIZE 64
+
+struct _kvs_shared_s; /* FORWARD */
+
+typedef struct _kvs_shared_s *kvs_shared;
+
+struct _kvs_shared_s {
+    kvs_shared next; // next value in same bucket
+      uint64_t hash; // hash of the value's content
+      cardinal size; // size of the value in bytes
+      cardinal share_count; // number of entries sharing the value
+       octet_t data[0]; // the value
+};
+
+typedef struct _kvs_shared_s kvs_shared_s;
+
+typedef struct /* kvs_value_store_s */ {
+    kvs_shared *bucket; // bucket array
+      cardinal bucket_count; // number of buckets,  a power of two
+      cardinal value_count; // number of distinct values
+} kvs_value_store_s;
+
+
+// ---------------------------------------------------------------------------
+// KVS concurrency types
+// ---------------------------------------------------------------------------
+//
+// Every reader stripe counts the readers in each of the three epochs which can
+// be active at any time.  Entries unlinked during an epoch are kept in the
+// limbo list of that epoch  until no reader can hold a pointer to them.  If a
+// limbo list cannot grow,  the entry goes to the overflow list of the epoch
+// instead,  linked through its timer_next field,  which is otherwise unused
+// in concurrent tables as their entries cannot expire.
+
+typedef cardinal kvs_epoch_t; // reader stripe * 3 + epoch
+
+typedef struct /* kvs_reader_stripe_s */ {
+      cardinal active[3]; // number of readers in each epoch
+       octet_t padding[KVS_CACHE_LINE_SIZE - 3 * sizeof(cardinal)];
+} kvs_reader_stripe_s;
+
+typedef struct /* kvs_concurrency_s */ {
+    kvs_reader_stripe_s reader[KVS_EPOCH_STRIPES]; // cache line aligned
+      cardinal epoch; // global epoch counter
+       octet_t padding[KVS_CACHE_LINE_SIZE - sizeof(cardinal)];
+          void *block; // unaligned allocation holding this structure
+     kvs_entry *limbo[3]; // entries retired in each epoch
+      cardinal limbo_count[3];
+      cardinal limbo_size[3];
+     kvs_entry limbo_overflow[3]; // retired when the limbo list could not grow
+#if KVS_USE_THREADS
+    pthread_mutex_t limbo_lock;
+    pthread_mutex_t bucket_lock[KVS_LOCK_STRIPES];
+#endif
+} kvs_concurrency_s;
+
+
+// ---------------------------------------------------------------------------
+// KVS table type
+// ---------------------------------------------------------------------------
+//
+// Chained tables keep their buckets in a separately allocated bucket array.
+// While a resizable table grows,  its chains are migrated bucket by bucket from
+// the old bucket array into the new one.  Old buckets with an index lower than
+// migrated_count have been migrated,  all others are still in use.
+//
+// Open addressing tables keep their slots and control bytes  in separately
+// allocated arrays,  which are replaced when the table grows,  bucket_count
+// then holds the number of slots.
+//
+// Compact tables keep their bucket array of record indices  and  their records
+// in a separately allocated structure,  their bucket pointer array is NULL.
+//
+// Non-concurrent chained tables move entries marked for removal  out of their
+// chains  into a graveyard,  a separately allocated array of buckets  which
+// is allocated with the first such entry  and doubled whenever it holds as
+// many entries as buckets.
+
+#define KVS_GRAVEYARD_INITIAL_SIZE 16
+
+struct _kvs_frozen_s; /* FORWARD */
+
+typedef struct /* kvs_table_s */ {
+   kvs_flags_t flags;
+     kvs_entry *hot; // hot entry cache,  direct-mapped by key
+      cardinal hot_mask; // number of hot cache slots - 1
+     kvs_entry hot_single; // the slot of a hot cache of one slot
+      cardinal entry_count;
+      cardinal bucket_count;
+     kvs_entry *bucket; // chained only: bucket array
+     kvs_entry *old_bucket; // chained only: bucket array being migrated
+      cardinal old_bucket_count; // chained only: size of old bucket array
+      cardinal migrated_count; // chained only: old buckets migrated so far
+       octet_t *ctrl; // open addressing only: control bytes
+    kvs_slot_s *slot; // open addressing only: slots
+      cardinal growth_left; // open addressing only: free slots until rehash
+    kvs_slab_s *slab; // inline values only: slab for small entries
+    kvs_concurrency_s *cc; // concurrent only: locks and epochs
+      uint64_t seed; // random seed of the key hash
+ const octet_t *snapshot; // snapshot only: mapped snapshot file
+        size_t snapshot_size; // snapshot only: size of snapshot file
+     kvs_log_s *log; // write-ahead log or NULL
+     kvs_entry clock_hand; // cache only: next entry the CLOCK hand visits
+        size_t byte_budget; // cache only: bytes held before evicting
+        size_t bytes_used; // cache only: bytes held by entries
+      uint64_t hits; // cache only: retrievals that found an entry
+      uint64_t misses; // cache only: retrievals that found no entry
+      uint64_t evictions; // cache only: entries evicted
+      uint64_t lookups; // stats only: searches for a key
+      uint64_t compares; // stats only: entries compared by searches
+      uint64_t hot_hits; // stats only: searches answered by the hot cache
+   kvs_wheel_s *wheel; // expiry deadlines,  NULL until an entry expires
+ kvs_compact_s *compact; // compact only: records and bucket indices
+  kvs_filter_s *filter; // filter only: lookup filter
+       octet_t *arena; // bulk built only: entries built with the table
+        size_t arena_size; // bulk built only: bytes of the arena
+        size_t arena_live; // bulk built only: bytes of live arena entries
+        size_t arena_fill; // bulk built only: bytes filled by compaction
+       octet_t *old_arena; // bulk built only: arena compacted into the arena
+        size_t old_arena_size; // bulk built only: bytes of the old arena
+        size_t old_arena_live; // bulk built only: bytes of its live entries
+ kvs_value_store_s *values; // dedup only: values shared by content
+     kvs_entry *grave; // chained only: graveyard of entries marked for removal
+      cardinal grave_mask; // number of graveyard buckets - 1
+      cardinal grave_count; // number of entries in the graveyard
+      cardinal sweep_index; // next bucket visited by kvs_compact()
+ struct _kvs_frozen_s *frozen; // snapshots of the table,  or frozen state
+} kvs_table_s;
+
+
+// ---------------------------------------------------------------------------
+// KVS frozen table type
+// ---------------------------------------------------------------------------
+//
+// A table returned by kvs_snapshot() shares the bucket array and entries of
+// the table it was taken of,  its origin,  and keeps one bit per bucket that
+// is set while the bucket is still shared.  Before the origin changes a
+// shared bucket,  or replaces its bucket array,  it saves a copy of the
+// entries visible in the bucket to the saved chain of the bucket in every
+// snapshot still sharing it,  then clears the bit.  Saved chains are never
+// changed again,  they can be read without a lock.  Shared buckets are read
+// under the lock of the origin bucket.  The snapshots of a table are linked
+// through their next field,  the list is changed under all bucket locks.
+//
+// Lookups and iteration copy the fields they need from entries of a shared
+// bucket into items under the lock,  iteration up to KVS_FROZEN_BATCH_SIZE
+// entries at a time.  Entries are never copied whole,  readers of a
+// concurrent origin change their reference counts without the lock.
+
+#define KVS_FROZEN_BATCH_SIZE 16
+
+typedef struct /* kvs_frozen_item_s */ {
+     kvs_key_t key;
+      opaque_t value;
+      cardinal size;
+       octet_t null_terminated;
+    kvs_time_t expires;
+} kvs_frozen_item_s;
+
+typedef struct _kvs_frozen_s kvs_frozen_s;
+
+struct _kvs_frozen_s {
+    kvs_frozen_s *next; // next snapshot of the same origin
+     kvs_table_s *origin; // table the snapshot was taken of,  or NULL
+     kvs_table_s *table; // the snapshot table itself
+        uint64_t *shared; // one bit per bucket still shared with the origin
+       kvs_entry *saved; // chains saved before the origin changed them
+        cardinal shared_count; // number of buckets still shared
+};
+
+
+// ---------------------------------------------------------------------------
+// KVS iteration type
+// ---------------------------------------------------------------------------
+//
+// Iteration visits a range of buckets.  Chained tables number the old buckets
+// not yet migrated first,  then the buckets of the current bucket array.  Open
+// addressing tables number their slots,  snapshot tables their records.  An
+// entry whose value is kept in chunks is passed to the chunked action,  if
+// any,  instead of as a copy to the action.  The chunked action returns true
+// if it visited the entry.  The expiry deadline of the entry passed to the
+// action is held in the range while the action is called.
+
+typedef bool (*kvs_chunked_action_f)(kvs_entry, void *);
+
+typedef struct /* kvs_foreach_s */ {
+           kvs_table_s *table;
+          kvs_action_f action;
+  kvs_chunked_action_f chunked; // action for chunked entries,  or NULL
+                  void *context;
+              cardinal first; // first bucket of the range
+              cardinal last; // bucket after the last of the range
+              cardinal count; // entries visited
+            kvs_time_t expires; // deadline of the entry passed to the action
+          kvs_status_t status; // allocation failed if a copy could not be made
+#if KVS_USE_THREADS
+             pthread_t thread;
+                  bool has_thread;
+#endif
+} kvs_foreach_s;
+
+
+// ---------------------------------------------------------------------------
+// KVS snapshot gathering type
+// ---------------------------------------------------------------------------
+//
+// The items of the entries to be saved by kvs_save_snapshot()  are gathered
+// by iteration into an array allocated for the entry count of the table.
+
+typedef struct /* kvs_snapshot_gather_s */ {
+            kvs_table_s *table; // table whose entries are gathered
+    const kvs_foreach_s *range; // range visited to gather the entries
+    kvs_snapshot_item_s *item; // items gathered so far
+               cardinal capacity; // number of items allocated
+               cardinal count; // number of items gathered
+} kvs_snapshot_gather_s;
+
+
+// ===========================================================================
+// P R I V A T E   F U N C T I O N   P R O T O T Y P E S   A N D   M A C R O S
+// ===========================================================================
+
+#define _kvs_set_status(_status_p,_code) \
+    { if (_status_p != NULL) *_status_p = _code; }
+
+#if KVS_USE_STATS
+#define _kvs_stats_lookup(_table,_compared) \
+    { __atomic_fetch_add(&(_table)->lookups, 1, __ATOMIC_RELAXED); \
+      __atomic_fetch_add(&(_table)->compares, (_compared), __ATOMIC_RELAXED); }
+
+#define _kvs_stats_hot_hit(_table) \
+    { __atomic_fetch_add(&(_table)->lookups, 1, __ATOMIC_RELAXED); \
+      __atomic_fetch_add(&(_table)->hot_hits, 1, __ATOMIC_RELAXED); }
+#else
+#define _kvs_stats_lookup(_table,_compared) { (void) (_compared); }
+
+#define _kvs_stats_hot_hit(_table) { }
+#endif
+
+static kvs_entry _kvs_find_entry
+    (kvs_table_t table, kvs_key_t key, kvs_status_t *status);
+
+static fmacro kvs_entry *_kvs_bucket_for_key
+    (kvs_table_s *table, kvs_key_t key);
+
+static void _kvs_start_resize(kvs_table_s *table);
+
+static void _kvs_migrate_buckets(kvs_table_s *table, cardinal count);
+
+static void _kvs_prefetch_group
+    (kvs_table_s *table, const kvs_key_t *keys, cardinal count);
+
+static kvs_entry _kvs_cc_find_entry
+    (kvs_table_s *table, kvs_key_t key, kvs_status_t *status);
+
+static void _kvs_remove
+    (kvs_table_s *table, kvs_key_t key, kvs_entry expected,
+     kvs_status_t *status);
+
+static void _kvs_unlink_entry
+    (kvs_table_s *table, kvs_entry *bucket, kvs_entry prev, kvs_entry entry,
+     kvs_status_t *status);
+
+static fmacro bool _kvs_pin_entry(kvs_table_s *table, kvs_entry entry);
+
+static fmacro cardinal _kvs_unpin_entry(kvs_table_s *table, kvs_entry entry);
+
+static fmacro bool _kvs_unpin_last(kvs_table_s *table, kvs_entry entry);
+
+static fmacro bool _kvs_is_marked(kvs_entry entry);
+
+static fmacro cardinal _kvs_ref_count(kvs_entry entry);
+
+static kvs_concurrency_s *_kvs_cc_new(void);
+
+static void _kvs_cc_dispose(kvs_table_s *table);
+
+static fmacro kvs_epoch_t _kvs_read_begin(kvs_table_s *table);
+
+static fmacro void _kvs_read_end(kvs_table_s *table, kvs_epoch_t token);
+
+static fmacro void _kvs_lock_bucket(kvs_table_s *table, kvs_entry *bucket);
+
+static fmacro void _kvs_unlock_bucket(kvs_table_s *table, kvs_entry *bucket);
+
+static void _kvs_lock_all(kvs_table_s *table);
+
+static void _kvs_unlock_all(kvs_table_s *table);
+
+static void _kvs_retire_entry(kvs_table_s *table, kvs_entry entry);
+
+static void _kvs_add_entry
+    (kvs_table_s *table, kvs_key_t key, kvs_data_t value, cardinal size,
+     bool null_terminated, bool by_copy, kvs_time_t expires,
+     kvs_status_t *status);
+
+static fmacro uint64_t _kvs_hash(kvs_table_s *table, kvs_key_t key);
+
+static fmacro cardinal _kvs_bucket_index
+    (kvs_table_s *table, kvs_key_t key, cardinal bucket_count);
+
+static uint64_t _kvs_new_seed(kvs_table_s *table);
+
+static fmacro uint32_t _kvs_oa_match_byte
+    (const octet_t *group, octet_t byte);
+
+static fmacro uint32_t _kvs_oa_match_free(const octet_t *group);
+
+static bool _kvs_oa_allocate_slots
+    (cardinal capacity, octet_t **ctrl, kvs_slot_s **slot);
+
+static cardinal _kvs_oa_find_slot(kvs_table_s *table, kvs_key_t key);
+
+static cardinal _kvs_oa_find_free_slot
+    (octet_t *ctrl, cardinal capacity, uint64_t hash);
+
+static bool _kvs_oa_rehash(kvs_table_s *table, cardinal capacity);
+
+static void _kvs_oa_add_entry
+    (kvs_table_s *table, kvs_key_t key, kvs_data_t value, cardinal size,
+     bool null_terminated, bool by_copy, kvs_time_t expires,
+     kvs_status_t *status);
+
+static void _kvs_oa_remove_entry
+    (kvs_table_s *table, kvs_key_t key, kvs_status_t *status);
+
+static fmacro cardinal _kvs_calc_null_terminated_data_size
+    (kvs_data_t data);
+
+static fmacro kvs_entry _kvs_new_entry_with_copy
+    (kvs_table_s *table, kvs_key_t key, kvs_data_t value, cardinal size,
+     bool null_terminated, kvs_status_t *status);
+
+static fmacro kvs_entry _kvs_new_entry_with_ref
+    (kvs_key_t key, kvs_data_t value, cardinal size,
+     bool null_terminated, kvs_status_t *status);
+
+static fmacro kvs_data_t _kvs_retrieve_copy
+    (kvs_entry_s *entry, kvs_status_t *status);
+
+static fmacro void _kvs_dispose_entry
+    (kvs_table_s *table, kvs_entry entry, kvs_status_t *status);
+
+static kvs_chunk _kvs_chunks_new(const octet_t *value, cardinal size);
+
+static void _kvs_chunks_dispose(kvs_chunk chunk);
+
+static kvs_slab_s *_kvs_slab_new(void);
+
+static void *_kvs_slab_allocate(kvs_slab_s *slab, cardinal size);
+
+static void _kvs_slab_release(kvs_slab_s *slab, void *block, cardinal size);
+
+static void _kvs_slab_dispose(kvs_slab_s *slab);
+
+static kvs_snapshot_item_s *_kvs_snapshot_collect
+    (kvs_table_s *table, cardinal *count, kvs_status_t *status);
+
+static void _kvs_snapshot_gather
+    (kvs_key_t key, kvs_data_t value, cardinal size, bool null_terminated,
+     void *gather_p);
+
+static bool _kvs_snapshot_gather_chunked(kvs_entry entry, void *gather_p);
+
+static void _kvs_snapshot_release
+    (kvs_table_s *table, kvs_snapshot_item_s *item, cardinal count);
+
+static bool _kvs_snapshot_write(FILE *file, const void *data, size_t size);
+
+static bool _kvs_snapshot_write_chunks
+    (FILE *file, kvs_chunk chunk, size_t size);
+
+static const octet_t *_kvs_snapshot_map
+    (const char *path, size_t *size, kvs_status_t *status);
+
+static void _kvs_snapshot_unmap(const octet_t *snapshot, size_t size);
+
+static bool _kvs_snapshot_is_valid(const octet_t *snapshot, size_t size);
+
+static fmacro const uint64_t *_kvs_snapshot_deadlines(const octet_t *snapshot);
+
+static const kvs_snapshot_record_s *_kvs_snapshot_find
+    (kvs_table_s *table, kvs_key_t key, kvs_status_t *status);
+
+static kvs_data_t _kvs_snapshot_get_entry
+    (kvs_table_s *table, bool copy, kvs_key_t key, cardinal *size,
+     bool *null_terminated, kvs_status_t *status);
+
+static bool _kvs_snapshot_load
+    (kvs_table_s *table, kvs_table_s *snapshot, kvs_status_t *status);
+
+static kvs_log_s *_kvs_log_open
+    (const char *path, cardinal window, kvs_status_t *status);
+
+static bool _kvs_log_close(kvs_log_s *log);
+
+static bool _kvs_log_append
+    (kvs_log_s *log, octet_t type, kvs_key_t key, const void *value,
+     cardinal size, bool null_terminated, kvs_time_t expires);
+
+static bool _kvs_log_commit(kvs_log_s *log);
+
+static bool _kvs_log_truncate(const char *path, uint64_t length);
+
+static uint32_t _kvs_log_checksum
+    (const kvs_log_record_s *record, const uint64_t *deadline,
+     const void *value, cardinal size);
+
+static fmacro void _kvs_cache_insert(kvs_table_s *table, kvs_entry entry);
+
+static fmacro void _kvs_cache_unlink(kvs_table_s *table, kvs_entry entry);
+
+static fmacro void _kvs_cache_count(kvs_table_s *table, kvs_entry entry);
+
+static void _kvs_cache_evict(kvs_table_s *table, kvs_key_t keep);
+
+static fmacro size_t _kvs_cache_charge(kvs_entry entry);
+
+static kvs_entry _kvs_locate_entry
+    (kvs_table_s *table, kvs_key_t key, kvs_status_t *status);
+
+static kvs_entry _kvs_expire_entry
+    (kvs_table_s *table, kvs_entry entry, kvs_status_t *status);
+
+static fmacro kvs_time_t _kvs_deadline(kvs_time_t ttl);
+
+static kvs_time_t _kvs_wall_clock(void);
+
+static kvs_time_t _kvs_wall_deadline(kvs_time_t expires);
+
+static kvs_time_t _kvs_local_deadline(kvs_time_t deadline);
+
+static kvs_wheel_s *_kvs_wheel_new(void);
+
+static void _kvs_wheel_insert(kvs_wheel_s *wheel, kvs_entry entry);
+
+static void _kvs_wheel_unlink(kvs_wheel_s *wheel, kvs_entry entry);
+
+static kvs_entry _kvs_wheel_take
+    (kvs_wheel_s *wheel, cardinal level, cardinal index);
+
+static bool _kvs_wheel_next(kvs_wheel_s *wheel, kvs_time_t *tick);
+
+static cardinal _kvs_wheel_advance(kvs_table_s *table, kvs_time_t now);
+
+static cardinal _kvs_foreach_bucket_count(kvs_table_s *table);
+
+static fmacro kvs_entry _kvs_foreach_head(kvs_table_s *table, cardinal index);
+
+static void _kvs_foreach_range(kvs_foreach_s *range);
+
+static void _kvs_foreach_chunked(kvs_foreach_s *range, kvs_entry entry);
+
+static void _kvs_foreach_snapshot(kvs_foreach_s *range);
+
+static kvs_compact_s *_kvs_compact_new(cardinal bucket_count);
+
+static void _kvs_compact_dispose(kvs_compact_s *compact);
+
+static fmacro kvs_compact_entry_s *_kvs_compact_record
+    (kvs_compact_s *compact, uint32_t index);
+
+static uint32_t _kvs_compact_allocate(kvs_compact_s *compact);
+
+static fmacro void _kvs_compact_free(kvs_compact_s *compact, uint32_t index);
+
+static kvs_compact_entry_s *_kvs_compact_find
+    (kvs_table_s *table, kvs_key_t key, uint32_t **link, kvs_status_t *status);
+
+static void _kvs_compact_add_entry
+    (kvs_table_s *table, kvs_key_t key, kvs_data_t value, cardinal size,
+     bool null_terminated, bool by_copy, kvs_status_t *status);
+
+static void _kvs_compact_remove
+    (kvs_table_s *table, kvs_key_t key, kvs_compact_entry_s *expected,
+     kvs_status_t *status);
+
+static void _kvs_compact_unlink(kvs_table_s *table, uint32_t *link);
+
+static kvs_data_t _kvs_compact_get_entry
+    (kvs_table_s *table, bool copy, kvs_key_t key, cardinal *size,
+     bool *null_terminated, kvs_status_t *status);
+
+static void _kvs_compact_release
+    (kvs_table_s *table, kvs_compact_entry_s *entry, kvs_status_t *status);
+
+static void _kvs_foreach_compact(kvs_foreach_s *range);
+
+static kvs_filter_s *_kvs_filter_new(cardinal bucket_count);
+
+static void _kvs_filter_dispose(kvs_filter_s *filter);
+
+static fmacro uint64_t *_kvs_filter_block
+    (kvs_filter_s *filter, uint64_t hash);
+
+static void _kvs_filter_add(kvs_table_s *table, kvs_key_t key);
+
+static void _kvs_filter_remove(kvs_table_s *table, kvs_key_t key);
+
+static bool _kvs_filter_query(kvs_table_s *table, kvs_key_t key);
+
+static fmacro kvs_entry *_kvs_hot_slot(kvs_table_s *table, kvs_key_t key);
+
+static fmacro void _kvs_hot_forget(kvs_table_s *table, kvs_entry entry);
+
+static kvs_value_store_s *_kvs_value_store_new(void);
+
+static void _kvs_value_store_dispose(kvs_value_store_s *store);
+
+static uint64_t _kvs_value_hash(const octet_t *data, cardinal size);
+
+static void *_kvs_value_intern
+    (kvs_value_store_s *store, kvs_data_t value, cardinal size);
+
+static void _kvs_value_release(kvs_value_store_s *store, opaque_t data);
+
+static void _kvs_value_store_grow(kvs_value_store_s *store);
+
+static fmacro kvs_entry *_kvs_grave_for_key(kvs_table_s *table, kvs_key_t key);
+
+static kvs_entry _kvs_grave_find(kvs_table_s *table, kvs_key_t key);
+
+static bool _kvs_bury_entry
+    (kvs_table_s *table, kvs_entry *bucket, kvs_entry prev, kvs_entry entry);
+
+static bool _kvs_grave_grow(kvs_table_s *table);
+
+static bool _kvs_arena_renew(kvs_table_s *table);
+
+static kvs_entry _kvs_arena_move
+    (kvs_table_s *table, kvs_entry *bucket, kvs_entry prev, kvs_entry entry);
+
+static void _kvs_arena_release(kvs_table_s *table, kvs_entry entry);
+
+static fmacro bool _kvs_frozen_is_shared(kvs_frozen_s *frozen, cardinal index);
+
+static bool _kvs_frozen_save(kvs_frozen_s *frozen, cardinal index);
+
+static bool _kvs_frozen_detach(kvs_table_s *table, kvs_entry *bucket);
+
+static bool _kvs_frozen_detach_all(kvs_table_s *table);
+
+static kvs_entry *_kvs_frozen_open
+    (kvs_table_s *table, cardinal index, bool detach, kvs_status_t *status);
+
+static fmacro void _kvs_frozen_close
+    (kvs_table_s *table, cardinal index, kvs_entry *chain);
+
+static kvs_entry _kvs_frozen_match
+    (kvs_entry chain, kvs_key_t key, kvs_status_t *status);
+
+static bool _kvs_frozen_find
+    (kvs_table_s *table, kvs_key_t key, kvs_frozen_item_s *found,
+     kvs_status_t *status);
+
+static kvs_data_t _kvs_frozen_get_entry
+    (kvs_table_s *table, bool copy, kvs_key_t key, cardinal *size,
+     bool *null_terminated, kvs_status_t *status);
+
+static void _kvs_foreach_frozen(kvs_foreach_s *range);
+
+static void _kvs_frozen_dispose(kvs_table_s *table);
+
+static void _kvs_stats_walk(kvs_table_s *table, kvs_stats_t *stats);
+
+static void _kvs_stats_walk_compact(kvs_table_s *table, kvs_stats_t *stats);
+
+static void _kvs_stats_walk_snapshot(kvs_table_s *table, kvs_stats_t *stats);
+
+static void _kvs_stats_entry(kvs_stats_t *stats, kvs_entry entry);
+
+static fmacro void _kvs_stats_chain(kvs_stats_t *stats, cardinal length);
+
+#if KVS_USE_THREADS
+static void *_kvs_foreach_worker(void *range_p);
+#endif
+
+#if KVS_USE_LOG
+static fmacro bool _kvs_log_write
+    (kvs_log_s *log, const void *data, size_t size);
+
+static bool _kvs_log_sync(kvs_log_s *log);
+
+static fmacro uint64_t _kvs_log_now(void);
+
+#if KVS_USE_THREADS
+static void *_kvs_log_flusher(void *log_p);
+#endif
+#endif
+
+
+// ===========================================================================
+// P U B L I C   F U N C T I O N   I M P L E M E N T A T I O N S
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_table( size, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new KVS table object with <size> number of buckets.
+// If  zero is passed in <size>,  then  the new table will be created with the
+// default table size  as  defined  by  KVS_DEFAULT_TABLE_SIZE.  Returns  NULL
+// if the KVS table object could not be created.
+
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_new_table(cardinal size, kvs_status_t *status) {
+    
+    return kvs_new_table_with_flags(size, KVS_FLAGS_NONE, status);
+    
+} // end kvs_new_table
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_table_with_flags( size, flags, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new KVS table object  with  <size>  number of buckets
+// and the storage scheme and options selected by <flags>.  If zero is passed in
+// <size>,  then  the default table size  is used.  For open addressing tables,
+// <size> is rounded up to the next power of two,  but not less than 16.  For
+// tables with power of two buckets,  <size> is rounded up to the next power of
+// two.  If the flags are unknown or mutually exclusive,  then no table is
+// created  and NULL is returned.  Passing KVS_FLAGS_NONE is equivalent to
+// calling kvs_new_table().
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_new_table_with_flags(cardinal size,
+                                  kvs_flags_t flags,
+                                 kvs_status_t *status) {
+    cardinal index, bucket_count;
+    kvs_table_s *new_table;
+    
+    // flags must be known
+    if ((flags & ~KVS_KNOWN_FLAGS) != 0) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return NULL;
+    } // end if
+    
+    // flags must not be mutually exclusive
+    if (((flags & KVS_FLAG_OPEN_ADDRESSING) &&
+         ((flags & KVS_OA_EXCLUDED_FLAGS) != 0)) ||
+        ((flags & KVS_FLAG_CONCURRENT) &&
+         ((flags & KVS_CONCURRENT_EXCLUDED_FLAGS) != 0)) ||
+        ((flags & KVS_FLAG_COMPACT) &&
+         ((flags & KVS_COMPACT_EXCLUDED_FLAGS) != 0)) ||
+        ((flags & KVS_FLAG_DEDUP) &&
+         ((flags & KVS_DEDUP_EXCLUDED_FLAGS) != 0)) ||
+        ((flags & KVS_FLAG_CHUNKED_VALUES) &&
+         ((flags & KVS_CHUNKED_EXCLUDED_FLAGS) != 0))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return NULL;
+    } // end if
+    
+    // determine table size
+    if (size == 0) bucket_count = KVS_DEFAULT_TABLE_SIZE;
+    else bucket_count = size;
+    
+    if /* open addressing */ (flags & KVS_FLAG_OPEN_ADDRESSING) {
+        
+        // size must not exceed the largest power of two in range
+        if (bucket_count > ((cardinal) 1 << (sizeof(cardinal) * 8 - 1))) {
+            _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+            return NULL;
+        } // end if
+        
+        // round up to a power of two of at least one group
+        size = KVS_OA_GROUP_WIDTH;
+        while (size < bucket_count) size = size << 1;
+        bucket_count = size;
+        
+        // allocate table base without bucket array
+        new_table = ALLOCATE(sizeof(kvs_table_s));
+        
+        // exit if allocation failed
+        if (new_table == NULL) {
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+        
+        new_table->bucket = NULL;
+        new_table->old_bucket = NULL;
+        new_table->old_bucket_count = 0;
+        new_table->migrated_count = 0;
+        new_table->compact = NULL;
+        
+        // allocate slots and control bytes
+        if (_kvs_oa_allocate_slots(bucket_count, &new_table->ctrl,
+                                   &new_table->slot) == false) {
+            DEALLOCATE(new_table);
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+        
+        // maximum load factor is 7/8
+        new_table->growth_left = bucket_count - bucket_count / 8;
+    }
+    else /* separate chaining */ {
+        
+        // round up to a power of two for masked bucket indices
+        if (flags & KVS_FLAG_POWER_OF_TWO_BUCKETS) {
+            
+            // size must not exceed the largest power of two in range
+            if (bucket_count > ((cardinal) 1 << (sizeof(cardinal) * 8 - 1))) {
+                _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+                return NULL;
+            } // end if
+            
+            size = 1;
+            while (size < bucket_count) size = size << 1;
+            bucket_count = size;
+        } // end if
+        
+        // allocate table base
+        new_table = ALLOCATE(sizeof(kvs_table_s));
+        
+        // exit if allocation failed
+        if (new_table == NULL) {
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+        
+        if /* compact */ (flags & KVS_FLAG_COMPACT) {
+            
+            // allocate bucket array of record indices and no records yet
+            new_table->compact = _kvs_compact_new(bucket_count);
+            new_table->bucket = NULL;
+            
+            // exit if allocation failed
+            if (new_table->compact == NULL) {
+                DEALLOCATE(new_table);
+                _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+                return NULL;
+            } // end if
+        }
+        else /* pointer buckets */ {
+            
+            // allocate bucket array
+            new_table->bucket = ALLOCATE(sizeof(kvs_entry) * bucket_count);
+            new_table->compact = NULL;
+            
+            // exit if allocation failed
+            if (new_table->bucket == NULL) {
+                DEALLOCATE(new_table);
+                _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+                return NULL;
+            } // end if
+            
+            // initialise buckets with NULL pointers
+            for (index = 0; index < bucket_count; index++) {
+                new_table->bucket[index] = NULL;
+            } // end for
+        } // end if
+        
+        new_table->old_bucket = NULL;
+        new_table->old_bucket_count = 0;
+        new_table->migrated_count = 0;
+        new_table->ctrl = NULL;
+        new_table->slot = NULL;
+        new_table->growth_left = 0;
+    } // end if
+    
+    // allocate slab for entries with inline values or compact values
+    if (flags & (KVS_FLAG_INLINE_VALUES | KVS_FLAG_COMPACT)) {
+        new_table->slab = _kvs_slab_new();
+        
+        // exit if allocation failed
+        if (new_table->slab == NULL) {
+            if (flags & KVS_FLAG_OPEN_ADDRESSING) {
+                DEALLOCATE(new_table->slot);
+                DEALLOCATE(new_table->ctrl);
+            }
+            else if (flags & KVS_FLAG_COMPACT) {
+                _kvs_compact_dispose(new_table->compact);
+            }
+            else {
+                DEALLOCATE(new_table->bucket);
+            } // end if
+            DEALLOCATE(new_table);
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+    }
+    else {
+        new_table->slab = NULL;
+    } // end if
+    
+    // allocate locks and epochs for concurrent access
+    if (flags & KVS_FLAG_CONCURRENT) {
+        new_table->cc = _kvs_cc_new();
+        
+        // exit if allocation failed
+        if (new_table->cc == NULL) {
+            DEALLOCATE(new_table->bucket);
+            DEALLOCATE(new_table);
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+    }
+    else {
+        new_table->cc = NULL;
+    } // end if
+    
+    // allocate lookup filter sized for the initial number of buckets
+    if (flags & KVS_FLAG_FILTER) {
+        new_table->filter = _kvs_filter_new(bucket_count);
+        
+        // exit if allocation failed
+        if (new_table->filter == NULL) {
+            if (flags & KVS_FLAG_OPEN_ADDRESSING) {
+                DEALLOCATE(new_table->slot);
+                DEALLOCATE(new_table->ctrl);
+            }
+            else if (flags & KVS_FLAG_COMPACT) {
+                _kvs_compact_dispose(new_table->compact);
+            }
+            else {
+                DEALLOCATE(new_table->bucket);
+            } // end if
+            _kvs_slab_dispose(new_table->slab);
+            DEALLOCATE(new_table);
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+    }
+    else {
+        new_table->filter = NULL;
+    } // end if
+    
+    // allocate value store for deduplicated values
+    if (flags & KVS_FLAG_DEDUP) {
+        new_table->values = _kvs_value_store_new();
+        
+        // exit if allocation failed
+        if (new_table->values == NULL) {
+            if (flags & KVS_FLAG_OPEN_ADDRESSING) {
+                DEALLOCATE(new_table->slot);
+                DEALLOCATE(new_table->ctrl);
+            }
+            else {
+                DEALLOCATE(new_table->bucket);
+            } // end if
+            _kvs_filter_dispose(new_table->filter);
+            DEALLOCATE(new_table);
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+    }
+    else {
+        new_table->values = NULL;
+    } // end if
+    
+    // initialise table meta data
+    new_table->flags = flags;
+    new_table->hot = &new_table->hot_single;
+    new_table->hot_mask = 0;
+    new_table->hot_single = NULL;
+    new_table->entry_count = 0;
+    new_table->bucket_count = bucket_count;
+    new_table->seed = _kvs_new_seed(new_table);
+    new_table->snapshot = NULL;
+    new_table->snapshot_size = 0;
+    new_table->log = NULL;
+    new_table->clock_hand = NULL;
+    new_table->byte_budget = 0;
+    new_table->bytes_used = 0;
+    new_table->hits = 0;
+    new_table->misses = 0;
+    new_table->evictions = 0;
+    new_table->lookups = 0;
+    new_table->compares = 0;
+    new_table->hot_hits = 0;
+    new_table->wheel = NULL;
+    new_table->arena = NULL;
+    new_table->arena_size = 0;
+    new_table->arena_live = 0;
+    new_table->arena_fill = 0;
+    new_table->old_arena = NULL;
+    new_table->old_arena_size = 0;
+    new_table->old_arena_live = 0;
+    new_table->grave = NULL;
+    new_table->grave_mask = 0;
+    new_table->grave_count = 0;
+    new_table->sweep_index = 0;
+    new_table->frozen = NULL;
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    // return a reference to the new table
+    return (kvs_table_t) new_table;
+} // end kvs_new_table_with_flags
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_cache( size, flags, byte_budget, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new KVS table  as kvs_new_table_with_flags() does,
+// which evicts entries in CLOCK order  whenever it holds more than
+// <byte_budget> bytes.  Returns NULL if the table could not be created.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_new_cache(cardinal size,
+                       kvs_flags_t flags,
+                            size_t byte_budget,
+                      kvs_status_t *status) {
+    kvs_table_s *new_table;
+    
+    // concurrent readers cannot update the CLOCK ring,
+    // compact entries have no room for it
+    if (flags & (KVS_FLAG_CONCURRENT | KVS_FLAG_COMPACT)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return NULL;
+    } // end if
+    
+    // byte budget must not be zero
+    if (byte_budget == 0) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+        return NULL;
+    } // end if
+    
+    new_table = kvs_new_table_with_flags(size, flags, status);
+    
+    // exit if the table could not be created
+    if (new_table == NULL)
+        return NULL;
+    
+    new_table->flags = new_table->flags | KVS_TABLE_CACHE;
+    new_table->byte_budget = byte_budget;
+    
+    return (kvs_table_t) new_table;
+} // end kvs_new_cache
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_table_from_arrays( keys, vals, sizes, nt, count, ... )
+// ---------------------------------------------------------------------------
+//
+// Creates and returns a new KVS table  holding the <count> number of keys in
+// array <keys>  with the values at the same index in array <values>.  The
+// entries are built in two passes.  The first pass determines the size and
+// bucket of every entry  and  the bytes taken by the entries of every bucket,
+// from which the range of every bucket in the arena follows.  The second pass
+// builds every entry at the end of the unused part of its bucket's range and
+// links it first in its chain,  so that every chain ascends through memory.
+// Entries are always stored by value in the arena,  flags that choose another
+// layout for values are rejected.  The number of keys skipped is passed back
+// in <skipped>,  unless NULL was passed in for <skipped>.  The status of the
+// operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+kvs_table_t kvs_new_table_from_arrays(const kvs_key_t *keys,
+                                     const kvs_data_t *values,
+                                       const cardinal *sizes,
+                                                 bool null_terminated,
+                                             cardinal count,
+                                          kvs_flags_t flags,
+                                             cardinal *skipped,
+                                         kvs_status_t *status) {
+    kvs_table_s *new_table;
+    kvs_entry_s *new_entry, *this_entry, **bucket;
+    cardinal index, size, bucket_count, *bucket_of, *entry_size;
+    cardinal skip_count = 0;
+    size_t total, *offset;
+    uint64_t buckets_needed;
+    
+    if (skipped != NULL)
+        *skipped = 0;
+    
+    // key and value arrays must not be NULL
+    if ((keys == NULL) || (values == NULL)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return NULL;
+    } // end if
+    
+    // sizes must be given unless data is null-terminated
+    if ((sizes == NULL) && (null_terminated == false)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+        return NULL;
+    } // end if
+    
+    // entries are built in chains  with their values following them
+    if (flags & (KVS_FLAG_OPEN_ADDRESSING | KVS_FLAG_COMPACT |
+                 KVS_FLAG_INLINE_VALUES | KVS_FLAG_DEDUP |
+                 KVS_FLAG_CHUNKED_VALUES)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return NULL;
+    } // end if
+    
+    // choose the number of buckets for count entries at the load factor
+    buckets_needed = (uint64_t) count * 100 / KVS_RESIZE_LOAD_FACTOR;
+    bucket_count = (cardinal) MIN(buckets_needed, (cardinal) ~0);
+    
+    new_table = kvs_new_table_with_flags(bucket_count, flags, status);
+    
+    // exit if the table could not be created or there are no entries
+    if ((new_table == NULL) || (count == 0))
+        return (kvs_table_t) new_table;
+    
+    bucket_count = new_table->bucket_count;
+    
+    // allocate bucket and size of every key and offset of every bucket
+    bucket_of = ALLOCATE(sizeof(cardinal) * count);
+    entry_size = ALLOCATE(sizeof(cardinal) * count);
+    offset = ALLOCATE(sizeof(size_t) * bucket_count);
+    
+    // exit if allocation failed
+    if ((bucket_of == NULL) || (entry_size == NULL) || (offset == NULL)) {
+        DEALLOCATE(bucket_of);
+        DEALLOCATE(entry_size);
+        DEALLOCATE(offset);
+        kvs_dispose_table(new_table, NULL);
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    for (index = 0; index < bucket_count; index++) {
+        offset[index] = 0;
+    } // end for
+    
+    // first pass: size and bucket of every entry,  bytes of every bucket
+    for (index = 0; index < count; index++) {
+        size = (sizes != NULL) ? sizes[index] : 0;
+        
+        // zero keys,  NULL values and values of unknown size are skipped
+        if ((keys[index] == 0) || (values[index] == NULL))
+            size = 0;
+        else if ((size == 0) && (null_terminated))
+            size = _kvs_calc_null_terminated_data_size(values[index]);
+        
+        entry_size[index] = size;
+        
+        if (size == 0)
+            skip_count++;
+        else {
+            bucket_of[index] =
+                _kvs_bucket_index(new_table, keys[index], bucket_count);
+            offset[bucket_of[index]] += KVS_ARENA_ENTRY_SIZE(size);
+        } // end if
+    } // end for
+    
+    // turn the bytes of every bucket into the end of its range
+    total = 0;
+    for (index = 0; index < bucket_count; index++) {
+        total += offset[index];
+        offset[index] = total;
+    } // end for
+    
+    new_table->arena = ALLOCATE(total);
+    new_table->arena_size = total;
+    
+    // exit if allocation failed
+    if ((new_table->arena == NULL) && (total != 0)) {
+        DEALLOCATE(bucket_of);
+        DEALLOCATE(entry_size);
+        DEALLOCATE(offset);
+        kvs_dispose_table(new_table, NULL);
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // second pass: build and link every entry
+    for (index = 0; index < count; index++) {
+        size = entry_size[index];
+        
+        if (size == 0)
+            continue;
+        
+        bucket = &new_table->bucket[bucket_of[index]];
+        
+        // skip keys stored before,  their chain is adjacent in the arena
+        this_entry = *bucket;
+        while ((this_entry != NULL) && (this_entry->key != keys[index]))
+            this_entry = this_entry->next;
+        
+        if (this_entry != NULL) {
+            skip_count++;
+            continue;
+        } // end if
+        
+        // build the entry below those of its bucket built before
+        offset[bucket_of[index]] -= KVS_ARENA_ENTRY_SIZE(size);
+        new_entry =
+            (kvs_entry_s *) (new_table->arena + offset[bucket_of[index]]);
+        
+        new_entry->key = keys[index];
+        new_entry->size = size;
+        new_entry->value = new_entry->data;
+        new_entry->ref_count = 1;
+        new_entry->null_terminated = null_terminated;
+        new_entry->marked_for_removal = false;
+        new_entry->storage = KVS_STORAGE_ARENA;
+        new_entry->clock_prev = NULL;
+        new_entry->clock_next = NULL;
+        new_entry->referenced = false;
+        new_entry->expires = 0;
+        new_entry->timer_next = NULL;
+        new_entry->timer_link = NULL;
+        memcpy(new_entry->data, values[index], size);
+        
+        // link the entry first in its chain
+        new_entry->next = *bucket;
+        *bucket = new_entry;
+        
+        // count the new entry in the lookup filter
+        if (new_table->filter != NULL)
+            _kvs_filter_add(new_table, new_entry->key);
+        
+        new_table->arena_live += KVS_ARENA_ENTRY_SIZE(size);
+        new_table->entry_count++;
+    } // end for
+    
+    DEALLOCATE(bucket_of);
+    DEALLOCATE(entry_size);
+    DEALLOCATE(offset);
+    
+    if (skipped != NULL)
+        *skipped = skip_count;
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return (kvs_table_t) new_table;
+} // end kvs_new_table_from_arrays
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_store_value( table, key, val, size, null_terminated, stat )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to table <table>.  The new entry is stored
+// by value.  Data is copied from the address passed in as <value>.  If <size>
+// is not zero, then <size> number of bytes are copied.  If <size> is zero and
+// <null_terminated> is true, then data will be copied up to and including the
+// first zero-value byte encountered.  If <size> is zero and <null_terminated>
+// is false,  then the operation will fail and no entry will be added.  If the
+// operation succeeds,  then the initial reference count of the new entry will
+// be set to one.
+//
+// Keys must be unique.  Existing entries are not replaced.  Duplicate entries
+// are not added.  The  status  of  the operation  is passed back in <status>,
+// unless NULL was passed in for <status>.
+
+void kvs_store_value(kvs_table_t table,
+                       kvs_key_t key,
+                      kvs_data_t value,
+                        cardinal size,
+                       bool null_terminated,
+                    kvs_status_t *status) {
+    
+    kvs_store_value_ttl(table, key, value, size, null_terminated, 0, status);
+    
+} // end kvs_store_value
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_store_reference( tbl, key, val, siz, null_terminated, stat )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to table <table>.  The new entry is stored
+// by reference.  No data is copied.  If <size> is zero  and <null_terminated>
+// is true,  then  the size of the referenced data  is calculated  by counting
+// up to  and including  the  first  zero-value byte.  The size of the data is
+// then stored for faster retrieval by-copy of the entry.  Entries  stored  by
+// reference  and for which  the size  is unknown cannot be retrieved by copy.
+// The initial reference count of the new entry will be set to one.
+//
+// Keys must be unique.  Existing entries are not replaced.  Duplicate entries
+// are not added.  The  status  of  the operation  is passed back in <status>,
+// unless NULL was passed in for <status>.
+
+void kvs_store_reference(kvs_table_t table,
+                           kvs_key_t key,
+                          kvs_data_t value,
+                            cardinal size,
+                           bool null_terminated,
+                        kvs_status_t *status) {
+    
+    kvs_store_reference_ttl(table, key, value, size,
+                            null_terminated, 0, status);
+    
+} // end kvs_store_reference
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_store_value_ttl( tbl, key, val, siz, nt, ttl, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to table <table>  by value  as
+// kvs_store_value() does,  which expires <ttl> milliseconds from now.  If
+// zero is passed in for <ttl>,  then the entry does not expire.  Entries of
+// concurrent and compact tables cannot expire.  The status of the operation
+// is passed back in <status>,  unless NULL was passed in for <status>.
+
+void kvs_store_value_ttl(kvs_table_t table,
+                           kvs_key_t key,
+                          kvs_data_t value,
+                            cardinal size,
+                                bool null_terminated,
+                          kvs_time_t ttl,
+                        kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_time_t expires;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // entries of concurrent and compact tables cannot expire
+    if ((ttl > 0) &&
+        (this_table->flags & (KVS_FLAG_CONCURRENT | KVS_FLAG_COMPACT))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return;
+    } // end if
+    
+    // key must not be zero
+    if (key == 0) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return;
+    } // end if
+    
+    // value must not be NULL
+    if (value == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    // size must not be NULL if data is not null-terminated
+    if ((size == 0) && (null_terminated == false)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+        return;
+    } // end if
+    
+    if /* size unknown */ (size == 0) {
+        if /* data is null-terminated */ (null_terminated) {
+            // calculate size
+            size = _kvs_calc_null_terminated_data_size(value);
+            if (size == 0) {
+                _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+                return;
+            } // end if
+        }
+        else /* data is not null-terminated */ {
+            _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+            return;
+        } // end if
+    } // end if
+    
+    // determine the expiry deadline,  zero if the entry does not expire
+    expires = _kvs_deadline(ttl);
+    
+    // add a new entry by copy, fails if key is not unique
+    _kvs_add_entry(this_table, key, value, size, null_terminated, true,
+                   expires, status);
+    
+    return;
+} // end kvs_store_value_ttl
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_store_reference_ttl( tbl, key, val, siz, nt, ttl, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to table <table>  by reference  as
+// kvs_store_reference() does,  which expires <ttl> milliseconds from now.  If
+// zero is passed in for <ttl>,  then the entry does not expire.  Entries of
+// concurrent and compact tables cannot expire.  The status of the operation
+// is passed back in <status>,  unless NULL was passed in for <status>.
+
+void kvs_store_reference_ttl(kvs_table_t table,
+                               kvs_key_t key,
+                              kvs_data_t value,
+                                cardinal size,
+                                    bool null_terminated,
+                              kvs_time_t ttl,
+                            kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_time_t expires;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // entries of concurrent and compact tables cannot expire
+    if ((ttl > 0) &&
+        (this_table->flags & (KVS_FLAG_CONCURRENT | KVS_FLAG_COMPACT))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return;
+    } // end if
+    
+    // key must not be zero
+    if (key == 0) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return;
+    } // end if
+    
+    // value must not be NULL
+    if (value == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    // size must not be NULL if data is not null-terminated
+    if ((size == 0) && (null_terminated == false)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+        return;
+    } // end if
+    
+    if /* size unknown */ ((size == 0) && (null_terminated)) {
+        // calculate size
+        size = _kvs_calc_null_terminated_data_size(value);
+        if (size == 0) {
+            _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+            return;
+        } // end if
+    } // end if
+    
+    // determine the expiry deadline,  zero if the entry does not expire
+    expires = _kvs_deadline(ttl);
+    
+    // add a new entry by reference, fails if key is not unique
+    _kvs_add_entry(this_table, key, value, size, null_terminated, false,
+                   expires, status);
+    
+    return;
+} // end kvs_store_reference_ttl
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_entry_exists( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns  true  if a  valid entry  for <key> exists  in  KVS  table <table>,
+// returns false otherwise.  If an entry is found,  valid or invalid,  then it
+// will be cached in the hot entry cache of the table  and a subsequent search
+// request for the same key  will check the cache first,  which is faster than
+// a lookup of a non-cached entry.  The reference count of the entry is  not
+// modified.
+// The  status  of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+bool kvs_entry_exists(kvs_table_t table,
+                        kvs_key_t key,
+                     kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_compact_entry_s *compact_entry;
+    kvs_frozen_item_s found;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    bool result;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return false;
+    } // end if
+    
+    // snapshot tables are served from the snapshot
+    if (this_table->flags & KVS_TABLE_SNAPSHOT)
+        return (_kvs_snapshot_find(this_table, key, status) != NULL);
+    
+    // frozen tables are served from their origin or their saved chains
+    if (this_table->flags & KVS_TABLE_FROZEN)
+        return _kvs_frozen_find(this_table, key, &found, status);
+    
+    // compact tables are served from their records
+    if (this_table->flags & KVS_FLAG_COMPACT) {
+        compact_entry = _kvs_compact_find(this_table, key, NULL, status);
+        if (compact_entry == NULL)
+            return false;
+        if (compact_entry->state & KVS_COMPACT_MARKED) {
+            _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+            return false;
+        } // end if
+        return true;
+    } // end if
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    // try to find entry for key
+    this_entry = _kvs_find_entry(table, key, status);
+    
+    if /* entry not found */ (this_entry == NULL) {
+        result = false;
+    }
+    else if (_kvs_is_marked(this_entry)) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+        result = false;
+    }
+    else /* entry is valid */ {
+        result = true;
+    } // end if
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return result;
+} // end kvs_entry_exists
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_entry(table, copy, key, size, null_terminated, status)
+// ---------------------------------------------------------------------------
+//
+// Retrieves the table entry stored in <table> for <key>  either by copy or by
+// reference.  If  true  is passed in for <copy>,  then  the  function returns
+// the entry's data by-copy,  otherwise it returns the data by-reference.
+//
+// For by-copy retrieval,  if the entry exists,  a newly allocated copy of its
+// value is created,  and a pointer to it is returned as function result.  The
+// size of the entry's data (in bytes)  is passed back in <size>.  However, if
+// the size of the entry's data is unknown,  then no copy is made and  NULL is
+// returned.  The entry's reference count is never incremented when retrieving
+// by copy.
+//
+// For by-reference retrieval,  if the entry exists,  a pointer to the entry's
+// data  is returned as function result  and  the  entry's reference count  is
+// incremented.  The size of the  entry's data  (in bytes)  is  passed back in
+// <size>.  However,  if the size of the entry's data is  unknown,  then  zero
+// is passed back in <size>.
+//
+// If the entry's data is null-terminated,  then  true  will be passed back in
+// <null_terminated>,  otherwise  false  will be passed back.
+//
+// If the entry has been successfully retrieved,  then it is cached within the
+// table,  regardless of whether it was returned by copy or by reference.
+//
+// If the entry does not exist,  or,  if it has been marked for removal,  then
+// NULL  is  returned,  no  data  is copied,  no table meta data  is modified,
+// no entry meta data is modified.
+//
+// The  status  of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+kvs_data_t kvs_get_entry(kvs_table_t table,
+                                bool copy,
+                           kvs_key_t key,
+                            cardinal *size,
+                                bool *null_terminated,
+                        kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_data_t result = NULL;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return NULL;
+    } // end if
+    
+    // snapshot tables are served from the snapshot
+    if (this_table->flags & KVS_TABLE_SNAPSHOT)
+        return _kvs_snapshot_get_entry(this_table, copy, key, size,
+                                       null_terminated, status);
+    
+    // frozen tables are served from their origin or their saved chains
+    if (this_table->flags & KVS_TABLE_FROZEN)
+        return _kvs_frozen_get_entry(this_table, copy, key, size,
+                                     null_terminated, status);
+    
+    // compact tables are served from their records
+    if (this_table->flags & KVS_FLAG_COMPACT)
+        return _kvs_compact_get_entry(this_table, copy, key, size,
+                                      null_terminated, status);
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    // try to find entry for key
+    this_entry = _kvs_find_entry(table, key, status);
+    
+    // count hits and misses of a cache
+    if (this_table->flags & KVS_TABLE_CACHE)
+        _kvs_cache_count(this_table, this_entry);
+    
+    if /* entry found */ (this_entry != NULL) {
+    
+        // check if entry is pending removal
+        if (_kvs_is_marked(this_entry)) {
+    
+            // set status
+            _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+        }
+        else if /* by copy */ (copy == true) {
+    
+            if /* entry size unknown */ (this_entry->size == 0) {
+    
+                // set status
+                _kvs_set_status(status, KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN);
+            }
+            else /* entry not pending removal and size known */ {
+    
+                // pass back size and null_terminated
+                if (size != NULL)
+                    *size = this_entry->size;
+                if (null_terminated != NULL)
+                    *null_terminated = this_entry->null_terminated;
+    
+                // make a copy
+                result = _kvs_retrieve_copy(this_entry, status);
+            } // end if
+        }
+        else if /* chunked */ (this_entry->storage == KVS_STORAGE_CHUNKED) {
+    
+            // set status
+            _kvs_set_status(status, KVS_STATUS_VALUE_CHUNKED);
+        }
+        else /* by reference */ {
+    
+            // increment the reference count for entry
+            if (_kvs_pin_entry(this_table, this_entry)) {
+    
+                // pass back size and null_terminated
+                if (size != NULL)
+                    *size = this_entry->size;
+                if (null_terminated != NULL)
+                    *null_terminated = this_entry->null_terminated;
+    
+                // set status and reference
+                _kvs_set_status(status, KVS_STATUS_SUCCESS);
+                result = (kvs_data_t) this_entry->value;
+            }
+            else /* removed concurrently */ {
+    
+                // set status
+                _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+            } // end if
+        } // end if
+    }
+    else /* entry not found */ {
+    
+        // set status
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    } // end if
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return result;
+} // end kvs_get_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_value_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in table <table> for <key> and returns a pointer
+// to a  newly  allocated  copy  of the  entry's value.  The entry's reference
+// count is NOT incremented.  Entries that have been stored  by reference  and
+// are not null-terminated can  only  be retrieved by value if their data size
+// was  explicitly  passed in  when  they  were  stored.  If  no entry  exists
+// for <key>  or if the entry is pending removal  or  if the size of the entry
+// is unknown,  then  NULL  is  returned.  The  status  of  the  operation  is
+// passed  back in <status>,  unless  NULL  was passed in for <status>.
+
+kvs_data_t kvs_value_for_key(kvs_table_t table,
+                               kvs_key_t key,
+                            kvs_status_t *status) {
+    
+    return kvs_get_entry(table, true, key, NULL, NULL, status);
+    
+} // end kvs_value_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_reference_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in table <table> for <key> and returns a pointer
+// to the  entry's value  in the table  and  increments the  entry's reference
+// count.  If  no entry exists  for <key>  or if the entry is pending removal,
+// then  NULL  is returned.  The  status  of  the  operation  is  passed  back
+// in <status>,  unless  NULL  was passed in for <status>.
+
+kvs_data_t kvs_reference_for_key(kvs_table_t table,
+                                   kvs_key_t key,
+                                kvs_status_t *status) {
+    
+    return kvs_get_entry(table, false, key, NULL, NULL, status);
+    
+} // end kvs_reference_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_view( table, key, view, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in <table> for <key>  and fills in <view> with a
+// pointer to the entry's value in the table,  its size  and  null-terminated
+// flag,  then pins the entry  by incrementing its reference count.  No memory
+// is allocated and no data is copied.  Returns  true  if a view was taken.
+// The view must be given back with kvs_view_release(),  which releases the
+// entry without looking up its key again.
+//
+// If no entry exists for <key>,  or if it is pending removal,  then  false is
+// returned and <view> is cleared.  Values kept in chunks cannot be viewed,
+// false is then returned with status KVS_STATUS_VALUE_CHUNKED.  The status of
+// the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+bool kvs_get_view(kvs_table_t table,
+                    kvs_key_t key,
+                   kvs_view_t *view,
+                 kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_compact_entry_s *compact_entry;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    bool result = false;
+    
+    // view must not be NULL
+    if (view == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return false;
+    } // end if
+    
+    view->value = NULL;
+    view->size = 0;
+    view->null_terminated = false;
+    view->table = table;
+    view->entry = NULL;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return false;
+    } // end if
+    
+    // snapshot values stay mapped for the lifetime of the table
+    if (this_table->flags & KVS_TABLE_SNAPSHOT) {
+        view->value = _kvs_snapshot_get_entry(this_table, false, key,
+            &view->size, &view->null_terminated, status);
+        return (view->value != NULL);
+    } // end if
+    
+    // frozen values are owned by the table once retrieved by reference
+    if (this_table->flags & KVS_TABLE_FROZEN) {
+        view->value = _kvs_frozen_get_entry(this_table, false, key,
+            &view->size, &view->null_terminated, status);
+        return (view->value != NULL);
+    } // end if
+    
+    // compact records are pinned by their reference count
+    if (this_table->flags & KVS_FLAG_COMPACT) {
+        compact_entry = _kvs_compact_find(this_table, key, NULL, status);
+        if (compact_entry == NULL)
+            return false;
+        if (compact_entry->state & KVS_COMPACT_MARKED) {
+            _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+            return false;
+        } // end if
+        compact_entry->state += KVS_COMPACT_REF_ONE;
+        view->value = (kvs_data_t) compact_entry->value;
+        view->size = compact_entry->size;
+        view->null_terminated =
+            (compact_entry->state & KVS_COMPACT_NULL_TERMINATED) != 0;
+        view->entry = (opaque_t) compact_entry;
+        return true;
+    } // end if
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    // try to find entry for key
+    this_entry = _kvs_find_entry(table, key, status);
+    
+    // count hits and misses of a cache
+    if (this_table->flags & KVS_TABLE_CACHE)
+        _kvs_cache_count(this_table, this_entry);
+    
+    if /* entry not found */ (this_entry == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    }
+    else if /* pending removal */ (_kvs_is_marked(this_entry)) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+    }
+    else if /* chunked */ (this_entry->storage == KVS_STORAGE_CHUNKED) {
+        _kvs_set_status(status, KVS_STATUS_VALUE_CHUNKED);
+    }
+    else if /* removed concurrently */
+            (NOT(_kvs_pin_entry(this_table, this_entry))) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+    }
+    else /* pinned */ {
+        view->value = (kvs_data_t) this_entry->value;
+        view->size = this_entry->size;
+        view->null_terminated = this_entry->null_terminated;
+        view->entry = (opaque_t) this_entry;
+        
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        result = true;
+    } // end if
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return result;
+} // end kvs_get_view
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_view_release( view, status )
+// ---------------------------------------------------------------------------
+//
+// Releases the entry pinned by <view>  as kvs_release_entry() does  and clears
+// <view>.  If the entry has been marked for removal  and this was its last
+// reference,  then it is removed.  Releasing a cleared view has no effect.
+// The status of the operation is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+void kvs_view_release(kvs_view_t *view, kvs_status_t *status) {
+    kvs_table_s *this_table;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    
+    // view must not be NULL
+    if (view == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    this_table = (kvs_table_s *) view->table;
+    this_entry = (kvs_entry) view->entry;
+    
+    view->value = NULL;
+    view->size = 0;
+    view->null_terminated = false;
+    view->entry = NULL;
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    // nothing to release for a cleared view or a snapshot value
+    if (this_entry == NULL)
+        return;
+    
+    // compact records are released by their reference count
+    if (this_table->flags & KVS_FLAG_COMPACT) {
+        _kvs_compact_release(this_table,
+            (kvs_compact_entry_s *) (opaque_t) this_entry, status);
+        return;
+    } // end if
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    // remove the entry if this was the last reference to a removed entry
+    if ((_kvs_unpin_entry(this_table, this_entry) == 1) &&
+        (_kvs_is_marked(this_entry))) {
+        
+        _kvs_remove(this_table, this_entry->key, this_entry, status);
+        
+    } // end if
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return;
+} // end kvs_view_release
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_stream_open( table, key, stream, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in <table> for <key>,  pins it as kvs_get_view()
+// does  and opens <stream> on its value,  which kvs_stream_next() then reads
+// piece by piece.  A value kept in chunks is read one chunk at a time,  any
+// other value in a single piece.  No memory is allocated and no data is
+// copied.  Returns  true  if the stream was opened.  The stream must be closed
+// with kvs_stream_close().
+//
+// If no entry exists for <key>,  or if it is pending removal,  then  false is
+// returned and <stream> is cleared.  The status of the operation is passed
+// back in <status>,  unless NULL was passed in for <status>.
+
+bool kvs_stream_open(kvs_table_t table,
+                       kvs_key_t key,
+                    kvs_stream_t *stream,
+                    kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    bool result = false;
+    
+    // stream must not be NULL
+    if (stream == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return false;
+    } // end if
+    
+    stream->size = 0;
+    stream->null_terminated = false;
+    stream->chunk = NULL;
+    
+    // values of tables without chunks are read from a view in one piece
+    if ((table == NULL) ||
+        ((this_table->flags & KVS_FLAG_CHUNKED_VALUES) == 0)) {
+        result = kvs_get_view(table, key, &stream->view, status);
+        stream->size = stream->view.size;
+        stream->null_terminated = stream->view.null_terminated;
+        return result;
+    } // end if
+    
+    stream->view.value = NULL;
+    stream->view.size = 0;
+    stream->view.null_terminated = false;
+    stream->view.table = table;
+    stream->view.entry = NULL;
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    // try to find entry for key
+    this_entry = _kvs_find_entry(table, key, status);
+    
+    // count hits and misses of a cache
+    if (this_table->flags & KVS_TABLE_CACHE)
+        _kvs_cache_count(this_table, this_entry);
+    
+    if /* entry not found */ (this_entry == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    }
+    else if /* pending removal */ ((_kvs_is_marked(this_entry)) ||
+             NOT(_kvs_pin_entry(this_table, this_entry))) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+    }
+    else /* pinned */ {
+        
+        // chunks are read from the first,  other values at once
+        if (this_entry->storage == KVS_STORAGE_CHUNKED)
+            stream->chunk = this_entry->value;
+        else
+            stream->view.value = (kvs_data_t) this_entry->value;
+        
+        stream->view.size = this_entry->size;
+        stream->view.null_terminated = this_entry->null_terminated;
+        stream->view.entry = (opaque_t) this_entry;
+        stream->size = this_entry->size;
+        stream->null_terminated = this_entry->null_terminated;
+        
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        result = true;
+    } // end if
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return result;
+} // end kvs_stream_open
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_stream_next( stream, size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the next piece of the value read by <stream>  and
+// passes its size back in <size>.  Once the whole value has been read,  NULL
+// is returned and zero is passed back in <size>.  The status of the operation
+// is passed back in <status>,  unless NULL was passed in for <status>.
+
+kvs_data_t kvs_stream_next(kvs_stream_t *stream,
+                               cardinal *size,
+                           kvs_status_t *status) {
+    kvs_data_t piece = NULL;
+    cardinal piece_size = 0;
+    kvs_chunk this_chunk;
+    
+    // stream must not be NULL
+    if (stream == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return NULL;
+    } // end if
+    
+    if /* contiguous value not yet read */ (stream->view.value != NULL) {
+        piece = stream->view.value;
+        piece_size = stream->view.size;
+        stream->view.value = NULL;
+    }
+    else if /* chunks not yet read */ (stream->chunk != NULL) {
+        this_chunk = (kvs_chunk) stream->chunk;
+        piece = (kvs_data_t) this_chunk->data;
+        piece_size = this_chunk->size;
+        stream->chunk = this_chunk->next;
+    } // end if
+    
+    // pass back size
+    if (size != NULL)
+        *size = piece_size;
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return piece;
+} // end kvs_stream_next
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_stream_close( stream, status )
+// ---------------------------------------------------------------------------
+//
+// Releases the entry pinned by <stream>  as kvs_view_release() does  and
+// clears <stream>.  Closing a cleared stream has no effect.  The status of
+// the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+void kvs_stream_close(kvs_stream_t *stream, kvs_status_t *status) {
+    
+    // stream must not be NULL
+    if (stream == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    stream->size = 0;
+    stream->null_terminated = false;
+    stream->chunk = NULL;
+    
+    kvs_view_release(&stream->view, status);
+    
+    return;
+} // end kvs_stream_close
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_size_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns  the size of the data of the entry stored in <table> for <key>.  If
+// no entry exists for <key>,  then  zero  is  returned.  The  status  of  the
+// operation  is  passed  back  in  <status>,  unless   NULL   was  passed  in
+// for <status>.
+
+cardinal kvs_size_for_key(kvs_table_t table,
+                          kvs_key_t key,
+                          kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    const kvs_snapshot_record_s *record;
+    kvs_compact_entry_s *compact_entry;
+    kvs_frozen_item_s found;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    cardinal result = 0;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // snapshot tables are served from the snapshot
+    if (this_table->flags & KVS_TABLE_SNAPSHOT) {
+        record = _kvs_snapshot_find(this_table, key, status);
+        return (record != NULL) ? record->size : 0;
+    } // end if
+    
+    // frozen tables are served from their origin or their saved chains
+    if (this_table->flags & KVS_TABLE_FROZEN)
+        return _kvs_frozen_find(this_table, key, &found, status) ?
+            found.size : 0;
+    
+    // compact tables are served from their records
+    if (this_table->flags & KVS_FLAG_COMPACT) {
+        compact_entry = _kvs_compact_find(this_table, key, NULL, status);
+        return (compact_entry != NULL) ? compact_entry->size : 0;
+    } // end if
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    this_entry = _kvs_find_entry(table, key, status);
+    
+    if /* entry found */ (this_entry != NULL)
+        result = this_entry->size;
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return result;
+} // end kvs_size_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_data_for_key_is_null_terminated( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the  null-terminated flag of the entry stored in <table> for <key>.
+// If no entry exists for <key>,  then  false  is returned.  The status of the
+// operation  is  passed  back  in  <status>,  unless   NULL   was  passed  in
+// for <status>.
+
+bool kvs_data_for_key_is_null_terminated(kvs_table_t table,
+                                           kvs_key_t key,
+                                        kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    const kvs_snapshot_record_s *record;
+    kvs_compact_entry_s *compact_entry;
+    kvs_frozen_item_s found;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    bool result = false;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return false;
+    } // end if
+    
+    // snapshot tables are served from the snapshot
+    if (this_table->flags & KVS_TABLE_SNAPSHOT) {
+        record = _kvs_snapshot_find(this_table, key, status);
+        return (record != NULL) ? record->null_terminated : false;
+    } // end if
+    
+    // frozen tables are served from their origin or their saved chains
+    if (this_table->flags & KVS_TABLE_FROZEN)
+        return _kvs_frozen_find(this_table, key, &found, status) &&
+            found.null_terminated;
+    
+    // compact tables are served from their records
+    if (this_table->flags & KVS_FLAG_COMPACT) {
+        compact_entry = _kvs_compact_find(this_table, key, NULL, status);
+        return (compact_entry != NULL) &&
+            ((compact_entry->state & KVS_COMPACT_NULL_TERMINATED) != 0);
+    } // end if
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    this_entry = _kvs_find_entry(table, key, status);
+    
+    if /* entry found */ (this_entry != NULL)
+        result = this_entry->null_terminated;
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return result;
+} // end kvs_data_for_key_is_null_terminated
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_reference_count_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the  reference count  of the entry stored in <table> for <key>.  If
+// no entry exists for <key>,  then  zero  is returned.  Valid entries  always
+// have a  reference count  greater than zero.  The status of the operation is
+// passed back in <status>,  unless  NULL  was passed in for <status>.
+
+cardinal kvs_reference_count_for_key(kvs_table_t table,
+                                       kvs_key_t key,
+                                    kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_compact_entry_s *compact_entry;
+    kvs_frozen_item_s found;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    cardinal result = 0;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // snapshot entries always have a reference count of one
+    if (this_table->flags & KVS_TABLE_SNAPSHOT)
+        return (_kvs_snapshot_find(this_table, key, status) != NULL) ? 1 : 0;
+    
+    // so do entries of frozen tables
+    if (this_table->flags & KVS_TABLE_FROZEN)
+        return _kvs_frozen_find(this_table, key, &found, status) ? 1 : 0;
+    
+    // compact tables keep the reference count in the record state
+    if (this_table->flags & KVS_FLAG_COMPACT) {
+        compact_entry = _kvs_compact_find(this_table, key, NULL, status);
+        return (compact_entry != NULL) ?
+            compact_entry->state / KVS_COMPACT_REF_ONE : 0;
+    } // end if
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    this_entry = _kvs_find_entry(table, key, status);
+    
+    if /* entry found */ (this_entry != NULL)
+        result = _kvs_ref_count(this_entry);
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return result;
+} // end kvs_reference_count_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_release_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Decrements the reference count of entry stored in <table> for <key> by one.
+// If the entry has previously been marked for removal and its reference count
+// reaches one  as a result of this release,  then  the entry will be removed.
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_release_entry(kvs_table_t table,
+                         kvs_key_t key,
+                      kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_compact_entry_s *compact_entry;
+    kvs_frozen_item_s found;
+    kvs_entry this_entry;
+    kvs_epoch_t epoch;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // snapshot entries are not reference counted
+    if (this_table->flags & KVS_TABLE_SNAPSHOT) {
+        _kvs_snapshot_find(this_table, key, status);
+        return;
+    } // end if
+    
+    // neither are entries of frozen tables
+    if (this_table->flags & KVS_TABLE_FROZEN) {
+        _kvs_frozen_find(this_table, key, &found, status);
+        return;
+    } // end if
+    
+    // compact records are released by their reference count
+    if (this_table->flags & KVS_FLAG_COMPACT) {
+        compact_entry = _kvs_compact_find(this_table, key, NULL, status);
+        if (compact_entry != NULL)
+            _kvs_compact_release(this_table, compact_entry, status);
+        return;
+    } // end if
+    
+    epoch = _kvs_read_begin(this_table);
+    
+    this_entry = _kvs_find_entry(table, key, status);
+    
+    if (this_entry != NULL) {
+    
+        // remove the entry if this was the last reference to a removed entry
+        if ((_kvs_unpin_entry(this_table, this_entry) == 1) &&
+            (_kvs_is_marked(this_entry))) {
+    
+            _kvs_remove(this_table, key, this_entry, status);
+    
+        } // end if
+    } // end if
+    
+    _kvs_read_end(this_table, epoch);
+    
+    return;
+} // end kvs_release_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_remove_entry(table, key, status)
+// ---------------------------------------------------------------------------
+//
+// Marks the entry stored in <table> for <key> as removed.  An entry which has
+// been marked as removed can no longer be retrieved  and will be removed when
+// its  reference count  reaches  zero.  The status of the operation is passed
+// back in <status>,  unless  NULL  was passed in for <status>.
+
+void kvs_remove_entry(kvs_table_t table,
+                        kvs_key_t key,
+                     kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // key must not be zero
+    if (key == 0) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return;
+    } // end if
+    
+    // remove whichever entry is stored for key
+    _kvs_remove(this_table, key, NULL, status);
+    
+    return;
+} // end kvs_remove_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_expire( table, now, status )
+// ---------------------------------------------------------------------------
+//
+// Removes all entries of <table>  whose expiry deadline is not later than
+// <now>,  or marks them for removal if they are referenced,  and returns
+// their number.  The status of the operation is passed back in <status>,
+// unless NULL was passed in for <status>.
+
+cardinal kvs_expire(kvs_table_t table, kvs_time_t now, kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    cardinal count = 0;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // nothing expires before the first entry that expires is stored
+    if (this_table->wheel != NULL)
+        count = _kvs_wheel_advance(this_table, now);
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return count;
+} // end kvs_expire
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_current_time()
+// ---------------------------------------------------------------------------
+//
+// Returns the current time of a monotonic clock in milliseconds.
+
+kvs_time_t kvs_current_time(void) {
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (kvs_time_t) now.tv_sec * 1000 + (kvs_time_t) now.tv_nsec / 1000000;
+} // end kvs_current_time
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_compact( table, budget, status )
+// ---------------------------------------------------------------------------
+//
+// Performs one step of compaction of <table>,  visiting no more than <budget>
+// buckets,  and returns the number of buckets migrated and entries moved.  If
+// the graveyard or a new arena cannot be allocated,  the step continues  with
+// the entries concerned left in place.  The status of the operation is passed
+// back in <status>,  unless NULL was passed in for <status>.
+
+cardinal kvs_compact(kvs_table_t table,
+                        cardinal budget,
+                    kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_entry prev_entry, this_entry, next_entry, *bucket;
+    cardinal steps, count = 0;
+    kvs_status_t _status = KVS_STATUS_SUCCESS;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // only non-concurrent chained tables are compacted
+    if (this_table->flags & (KVS_TABLE_READ_ONLY | KVS_FLAG_OPEN_ADDRESSING |
+                             KVS_FLAG_COMPACT | KVS_FLAG_CONCURRENT)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return 0;
+    } // end if
+    
+    // continue an ongoing resize first
+    if (this_table->old_bucket != NULL) {
+        steps = MIN(budget, this_table->old_bucket_count -
+                            this_table->migrated_count);
+        _kvs_migrate_buckets(this_table, steps);
+        budget = budget - steps;
+        count = count + steps;
+    } // end if
+    
+    // start to compact an arena holding more removed than live entries
+    if ((this_table->arena != NULL) && (this_table->old_arena == NULL) &&
+        (this_table->arena_live < this_table->arena_size / 2) &&
+        NOT(_kvs_arena_renew(this_table)))
+        _status = KVS_STATUS_ALLOCATION_FAILED;
+    
+    // visit buckets from where the previous step stopped
+    for (steps = 0; steps < budget; steps++) {
+        
+        if (this_table->sweep_index >= this_table->bucket_count)
+            this_table->sweep_index = 0;
+        
+        bucket = &this_table->bucket[this_table->sweep_index];
+        this_table->sweep_index++;
+        
+        prev_entry = NULL;
+        this_entry = *bucket;
+        while (this_entry != NULL) {
+            next_entry = this_entry->next;
+            
+            if /* pending removal */ (this_entry->marked_for_removal) {
+                
+                // move the entry to the graveyard,  its predecessor stays
+                if (_kvs_bury_entry(this_table, bucket, prev_entry,
+                                    this_entry)) {
+                    count++;
+                    this_entry = next_entry;
+                    continue;
+                } // end if
+                
+                // the graveyard could not grow,  the entry stays
+                _status = KVS_STATUS_ALLOCATION_FAILED;
+            }
+            else if /* unreferenced in the old arena */
+                    ((this_table->old_arena != NULL) &&
+                     (this_entry->storage == KVS_STORAGE_ARENA) &&
+                     (this_entry->ref_count <= 1) &&
+                     ((octet_t *) this_entry >= this_table->old_arena) &&
+                     ((octet_t *) this_entry < this_table->old_arena +
+                                               this_table->old_arena_size)) {
+                
+                // move the entry to the end of the filled part of the arena
+                this_entry = _kvs_arena_move(this_table, bucket, prev_entry,
+                                             this_entry);
+                count++;
+            } // end if
+            
+            prev_entry = this_entry;
+            this_entry = next_entry;
+        } // end while
+    } // end for
+    
+    // set status
+    _kvs_set_status(status, _status);
+    
+    return count;
+} // end kvs_compact
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_many( table, copy, keys, values, sizes, count, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entries  stored in <table>  for the <count> number of keys in
+// array <keys>  either by copy or by reference  as kvs_get_entry() does and
+// passes them back in array <values>  at the same index as their keys.  If an
+// entry does not exist,  is pending removal,  or cannot be retrieved,  then
+// NULL is passed back for the entry.  Unless NULL is passed in for <sizes>,
+// the size of each entry's data  is  passed back in array <sizes>,  or zero if
+// no entry was retrieved.  Returns the number of entries retrieved.
+//
+// Keys are processed in groups of KVS_BATCH_GROUP_SIZE.  The buckets and first
+// entries of a group are prefetched before any of its keys are looked up,  so
+// that cache misses of the keys within a group overlap.
+//
+// The  status  of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.  The status is KVS_STATUS_SUCCESS  if the arguments
+// were valid,  even if some entries were not retrieved.
+
+cardinal kvs_get_many(kvs_table_t table,
+                             bool copy,
+                  const kvs_key_t *keys,
+                       kvs_data_t *values,
+                         cardinal *sizes,
+                         cardinal count,
+                     kvs_status_t *status) {
+    cardinal index, group_end, size, retrieved = 0;
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // key and value arrays must not be NULL
+    if ((keys == NULL) || (values == NULL)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return 0;
+    } // end if
+    
+    for (group_end = 0; group_end < count; ) {
+        index = group_end;
+        group_end = MIN(count, group_end + KVS_BATCH_GROUP_SIZE);
+        
+        // prefetch buckets, then first entries of the group
+        _kvs_prefetch_group(this_table, &keys[index], group_end - index);
+        
+        // look up every key of the group
+        for (; index < group_end; index++) {
+            size = 0;
+            values[index] = kvs_get_entry(table, copy, keys[index],
+                                          &size, NULL, NULL);
+            if (values[index] != NULL)
+                retrieved++;
+            else
+                size = 0;
+            if (sizes != NULL)
+                sizes[index] = size;
+        } // end for
+    } // end for
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return retrieved;
+} // end kvs_get_many
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_store_many( table, keys, vals, sizes, nt, count, status )
+// ---------------------------------------------------------------------------
+//
+// Adds new entries  for the <count> number of keys  in array <keys>  to table
+// <table>  by value  as kvs_store_value() does,  taking the value of each key
+// from array <values>  at the same index.  If NULL is passed in for <sizes>,
+// then all values must be null-terminated and <null_terminated> must be true,
+// otherwise the size of each value is taken from array <sizes>.  Keys that are
+// not unique  or  values that are invalid  are skipped.  Returns  the number
+// of entries added.
+//
+// Keys are processed in groups of KVS_BATCH_GROUP_SIZE.  The buckets and first
+// entries of a group are prefetched before any of its keys are stored.
+//
+// The  status  of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.  The status is KVS_STATUS_SUCCESS  if the arguments
+// were valid,  even if some entries were not added.
+
+cardinal kvs_store_many(kvs_table_t table,
+                    const kvs_key_t *keys,
+                   const kvs_data_t *values,
+                     const cardinal *sizes,
+                               bool null_terminated,
+                           cardinal count,
+                       kvs_status_t *status) {
+    cardinal index, group_end, stored = 0;
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_status_t _status;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // key and value arrays must not be NULL
+    if ((keys == NULL) || (values == NULL)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return 0;
+    } // end if
+    
+    // sizes must be given unless data is null-terminated
+    if ((sizes == NULL) && (null_terminated == false)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+        return 0;
+    } // end if
+    
+    for (group_end = 0; group_end < count; ) {
+        index = group_end;
+        group_end = MIN(count, group_end + KVS_BATCH_GROUP_SIZE);
+        
+        // prefetch buckets, then first entries of the group
+        _kvs_prefetch_group(this_table, &keys[index], group_end - index);
+        
+        // store every key of the group
+        for (; index < group_end; index++) {
+            kvs_store_value(table, keys[index], values[index],
+                            (sizes != NULL) ? sizes[index] : 0,
+                            null_terminated, &_status);
+            if (_status == KVS_STATUS_SUCCESS)
+                stored++;
+        } // end for
+    } // end for
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return stored;
+} // end kvs_store_many
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_foreach( table, action, context, status )
+// ---------------------------------------------------------------------------
+//
+// Calls <action> once for every entry of <table>  that is neither marked for
+// removal nor expired,  and returns the number of entries visited.  Buckets
+// are walked in memory order.  While a bucket is visited,  the entries of the
+// bucket KVS_FOREACH_PREFETCH_DISTANCE buckets ahead  and  the values of the
+// entries half as far ahead  are prefetched.  Values kept in chunks are
+// passed as temporary copies,  if a copy cannot be allocated,  the entry is
+// not visited  and  KVS_STATUS_ALLOCATION_FAILED is passed back.  The function
+// fails and returns zero  if NULL is passed in for <table> or <action>.  The
+// status of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+cardinal kvs_foreach(kvs_table_t table,
+                    kvs_action_f action,
+                            void *context,
+                    kvs_status_t *status) {
+    kvs_foreach_s range;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // action must not be NULL
+    if (action == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return 0;
+    } // end if
+    
+    range.table = (kvs_table_s *) table;
+    range.action = action;
+    range.chunked = NULL;
+    range.context = context;
+    range.first = 0;
+    range.last = _kvs_foreach_bucket_count(range.table);
+    
+    _kvs_foreach_range(&range);
+    
+    _kvs_set_status(status, range.status);
+    
+    return range.count;
+} // end kvs_foreach
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_parallel_foreach( table, action, context, threads, status )
+// ---------------------------------------------------------------------------
+//
+// Visits the entries of <table> as kvs_foreach() does,  but splits the buckets
+// into <threads> contiguous ranges  of which all but the first are visited by
+// threads of their own,  at most KVS_FOREACH_MAX_THREADS in all.  The calling
+// thread visits the first range and waits for the others.  A range for which
+// no thread could be started is visited by the calling thread.  The function
+// fails and returns zero  if NULL is passed in for <table> or <action>.  The
+// status of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+cardinal kvs_parallel_foreach(kvs_table_t table,
+                             kvs_action_f action,
+                                     void *context,
+                                 cardinal threads,
+                             kvs_status_t *status) {
+#if KVS_USE_THREADS
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_foreach_s *range;
+    cardinal index, bucket_count, count;
+    kvs_status_t _status;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // action must not be NULL
+    if (action == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return 0;
+    } // end if
+    
+    bucket_count = _kvs_foreach_bucket_count(this_table);
+    
+    // no more threads than buckets
+    threads = MIN(threads, KVS_FOREACH_MAX_THREADS);
+    threads = MIN(threads, bucket_count);
+    
+    if (threads < 2)
+        return kvs_foreach(table, action, context, status);
+    
+    range = ALLOCATE(sizeof(kvs_foreach_s) * threads);
+    
+    // exit if allocation failed
+    if (range == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return 0;
+    } // end if
+    
+    // split the buckets into ranges of equal size
+    for (index = 0; index < threads; index++) {
+        range[index].table = this_table;
+        range[index].action = action;
+        range[index].chunked = NULL;
+        range[index].context = context;
+        range[index].first =
+            (cardinal) ((uint64_t) bucket_count * index / threads);
+        range[index].last =
+            (cardinal) ((uint64_t) bucket_count * (index + 1) / threads);
+        range[index].has_thread = false;
+    } // end for
+    
+    // start a thread for every range but the first
+    for (index = 1; index < threads; index++) {
+        range[index].has_thread =
+            (pthread_create(&range[index].thread, NULL,
+                            _kvs_foreach_worker, &range[index]) == 0);
+    } // end for
+    
+    _kvs_foreach_range(&range[0]);
+    count = range[0].count;
+    _status = range[0].status;
+    
+    // wait for the threads,  visit the ranges of threads that did not start
+    for (index = 1; index < threads; index++) {
+        if (range[index].has_thread)
+            pthread_join(range[index].thread, NULL);
+        else
+            _kvs_foreach_range(&range[index]);
+        count = count + range[index].count;
+        if (range[index].status != KVS_STATUS_SUCCESS)
+            _status = range[index].status;
+    } // end for
+    
+    DEALLOCATE(range);
+    
+    _kvs_set_status(status, _status);
+    
+    return count;
+#else
+    (void) threads;
+    
+    return kvs_foreach(table, action, context, status);
+#endif
+} // end kvs_parallel_foreach
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_save_snapshot( table, path, status )
+// ---------------------------------------------------------------------------
+//
+// Writes all entries of <table>  that are not marked for removal  to a new
+// snapshot file at <path>,  replacing any existing file.  The snapshot stores
+// bucket index,  entry headers and value bytes in a position-independent layout
+// that kvs_open_snapshot() maps into memory without deserialising it.  Entries
+// stored by reference are saved with the data they reference.  If any entry
+// to be saved has an unknown size,  then no snapshot is written.  Other threads
+// may modify a concurrent table while it is saved,  entries they store or
+// remove meanwhile may or may not be saved.  A table returned by kvs_snapshot()
+// for the table can be saved instead to save a consistent state.
+// Tables opened from a snapshot cannot be saved again.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_save_snapshot(kvs_table_t table,
+                        const char *path,
+                      kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_snapshot_item_s *entries = NULL, **ordered = NULL;
+    kvs_snapshot_record_s *records = NULL;
+    kvs_snapshot_header_s header;
+    uint64_t *deadlines = NULL;
+    uint32_t *start = NULL;
+    cardinal index, count, bucket_count, bucket;
+    uint64_t offset;
+    kvs_status_t _status;
+    kvs_table_s *reader;
+    kvs_epoch_t epoch = 0;
+    bool written, expiring;
+    FILE *file;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // table must not be a snapshot itself
+    if (this_table->flags & KVS_TABLE_SNAPSHOT) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // path must not be NULL
+    if (path == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    // values gathered are kept until written:  a frozen table shares them
+    // with its origin,  a concurrent table retires them as they are removed,
+    // neither deallocates them before the epoch entered here is left
+    reader = this_table;
+    if (this_table->flags & KVS_TABLE_FROZEN)
+        reader = this_table->frozen->origin;
+    if (reader != NULL)
+        epoch = _kvs_read_begin(reader);
+    
+    // gather the entries to be saved
+    entries = _kvs_snapshot_collect(this_table, &count, &_status);
+    
+    // exit if any entry cannot be saved
+    if (entries == NULL) {
+        if (reader != NULL)
+            _kvs_read_end(reader, epoch);
+        _kvs_set_status(status, _status);
+        return;
+    } // end if
+    
+    // use the smallest power of two buckets for a load factor of at most one
+    bucket_count = 1;
+    while ((bucket_count < count) &&
+           (bucket_count < ((cardinal) 1 << (sizeof(cardinal) * 8 - 1))))
+        bucket_count = bucket_count << 1;
+    
+    start = ALLOCATE(sizeof(uint32_t) * (bucket_count + 1));
+    ordered = ALLOCATE(sizeof(kvs_snapshot_item_s *) * (count + 1));
+    records = ALLOCATE(sizeof(kvs_snapshot_record_s) * (count + 1));
+    
+    // deadlines are only saved if any entry expires
+    expiring = false;
+    for (index = 0; (index < count) && NOT(expiring); index++) {
+        expiring = (entries[index].expires != 0);
+    } // end for
+    if (expiring)
+        deadlines = ALLOCATE(sizeof(uint64_t) * count);
+    
+    // exit if allocation failed
+    if ((start == NULL) || (ordered == NULL) || (records == NULL) ||
+        ((expiring) && (deadlines == NULL))) {
+        DEALLOCATE(start);
+        DEALLOCATE(ordered);
+        DEALLOCATE(records);
+        DEALLOCATE(deadlines);
+        _kvs_snapshot_release(this_table, entries, count);
+        DEALLOCATE(entries);
+        if (reader != NULL)
+            _kvs_read_end(reader, epoch);
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return;
+    } // end if
+    
+    // count the entries of every bucket
+    for (index = 0; index <= bucket_count; index++) {
+        start[index] = 0;
+    } // end for
+    for (index = 0; index < count; index++) {
+        bucket = _kvs_hash(this_table, entries[index].key) &
+                 (bucket_count - 1);
+        start[bucket + 1]++;
+    } // end for
+    
+    // turn counts into the index of the first record of every bucket
+    for (index = 0; index < bucket_count; index++) {
+        start[index + 1] = start[index + 1] + start[index];
+    } // end for
+    
+    // order entries by bucket,  advancing every bucket's start as it is filled
+    for (index = 0; index < count; index++) {
+        bucket = _kvs_hash(this_table, entries[index].key) &
+                 (bucket_count - 1);
+        ordered[start[bucket]] = &entries[index];
+        start[bucket]++;
+    } // end for
+    
+    // every start now holds the start of the next bucket,  shift them back
+    for (index = bucket_count; index > 0; index--) {
+        start[index] = start[index - 1];
+    } // end for
+    start[0] = 0;
+    
+    // lay out the file
+    header.magic = KVS_SNAPSHOT_MAGIC;
+    header.version = KVS_SNAPSHOT_VERSION;
+    header.bucket_count = bucket_count;
+    header.entry_count = count;
+    header.key_size = sizeof(kvs_key_t);
+    header.seed = this_table->seed;
+    header.start_offset = sizeof(kvs_snapshot_header_s);
+    header.record_offset = KVS_SNAPSHOT_ALIGN(header.start_offset +
+        sizeof(uint32_t) * ((uint64_t) bucket_count + 1));
+    header.value_offset = KVS_SNAPSHOT_ALIGN(header.record_offset +
+        sizeof(kvs_snapshot_record_s) * (uint64_t) count);
+    header.expires_offset = 0;
+    header.reserved = 0;
+    
+    // deadlines follow the records
+    if (expiring) {
+        header.expires_offset = header.value_offset;
+        header.value_offset = KVS_SNAPSHOT_ALIGN(header.expires_offset +
+            sizeof(uint64_t) * (uint64_t) count);
+    } // end if
+    
+    offset = header.value_offset;
+    for (index = 0; index < count; index++) {
+        records[index].value_offset = offset;
+        records[index].key = ordered[index]->key;
+        records[index].size = ordered[index]->size;
+        records[index].null_terminated = ordered[index]->null_terminated;
+        memset(records[index].reserved, 0, sizeof(records[index].reserved));
+        if (expiring)
+            deadlines[index] = _kvs_wall_deadline(ordered[index]->expires);
+        offset = KVS_SNAPSHOT_ALIGN(offset + ordered[index]->size);
+    } // end for
+    header.file_size = offset;
+    
+    // write header,  record indices,  records,  deadlines and values,  padded
+    file = fopen(path, "wb");
+    written = (file != NULL);
+    
+    if (written) {
+        written =
+            _kvs_snapshot_write(file, &header, sizeof(header)) &&
+            _kvs_snapshot_write(file, start,
+                                sizeof(uint32_t) * (bucket_count + 1)) &&
+            _kvs_snapshot_write(file, records,
+                                sizeof(kvs_snapshot_record_s) * count) &&
+            (NOT(expiring) ||
+             _kvs_snapshot_write(file, deadlines, sizeof(uint64_t) * count));
+        
+        for (index = 0; (written) && (index < count); index++) {
+            
+            // chunked values are written from their pinned entries
+            if (ordered[index]->entry != NULL)
+                written = _kvs_snapshot_write_chunks(file,
+                    (kvs_chunk) ordered[index]->entry->value,
+                    ordered[index]->size);
+            else
+                written = _kvs_snapshot_write(file, ordered[index]->value,
+                                              ordered[index]->size);
+        } // end for
+        
+        if (fclose(file) != 0)
+            written = false;
+        
+        // do not leave an incomplete snapshot behind
+        if (NOT(written))
+            remove(path);
+    } // end if
+    
+    DEALLOCATE(start);
+    DEALLOCATE(ordered);
+    DEALLOCATE(records);
+    DEALLOCATE(deadlines);
+    _kvs_snapshot_release(this_table, entries, count);
+    DEALLOCATE(entries);
+    
+    if (reader != NULL)
+        _kvs_read_end(reader, epoch);
+    
+    if (written) {
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    }
+    else {
+        _kvs_set_status(status, KVS_STATUS_FILE_ERROR);
+    } // end if
+    
+    return;
+} // end kvs_save_snapshot
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_open_snapshot( path, status )
+// ---------------------------------------------------------------------------
+//
+// Opens the snapshot file at <path>  saved by kvs_save_snapshot()  and returns
+// a read-only KVS table that serves lookups directly from the file mapped into
+// memory.  Nothing is deserialised,  pages of the file are read on first use.
+// Entries retrieved by reference point into the mapping  and must not be
+// written to.  Reference counts are not tracked,  every entry has a reference
+// count of one and releasing an entry has no effect.  Stores and removals fail
+// with status KVS_STATUS_TABLE_READ_ONLY.  The file is unmapped when the table
+// is disposed of.  Returns NULL if the file cannot be read or is not a valid
+// snapshot.  Snapshot tables may be read by multiple threads at once.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_open_snapshot(const char *path, kvs_status_t *status) {
+    const kvs_snapshot_header_s *header;
+    kvs_table_s *new_table;
+    const octet_t *snapshot;
+    size_t snapshot_size;
+    kvs_status_t _status;
+    
+    // path must not be NULL
+    if (path == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return NULL;
+    } // end if
+    
+    snapshot = _kvs_snapshot_map(path, &snapshot_size, &_status);
+    
+    // exit if the file could not be mapped
+    if (snapshot == NULL) {
+        _kvs_set_status(status, _status);
+        return NULL;
+    } // end if
+    
+    // exit if the file is not a valid snapshot
+    if (NOT(_kvs_snapshot_is_valid(snapshot, snapshot_size))) {
+        _kvs_snapshot_unmap(snapshot, snapshot_size);
+        _kvs_set_status(status, KVS_STATUS_INVALID_SNAPSHOT);
+        return NULL;
+    } // end if
+    
+    // allocate table base
+    new_table = ALLOCATE(sizeof(kvs_table_s));
+    
+    // exit if allocation failed
+    if (new_table == NULL) {
+        _kvs_snapshot_unmap(snapshot, snapshot_size);
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    header = (const kvs_snapshot_header_s *) snapshot;
+    
+    // initialise table meta data,  there are no buckets, slots or slabs
+    new_table->flags = KVS_TABLE_SNAPSHOT;
+    new_table->hot = &new_table->hot_single;
+    new_table->hot_mask = 0;
+    new_table->hot_single = NULL;
+    new_table->entry_count = header->entry_count;
+    new_table->bucket_count = header->bucket_count;
+    new_table->bucket = NULL;
+    new_table->old_bucket = NULL;
+    new_table->old_bucket_count = 0;
+    new_table->migrated_count = 0;
+    new_table->ctrl = NULL;
+    new_table->slot = NULL;
+    new_table->growth_left = 0;
+    new_table->slab = NULL;
+    new_table->cc = NULL;
+    new_table->seed = header->seed;
+    new_table->snapshot = snapshot;
+    new_table->snapshot_size = snapshot_size;
+    new_table->log = NULL;
+    new_table->clock_hand = NULL;
+    new_table->byte_budget = 0;
+    new_table->bytes_used = 0;
+    new_table->hits = 0;
+    new_table->misses = 0;
+    new_table->evictions = 0;
+    new_table->lookups = 0;
+    new_table->compares = 0;
+    new_table->hot_hits = 0;
+    new_table->wheel = NULL;
+    new_table->compact = NULL;
+    new_table->filter = NULL;
+    new_table->arena = NULL;
+    new_table->arena_size = 0;
+    new_table->arena_live = 0;
+    new_table->arena_fill = 0;
+    new_table->old_arena = NULL;
+    new_table->old_arena_size = 0;
+    new_table->old_arena_live = 0;
+    new_table->values = NULL;
+    new_table->grave = NULL;
+    new_table->grave_mask = 0;
+    new_table->grave_count = 0;
+    new_table->sweep_index = 0;
+    new_table->frozen = NULL;
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    // return a reference to the new table
+    return (kvs_table_t) new_table;
+} // end kvs_open_snapshot
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_snapshot( table, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a read-only KVS table  that holds the entries of <table>  as they
+// are at the time of the call.  The snapshot shares the bucket array and
+// entries of <table>,  buckets are only copied into the snapshot  before
+// <table> changes them.  An ongoing resize of <table> is completed first.
+// Snapshots cannot be taken of open addressing,  compact,  read-only and
+// chunked tables.  The status of the operation  is passed back in <status>,
+// unless  NULL  was passed in for <status>.
+
+kvs_table_t kvs_snapshot(kvs_table_t table, kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_table_s *new_table;
+    kvs_frozen_s *new_frozen;
+    uint64_t *shared;
+    kvs_entry *saved;
+    cardinal index, word_count;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return NULL;
+    } // end if
+    
+    // only chained tables that can be modified share their buckets,
+    // saved chains hold contiguous copies of values
+    if (this_table->flags & (KVS_FLAG_OPEN_ADDRESSING | KVS_FLAG_COMPACT |
+                             KVS_FLAG_CHUNKED_VALUES | KVS_TABLE_READ_ONLY)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return NULL;
+    } // end if
+    
+    // complete an ongoing resize,  snapshots share a single bucket array
+    if (this_table->old_bucket != NULL)
+        _kvs_migrate_buckets(this_table, this_table->old_bucket_count);
+    
+    word_count = (this_table->bucket_count + 63) / 64;
+    
+    // allocate table base,  frozen state,  shared bits and saved chains
+    new_table = ALLOCATE(sizeof(kvs_table_s));
+    new_frozen = ALLOCATE(sizeof(kvs_frozen_s));
+    shared = ALLOCATE(sizeof(uint64_t) * word_count);
+    saved = ALLOCATE(sizeof(kvs_entry) * this_table->bucket_count);
+    
+    // exit if allocation failed
+    if ((new_table == NULL) || (new_frozen == NULL) ||
+        (shared == NULL) || (saved == NULL)) {
+        DEALLOCATE(new_table);
+        DEALLOCATE(new_frozen);
+        DEALLOCATE(shared);
+        DEALLOCATE(saved);
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // every bucket is shared,  none has been saved
+    for (index = 0; index < word_count; index++) {
+        shared[index] = ~(uint64_t) 0;
+    } // end for
+    if (this_table->bucket_count % 64 != 0)
+        shared[word_count - 1] =
+            ((uint64_t) 1 << (this_table->bucket_count % 64)) - 1;
+    
+    for (index = 0; index < this_table->bucket_count; index++) {
+        saved[index] = NULL;
+    } // end for
+    
+    new_frozen->origin = this_table;
+    new_frozen->table = new_table;
+    new_frozen->shared = shared;
+    new_frozen->saved = saved;
+    new_frozen->shared_count = this_table->bucket_count;
+    
+    // initialise table meta data,  buckets are those of the origin
+    new_table->flags = KVS_TABLE_FROZEN |
+        (this_table->flags & KVS_FLAG_POWER_OF_TWO_BUCKETS);
+    new_table->hot = &new_table->hot_single;
+    new_table->hot_mask = 0;
+    new_table->hot_single = NULL;
+    new_table->bucket_count = this_table->bucket_count;
+    new_table->bucket = NULL;
+    new_table->old_bucket = NULL;
+    new_table->old_bucket_count = 0;
+    new_table->migrated_count = 0;
+    new_table->ctrl = NULL;
+    new_table->slot = NULL;
+    new_table->growth_left = 0;
+    new_table->slab = NULL;
+    new_table->cc = NULL;
+    new_table->seed = this_table->seed;
+    new_table->snapshot = NULL;
+    new_table->snapshot_size = 0;
+    new_table->log = NULL;
+    new_table->clock_hand = NULL;
+    new_table->byte_budget = 0;
+    new_table->bytes_used = 0;
+    new_table->hits = 0;
+    new_table->misses = 0;
+    new_table->evictions = 0;
+    new_table->lookups = 0;
+    new_table->compares = 0;
+    new_table->hot_hits = 0;
+    new_table->wheel = NULL;
+    new_table->compact = NULL;
+    new_table->filter = NULL;
+    new_table->arena = NULL;
+    new_table->arena_size = 0;
+    new_table->arena_live = 0;
+    new_table->arena_fill = 0;
+    new_table->old_arena = NULL;
+    new_table->old_arena_size = 0;
+    new_table->old_arena_live = 0;
+    new_table->values = NULL;
+    new_table->grave = NULL;
+    new_table->grave_mask = 0;
+    new_table->grave_count = 0;
+    new_table->sweep_index = 0;
+    new_table->frozen = new_frozen;
+    
+    // link the snapshot to the table while no bucket can change
+    _kvs_lock_all(this_table);
+    new_table->entry_count =
+        __atomic_load_n(&this_table->entry_count, __ATOMIC_RELAXED);
+    new_frozen->next = this_table->frozen;
+    this_table->frozen = new_frozen;
+    _kvs_unlock_all(this_table);
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    // return a reference to the new table
+    return (kvs_table_t) new_table;
+} // end kvs_snapshot
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_attach_log( table, path, commit_window, status )
+// ---------------------------------------------------------------------------
+//
+// Opens or creates the write-ahead log file at <path>  and attaches it to
+// <table>.  Every store and every removal requested for the table is then
+// appended to the log once applied.  With a <commit_window> of zero,  the log
+// is synced after every record,  otherwise at most once per <commit_window>
+// microseconds.  Any log attached before is detached first.  Logs cannot be
+// attached to snapshot tables,  nor when built with KVS_NO_LOG.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_attach_log(kvs_table_t table,
+                     const char *path,
+                       cardinal commit_window,
+                   kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_log_s *new_log;
+    kvs_status_t _status;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // snapshot tables cannot be modified
+    if (this_table->flags & KVS_TABLE_READ_ONLY) {
+        _kvs_set_status(status, KVS_STATUS_TABLE_READ_ONLY);
+        return;
+    } // end if
+    
+    // path must not be NULL
+    if (path == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    // detach any log attached before
+    if (this_table->log != NULL) {
+        if (NOT(_kvs_log_close(this_table->log))) {
+            this_table->log = NULL;
+            _kvs_set_status(status, KVS_STATUS_FILE_ERROR);
+            return;
+        } // end if
+        this_table->log = NULL;
+    } // end if
+    
+    new_log = _kvs_log_open(path, commit_window, &_status);
+    
+    // exit if the log could not be opened
+    if (new_log == NULL) {
+        _kvs_set_status(status, _status);
+        return;
+    } // end if
+    
+    this_table->log = new_log;
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return;
+} // end kvs_attach_log
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sync_log( table, status )
+// ---------------------------------------------------------------------------
+//
+// Writes all buffered records of the write-ahead log attached to <table> to
+// the log file  and syncs it to stable storage.  Has no effect if no log is
+// attached.  The status of the operation is passed back in <status>,  unless
+// NULL was passed in for <status>.
+
+void kvs_sync_log(kvs_table_t table, kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    if ((this_table->log != NULL) && NOT(_kvs_log_commit(this_table->log))) {
+        _kvs_set_status(status, KVS_STATUS_FILE_ERROR);
+    }
+    else {
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    } // end if
+    
+    return;
+} // end kvs_sync_log
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_detach_log( table, status )
+// ---------------------------------------------------------------------------
+//
+// Syncs and closes the write-ahead log attached to <table>.  Has no effect if
+// no log is attached.  The status of the operation is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+void kvs_detach_log(kvs_table_t table, kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    bool closed = true;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    if (this_table->log != NULL) {
+        closed = _kvs_log_close(this_table->log);
+        this_table->log = NULL;
+    } // end if
+    
+    if (closed) {
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    }
+    else {
+        _kvs_set_status(status, KVS_STATUS_FILE_ERROR);
+    } // end if
+    
+    return;
+} // end kvs_detach_log
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_replay_log( table, path, status )
+// ---------------------------------------------------------------------------
+//
+// Applies the records of the write-ahead log file at <path> to <table>  and
+// returns the number of records applied.  Logged stores replace any entry for
+// the same key,  logged removals remove it.  Replay stops at the first record
+// that is incomplete or fails its checksum,  and the file is truncated to the
+// records before it.  A log file that does not exist is treated as empty.
+// Replay also stops,  without truncating the file,  at a store whose key is
+// held by an entry that is still referenced,  and at a store of an entry that
+// has not yet expired if entries of <table> cannot expire.  Stores of entries
+// that have expired since they were logged only remove the entry replaced.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+cardinal kvs_replay_log(kvs_table_t table,
+                         const char *path,
+                       kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_log_record_s record;
+    octet_t *value = NULL, *new_value;
+    cardinal value_size = 0, count = 0, prefix;
+    uint64_t valid_length = 0, deadline;
+    kvs_time_t expires;
+    kvs_status_t _status;
+    long file_length;
+    kvs_log_s *log;
+    bool torn = false;
+    size_t length;
+    FILE *file;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // snapshot tables cannot be modified
+    if (this_table->flags & KVS_TABLE_READ_ONLY) {
+        _kvs_set_status(status, KVS_STATUS_TABLE_READ_ONLY);
+        return 0;
+    } // end if
+    
+    // path must not be NULL
+    if (path == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return 0;
+    } // end if
+    
+    file = fopen(path, "rb");
+    
+    // exit if the file could not be opened,  a missing log is empty
+    if (file == NULL) {
+        if (errno == ENOENT) {
+            _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        }
+        else {
+            _kvs_set_status(status, KVS_STATUS_FILE_ERROR);
+        } // end if
+        return 0;
+    } // end if
+    
+    // the length of the file bounds the value size of a complete record
+    if ((fseek(file, 0, SEEK_END) != 0) ||
+        ((file_length = ftell(file)) < 0) ||
+        (fseek(file, 0, SEEK_SET) != 0)) {
+        fclose(file);
+        _kvs_set_status(status, KVS_STATUS_FILE_ERROR);
+        return 0;
+    } // end if
+    
+    // replayed records must not be logged again
+    log = this_table->log;
+    this_table->log = NULL;
+    
+    _status = KVS_STATUS_SUCCESS;
+    while (_status == KVS_STATUS_SUCCESS) {
+        
+        length = fread(&record, 1, sizeof(kvs_log_record_s), file);
+        
+        // stop at the end of the file or at an incomplete header
+        if (length < sizeof(kvs_log_record_s)) {
+            if (ferror(file))
+                _status = KVS_STATUS_FILE_ERROR;
+            else
+                torn = (length > 0);
+            break;
+        } // end if
+        
+        // stop at a header that cannot have been written
+        if (((record.type != KVS_LOG_RECORD_STORE) &&
+             (record.type != KVS_LOG_RECORD_REMOVE) &&
+             (record.type != KVS_LOG_RECORD_STORE_EXPIRING)) ||
+            ((record.type == KVS_LOG_RECORD_REMOVE) != (record.size == 0)) ||
+            ((record.type == KVS_LOG_RECORD_STORE_EXPIRING) &&
+             (record.size <= sizeof(uint64_t))) ||
+            (record.null_terminated > 1) || (record.key == 0)) {
+            torn = true;
+            break;
+        } // end if
+        
+        // stop at a value that would extend past the end of the file,
+        // before a torn size is used to allocate the value buffer
+        if (record.size > (uint64_t) file_length - valid_length -
+                          sizeof(kvs_log_record_s)) {
+            torn = true;
+            break;
+        } // end if
+        
+        // grow the value buffer as needed
+        if (record.size > value_size) {
+            new_value = REALLOCATE(value, record.size);
+            
+            if (new_value == NULL) {
+                _status = KVS_STATUS_ALLOCATION_FAILED;
+                break;
+            } // end if
+            
+            value = new_value;
+            value_size = record.size;
+        } // end if
+        
+        // stop at an incomplete value or a checksum mismatch
+        if ((fread(value, 1, record.size, file) != record.size) ||
+            (_kvs_log_checksum(&record, NULL, value, record.size) !=
+             record.checksum)) {
+            if (ferror(file))
+                _status = KVS_STATUS_FILE_ERROR;
+            else
+                torn = true;
+            break;
+        } // end if
+        
+        // an expiring store carries its deadline ahead of the value
+        prefix = 0;
+        expires = 0;
+        if (record.type == KVS_LOG_RECORD_STORE_EXPIRING) {
+            memcpy(&deadline, value, sizeof(uint64_t));
+            prefix = sizeof(uint64_t);
+            expires = _kvs_local_deadline(deadline);
+            
+            // an entry that has expired since is not stored again
+            if (expires <= kvs_current_time())
+                record.type = KVS_LOG_RECORD_REMOVE;
+            
+            // stop if entries of the table cannot expire
+            else if (this_table->flags &
+                     (KVS_FLAG_CONCURRENT | KVS_FLAG_COMPACT)) {
+                _status = KVS_STATUS_INVALID_FLAGS;
+                break;
+            } // end if
+        } // end if
+        
+        // apply the record,  a store replaces any entry for its key
+        _kvs_remove(this_table, record.key, NULL, &_status);
+        if (_status == KVS_STATUS_ENTRY_NOT_FOUND)
+            _status = KVS_STATUS_SUCCESS;
+        
+        if ((_status == KVS_STATUS_SUCCESS) &&
+            (record.type != KVS_LOG_RECORD_REMOVE)) {
+            _kvs_add_entry(this_table, record.key, value + prefix,
+                           record.size - prefix, record.null_terminated,
+                           true, expires, &_status);
+            
+            // an entry still referenced was only marked for removal
+            if (_status == KVS_STATUS_KEY_NOT_UNIQUE)
+                _status = KVS_STATUS_ENTRY_PENDING_REMOVAL;
+        } // end if
+        
+        if (_status == KVS_STATUS_SUCCESS) {
+            valid_length = valid_length + sizeof(kvs_log_record_s) +
+                           record.size;
+            count++;
+        } // end if
+    } // end while
+    
+    fclose(file);
+    DEALLOCATE(value);
+    
+    this_table->log = log;
+    
+    // cut off the torn tail  so that appended records follow valid ones
+    if ((_status == KVS_STATUS_SUCCESS) && (torn) &&
+        NOT(_kvs_log_truncate(path, valid_length)))
+        _status = KVS_STATUS_FILE_ERROR;
+    
+    _kvs_set_status(status, _status);
+    
+    return count;
+} // end kvs_replay_log
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_recover_table( snapshot_path, log_path, size, flags, status )
+// ---------------------------------------------------------------------------
+//
+// Creates a new KVS table as kvs_new_table_with_flags() does,  loads all
+// entries of the snapshot file at <snapshot_path>  and then replays the
+// write-ahead log file at <log_path>.  Either path may be NULL.  Returns NULL
+// if the table cannot be created  or the snapshot or log cannot be read.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_recover_table(const char *snapshot_path,
+                              const char *log_path,
+                                cardinal size,
+                             kvs_flags_t flags,
+                            kvs_status_t *status) {
+    kvs_table_s *new_table, *snapshot;
+    kvs_status_t _status;
+    
+    new_table = kvs_new_table_with_flags(size, flags, &_status);
+    
+    // exit if the table could not be created
+    if (new_table == NULL) {
+        _kvs_set_status(status, _status);
+        return NULL;
+    } // end if
+    
+    // load the snapshot by copy
+    if (snapshot_path != NULL) {
+        snapshot = kvs_open_snapshot(snapshot_path, &_status);
+        
+        if (snapshot != NULL) {
+            _kvs_snapshot_load(new_table, snapshot, &_status);
+            kvs_dispose_table(snapshot, NULL);
+        } // end if
+        
+        // exit if the snapshot could not be loaded
+        if (_status != KVS_STATUS_SUCCESS) {
+            kvs_dispose_table(new_table, NULL);
+            _kvs_set_status(status, _status);
+            return NULL;
+        } // end if
+    } // end if
+    
+    // replay the log on top of the snapshot
+    if (log_path != NULL) {
+        kvs_replay_log(new_table, log_path, &_status);
+        
+        // exit if the log could not be replayed
+        if (_status != KVS_STATUS_SUCCESS) {
+            kvs_dispose_table(new_table, NULL);
+            _kvs_set_status(status, _status);
+            return NULL;
+        } // end if
+    } // end if
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    // return a reference to the new table
+    return (kvs_table_t) new_table;
+} // end kvs_recover_table
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_set_hot_cache( table, slots, status )
+// ---------------------------------------------------------------------------
+//
+// Replaces the hot entry cache of <table>  by an empty cache of <slots> slots
+// rounded up to a power of two.  A cache of one slot is kept within the table,
+// so that every table has a cache  and lookups need not check for one.  The
+// status of the operation is passed back in <status>,  unless NULL was passed
+// in for <status>.
+
+void kvs_set_hot_cache(kvs_table_t table,
+                          cardinal slots,
+                      kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_entry *new_hot;
+    cardinal index, slot_count;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // only tables caching their entries have a hot entry cache
+    if (this_table->flags &
+        (KVS_FLAG_CONCURRENT | KVS_FLAG_COMPACT | KVS_TABLE_READ_ONLY)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_FLAGS);
+        return;
+    } // end if
+    
+    // round up to a power of two within the limit
+    slot_count = 1;
+    while ((slot_count < slots) && (slot_count < KVS_HOT_CACHE_MAX_SLOTS))
+        slot_count = slot_count << 1;
+    
+    if /* one slot */ (slot_count == 1) {
+        new_hot = &this_table->hot_single;
+    }
+    else /* separate slots */ {
+        new_hot = ALLOCATE(sizeof(kvs_entry) * slot_count);
+        
+        // exit if allocation failed
+        if (new_hot == NULL) {
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return;
+        } // end if
+    } // end if
+    
+    for (index = 0; index < slot_count; index++) {
+        new_hot[index] = NULL;
+    } // end for
+    
+    // dispose of the previous cache of more than one slot
+    if (this_table->hot != &this_table->hot_single)
+        DEALLOCATE(this_table->hot);
+    
+    this_table->hot = new_hot;
+    this_table->hot_mask = slot_count - 1;
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return;
+} // end kvs_set_hot_cache
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_cache_stats( table, stats, status )
+// ---------------------------------------------------------------------------
+//
+// Passes back the counters,  bytes held and byte budget  of cache table
+// <table> in <stats>.  The status of the operation is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+void kvs_get_cache_stats(kvs_table_t table,
+                   kvs_cache_stats_t *stats,
+                        kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    
+    // table must not be NULL and must be a cache
+    if ((table == NULL) || NOT(this_table->flags & KVS_TABLE_CACHE)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // stats must not be NULL
+    if (stats == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    stats->hits = this_table->hits;
+    stats->misses = this_table->misses;
+    stats->evictions = this_table->evictions;
+    stats->bytes_used = this_table->bytes_used;
+    stats->byte_budget = this_table->byte_budget;
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return;
+} // end kvs_get_cache_stats
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_filter_stats( table, stats, status )
+// ---------------------------------------------------------------------------
+//
+// Passes back the counters of the lookup filter of <table> in <stats>.  The
+// status of the operation is passed back in <status>,  unless NULL was passed
+// in for <status>.
+
+void kvs_get_filter_stats(kvs_table_t table,
+                   kvs_filter_stats_t *stats,
+                         kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_filter_s *filter;
+    uint64_t absent;
+    
+    // table must not be NULL and must have a filter
+    if ((table == NULL) || (this_table->filter == NULL)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // stats must not be NULL
+    if (stats == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    filter = this_table->filter;
+    absent = filter->rejections + filter->false_positives;
+    
+    stats->rejections = filter->rejections;
+    stats->false_positives = filter->false_positives;
+    stats->false_positive_rate = (absent == 0) ? 0.0 :
+        (double) filter->false_positives / (double) absent;
+    stats->size = ((size_t) filter->block_mask + 1) * KVS_CACHE_LINE_SIZE;
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return;
+} // end kvs_get_filter_stats
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_stats( table, stats, status )
+// ---------------------------------------------------------------------------
+//
+// Passes back the lookup counters of <table>  and  the figures taken by a walk
+// of all its buckets in <stats>.  The status of the operation is passed back
+// in <status>,  unless NULL was passed in for <status>.
+
+void kvs_get_stats(kvs_table_t table,
+                   kvs_stats_t *stats,
+                  kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    cardinal index;
+    
+    // table must not be NULL and must not share the entries of another
+    if ((table == NULL) || (this_table->flags & KVS_TABLE_FROZEN)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // stats must not be NULL
+    if (stats == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    stats->lookups = __atomic_load_n(&this_table->lookups, __ATOMIC_RELAXED);
+    stats->compares =
+        __atomic_load_n(&this_table->compares, __ATOMIC_RELAXED);
+    stats->hot_hits =
+        __atomic_load_n(&this_table->hot_hits, __ATOMIC_RELAXED);
+    stats->compares_per_lookup = (stats->lookups == 0) ? 0.0 :
+        (double) stats->compares / (double) stats->lookups;
+    stats->hot_hit_rate = (stats->lookups == 0) ? 0.0 :
+        (double) stats->hot_hits / (double) stats->lookups;
+    
+    stats->entry_bytes = 0;
+    stats->value_bytes = 0;
+    stats->entry_count = 0;
+    stats->marked_count = 0;
+    stats->bucket_count = 0;
+    stats->longest_chain = 0;
+    for (index = 0; index < KVS_STATS_CHAIN_LENGTHS; index++) {
+        stats->chain_length[index] = 0;
+    } // end for
+    
+    // walk the buckets by the storage scheme of the table
+    if (this_table->flags & KVS_TABLE_SNAPSHOT)
+        _kvs_stats_walk_snapshot(this_table, stats);
+    else if (this_table->flags & KVS_FLAG_COMPACT)
+        _kvs_stats_walk_compact(this_table, stats);
+    else
+        _kvs_stats_walk(this_table, stats);
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return;
+} // end kvs_get_stats
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_number_of_buckets( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the number of buckets  of KVS table <table>,  returns zero if NULL
+// is passed in for <table>.
+
+cardinal kvs_number_of_buckets(kvs_table_t table) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+
+    if (table != NULL) return this_table->bucket_count;
+    else return 0;
+    
+} // end kvs_number_of_buckets
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_number_of_entries( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the number of entries  stored in KVS table <table>,  returns  zero
+// if NULL is passed in for <table>.
+
+cardinal kvs_number_of_entries(kvs_table_t table) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+
+    if (table != NULL) return this_table->entry_count;
+    else return 0;        
+    
+} // end kvs_number_of_entries
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_dispose_table( table, status )
+// ---------------------------------------------------------------------------
+//
+// Disposes of  KVS table object <table>,  deallocating  all its entries.  The
+// table and its entries are disposed of  regardless of any references held to
+// any values stored in the table.  Buckets still shared with snapshots taken
+// by kvs_snapshot() are copied into the snapshots first,  if they cannot be
+// copied,  then nothing is disposed of and KVS_STATUS_ALLOCATION_FAILED is
+// passed back.  The status of the operation is passed back in <status>,
+// unless  NULL  was passed in for <status>.
+
+void kvs_dispose_table(kvs_table_t table, kvs_status_t *status) {
+    cardinal index;
+    bool log_closed = true;
+    kvs_entry prev_entry, this_entry;
+    kvs_frozen_s *frozen;
+    kvs_table_s *this_table = (kvs_table_s *) table;
+
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // snapshots of the table keep a copy of the buckets they still share
+    if ((this_table->frozen != NULL) &&
+        NOT(this_table->flags & KVS_TABLE_FROZEN)) {
+        
+        // exit if the buckets could not be saved
+        if (NOT(_kvs_frozen_detach_all(this_table))) {
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return;
+        } // end if
+        
+        for (frozen = this_table->frozen; frozen != NULL;
+             frozen = frozen->next) {
+            frozen->origin = NULL;
+        } // end for
+    } // end if
+    
+    // sync and close the write-ahead log
+    if (this_table->log != NULL)
+        log_closed = _kvs_log_close(this_table->log);
+    
+    if /* snapshot */ (this_table->flags & KVS_TABLE_SNAPSHOT) {
+        
+        // unmap the snapshot,  there are no entries
+        _kvs_snapshot_unmap(this_table->snapshot, this_table->snapshot_size);
+    }
+    else if /* frozen */ (this_table->flags & KVS_TABLE_FROZEN) {
+        
+        // dispose of the saved chains,  the buckets are those of the origin
+        _kvs_frozen_dispose(this_table);
+    }
+    else if /* open addressing */
+            (this_table->flags & KVS_FLAG_OPEN_ADDRESSING) {
+        
+        // dispose of the entries in all full slots
+        for (index = 0; index < this_table->bucket_count; index++) {
+            if (this_table->slot[index].entry != NULL)
+                _kvs_dispose_entry(this_table,
+                                   this_table->slot[index].entry, NULL);
+        } // end for
+        
+        // dispose of slots and control bytes
+        DEALLOCATE(this_table->slot);
+        DEALLOCATE(this_table->ctrl);
+    }
+    else if /* compact */ (this_table->flags & KVS_FLAG_COMPACT) {
+        
+        // dispose of records,  values not taken from the slab and buckets
+        _kvs_compact_dispose(this_table->compact);
+    }
+    else /* separate chaining */ {
+        
+        // dispose of any chains not yet migrated
+        if (this_table->old_bucket != NULL) {
+            
+            // finish migration, then all chains are in the new bucket array
+            _kvs_migrate_buckets(this_table, this_table->old_bucket_count);
+            
+        } // end if
+        
+        for (index = 0; index < this_table->bucket_count; index++) {
+        
+            this_entry = this_table->bucket[index];
+            
+            while (this_entry != NULL) {
+                prev_entry = this_entry;
+                this_entry = this_entry->next;
+                _kvs_dispose_entry(this_table, prev_entry, NULL);
+            } // end while
+            
+            this_table->bucket[index] = NULL;
+            
+        } // end for
+        
+        // dispose of entries pending removal in the graveyard
+        if (this_table->grave != NULL) {
+            for (index = 0; index <= this_table->grave_mask; index++) {
+                this_entry = this_table->grave[index];
+                while (this_entry != NULL) {
+                    prev_entry = this_entry;
+                    this_entry = this_entry->next;
+                    _kvs_dispose_entry(this_table, prev_entry, NULL);
+                } // end while
+            } // end for
+            DEALLOCATE(this_table->grave);
+        } // end if
+        
+        // dispose of retired entries, locks and epochs
+        if (this_table->cc != NULL)
+            _kvs_cc_dispose(this_table);
+        
+        // dispose of bucket array
+        DEALLOCATE(this_table->bucket);
+        
+    } // end if
+    
+    // dispose of all slab chunks at once
+    _kvs_slab_dispose(this_table->slab);
+    
+    // dispose of the timing wheel
+    DEALLOCATE(this_table->wheel);
+    
+    // dispose of the lookup filter
+    _kvs_filter_dispose(this_table->filter);
+    
+    // dispose of the value store,  its values have been released
+    _kvs_value_store_dispose(this_table->values);
+    
+    // dispose of a hot entry cache of more than one slot
+    if (this_table->hot != &this_table->hot_single)
+        DEALLOCATE(this_table->hot);
+    
+    // dispose of all entries built with the table at once
+    DEALLOCATE(this_table->arena);
+    DEALLOCATE(this_table->old_arena);
+    
+    // dispose table base
+    DEALLOCATE(this_table);
+    
+    // set status
+    if (log_closed) {
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    }
+    else {
+        _kvs_set_status(status, KVS_STATUS_FILE_ERROR);
+    } // end if
+    
+    return;
+} // end kvs_dispose_table
+
+
+// ===========================================================================
+// P R I V A T E   F U N C T I O N   I M P L E M E N T A T I O N S
+// ===========================================================================
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_find_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// If an entry for <key> exists in <table> then the function returns a pointer
+// to the entry,  otherwise  it returns NULL.  If the entry has expired,  then
+// it is removed and NULL is returned,  or if it is still referenced,  it is
+// marked for removal and returned.  The  reference count  of the entry is
+// not  incremented by this function.  The  status  of the operation  is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+static kvs_entry _kvs_find_entry(kvs_table_t table,
+                                   kvs_key_t key,
+                                kvs_status_t *status) {
+    kvs_table_s *this_table = (kvs_table_s *) table;
+    kvs_entry this_entry;
+    
+    // concurrent tables are read without caching
+    if (this_table->flags & KVS_FLAG_CONCURRENT)
+        return _kvs_cc_find_entry(this_table, key, status);
+    
+    // check if the entry has been cached by a previous lookup
+    this_entry = *_kvs_hot_slot(this_table, key);
+    
+    if /* cached */ ((this_entry != NULL) && (this_entry->key == key)) {
+        _kvs_stats_hot_hit(this_table);
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    }
+    else if /* rejected by the filter */ ((this_table->filter != NULL) &&
+             NOT(_kvs_filter_query(this_table, key))) {
+        _kvs_stats_lookup(this_table, 0);
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+        return NULL;
+    }
+    else /* not cached */ {
+        this_entry = _kvs_locate_entry(this_table, key, status);
+        
+        // count keys passed by the filter that are not in the table
+        if ((this_entry == NULL) && (this_table->filter != NULL))
+            this_table->filter->false_positives++;
+    } // end if
+    
+    // remove an expired entry as soon as it is found
+    if ((this_entry != NULL) && (this_entry->expires != 0) &&
+        (this_entry->expires <= kvs_current_time()) &&
+        NOT(this_entry->marked_for_removal))
+        this_entry = _kvs_expire_entry(this_table, this_entry, status);
+    
+    return this_entry;
+} // end _kvs_find_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_locate_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// If an entry for <key> exists in non-concurrent table <table>  then the
+// function returns a pointer to the entry,  otherwise  it returns NULL.  If
+// the entry is found,  then it will be cached in the hot entry cache of the
+// table,  and a subsequent request to find the same entry  will then return
+// the cached entry pointer  without searching the table.  The status of the
+// operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+static kvs_entry _kvs_locate_entry(kvs_table_s *table,
+                                     kvs_key_t key,
+                                  kvs_status_t *status) {
+    cardinal index, compared = 0;
+    kvs_entry this_entry, *bucket;
+    
+    if /* open addressing */ (table->flags & KVS_FLAG_OPEN_ADDRESSING) {
+        
+        index = _kvs_oa_find_slot(table, key);
+        
+        if /* key not found */ (index == KVS_OA_NOT_FOUND) {
+            _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+            return NULL;
+        } // end if
+        
+        // cache the entry for faster subsequent lookup
+        this_entry = table->slot[index].entry;
+        *_kvs_hot_slot(table, key) = this_entry;
+        
+        // set status and return pointer to entry found
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        return this_entry;
+    } // end if
+    
+    // advance an ongoing resize
+    if (table->old_bucket != NULL)
+        _kvs_migrate_buckets(table, KVS_RESIZE_MIGRATION_STEP);
+    
+    // determine the bucket for key
+    bucket = _kvs_bucket_for_key(table, key);
+    
+    // first entry in this bucket is starting point
+    this_entry = *bucket;
+    
+    // check every entry in this bucket for a key match
+    while ((this_entry != NULL) && (this_entry->key != key)) {
+        this_entry = this_entry->next;
+        compared++;
+    } // end while
+    
+    _kvs_stats_lookup(table, compared + ((this_entry != NULL) ? 1 : 0));
+    
+    // entries pending removal may have been moved to the graveyard
+    if ((this_entry == NULL) && (table->grave_count > 0))
+        this_entry = _kvs_grave_find(table, key);
+    
+    if /* key matched */ (this_entry != NULL) {
+        
+        // cache the entry for faster subsequent lookup
+        *_kvs_hot_slot(table, key) = this_entry;
+        
+        // set status
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        
+        // return pointer to entry found
+        return this_entry;
+    }
+    else /* key did not match */ {
+        
+        // set status
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+        
+        // return null, indicating entry not found
+        return NULL;
+    } // end if
+} // end _kvs_locate_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_cc_find_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// If an entry for <key> exists  in concurrent table <table>,  then a pointer to
+// the entry is returned,  otherwise NULL.  The chain is traversed without any
+// lock while writers may link and unlink entries.  The caller must be within
+// an epoch of the table for as long as it uses the returned entry.  Entries
+// are not cached.  The status of the operation is passed back in <status>,
+// unless NULL was passed in for <status>.
+
+static kvs_entry _kvs_cc_find_entry(kvs_table_s *table,
+                                      kvs_key_t key,
+                                   kvs_status_t *status) {
+    kvs_entry this_entry;
+    cardinal compared = 0;
+    
+    this_entry = __atomic_load_n(
+        &table->bucket[_kvs_bucket_index(table, key, table->bucket_count)],
+        __ATOMIC_ACQUIRE);
+    
+    // check every entry in this bucket for a key match
+    while ((this_entry != NULL) && (this_entry->key != key)) {
+        this_entry = __atomic_load_n(&this_entry->next, __ATOMIC_ACQUIRE);
+        compared++;
+    } // end while
+    
+    _kvs_stats_lookup(table, compared + ((this_entry != NULL) ? 1 : 0));
+    
+    if /* key matched */ (this_entry != NULL) {
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    }
+    else /* key did not match */ {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    } // end if
+    
+    return this_entry;
+} // end _kvs_cc_find_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_add_entry( table, key, val, size, nt, by_copy, st )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry for <key> to <table>  unless an entry for <key> exists.  If
+// <by_copy> is true,  then  the new entry holds a copy of the data at <value>,
+// otherwise it holds a reference to <value>.  The  status  of the operation is
+// passed back in <status>,  unless NULL was passed in for <status>.
+//
+// pre-conditions:
+//
+//  This function DOES NOT CHECK pre-conditions.  The caller MUST ENFORCE pre-
+//  conditions before calling this function:
+//
+//  o  table must never be NULL
+//  o  key must never be 0
+//  o  size must never be 0
+//  o  value must never be NULL
+
+static void _kvs_add_entry(kvs_table_s *table,
+                             kvs_key_t key,
+                            kvs_data_t value,
+                              cardinal size,
+                                  bool null_terminated,
+                                  bool by_copy,
+                            kvs_time_t expires,
+                          kvs_status_t *status) {
+    kvs_entry *bucket;
+    kvs_entry_s *new_entry = NULL;
+    kvs_entry_s *this_entry = NULL;
+    kvs_status_t _status;
+    
+    // snapshot tables cannot be modified
+    if (table->flags & KVS_TABLE_READ_ONLY) {
+        _kvs_set_status(status, KVS_STATUS_TABLE_READ_ONLY);
+        return;
+    } // end if
+    
+    // compact tables add to their records
+    if (table->flags & KVS_FLAG_COMPACT) {
+        _kvs_compact_add_entry(table, key, value, size,
+                               null_terminated, by_copy, &_status);
+        
+        // log the store once it has been applied
+        if ((_status == KVS_STATUS_SUCCESS) && (table->log != NULL) &&
+            NOT(_kvs_log_append(table->log, KVS_LOG_RECORD_STORE, key,
+                                value, size, null_terminated, 0)))
+            _status = KVS_STATUS_FILE_ERROR;
+        
+        _kvs_set_status(status, _status);
+        return;
+    } // end if
+    
+    // an expired entry for key must not keep the new entry out
+    if (table->wheel != NULL)
+        _kvs_find_entry(table, key, NULL);
+    
+    // allocate the timing wheel with the first entry that expires
+    if ((expires != 0) && (table->wheel == NULL)) {
+        table->wheel = _kvs_wheel_new();
+        
+        // exit if allocation failed
+        if (table->wheel == NULL) {
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return;
+        } // end if
+    } // end if
+    
+    // open addressing tables add to their slots
+    if (table->flags & KVS_FLAG_OPEN_ADDRESSING) {
+        _kvs_oa_add_entry(table, key, value, size,
+                          null_terminated, by_copy, expires, &_status);
+        
+        // log the store once it has been applied
+        if ((_status == KVS_STATUS_SUCCESS) && (table->log != NULL) &&
+            NOT(_kvs_log_append(table->log, KVS_LOG_RECORD_STORE, key,
+                                value, size, null_terminated,
+                                expires)))
+            _status = KVS_STATUS_FILE_ERROR;
+        
+        // evict entries of a cache that exceeds its budget
+        if ((table->flags & KVS_TABLE_CACHE) &&
+            (table->bytes_used > table->byte_budget))
+            _kvs_cache_evict(table, key);
+        
+        _kvs_set_status(status, _status);
+        return;
+    } // end if
+    
+    // advance an ongoing resize
+    if (table->old_bucket != NULL)
+        _kvs_migrate_buckets(table, KVS_RESIZE_MIGRATION_STEP);
+    
+    // determine and lock the bucket for key
+    bucket = _kvs_bucket_for_key(table, key);
+    _kvs_lock_bucket(table, bucket);
+    
+    // check every entry in this bucket for a key match
+    this_entry = *bucket;
+    if (this_entry != NULL) {
+        while ((this_entry->key != key) && (this_entry->next != NULL))
+            this_entry = this_entry->next;
+        
+        // do not add a new entry if the key is not unique
+        if (this_entry->key == key) {
+            _kvs_unlock_bucket(table, bucket);
+            _kvs_set_status(status, KVS_STATUS_KEY_NOT_UNIQUE);
+            return;
+        } // end if
+    } // end if
+    
+    // an entry pending removal keeps its key in the graveyard
+    if ((table->grave_count > 0) && (_kvs_grave_find(table, key) != NULL)) {
+        _kvs_unlock_bucket(table, bucket);
+        _kvs_set_status(status, KVS_STATUS_KEY_NOT_UNIQUE);
+        return;
+    } // end if
+    
+    // snapshots sharing the bucket keep a copy of it before it changes
+    if ((table->frozen != NULL) && NOT(_kvs_frozen_detach(table, bucket))) {
+        _kvs_unlock_bucket(table, bucket);
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return;
+    } // end if
+    
+    // create a new entry
+    if (by_copy)
+        new_entry =
+        _kvs_new_entry_with_copy(table, key, value, size,
+                                 null_terminated, &_status);
+    else
+        new_entry =
+        _kvs_new_entry_with_ref(key, value, size, null_terminated, &_status);
+    
+    // exit if allocation failed
+    if (new_entry == NULL) {
+        _kvs_unlock_bucket(table, bucket);
+        _kvs_set_status(status, _status);
+        return;
+    } // end if
+    
+    // the new entry is published to concurrent readers fully initialised
+    if /* bucket is empty */ (this_entry == NULL) {
+        // link the empty bucket to the new entry
+        __atomic_store_n(bucket, new_entry, __ATOMIC_RELEASE);
+    }
+    else /* bucket is not empty */ {
+        // link the final entry in the chain to the new entry
+        __atomic_store_n(&this_entry->next, new_entry, __ATOMIC_RELEASE);
+    } // end if
+    
+    // put the new entry on the CLOCK ring of a cache
+    if (table->flags & KVS_TABLE_CACHE)
+        _kvs_cache_insert(table, new_entry);
+    
+    // schedule the expiry of the new entry
+    if (expires != 0) {
+        new_entry->expires = expires;
+        _kvs_wheel_insert(table->wheel, new_entry);
+    } // end if
+    
+    // log the store under the bucket lock to keep the order of stores and
+    // removals for the same key
+    _status = KVS_STATUS_SUCCESS;
+    if ((table->log != NULL) &&
+        NOT(_kvs_log_append(table->log, KVS_LOG_RECORD_STORE, key,
+                            value, size, null_terminated, expires)))
+        _status = KVS_STATUS_FILE_ERROR;
+    
+    _kvs_unlock_bucket(table, bucket);
+    
+    // count the new entry in the lookup filter
+    if (table->filter != NULL)
+        _kvs_filter_add(table, key);
+    
+    // update the entry counter
+    if (table->flags & KVS_FLAG_CONCURRENT)
+        __atomic_fetch_add(&table->entry_count, 1, __ATOMIC_RELAXED);
+    else
+        table->entry_count++;
+    
+    // start to grow the table if the load factor threshold has been exceeded
+    if ((table->flags & KVS_FLAG_INCREMENTAL_RESIZE) &&
+        (table->old_bucket == NULL) &&
+        ((uint64_t) table->entry_count * 100 >
+         (uint64_t) table->bucket_count * KVS_RESIZE_LOAD_FACTOR))
+        _kvs_start_resize(table);
+    
+    // evict entries of a cache that exceeds its budget
+    if ((table->flags & KVS_TABLE_CACHE) &&
+        (table->bytes_used > table->byte_budget))
+        _kvs_cache_evict(table, key);
+    
+    // set status
+    _kvs_set_status(status, _status);
+    
+    return;
+} // end _kvs_add_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_hash( table, key )
+// ---------------------------------------------------------------------------
+//
+// Returns a 64 bit hash value for <key>  in <table>.  The function is the
+// finaliser of MurmurHash3 applied to the key XORed with the random seed of
+// the table,  every key bit affects every hash bit so that sequential keys are
+// spread evenly,  and the seed keeps the placement of keys unpredictable.  In
+// open addressing tables,  the low seven bits are stored in the control byte
+// of the slot,  the remaining bits select the first group probed.
+
+static fmacro uint64_t _kvs_hash(kvs_table_s *table, kvs_key_t key) {
+    uint64_t hash = (uint64_t) key ^ table->seed;
+    
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    
+    return hash;
+} // end _kvs_hash
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_bucket_index( table, key, bucket_count )
+// ---------------------------------------------------------------------------
+//
+// Returns the index of the bucket for <key>  in a bucket array of <table> with
+// <bucket_count> buckets.  Tables with power of two buckets mask the hash of
+// the key,  other tables take the remainder of the key itself.
+
+static fmacro cardinal _kvs_bucket_index(kvs_table_s *table,
+                                           kvs_key_t key,
+                                            cardinal bucket_count) {
+    
+    if (table->flags & KVS_FLAG_POWER_OF_TWO_BUCKETS)
+        return (cardinal) (_kvs_hash(table, key) & (bucket_count - 1));
+    else
+        return (cardinal) (key % bucket_count);
+    
+} // end _kvs_bucket_index
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_new_seed( table )
+// ---------------------------------------------------------------------------
+//
+// Returns a new random seed for <table>.  The seed is derived from the time,
+// the processor clock,  the address of the table and a process wide counter,
+// so that tables created at the same time still receive different seeds.  It
+// is not suitable for cryptographic purposes.
+
+static uint64_t _kvs_new_seed(kvs_table_s *table) {
+    static cardinal counter = 0;
+    uint64_t seed;
+    
+    seed = (uint64_t) time(NULL);
+    seed ^= (uint64_t) clock() << 32;
+    seed ^= (uint64_t) (uintptr_t) table;
+    seed ^= (uint64_t) __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED) *
+            0x9e3779b97f4a7c15ULL;
+    
+    // mix all bits
+    seed ^= seed >> 33;
+    seed *= 0xff51afd7ed558ccdULL;
+    seed ^= seed >> 33;
+    seed *= 0xc4ceb9fe1a85ec53ULL;
+    seed ^= seed >> 33;
+    
+    return seed;
+} // end _kvs_new_seed
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_bucket_for_key( table, key )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the bucket of chained table <table>  that holds or will
+// hold the entry for <key>.  While the table is being resized,  this is the old
+// bucket if it has not been migrated yet,  otherwise it is the new bucket.
+
+static fmacro kvs_entry *_kvs_bucket_for_key(kvs_table_s *table,
+                                               kvs_key_t key) {
+    cardinal index;
+    
+    if (table->old_bucket != NULL) {
+        index = _kvs_bucket_index(table, key, table->old_bucket_count);
+        if (index >= table->migrated_count)
+            return &table->old_bucket[index];
+    } // end if
+    
+    return &table->bucket[_kvs_bucket_index(table, key, table->bucket_count)];
+} // end _kvs_bucket_for_key
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_start_resize( table )
+// ---------------------------------------------------------------------------
+//
+// Replaces the bucket array of chained table <table>  by a new bucket array of
+// about twice the size and keeps the current bucket array as old bucket array
+// from which chains are then migrated by _kvs_migrate_buckets().  If the new
+// bucket array cannot be allocated,  or the buckets shared with snapshots of
+// the table cannot be saved,  the table is left unchanged and growth is
+// attempted again on a subsequent insertion.
+
+static void _kvs_start_resize(kvs_table_s *table) {
+    kvs_entry *new_bucket;
+    cardinal index, new_count;
+    
+    // an odd bucket count spreads keys better with a modulo bucket index
+    if (table->bucket_count > ((cardinal) 1 << (sizeof(cardinal) * 8 - 2)))
+        return;
+    if (table->flags & KVS_FLAG_POWER_OF_TWO_BUCKETS)
+        new_count = table->bucket_count * 2;
+    else
+        new_count = table->bucket_count * 2 + 1;
+    
+    // snapshots sharing the bucket array keep a copy of all shared buckets
+    if ((table->frozen != NULL) && NOT(_kvs_frozen_detach_all(table)))
+        return;
+    
+    new_bucket = ALLOCATE(sizeof(kvs_entry) * new_count);
+    
+    // exit if allocation failed
+    if (new_bucket == NULL)
+        return;
+    
+    for (index = 0; index < new_count; index++) {
+        new_bucket[index] = NULL;
+    } // end for
+    
+    table->old_bucket = table->bucket;
+    table->old_bucket_count = table->bucket_count;
+    table->migrated_count = 0;
+    table->bucket = new_bucket;
+    table->bucket_count = new_count;
+    
+    return;
+} // end _kvs_start_resize
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_migrate_buckets( table, count )
+// ---------------------------------------------------------------------------
+//
+// Migrates the chains of up to <count> old buckets of chained table <table>
+// into its new bucket array.  Entries are relinked,  not reallocated,  so their
+// reference counts,  removal marks and the cached last retrieved entry remain
+// valid.  When the last old bucket has been migrated,  the old bucket array is
+// deallocated.
+
+static void _kvs_migrate_buckets(kvs_table_s *table, cardinal count) {
+    kvs_entry this_entry, next_entry, *bucket;
+    
+    while ((count > 0) && (table->migrated_count < table->old_bucket_count)) {
+        
+        // move every entry of this old bucket to the head of its new bucket
+        this_entry = table->old_bucket[table->migrated_count];
+        while (this_entry != NULL) {
+            next_entry = this_entry->next;
+            bucket = &table->bucket[_kvs_bucket_index(table, this_entry->key,
+                                                      table->bucket_count)];
+            this_entry->next = *bucket;
+            *bucket = this_entry;
+            this_entry = next_entry;
+        } // end while
+        
+        table->old_bucket[table->migrated_count] = NULL;
+        table->migrated_count++;
+        count--;
+    } // end while
+    
+    // dispose of the old bucket array when migration is complete
+    if (table->migrated_count == table->old_bucket_count) {
+        DEALLOCATE(table->old_bucket);
+        table->old_bucket = NULL;
+        table->old_bucket_count = 0;
+        table->migrated_count = 0;
+    } // end if
+    
+    return;
+} // end _kvs_migrate_buckets
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_prefetch_group( table, keys, count )
+// ---------------------------------------------------------------------------
+//
+// Issues prefetches for the lookup of <count> keys in array <keys>  in <table>
+// in two passes.  The first pass prefetches the buckets,  or control bytes and
+// slots,  of all keys.  The second pass then reads the buckets,  or matches the
+// control bytes,  and prefetches the first entry that may hold each key.  Both
+// passes are only hints and do not modify the table.
+
+static void _kvs_prefetch_group(kvs_table_s *table,
+                           const kvs_key_t *keys,
+                                  cardinal count) {
+    cardinal index, base, group_mask;
+    kvs_entry *bucket[KVS_BATCH_GROUP_SIZE];
+    kvs_entry first;
+    cardinal slot_base[KVS_BATCH_GROUP_SIZE];
+    cardinal bucket_index[KVS_BATCH_GROUP_SIZE];
+    octet_t h2[KVS_BATCH_GROUP_SIZE];
+    uint64_t hash;
+    uint32_t match;
+    const uint32_t *start;
+    
+    if /* snapshot */ (table->flags & KVS_TABLE_SNAPSHOT) {
+        start = (const uint32_t *) (table->snapshot +
+            ((const kvs_snapshot_header_s *) table->snapshot)->start_offset);
+        
+        // record index of every bucket,  records follow on first use
+        for (index = 0; index < count; index++) {
+            __builtin_prefetch(&start[_kvs_hash(table, keys[index]) &
+                                      (table->bucket_count - 1)]);
+        } // end for
+    }
+    else if /* frozen */ (table->flags & KVS_TABLE_FROZEN) {
+        
+        // saved chain of every bucket,  shared buckets are read under a lock
+        for (index = 0; index < count; index++) {
+            __builtin_prefetch(&table->frozen->saved[
+                _kvs_bucket_index(table, keys[index], table->bucket_count)]);
+        } // end for
+    }
+    else if /* open addressing */ (table->flags & KVS_FLAG_OPEN_ADDRESSING) {
+        group_mask = table->bucket_count / KVS_OA_GROUP_WIDTH - 1;
+        
+        // first pass: control bytes and slots of the first probed group
+        for (index = 0; index < count; index++) {
+            hash = _kvs_hash(table, keys[index]);
+            base = ((cardinal) (hash >> 7) & group_mask) * KVS_OA_GROUP_WIDTH;
+            h2[index] = (octet_t) (hash & 0x7F);
+            slot_base[index] = base;
+            __builtin_prefetch(&table->ctrl[base]);
+            __builtin_prefetch(&table->slot[base]);
+        } // end for
+        
+        // second pass: entry of the first slot with a matching fragment
+        for (index = 0; index < count; index++) {
+            base = slot_base[index];
+            match = _kvs_oa_match_byte(&table->ctrl[base], h2[index]);
+            if (match != 0)
+                __builtin_prefetch(
+                    table->slot[base + __builtin_ctz(match)].entry);
+        } // end for
+    }
+    else if /* compact */ (table->flags & KVS_FLAG_COMPACT) {
+        
+        // first pass: buckets
+        for (index = 0; index < count; index++) {
+            bucket_index[index] =
+                _kvs_bucket_index(table, keys[index], table->bucket_count);
+            __builtin_prefetch(&table->compact->bucket[bucket_index[index]]);
+        } // end for
+        
+        // second pass: first record of each chain
+        for (index = 0; index < count; index++) {
+            match = table->compact->bucket[bucket_index[index]];
+            if (match != 0)
+                __builtin_prefetch(
+                    _kvs_compact_record(table->compact, match));
+        } // end for
+    }
+    else /* separate chaining */ {
+        
+        // first pass: buckets
+        for (index = 0; index < count; index++) {
+            bucket[index] = _kvs_bucket_for_key(table, keys[index]);
+            __builtin_prefetch(bucket[index]);
+        } // end for
+        
+        // second pass: first entry of each chain
+        for (index = 0; index < count; index++) {
+            first = __atomic_load_n(bucket[index], __ATOMIC_RELAXED);
+            if (first != NULL)
+                __builtin_prefetch(first);
+        } // end for
+    } // end if
+    
+    return;
+} // end _kvs_prefetch_group
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_remove( table, key, expected, status )
+// ---------------------------------------------------------------------------
+//
+// Removes the entry for <key> from <table>  if its reference count is one or
+// less,  otherwise marks the entry for removal.  If <expected> is not NULL,
+// then the entry is only removed if it is <expected>,  so that a release does
+// not remove an entry which has since been replaced under the same key.  The
+// status of the operation is passed back in <status>,  unless NULL was passed
+// in for <status>.
+
+static void _kvs_remove(kvs_table_s *table,
+                          kvs_key_t key,
+                          kvs_entry expected,
+                       kvs_status_t *status) {
+    kvs_entry prev_entry, this_entry, *bucket, *chain;
+    kvs_status_t _status;
+    
+    // snapshot tables cannot be modified
+    if (table->flags & KVS_TABLE_READ_ONLY) {
+        _kvs_set_status(status, KVS_STATUS_TABLE_READ_ONLY);
+        return;
+    } // end if
+    
+    // compact tables remove from their records
+    if (table->flags & KVS_FLAG_COMPACT) {
+        _kvs_compact_remove(table, key, NULL, &_status);
+        
+        // log requested removals,  not those completed by a release
+        if ((_status == KVS_STATUS_SUCCESS) && (expected == NULL) &&
+            (table->log != NULL) &&
+            NOT(_kvs_log_append(table->log, KVS_LOG_RECORD_REMOVE, key,
+                                NULL, 0, false, 0)))
+            _status = KVS_STATUS_FILE_ERROR;
+        
+        _kvs_set_status(status, _status);
+        return;
+    } // end if
+    
+    // open addressing tables remove from their slots
+    if (table->flags & KVS_FLAG_OPEN_ADDRESSING) {
+        _kvs_oa_remove_entry(table, key, &_status);
+        
+        // log requested removals,  not those completed by a release
+        if ((_status == KVS_STATUS_SUCCESS) && (expected == NULL) &&
+            (table->log != NULL) &&
+            NOT(_kvs_log_append(table->log, KVS_LOG_RECORD_REMOVE, key,
+                                NULL, 0, false, 0)))
+            _status = KVS_STATUS_FILE_ERROR;
+        
+        _kvs_set_status(status, _status);
+        return;
+    } // end if
+    
+    // determine and lock the bucket for key
+    bucket = _kvs_bucket_for_key(table, key);
+    _kvs_lock_bucket(table, bucket);
+    
+    // move to next entry until key matches or last entry is reached
+    prev_entry = NULL;
+    this_entry = *bucket;
+    while ((this_entry != NULL) && (this_entry->key != key)) {
+        prev_entry = this_entry;
+        this_entry = this_entry->next;
+    } // end while
+    
+    // entries pending removal may have been moved to the graveyard
+    chain = bucket;
+    if ((this_entry == NULL) && (table->grave_count > 0)) {
+        chain = _kvs_grave_for_key(table, key);
+        prev_entry = NULL;
+        this_entry = *chain;
+        while ((this_entry != NULL) && (this_entry->key != key)) {
+            prev_entry = this_entry;
+            this_entry = this_entry->next;
+        } // end while
+    } // end if
+    
+    if /* key did not match */
+       ((this_entry == NULL) ||
+        ((expected != NULL) && (this_entry != expected))) {
+    
+        // entry not found
+    
+        // set status
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    }
+    else if /* snapshots sharing the bucket cannot keep a copy of it */
+            ((chain == bucket) && (table->frozen != NULL) &&
+             NOT(_kvs_frozen_detach(table, bucket))) {
+    
+        // nothing is removed and nothing is logged
+        this_entry = NULL;
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+    }
+    else if /* reference count is 1 or less */
+            (_kvs_unpin_last(table, this_entry)) {
+    
+        // the entry leaves the graveyard
+        if (chain != bucket)
+            table->grave_count--;
+    
+        // remove the entry
+        _kvs_unlink_entry(table, chain, prev_entry, this_entry, status);
+    }
+    else /* reference count > 1 */ {
+    
+        // don't remove the entry yet, mark it for removal
+        __atomic_store_n(&this_entry->marked_for_removal, true,
+                         __ATOMIC_SEQ_CST);
+    
+        // the last other reference may have been released concurrently
+        // before the mark became visible to the releasing thread
+        if (_kvs_unpin_last(table, this_entry)) {
+    
+            // the entry leaves the graveyard
+            if (chain != bucket)
+                table->grave_count--;
+    
+            _kvs_unlink_entry(table, chain, prev_entry, this_entry, status);
+        }
+        else {
+            // move the entry out of its chain until it is released
+            if ((chain == bucket) && NOT(table->flags & KVS_FLAG_CONCURRENT))
+                _kvs_bury_entry(table, bucket, prev_entry, this_entry);
+            
+            _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        } // end if
+    } // end if
+    
+    // log requested removals under the bucket lock,  but not those completed
+    // by a release,  a marked entry is logged as removed when it is marked
+    if ((this_entry != NULL) && (expected == NULL) && (table->log != NULL) &&
+        NOT(_kvs_log_append(table->log, KVS_LOG_RECORD_REMOVE, key,
+                            NULL, 0, false, 0)))
+        _kvs_set_status(status, KVS_STATUS_FILE_ERROR);
+    
+    _kvs_unlock_bucket(table, bucket);
+    
+    return;
+} // end _kvs_remove
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_unlink_entry( table, bucket, prev, entry, status )
+// ---------------------------------------------------------------------------
+//
+// Unlinks <entry> from <bucket> of chained table <table>,  in which <prev> is
+// its predecessor or NULL if <entry> is first.  The entry is deallocated,  or
+// in a concurrent table retired  until no reader can hold a pointer to it.
+// The caller must hold the lock of <bucket>.
+
+static void _kvs_unlink_entry(kvs_table_s *table,
+                                kvs_entry *bucket,
+                                kvs_entry prev,
+                                kvs_entry entry,
+                             kvs_status_t *status) {
+    
+    // if cached, remove the entry from the cache
+    _kvs_hot_forget(table, entry);
+    
+    // link predecessor or bucket root to successor,
+    // concurrent readers may still be traversing the unlinked entry
+    if /* first entry */ (prev == NULL)
+        __atomic_store_n(bucket, entry->next, __ATOMIC_RELEASE);
+    else /* not first entry */
+        __atomic_store_n(&prev->next, entry->next, __ATOMIC_RELEASE);
+    
+    if /* concurrent */ (table->flags & KVS_FLAG_CONCURRENT) {
+    
+        // deallocate the entry once all current readers have left
+        _kvs_retire_entry(table, entry);
+        __atomic_fetch_sub(&table->entry_count, 1, __ATOMIC_RELAXED);
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    }
+    else {
+    
+        // remove the entry from the lookup filter
+        if (table->filter != NULL)
+            _kvs_filter_remove(table, entry->key);
+    
+        // deallocate the entry
+        _kvs_dispose_entry(table, entry, status);
+    
+        // update the entry counter
+        table->entry_count--;
+    } // end if
+    
+    return;
+} // end _kvs_unlink_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_pin_entry( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Increments the reference count of <entry> and returns true.  In concurrent
+// tables,  the count is only incremented  if  the  entry has  neither  been
+// marked for removal  nor been claimed for removal,  otherwise false is
+// returned.
+
+static fmacro bool _kvs_pin_entry(kvs_table_s *table, kvs_entry entry) {
+    word_t count;
+    
+    if (NOT(table->flags & KVS_FLAG_CONCURRENT)) {
+        entry->ref_count++;
+        return true;
+    } // end if
+    
+    count = __atomic_load_n(&entry->ref_count, __ATOMIC_ACQUIRE);
+    repeat {
+        // a count of zero means the entry has been claimed for removal
+        if ((count == 0) || (_kvs_is_marked(entry)))
+            return false;
+    } until (__atomic_compare_exchange_n(&entry->ref_count, &count, count + 1,
+                     false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    
+    return true;
+} // end _kvs_pin_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_unpin_entry( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Decrements the reference count of <entry> if it is greater than one,  and
+// returns the new count.  Returns zero if the count was not decremented.
+
+static fmacro cardinal _kvs_unpin_entry(kvs_table_s *table, kvs_entry entry) {
+    word_t count;
+    
+    if (NOT(table->flags & KVS_FLAG_CONCURRENT)) {
+        if (entry->ref_count <= 1)
+            return 0;
+        entry->ref_count--;
+        return entry->ref_count;
+    } // end if
+    
+    count = __atomic_load_n(&entry->ref_count, __ATOMIC_ACQUIRE);
+    repeat {
+        if (count <= 1)
+            return 0;
+    } until (__atomic_compare_exchange_n(&entry->ref_count, &count, count - 1,
+                     false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE));
+    
+    return count - 1;
+} // end _kvs_unpin_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_unpin_last( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Returns true if <entry> may be unlinked because no reference other than the
+// table's own is held.  In concurrent tables,  the count is atomically changed
+// from one to zero so that no reader can pin the entry thereafter.
+
+static fmacro bool _kvs_unpin_last(kvs_table_s *table, kvs_entry entry) {
+    word_t count = 1;
+    
+    if (NOT(table->flags & KVS_FLAG_CONCURRENT))
+        return (entry->ref_count <= 1);
+    
+    return __atomic_compare_exchange_n(&entry->ref_count, &count, 0,
+                     false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+} // end _kvs_unpin_last
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_is_marked( entry )
+// ---------------------------------------------------------------------------
+//
+// Returns true if <entry> has been marked for removal.
+
+static fmacro bool _kvs_is_marked(kvs_entry entry) {
+    
+    return __atomic_load_n(&entry->marked_for_removal, __ATOMIC_SEQ_CST);
+    
+} // end _kvs_is_marked
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_ref_count( entry )
+// ---------------------------------------------------------------------------
+//
+// Returns the reference count of <entry>.
+
+static fmacro cardinal _kvs_ref_count(kvs_entry entry) {
+    
+    return __atomic_load_n(&entry->ref_count, __ATOMIC_RELAXED);
+    
+} // end _kvs_ref_count
+
+
+#if KVS_USE_THREADS
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_cc_new()
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns  the concurrency state  for a concurrent table,  with
+// initialised bucket locks and epoch counters.  Returns NULL if allocation or
+// initialisation failed.
+
+static kvs_concurrency_s *_kvs_cc_new(void) {
+    kvs_concurrency_s *new_cc;
+    void *block;
+    cardinal index;
+    
+    // reader stripes must be aligned to cache lines
+    block = ALLOCATE(sizeof(kvs_concurrency_s) + KVS_CACHE_LINE_SIZE);
+    
+    if (block == NULL)
+        return NULL;
+    
+    new_cc = (kvs_concurrency_s *)
+        (((uintptr_t) block + KVS_CACHE_LINE_SIZE) &
+         ~(uintptr_t) (KVS_CACHE_LINE_SIZE - 1));
+    new_cc->block = block;
+    
+    if (pthread_mutex_init(&new_cc->limbo_lock, NULL) != 0) {
+        DEALLOCATE(block);
+        return NULL;
+    } // end if
+    
+    for (index = 0; index < KVS_LOCK_STRIPES; index++) {
+        if (pthread_mutex_init(&new_cc->bucket_lock[index], NULL) != 0) {
+            while (index > 0) {
+                index--;
+                pthread_mutex_destroy(&new_cc->bucket_lock[index]);
+            } // end while
+            pthread_mutex_destroy(&new_cc->limbo_lock);
+            DEALLOCATE(block);
+            return NULL;
+        } // end if
+    } // end for
+    
+    new_cc->epoch = 0;
+    for (index = 0; index < 3; index++) {
+        new_cc->limbo[index] = NULL;
+        new_cc->limbo_count[index] = 0;
+        new_cc->limbo_size[index] = 0;
+        new_cc->limbo_overflow[index] = NULL;
+    } // end for
+    
+    for (index = 0; index < KVS_EPOCH_STRIPES; index++) {
+        new_cc->reader[index].active[0] = 0;
+        new_cc->reader[index].active[1] = 0;
+        new_cc->reader[index].active[2] = 0;
+    } // end for
+    
+    return new_cc;
+} // end _kvs_cc_new
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_dispose_limbo( table, limbo )
+// ---------------------------------------------------------------------------
+//
+// Deallocates the entries  on limbo list <limbo>  of concurrent table <table>
+// and on its overflow list,  leaving both empty.  The caller must hold the
+// limbo lock or otherwise ensure that no other thread accesses the lists.
+
+static void _kvs_dispose_limbo(kvs_table_s *table, cardinal limbo) {
+    kvs_concurrency_s *cc = table->cc;
+    kvs_entry this_entry, next_entry;
+    cardinal index;
+    
+    for (index = 0; index < cc->limbo_count[limbo]; index++) {
+        _kvs_dispose_entry(table, cc->limbo[limbo][index], NULL);
+    } // end for
+    cc->limbo_count[limbo] = 0;
+    
+    this_entry = cc->limbo_overflow[limbo];
+    while (this_entry != NULL) {
+        next_entry = this_entry->timer_next;
+        this_entry->timer_next = NULL;
+        _kvs_dispose_entry(table, this_entry, NULL);
+        this_entry = next_entry;
+    } // end while
+    cc->limbo_overflow[limbo] = NULL;
+    
+    return;
+} // end _kvs_dispose_limbo
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_cc_dispose( table )
+// ---------------------------------------------------------------------------
+//
+// Deallocates all retired entries and the concurrency state of <table>.  The
+// caller must ensure that no other thread accesses the table.
+
+static void _kvs_cc_dispose(kvs_table_s *table) {
+    kvs_concurrency_s *cc = table->cc;
+    cardinal index, limbo;
+    
+    for (limbo = 0; limbo < 3; limbo++) {
+        _kvs_dispose_limbo(table, limbo);
+        DEALLOCATE(cc->limbo[limbo]);
+    } // end for
+    
+    for (index = 0; index < KVS_LOCK_STRIPES; index++) {
+        pthread_mutex_destroy(&cc->bucket_lock[index]);
+    } // end for
+    pthread_mutex_destroy(&cc->limbo_lock);
+    
+    DEALLOCATE(cc->block);
+    table->cc = NULL;
+    
+    return;
+} // end _kvs_cc_dispose
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_thread_stripe()
+// ---------------------------------------------------------------------------
+//
+// Returns the index of the reader stripe used by the calling thread.  Threads
+// are spread over stripes by the address of a thread-local variable.
+
+static __thread octet_t _kvs_thread_tag;
+
+static fmacro cardinal _kvs_thread_stripe(void) {
+    uint64_t tag = (uint64_t) (uintptr_t) &_kvs_thread_tag;
+    
+    return (cardinal) ((tag * 0x9E3779B97F4A7C15ULL) >> 32) % KVS_EPOCH_STRIPES;
+} // end _kvs_thread_stripe
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_read_begin( table )
+// ---------------------------------------------------------------------------
+//
+// Enters the current epoch of concurrent table <table>  and returns a token
+// that must be passed to _kvs_read_end().  Entries retired while the caller is
+// within the epoch are not deallocated  until  the caller has left it.  Does
+// nothing for tables that are not concurrent.
+
+static fmacro kvs_epoch_t _kvs_read_begin(kvs_table_s *table) {
+    kvs_concurrency_s *cc = table->cc;
+    cardinal stripe, epoch;
+    
+    if (NOT(table->flags & KVS_FLAG_CONCURRENT))
+        return 0;
+    
+    stripe = _kvs_thread_stripe();
+    loop {
+        epoch = __atomic_load_n(&cc->epoch, __ATOMIC_SEQ_CST) % 3;
+        __atomic_fetch_add(&cc->reader[stripe].active[epoch], 1,
+                           __ATOMIC_SEQ_CST);
+    
+        // the registration counts only if the epoch has not moved on
+        if (__atomic_load_n(&cc->epoch, __ATOMIC_SEQ_CST) % 3 == epoch)
+            return stripe * 3 + epoch;
+    
+        __atomic_fetch_sub(&cc->reader[stripe].active[epoch], 1,
+                           __ATOMIC_SEQ_CST);
+    } // end loop
+} // end _kvs_read_begin
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_read_end( table, token )
+// ---------------------------------------------------------------------------
+//
+// Leaves the epoch of concurrent table <table>  entered by _kvs_read_begin()
+// which returned <token>.  Does nothing for tables that are not concurrent.
+
+static fmacro void _kvs_read_end(kvs_table_s *table, kvs_epoch_t token) {
+    
+    if (NOT(table->flags & KVS_FLAG_CONCURRENT))
+        return;
+    
+    __atomic_fetch_sub(&table->cc->reader[token / 3].active[token % 3], 1,
+                       __ATOMIC_RELEASE);
+    
+    return;
+} // end _kvs_read_end
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_lock_bucket( table, bucket )
+// ---------------------------------------------------------------------------
+//
+// Acquires the lock stripe of <bucket> if <table> is concurrent.
+
+static fmacro void _kvs_lock_bucket(kvs_table_s *table, kvs_entry *bucket) {
+    
+    if (table->flags & KVS_FLAG_CONCURRENT)
+        pthread_mutex_lock(&table->cc->bucket_lock
+            [(cardinal) (bucket - table->bucket) % KVS_LOCK_STRIPES]);
+    
+    return;
+} // end _kvs_lock_bucket
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_unlock_bucket( table, bucket )
+// ---------------------------------------------------------------------------
+//
+// Releases the lock stripe of <bucket> if <table> is concurrent.
+
+static fmacro void _kvs_unlock_bucket(kvs_table_s *table, kvs_entry *bucket) {
+    
+    if (table->flags & KVS_FLAG_CONCURRENT)
+        pthread_mutex_unlock(&table->cc->bucket_lock
+            [(cardinal) (bucket - table->bucket) % KVS_LOCK_STRIPES]);
+    
+    return;
+} // end _kvs_unlock_bucket
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_lock_all( table )
+// ---------------------------------------------------------------------------
+//
+// Acquires all lock stripes in order if <table> is concurrent,  no bucket of
+// the table can then change until _kvs_unlock_all() is called.
+
+static void _kvs_lock_all(kvs_table_s *table) {
+    cardinal index;
+    
+    if (NOT(table->flags & KVS_FLAG_CONCURRENT))
+        return;
+    
+    for (index = 0; index < KVS_LOCK_STRIPES; index++) {
+        pthread_mutex_lock(&table->cc->bucket_lock[index]);
+    } // end for
+    
+    return;
+} // end _kvs_lock_all
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_unlock_all( table )
+// ---------------------------------------------------------------------------
+//
+// Releases all lock stripes if <table> is concurrent.
+
+static void _kvs_unlock_all(kvs_table_s *table) {
+    cardinal index;
+    
+    if (NOT(table->flags & KVS_FLAG_CONCURRENT))
+        return;
+    
+    for (index = KVS_LOCK_STRIPES; index > 0; index--) {
+        pthread_mutex_unlock(&table->cc->bucket_lock[index - 1]);
+    } // end for
+    
+    return;
+} // end _kvs_unlock_all
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_retire_entry( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Adds unlinked <entry> to the limbo list of the current epoch of concurrent
+// table <table>  and then tries to advance the epoch.  The epoch advances from
+// e to e+1  when no reader is left in epoch e-1.  Readers still in epoch e can
+// only have seen entries retired in epochs e-1 and e,  so the entries retired
+// in epoch e-2,  which share a limbo list with epoch e+1,  are deallocated.  If
+// the limbo list cannot grow,  the entry is put on the overflow list of the
+// epoch,  which is deallocated along with the limbo list.  The caller may be
+// a reader itself,  so it must never wait for readers to leave.
+
+static void _kvs_retire_entry(kvs_table_s *table, kvs_entry entry) {
+    kvs_concurrency_s *cc = table->cc;
+    cardinal epoch, limbo, index, new_size;
+    kvs_entry *new_list;
+    
+    pthread_mutex_lock(&cc->limbo_lock);
+    
+    epoch = __atomic_load_n(&cc->epoch, __ATOMIC_SEQ_CST);
+    limbo = epoch % 3;
+    
+    // grow the limbo list if necessary
+    if (cc->limbo_count[limbo] == cc->limbo_size[limbo]) {
+        new_size = MAX(16, cc->limbo_size[limbo] * 2);
+        new_list =
+            REALLOCATE(cc->limbo[limbo], sizeof(kvs_entry) * new_size);
+    
+        if (new_list != NULL) {
+            cc->limbo[limbo] = new_list;
+            cc->limbo_size[limbo] = new_size;
+        } // end if
+    } // end if
+    
+    if (cc->limbo_count[limbo] < cc->limbo_size[limbo]) {
+        cc->limbo[limbo][cc->limbo_count[limbo]] = entry;
+        cc->limbo_count[limbo]++;
+    }
+    else /* the limbo list could not grow */ {
+        entry->timer_next = cc->limbo_overflow[limbo];
+        cc->limbo_overflow[limbo] = entry;
+    } // end if
+    
+    // try to advance the epoch if no reader is left in the previous epoch
+    limbo = (epoch + 2) % 3;
+    for (index = 0; index < KVS_EPOCH_STRIPES; index++) {
+        if (__atomic_load_n(&cc->reader[index].active[limbo],
+                            __ATOMIC_SEQ_CST) != 0)
+            break;
+    } // end for
+    
+    if (index == KVS_EPOCH_STRIPES) {
+    
+        // deallocate the entries retired two epochs ago
+        _kvs_dispose_limbo(table, (epoch + 1) % 3);
+    
+        __atomic_store_n(&cc->epoch, epoch + 1, __ATOMIC_SEQ_CST);
+    } // end if
+    
+    pthread_mutex_unlock(&cc->limbo_lock);
+    
+    return;
+} // end _kvs_retire_entry
+
+#else /* NOT KVS_USE_THREADS */
+
+// Concurrent tables cannot be created,  the following are never called.
+
+static kvs_concurrency_s *_kvs_cc_new(void) { return NULL; }
+
+static void _kvs_cc_dispose(kvs_table_s *table) { (void) table; }
+
+static fmacro kvs_epoch_t _kvs_read_begin(kvs_table_s *table) {
+    (void) table; return 0;
+}
+    
+static fmacro void _kvs_read_end(kvs_table_s *table, kvs_epoch_t token) {
+    (void) table; (void) token;
+}
+    
+static fmacro void _kvs_lock_bucket(kvs_table_s *table, kvs_entry *bucket) {
+    (void) table; (void) bucket;
+}
+    
+static fmacro void _kvs_unlock_bucket(kvs_table_s *table, kvs_entry *bucket) {
+    (void) table; (void) bucket;
+}
+    
+static void _kvs_lock_all(kvs_table_s *table) { (void) table; }
+
+static void _kvs_unlock_all(kvs_table_s *table) { (void) table; }
+    
+static void _kvs_retire_entry(kvs_table_s *table, kvs_entry entry) {
+    _kvs_dispose_entry(table, entry, NULL);
+}
+    
+#endif /* KVS_USE_THREADS */
+    
+
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_oa_match_byte( group, byte )
+// ---------------------------------------------------------------------------
+//
+// Returns a bit mask with bit n set for every control byte n within the group
+// of control bytes at <group> which is equal to <byte>.
+
+static fmacro uint32_t _kvs_oa_match_byte(const octet_t *group, octet_t byte) {
+#if KVS_USE_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+    
+    return (uint32_t)
+        _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) byte)));
+#else
+    cardinal index;
+    uint32_t mask = 0;
+    
+    for (index = 0; index < KVS_OA_GROUP_WIDTH; index++) {
+        if (group[index] == byte) mask |= (uint32_t) 1 << index;
+    } // end for
+    
+    return mask;
+#endif
+} // end _kvs_oa_match_byte
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_oa_match_free( group )
+// ---------------------------------------------------------------------------
+//
+// Returns a bit mask with bit n set for every control byte n within the group
+// of control bytes at <group> which marks an empty or a deleted slot.
+
+static fmacro uint32_t _kvs_oa_match_free(const octet_t *group) {
+#if KVS_USE_SSE2
+    // empty and deleted are the only control bytes with the high bit set
+    return (uint32_t)
+        _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+    cardinal index;
+    uint32_t mask = 0;
+    
+    for (index = 0; index < KVS_OA_GROUP_WIDTH; index++) {
+        if (group[index] & 0x80) mask |= (uint32_t) 1 << index;
+    } // end for
+    
+    return mask;
+#endif
+} // end _kvs_oa_match_free
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_oa_allocate_slots( capacity, ctrl, slot )
+// ---------------------------------------------------------------------------
+//
+// Allocates control bytes and slots for <capacity> number of slots and passes
+// them back in <ctrl> and <slot>.  All slots are initialised as empty.  Returns
+// true if successful,  returns false if allocation failed.
+
+static bool _kvs_oa_allocate_slots(cardinal capacity,
+                                    octet_t **ctrl,
+                                 kvs_slot_s **slot) {
+    cardinal index;
+    
+    *ctrl = ALLOCATE(capacity);
+    
+    if (*ctrl == NULL)
+        return false;
+    
+    *slot = ALLOCATE(sizeof(kvs_slot_s) * capacity);
+    
+    if (*slot == NULL) {
+        DEALLOCATE(*ctrl);
+        return false;
+    } // end if
+    
+    for (index = 0; index < capacity; index++) {
+        (*ctrl)[index] = KVS_OA_CTRL_EMPTY;
+        (*slot)[index].key = 0;
+        (*slot)[index].entry = NULL;
+    } // end for
+    
+    return true;
+} // end _kvs_oa_allocate_slots
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_oa_find_slot( table, key )
+// ---------------------------------------------------------------------------
+//
+// Returns the index of the slot holding the entry for <key> in open addressing
+// table <table>,  or KVS_OA_NOT_FOUND if no entry for <key> exists.
+//
+// Groups are probed in triangular sequence,  which visits every group once if
+// the number of groups is a power of two.  The search ends at the first group
+// that has an empty slot because an insertion would have used that slot.
+
+static cardinal _kvs_oa_find_slot(kvs_table_s *table, kvs_key_t key) {
+    uint64_t hash = _kvs_hash(table, key);
+    octet_t h2 = (octet_t) (hash & 0x7F);
+    cardinal group_mask = table->bucket_count / KVS_OA_GROUP_WIDTH - 1;
+    cardinal group = (cardinal) (hash >> 7) & group_mask;
+    cardinal base, index, step = 0, compared = 0;
+    uint32_t match;
+    
+    loop {
+        base = group * KVS_OA_GROUP_WIDTH;
+        
+        // compare the key of every slot with a matching hash fragment
+        match = _kvs_oa_match_byte(&table->ctrl[base], h2);
+        while (match != 0) {
+            index = base + __builtin_ctz(match);
+            compared++;
+            if (table->slot[index].key == key) {
+                _kvs_stats_lookup(table, compared);
+                return index;
+            } // end if
+            match &= match - 1;
+        } // end while
+        
+        // stop at the first group that has an empty slot
+        if (_kvs_oa_match_byte(&table->ctrl[base], KVS_OA_CTRL_EMPTY) != 0) {
+            _kvs_stats_lookup(table, compared);
+            return KVS_OA_NOT_FOUND;
+        } // end if
+        
+        step++;
+        group = (group + step) & group_mask;
+    } // end loop
+} // end _kvs_oa_find_slot
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_oa_find_free_slot( ctrl, capacity, hash )
+// ---------------------------------------------------------------------------
+//
+// Returns the index of the first empty or deleted slot  in the probe sequence
+// for <hash> within control bytes <ctrl> of a table with <capacity> slots.  The
+// table must have at least one free slot.
+
+static cardinal _kvs_oa_find_free_slot(octet_t *ctrl,
+                                      cardinal capacity,
+                                      uint64_t hash) {
+    cardinal group_mask = capacity / KVS_OA_GROUP_WIDTH - 1;
+    cardinal group = (cardinal) (hash >> 7) & group_mask;
+    cardinal base, step = 0;
+    uint32_t match;
+    
+    loop {
+        base = group * KVS_OA_GROUP_WIDTH;
+        
+        match = _kvs_oa_match_free(&ctrl[base]);
+        if (match != 0)
+            return base + __builtin_ctz(match);
+        
+        step++;
+        group = (group + step) & group_mask;
+    } // end loop
+} // end _kvs_oa_find_free_slot
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_oa_rehash( table, capacity )
+// ---------------------------------------------------------------------------
+//
+// Moves all entries of open addressing table <table> into a new slot array of
+// <capacity> slots,  dropping all deleted slots.  Entries are not reallocated,
+// pointers to entries and values remain valid.  Returns true if successful,
+// returns false and leaves the table unchanged if allocation failed.
+
+static bool _kvs_oa_rehash(kvs_table_s *table, cardinal capacity) {
+    octet_t *new_ctrl;
+    kvs_slot_s *new_slot;
+    cardinal index, target;
+    uint64_t hash;
+    
+    if (_kvs_oa_allocate_slots(capacity, &new_ctrl, &new_slot) == false)
+        return false;
+    
+    // reinsert every entry, keys are known to be unique
+    for (index = 0; index < table->bucket_count; index++) {
+        if (table->slot[index].entry != NULL) {
+            hash = _kvs_hash(table, table->slot[index].key);
+            target = _kvs_oa_find_free_slot(new_ctrl, capacity, hash);
+            new_ctrl[target] = (octet_t) (hash & 0x7F);
+            new_slot[target] = table->slot[index];
+        } // end if
+    } // end for
+    
+    DEALLOCATE(table->ctrl);
+    DEALLOCATE(table->slot);
+    
+    table->ctrl = new_ctrl;
+    table->slot = new_slot;
+    table->bucket_count = capacity;
+    table->growth_left = capacity - capacity / 8 - table->entry_count;
+    
+    return true;
+} // end _kvs_oa_rehash
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_oa_add_entry( tbl, key, val, size, nt, by_copy, st )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry for <key>  to open addressing table <table>  unless an entry
+// for <key> exists.  If the table has no free slots left,  it is rehashed into
+// twice as many slots first,  or into the same number of slots  if more than
+// half of the used slots are deleted.  The  status  of the operation is passed
+// back in <status>,  unless NULL was passed in for <status>.
+//
+// pre-conditions:  as for _kvs_add_entry()
+
+static void _kvs_oa_add_entry(kvs_table_s *table,
+                                kvs_key_t key,
+                               kvs_data_t value,
+                                 cardinal size,
+                                     bool null_terminated,
+                                     bool by_copy,
+                               kvs_time_t expires,
+                             kvs_status_t *status) {
+    kvs_entry_s *new_entry;
+    cardinal index, capacity;
+    uint64_t hash;
+    kvs_status_t _status;
+    
+    // do not add a new entry if the key is not unique
+    if (_kvs_oa_find_slot(table, key) != KVS_OA_NOT_FOUND) {
+        _kvs_set_status(status, KVS_STATUS_KEY_NOT_UNIQUE);
+        return;
+    } // end if
+    
+    // make room if the maximum load factor has been reached
+    if (table->growth_left == 0) {
+        capacity = table->bucket_count;
+        if (table->entry_count >= (capacity - capacity / 8) / 2) {
+            if (capacity > ((cardinal) 1 << (sizeof(cardinal) * 8 - 2))) {
+                _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+                return;
+            } // end if
+            capacity = capacity * 2;
+        } // end if
+        
+        if (_kvs_oa_rehash(table, capacity) == false) {
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return;
+        } // end if
+    } // end if
+    
+    // create a new entry
+    if (by_copy)
+        new_entry =
+        _kvs_new_entry_with_copy(table, key, value, size,
+                                 null_terminated, &_status);
+    else
+        new_entry =
+        _kvs_new_entry_with_ref(key, value, size, null_terminated, &_status);
+    
+    // exit if allocation failed
+    if (new_entry == NULL) {
+        _kvs_set_status(status, _status);
+        return;
+    } // end if
+    
+    // claim the first free slot in the probe sequence
+    hash = _kvs_hash(table, key);
+    index = _kvs_oa_find_free_slot(table->ctrl, table->bucket_count, hash);
+    
+    // reusing a deleted slot does not consume growth
+    if (table->ctrl[index] == KVS_OA_CTRL_EMPTY)
+        table->growth_left--;
+    
+    table->ctrl[index] = (octet_t) (hash & 0x7F);
+    table->slot[index].key = key;
+    table->slot[index].entry = new_entry;
+    
+    // put the new entry on the CLOCK ring of a cache
+    if (table->flags & KVS_TABLE_CACHE)
+        _kvs_cache_insert(table, new_entry);
+    
+    // schedule the expiry of the new entry
+    if (expires != 0) {
+        new_entry->expires = expires;
+        _kvs_wheel_insert(table->wheel, new_entry);
+    } // end if
+    
+    // count the new entry in the lookup filter
+    if (table->filter != NULL)
+        _kvs_filter_add(table, key);
+    
+    // update the entry counter
+    table->entry_count++;
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return;
+} // end _kvs_oa_add_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_oa_remove_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Removes the entry for <key> from open addressing table <table> if its refer-
+// ence count is one or less,  otherwise marks the entry for removal.  A vacated
+// slot is marked empty if its group has another empty slot,  because no probe
+// has then ever continued past the group,  otherwise the slot is marked
+// deleted.
+// The status of the operation is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+static void _kvs_oa_remove_entry(kvs_table_s *table,
+                                   kvs_key_t key,
+                                kvs_status_t *status) {
+    cardinal index, base;
+    kvs_entry this_entry;
+    
+    index = _kvs_oa_find_slot(table, key);
+    
+    if /* key not found */ (index == KVS_OA_NOT_FOUND) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+        return;
+    } // end if
+    
+    this_entry = table->slot[index].entry;
+    
+    if /* reference count > 1 */ (this_entry->ref_count > 1) {
+        
+        // don't remove the entry yet, mark it for removal
+        this_entry->marked_for_removal = true;
+        
+        // set status
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        return;
+    } // end if
+    
+    // if cached, remove the entry from the cache
+    _kvs_hot_forget(table, this_entry);
+    
+    // vacate the slot
+    base = index & ~(cardinal) (KVS_OA_GROUP_WIDTH - 1);
+    if (_kvs_oa_match_byte(&table->ctrl[base], KVS_OA_CTRL_EMPTY) != 0) {
+        table->ctrl[index] = KVS_OA_CTRL_EMPTY;
+        table->growth_left++;
+    }
+    else {
+        table->ctrl[index] = KVS_OA_CTRL_DELETED;
+    } // end if
+    table->slot[index].key = 0;
+    table->slot[index].entry = NULL;
+    
+    // remove the entry from the lookup filter
+    if (table->filter != NULL)
+        _kvs_filter_remove(table, key);
+    
+    // deallocate the entry
+    _kvs_dispose_entry(table, this_entry, status);
+    
+    // update the entry counter
+    table->entry_count--;
+    
+    return;
+} // end _kvs_oa_remove_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_calc_null_terminated_data_size( data )
+// ---------------------------------------------------------------------------
+//
+// Returns the size of null-terminated data <data>  including the terminating
+// zero-value byte.  Returns zero if no zero-value byte is found  within the
+// first KVS_MAX_STRING_SIZE bytes.
+
+static fmacro cardinal _kvs_calc_null_terminated_data_size(kvs_data_t data) {
+    octet_t *_data = (octet_t *) data;
+    cardinal index = 0;
+    
+    while (_data[index] != 0) {
+        if (index < KVS_MAX_STRING_SIZE - 1)
+            index++;
+        else
+            return 0;
+    } // end while
+    
+    return index + 1;
+} // end _kvs_calc_null_terminated_data_size
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_new_entry_with_copy( table, key, val, size, nt, st )
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns a new table entry initalised with a copy of the data
+// at address <value>.  The  status  of  the  operation  is  passed  back  in
+// <status>,  unless  NULL  was passed in for <status>.
+//
+// If <table> stores values inline,  then the copy is placed directly after the
+// entry within the same allocation,  which is taken from the table's slab if
+// <size> does not exceed KVS_INLINE_VALUE_LIMIT.  Otherwise entry and copy are
+// allocated separately.
+//
+// pre-conditions:
+//
+//  This function DOES NOT CHECK pre-conditions.  The caller MUST ENFORCE pre-
+//  conditions before calling this function:
+// 
+//  o  table must never be NULL
+//  o  key must never be 0
+//  o  size must never be 0
+//  o  value must never be NULL
+//
+// post-conditions:
+//
+//  o  a new entry has been allocated
+//  o  additional space for <size> bytes has been allocated
+//  o  entry's key field contains key
+//  o  entry's value field contains pointer to newly allocated copy of
+//     <size> number of bytes starting at address <value>
+//  o  entry's size field contains size
+//  o  entry's null_terminated flas contains null_terminated
+//  o  entry's pending_removal flag contains false
+//  o  entry's next field contains NULL
+//  o  KVS_STATUS_SUCCESS is passed back in <status>
+//  o  pointer to entry is returned
+//
+// error-conditions:
+//
+//  if memory allocation fails:
+//  o  any partial allocation is rolled back
+//  o  KVS_STATUS_ALLOCATION_FAILED is passed back in <status>
+//  o  NULL is returned
+
+static fmacro kvs_entry _kvs_new_entry_with_copy(kvs_table_s *table,
+                                                   kvs_key_t key,
+                                                  kvs_data_t value,
+                                                    cardinal size,
+                                                   bool null_terminated,
+                                                kvs_status_t *status) {
+    kvs_entry_s *new_entry;
+    
+    if /* inline storage */ (table->flags & KVS_FLAG_INLINE_VALUES) {
+        
+        // allocate storage for new entry followed by a copy of the data
+        if (size <= KVS_INLINE_VALUE_LIMIT)
+            new_entry = _kvs_slab_allocate(table->slab,
+                                           sizeof(kvs_entry_s) + size);
+        else
+            new_entry = ALLOCATE(sizeof(kvs_entry_s) + size);
+        
+        // exit if allocation failed
+        if (new_entry == NULL) {
+            
+            // set status and return NULL
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+        
+        new_entry->storage = KVS_STORAGE_INLINE;
+        new_entry->value = new_entry->data;
+    }
+    else /* separate storage */ {
+        
+        // allocate storage for new entry
+        new_entry = ALLOCATE(sizeof(kvs_entry_s));
+        
+        // exit if allocation failed
+        if (new_entry == NULL) {
+            
+            // set status and return NULL
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+        
+        if /* deduplicated */ (table->values != NULL) {
+            
+            // share an equal value or store a copy of the data
+            new_entry->value = _kvs_value_intern(table->values, value, size);
+            new_entry->storage = KVS_STORAGE_SHARED;
+        }
+        else if /* chunked */ ((table->flags & KVS_FLAG_CHUNKED_VALUES) &&
+                 (size > KVS_CHUNK_THRESHOLD)) {
+            
+            // store a copy of the data in a list of chunks
+            new_entry->value = _kvs_chunks_new(value, size);
+            new_entry->storage = KVS_STORAGE_CHUNKED;
+        }
+        else /* copied */ {
+            
+            // allocate storage for a copy of the data
+            new_entry->value = ALLOCATE(size);
+            new_entry->storage = KVS_STORAGE_COPY;
+        } // end if
+        
+        // exit if allocation failed
+        if (new_entry->value == NULL) {
+            
+            // undo allocation for entry
+            DEALLOCATE(new_entry);
+            
+            // set status and return NULL
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
+        } // end if
+    } // end if
+    
+    // store key
+    new_entry->key = key;
+
+    // initialise meta data
+    new_entry->size = size;
+    new_entry->next = NULL;
+    new_entry->ref_count = 1;
+    new_entry->null_terminated = null_terminated;
+    new_entry->marked_for_removal = false;
+    new_entry->clock_prev = NULL;
+    new_entry->clock_next = NULL;
+    new_entry->referenced = false;
+    new_entry->expires = 0;
+    new_entry->timer_next = NULL;
+    new_entry->timer_link = NULL;
+    
+    // copy data,  a shared value and chunks already hold it
+    if ((new_entry->storage != KVS_STORAGE_SHARED) &&
+        (new_entry->storage != KVS_STORAGE_CHUNKED))
+        memcpy(new_entry->value, value, size);
+        
+    // set status and return
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return new_entry;
+} // end _kvs_new_entry_with_copy
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_new_entry_with_ref( key, value, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns a new table entry  initalised with a reference to the
+// data at address <value>.  The  status of the operation  is  passed back  in
+// <status>,  unless  NULL  was passed in for <status>.
+//
+// pre-conditions:
+//
+//  This function DOES NOT CHECK pre-conditions.  The caller MUST ENFORCE pre-
+//  conditions before calling this function:
+// 
+//  o  key must never be 0
+//  o  size must never be 0
+//  o  value must never be NULL
+//
+// post-conditions:
+//
+//  o  a new entry has been allocated
+//  o  entry's key field contains key
+//  o  entry's value field contains <value>
+//  o  entry's size field contains size
+//  o  entry's null_terminated flas contains null_terminated
+//  o  entry's pending_removal flag contains false
+//  o  entry's next field contains NULL
+//  o  KVS_STATUS_SUCCESS is passed back in <status>
+//  o  pointer to entry is returned
+//
+// error-conditions:
+//
+//  if memory allocation fails:
+//  o  KVS_STATUS_ALLOCATION_FAILED is passed back in <status>
+//  o  NULL is returned
+
+static fmacro kvs_entry _kvs_new_entry_with_ref(kvs_key_t key,
+                                               kvs_data_t value,
+                                                 cardinal size,
+                                                bool null_terminated,
+                                             kvs_status_t *status) {
+    kvs_entry_s *new_entry;
+    
+    // allocate storage for new entry
+    new_entry = ALLOCATE(sizeof(kvs_entry_s));
+    
+    // exit if allocation failed
+    if (new_entry == NULL) {
+        
+        // set status and return NULL
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // store key and value
+    new_entry->key = key;
+    new_entry->value = value;
+    
+    // initialise meta data
+    new_entry->size = size;
+    new_entry->next = NULL;
+    new_entry->ref_count = 1;
+    new_entry->null_terminated = null_terminated;
+    new_entry->marked_for_removal = false;
+    new_entry->storage = KVS_STORAGE_REFERENCE;
+    new_entry->clock_prev = NULL;
+    new_entry->clock_next = NULL;
+    new_entry->referenced = false;
+    new_entry->expires = 0;
+    new_entry->timer_next = NULL;
+    new_entry->timer_link = NULL;
+        
+    // set status and return
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return new_entry;
+} // end _kvs_new_entry_with_ref
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_retrieve_copy( entry, status )
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns a copy of the data of <entry>,  a value kept in chunks
+// is put together.  The size of the entry must be known.  The status of the
+// operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+static fmacro kvs_data_t _kvs_retrieve_copy(kvs_entry_s *entry,
+                                           kvs_status_t *status) {
+    octet_t *new_copy;
+    kvs_chunk this_chunk;
+    size_t offset;
+    
+    // allocate storage for a copy of the data
+    new_copy = ALLOCATE(entry->size);
+    
+    // exit if allocation failed
+    if (new_copy == NULL) {
+        
+        // set status and return NULL
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    if /* chunked */ (entry->storage == KVS_STORAGE_CHUNKED) {
+        
+        // copy data chunk by chunk
+        offset = 0;
+        this_chunk = (kvs_chunk) entry->value;
+        while (this_chunk != NULL) {
+            memcpy(new_copy + offset, this_chunk->data, this_chunk->size);
+            offset = offset + this_chunk->size;
+            this_chunk = this_chunk->next;
+        } // end while
+    }
+    else /* contiguous */ {
+        
+        // copy data
+        memcpy(new_copy, entry->value, entry->size);
+    } // end if
+    
+    // set status and return
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return (kvs_data_t) new_copy;
+} // end _kvs_retrieve_copy
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_dispose_entry( table, entry, status )
+// ---------------------------------------------------------------------------
+//
+// Deallocates <entry> of <table>,  including its data if the entry was stored
+// by copy.  Data of entries stored by reference is owned by the client and is
+// not deallocated.  Status passed back in <status> unless NULL passed in.
+
+static fmacro void _kvs_dispose_entry(kvs_table_s *table,
+                                        kvs_entry entry,
+                                     kvs_status_t *status) {
+
+    // don't try to free any null pointers for entry
+    if (entry == NULL) {
+    
+        // set status
+        _kvs_set_status(status, KVS_STATUS_INVALID_ENTRY);
+        
+        // exit
+        return;
+    } // end if
+    
+    // unlink the entry from the CLOCK ring of a cache
+    if (table->flags & KVS_TABLE_CACHE)
+        _kvs_cache_unlink(table, entry);
+    
+    // unlink the entry from the timing wheel
+    if (entry->timer_link != NULL)
+        _kvs_wheel_unlink(table->wheel, entry);
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    // entries in an arena are deallocated with their arena
+    if (entry->storage == KVS_STORAGE_ARENA) {
+        _kvs_arena_release(table, entry);
+        return;
+    } // end if
+    
+    if /* value follows entry */ (entry->storage == KVS_STORAGE_INLINE) {
+        
+        // return small entries to the slab, deallocate others
+        if (entry->size <= KVS_INLINE_VALUE_LIMIT)
+            _kvs_slab_release(table->slab, entry,
+                              sizeof(kvs_entry_s) + entry->size);
+        else
+            DEALLOCATE(entry);
+        
+        return;
+    } // end if
+    
+    // release a shared value,  it is deallocated with its last entry
+    if (entry->storage == KVS_STORAGE_SHARED)
+        _kvs_value_release(table->values, entry->value);
+    
+    // deallocate the chunks of a chunked value
+    if (entry->storage == KVS_STORAGE_CHUNKED)
+        _kvs_chunks_dispose((kvs_chunk) entry->value);
+    
+    // don't try to free any null pointers for value either, just in case
+    if ((entry->storage == KVS_STORAGE_COPY) && (entry->value != NULL)) {
+    
+        // deallocate entry's value
+        DEALLOCATE(entry->value);
+        
+        // don't exit here, the entry itself still needs to be deallocated
+    } // end if
+    
+    // deallocate the entry itself
+    DEALLOCATE(entry);
+    
+    return;
+} // end _kvs_dispose_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_chunks_new( value, size )
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns a list of chunks  holding a copy of the <size> bytes
+// at address <value>,  KVS_CHUNK_SIZE bytes per chunk  and  the remainder in
+// the last chunk.  Returns NULL if allocation failed,  any chunks allocated
+// are then deallocated.
+
+static kvs_chunk _kvs_chunks_new(const octet_t *value, cardinal size) {
+    kvs_chunk first_chunk = NULL, *link = &first_chunk, new_chunk;
+    cardinal chunk_size;
+    
+    while (size > 0) {
+        chunk_size = MIN(size, KVS_CHUNK_SIZE);
+        new_chunk = ALLOCATE(sizeof(kvs_chunk_s) + chunk_size);
+        
+        // exit if allocation failed
+        if (new_chunk == NULL) {
+            _kvs_chunks_dispose(first_chunk);
+            return NULL;
+        } // end if
+        
+        new_chunk->next = NULL;
+        new_chunk->size = chunk_size;
+        memcpy(new_chunk->data, value, chunk_size);
+        
+        // append the chunk
+        *link = new_chunk;
+        link = &new_chunk->next;
+        
+        value = value + chunk_size;
+        size = size - chunk_size;
+    } // end while
+    
+    return first_chunk;
+} // end _kvs_chunks_new
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_chunks_dispose( chunk )
+// ---------------------------------------------------------------------------
+//
+// Deallocates the list of chunks starting at <chunk>.
+
+static void _kvs_chunks_dispose(kvs_chunk chunk) {
+    kvs_chunk next_chunk;
+    
+    while (chunk != NULL) {
+        next_chunk = chunk->next;
+        DEALLOCATE(chunk);
+        chunk = next_chunk;
+    } // end while
+    
+    return;
+} // end _kvs_chunks_dispose
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_slab_new()
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns a new slab allocator with empty size classes.  Returns
+// NULL if allocation failed.
+
+static kvs_slab_s *_kvs_slab_new(void) {
+    kvs_slab_s *new_slab;
+    cardinal index;
+    
+    new_slab = ALLOCATE(sizeof(kvs_slab_s));
+    
+    if (new_slab == NULL)
+        return NULL;
+    
+    new_slab->chunk_list = NULL;
+    for (index = 0; index < KVS_SLAB_CLASS_COUNT; index++) {
+        new_slab->size_class[index].free_list = NULL;
+        new_slab->size_class[index].next_free = NULL;
+        new_slab->size_class[index].bytes_left = 0;
+    } // end for
+    
+    return new_slab;
+} // end _kvs_slab_new
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_slab_allocate( slab, size )
+// ---------------------------------------------------------------------------
+//
+// Returns a block of at least <size> bytes from the size class of <slab> for
+// <size>.  Blocks are taken from the size class's free list first,  then cut
+// from the size class's current chunk.  A new chunk is allocated when the
+// current chunk is used up.  Returns NULL if allocation failed.
+
+static void *_kvs_slab_allocate(kvs_slab_s *slab, cardinal size) {
+    kvs_slab_class_s *size_class;
+    kvs_slab_chunk_s *new_chunk;
+    cardinal block_size;
+    void *block;
+    
+    size_class = &slab->size_class[KVS_SLAB_CLASS_INDEX(size)];
+    block_size = KVS_SLAB_CLASS_SIZE(KVS_SLAB_CLASS_INDEX(size));
+    
+    // reuse a released block if there is one
+    if (size_class->free_list != NULL) {
+        block = size_class->free_list;
+        size_class->free_list = *(void **) block;
+        return block;
+    } // end if
+    
+    // start a new chunk if the current one is used up
+    if (size_class->bytes_left < block_size) {
+        new_chunk = ALLOCATE(sizeof(kvs_slab_chunk_s) + KVS_SLAB_CHUNK_SIZE);
+        
+        if (new_chunk == NULL)
+            return NULL;
+        
+        new_chunk->next = slab->chunk_list;
+        slab->chunk_list = new_chunk;
+        size_class->next_free = new_chunk->block;
+        size_class->bytes_left = KVS_SLAB_CHUNK_SIZE;
+    } // end if
+    
+    // cut the block from the current chunk
+    block = size_class->next_free;
+    size_class->next_free += block_size;
+    size_class->bytes_left -= block_size;
+    
+    return block;
+} // end _kvs_slab_allocate
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_slab_release( slab, block, size )
+// ---------------------------------------------------------------------------
+//
+// Returns <block> of <size> bytes to the free list of its size class in <slab>.
+
+static void _kvs_slab_release(kvs_slab_s *slab, void *block, cardinal size) {
+    kvs_slab_class_s *size_class;
+    
+    size_class = &slab->size_class[KVS_SLAB_CLASS_INDEX(size)];
+    *(void **) block = size_class->free_list;
+    size_class->free_list = block;
+    
+    return;
+} // end _kvs_slab_release
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_slab_dispose( slab )
+// ---------------------------------------------------------------------------
+//
+// Deallocates <slab> and all its chunks at once.  Any blocks still in use are
+// invalidated.
+
+static void _kvs_slab_dispose(kvs_slab_s *slab) {
+    kvs_slab_chunk_s *this_chunk, *next_chunk;
+    
+    if (slab == NULL)
+        return;
+    
+    this_chunk = slab->chunk_list;
+    while (this_chunk != NULL) {
+        next_chunk = this_chunk->next;
+        DEALLOCATE(this_chunk);
+        this_chunk = next_chunk;
+    } // end while
+    
+    DEALLOCATE(slab);
+    
+    return;
+} // end _kvs_slab_dispose
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_collect( table, count, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a newly allocated array of items for all entries of <table>  that
+// kvs_foreach() visits  and passes their number back in <count>.  Returns NULL
+// if any such entry has an unknown size  or if allocation failed.  The status
+// of the operation is passed back in <status>.
+
+static kvs_snapshot_item_s *_kvs_snapshot_collect(kvs_table_s *table,
+                                                     cardinal *count,
+                                                 kvs_status_t *status) {
+    kvs_snapshot_gather_s gather;
+    kvs_foreach_s range;
+    cardinal index;
+    
+    // one more than needed so that an empty table allocates a non-empty array
+    gather.table = table;
+    gather.capacity = table->entry_count + 1;
+    gather.count = 0;
+    gather.item = ALLOCATE(sizeof(kvs_snapshot_item_s) * gather.capacity);
+    
+    // exit if allocation failed
+    if (gather.item == NULL) {
+        *status = KVS_STATUS_ALLOCATION_FAILED;
+        return NULL;
+    } // end if
+    
+    // visit all entries as kvs_foreach() does,  but pin chunked entries
+    gather.range = &range;
+    range.table = table;
+    range.action = _kvs_snapshot_gather;
+    range.chunked = _kvs_snapshot_gather_chunked;
+    range.context = &gather;
+    range.first = 0;
+    range.last = _kvs_foreach_bucket_count(table);
+    
+    _kvs_foreach_range(&range);
+    
+    // exit if any entry could not be visited
+    if (range.status != KVS_STATUS_SUCCESS) {
+        _kvs_snapshot_release(table, gather.item, gather.count);
+        DEALLOCATE(gather.item);
+        *status = range.status;
+        return NULL;
+    } // end if
+    
+    // every entry must have a known size
+    for (index = 0; index < gather.count; index++) {
+        if (gather.item[index].size == 0) {
+            _kvs_snapshot_release(table, gather.item, gather.count);
+            DEALLOCATE(gather.item);
+            *status = KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN;
+            return NULL;
+        } // end if
+    } // end for
+    
+    *count = gather.count;
+    *status = KVS_STATUS_SUCCESS;
+    return gather.item;
+} // end _kvs_snapshot_collect
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_gather( key, value, size, nt, gather )
+// ---------------------------------------------------------------------------
+//
+// Action of kvs_foreach() for _kvs_snapshot_collect(),  appends an item for
+// the entry visited to <gather_p>  unless its array is full.
+
+static void _kvs_snapshot_gather(kvs_key_t key,
+                                kvs_data_t value,
+                                  cardinal size,
+                                      bool null_terminated,
+                                      void *gather_p) {
+    kvs_snapshot_gather_s *gather = (kvs_snapshot_gather_s *) gather_p;
+    kvs_snapshot_item_s *item;
+    
+    if (gather->count == gather->capacity)
+        return;
+    
+    item = &gather->item[gather->count];
+    item->key = key;
+    item->size = size;
+    item->null_terminated = null_terminated;
+    item->expires = gather->range->expires;
+    item->value = value;
+    item->entry = NULL;
+    gather->count++;
+    
+    return;
+} // end _kvs_snapshot_gather
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_gather_chunked( entry, gather )
+// ---------------------------------------------------------------------------
+//
+// Chunked action of _kvs_snapshot_collect(),  pins <entry>  and  appends an
+// item for it to <gather_p>,  so that its chunks can be written without a
+// copy and stay valid until they are.  Returns false if the array of items
+// is full or if the entry has been removed concurrently.
+
+static bool _kvs_snapshot_gather_chunked(kvs_entry entry, void *gather_p) {
+    kvs_snapshot_gather_s *gather = (kvs_snapshot_gather_s *) gather_p;
+    kvs_snapshot_item_s *item;
+    
+    if (gather->count == gather->capacity)
+        return false;
+    
+    if (NOT(_kvs_pin_entry(gather->table, entry)))
+        return false;
+    
+    item = &gather->item[gather->count];
+    item->key = entry->key;
+    item->size = entry->size;
+    item->null_terminated = entry->null_terminated;
+    item->expires = entry->expires;
+    item->value = NULL;
+    item->entry = entry;
+    gather->count++;
+    
+    return true;
+} // end _kvs_snapshot_gather_chunked
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_release( table, item, count )
+// ---------------------------------------------------------------------------
+//
+// Releases the entries pinned for the <count> items at <item>  gathered from
+// <table>  as kvs_view_release() does,  removing those that were marked for
+// removal meanwhile.
+
+static void _kvs_snapshot_release(kvs_table_s *table,
+                          kvs_snapshot_item_s *item,
+                                     cardinal count) {
+    cardinal index;
+    kvs_epoch_t epoch;
+    
+    for (index = 0; index < count; index++) {
+        if (item[index].entry == NULL)
+            continue;
+        
+        epoch = _kvs_read_begin(table);
+        
+        // remove the entry if this was the last reference to a removed entry
+        if ((_kvs_unpin_entry(table, item[index].entry) == 1) &&
+            (_kvs_is_marked(item[index].entry)))
+            _kvs_remove(table, item[index].key, item[index].entry, NULL);
+        
+        _kvs_read_end(table, epoch);
+    } // end for
+    
+    return;
+} // end _kvs_snapshot_release
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_write( file, data, size )
+// ---------------------------------------------------------------------------
+//
+// Writes <size> bytes at <data> to <file>,  followed by zero bytes up to the
+// next multiple of KVS_SNAPSHOT_ALIGNMENT.  Returns true if all bytes were
+// written,  otherwise false.
+
+static bool _kvs_snapshot_write(FILE *file, const void *data, size_t size) {
+    static const octet_t zero[KVS_SNAPSHOT_ALIGNMENT] = { 0 };
+    size_t padding = KVS_SNAPSHOT_ALIGN(size) - size;
+    
+    if ((size > 0) && (fwrite(data, 1, size, file) != size))
+        return false;
+    
+    if ((padding > 0) && (fwrite(zero, 1, padding, file) != padding))
+        return false;
+    
+    return true;
+} // end _kvs_snapshot_write
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_write_chunks( file, chunk, size )
+// ---------------------------------------------------------------------------
+//
+// Writes the <size> bytes of the value kept in the list of chunks starting at
+// <chunk> to <file>,  followed by zero bytes as _kvs_snapshot_write() does.
+// Returns true if all bytes were written,  otherwise false.
+
+static bool _kvs_snapshot_write_chunks(FILE *file,
+                                  kvs_chunk chunk,
+                                     size_t size) {
+    static const octet_t zero[KVS_SNAPSHOT_ALIGNMENT] = { 0 };
+    size_t padding = KVS_SNAPSHOT_ALIGN(size) - size;
+    
+    while (chunk != NULL) {
+        if (fwrite(chunk->data, 1, chunk->size, file) != chunk->size)
+            return false;
+        chunk = chunk->next;
+    } // end while
+    
+    if ((padding > 0) && (fwrite(zero, 1, padding, file) != padding))
+        return false;
+    
+    return true;
+} // end _kvs_snapshot_write_chunks
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_map( path, size, status )
+// ---------------------------------------------------------------------------
+//
+// Maps the file at <path> read-only into memory,  or reads it into allocated
+// memory when built with KVS_NO_MMAP,  and returns its address.  The size of
+// the file is passed back in <size>.  Returns NULL if the file could not be
+// mapped or is too small to hold a snapshot header.  The status of the
+// operation is passed back in <status>.
+
+static const octet_t *_kvs_snapshot_map(const char *path,
+                                              size_t *size,
+                                        kvs_status_t *status) {
+#if KVS_USE_MMAP
+    struct stat file_info;
+    void *snapshot;
+    int fd;
+    
+    fd = open(path, O_RDONLY);
+    
+    if (fd < 0) {
+        *status = KVS_STATUS_FILE_ERROR;
+        return NULL;
+    } // end if
+    
+    if (fstat(fd, &file_info) != 0) {
+        close(fd);
+        *status = KVS_STATUS_FILE_ERROR;
+        return NULL;
+    } // end if
+    
+    if (file_info.st_size < (off_t) sizeof(kvs_snapshot_header_s)) {
+        close(fd);
+        *status = KVS_STATUS_INVALID_SNAPSHOT;
+        return NULL;
+    } // end if
+    
+    *size = (size_t) file_info.st_size;
+    snapshot = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+    
+    // the mapping remains valid after the file is closed
+    close(fd);
+    
+    if (snapshot == MAP_FAILED) {
+        *status = KVS_STATUS_FILE_ERROR;
+        return NULL;
+    } // end if
+    
+    *status = KVS_STATUS_SUCCESS;
+    return (const octet_t *) snapshot;
+#else
+    octet_t *snapshot;
+    FILE *file;
+    long length;
+    
+    file = fopen(path, "rb");
+    
+    if (file == NULL) {
+        *status = KVS_STATUS_FILE_ERROR;
+        return NULL;
+    } // end if
+    
+    if ((fseek(file, 0, SEEK_END) != 0) || ((length = ftell(file)) < 0) ||
+        (fseek(file, 0, SEEK_SET) != 0)) {
+        fclose(file);
+        *status = KVS_STATUS_FILE_ERROR;
+        return NULL;
+    } // end if
+    
+    if ((size_t) length < sizeof(kvs_snapshot_header_s)) {
+        fclose(file);
+        *status = KVS_STATUS_INVALID_SNAPSHOT;
+        return NULL;
+    } // end if
+    
+    *size = (size_t) length;
+    snapshot = ALLOCATE(*size);
+    
+    if (snapshot == NULL) {
+        fclose(file);
+        *status = KVS_STATUS_ALLOCATION_FAILED;
+        return NULL;
+    } // end if
+    
+    if (fread(snapshot, 1, *size, file) != *size) {
+        DEALLOCATE(snapshot);
+        fclose(file);
+        *status = KVS_STATUS_FILE_ERROR;
+        return NULL;
+    } // end if
+    
+    fclose(file);
+    *status = KVS_STATUS_SUCCESS;
+    return snapshot;
+#endif
+} // end _kvs_snapshot_map
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_unmap( snapshot, size )
+// ---------------------------------------------------------------------------
+//
+// Unmaps or deallocates <snapshot> of <size> bytes returned by
+// _kvs_snapshot_map().
+
+static void _kvs_snapshot_unmap(const octet_t *snapshot, size_t size) {
+    
+#if KVS_USE_MMAP
+    munmap((void *) snapshot, size);
+#else
+    (void) size;
+    DEALLOCATE((void *) snapshot);
+#endif
+    
+    return;
+} // end _kvs_snapshot_unmap
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_is_valid( snapshot, size )
+// ---------------------------------------------------------------------------
+//
+// Returns true if the header of <snapshot> of <size> bytes is valid  and its
+// record index and record arrays lie within the snapshot,  otherwise false.
+// Record indices and value locations are checked when they are used  so that
+// opening a snapshot does not touch every page of the file.
+
+static bool _kvs_snapshot_is_valid(const octet_t *snapshot, size_t size) {
+    const kvs_snapshot_header_s *header;
+    const uint32_t *start;
+    
+    header = (const kvs_snapshot_header_s *) snapshot;
+    
+    if ((header->magic != KVS_SNAPSHOT_MAGIC) ||
+        (header->version < 1) || (header->version > KVS_SNAPSHOT_VERSION) ||
+        (header->file_size != (uint64_t) size))
+        return false;
+    
+    // keys must be of the width of this build,  older snapshots have 32 bits
+    if ((header->key_size != sizeof(kvs_key_t)) &&
+        ((header->key_size != 0) || (sizeof(kvs_key_t) != 4)))
+        return false;
+    
+    // bucket count must be a power of two
+    if ((header->bucket_count == 0) ||
+        ((header->bucket_count & (header->bucket_count - 1)) != 0))
+        return false;
+    
+    // arrays must be aligned and lie within the snapshot
+    if ((header->start_offset % KVS_SNAPSHOT_ALIGNMENT != 0) ||
+        (header->record_offset % KVS_SNAPSHOT_ALIGNMENT != 0) ||
+        (header->start_offset > size) || (header->record_offset > size) ||
+        ((uint64_t) header->bucket_count + 1 >
+         (size - header->start_offset) / sizeof(uint32_t)) ||
+        ((uint64_t) header->entry_count >
+         (size - header->record_offset) / sizeof(kvs_snapshot_record_s)))
+        return false;
+    
+    // deadlines must be aligned and lie within the snapshot
+    if ((header->version >= 2) && (header->expires_offset != 0) &&
+        ((header->expires_offset % KVS_SNAPSHOT_ALIGNMENT != 0) ||
+         (header->expires_offset > size) ||
+         ((uint64_t) header->entry_count >
+          (size - header->expires_offset) / sizeof(uint64_t))))
+        return false;
+    
+    // the record index must cover all records
+    start = (const uint32_t *) (snapshot + header->start_offset);
+    if ((start[0] != 0) || (start[header->bucket_count] != header->entry_count))
+        return false;
+    
+    return true;
+} // end _kvs_snapshot_is_valid
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_deadlines( snapshot )
+// ---------------------------------------------------------------------------
+//
+// Returns the array of expiry deadlines of the records of valid <snapshot>,
+// or NULL if no record expires.
+
+static fmacro const uint64_t *_kvs_snapshot_deadlines(const octet_t *snapshot) {
+    const kvs_snapshot_header_s *header;
+    
+    header = (const kvs_snapshot_header_s *) snapshot;
+    
+    // version 1 headers end before the offset of the deadlines
+    if ((header->version < 2) || (header->expires_offset == 0))
+        return NULL;
+    
+    return (const uint64_t *) (snapshot + header->expires_offset);
+} // end _kvs_snapshot_deadlines
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_find( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// If a record for <key> that has not expired exists in snapshot table <table>,
+// then a pointer to the record is returned,  otherwise NULL.  Returns NULL with
+// status KVS_STATUS_INVALID_SNAPSHOT  if the record index of the bucket  or
+// the value location of the record lies outside the snapshot.  The status of
+// the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+static const kvs_snapshot_record_s *_kvs_snapshot_find(kvs_table_s *table,
+                                                         kvs_key_t key,
+                                                      kvs_status_t *status) {
+    const kvs_snapshot_header_s *header;
+    const kvs_snapshot_record_s *record;
+    const uint64_t *deadline;
+    const uint32_t *start;
+    cardinal index, first, last;
+    
+    header = (const kvs_snapshot_header_s *) table->snapshot;
+    start = (const uint32_t *) (table->snapshot + header->start_offset);
+    record = (const kvs_snapshot_record_s *)
+        (table->snapshot + header->record_offset);
+    
+    index = _kvs_hash(table, key) & (table->bucket_count - 1);
+    first = start[index];
+    last = start[index + 1];
+    
+    if ((first > last) || (last > table->entry_count)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_SNAPSHOT);
+        return NULL;
+    } // end if
+    
+    // check every record in this bucket for a key match
+    for (index = first; index < last; index++) {
+        if (record[index].key == key) {
+            
+            // count the records compared up to the match
+            _kvs_stats_lookup(table, index - first + 1);
+            
+            // the value must lie within the snapshot
+            if ((record[index].value_offset > table->snapshot_size) ||
+                (record[index].size >
+                 table->snapshot_size - record[index].value_offset)) {
+                _kvs_set_status(status, KVS_STATUS_INVALID_SNAPSHOT);
+                return NULL;
+            } // end if
+            
+            // an expired record is not found
+            deadline = _kvs_snapshot_deadlines(table->snapshot);
+            if ((deadline != NULL) && (deadline[index] != 0) &&
+                (deadline[index] <= _kvs_wall_clock())) {
+                _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+                return NULL;
+            } // end if
+            
+            _kvs_set_status(status, KVS_STATUS_SUCCESS);
+            return &record[index];
+        } // end if
+    } // end for
+    
+    _kvs_stats_lookup(table, last - first);
+    
+    _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    return NULL;
+} // end _kvs_snapshot_find
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_get_entry( tbl, copy, key, size, nt, st )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the value stored in snapshot table <table> for <key>  either by
+// copy or as a pointer into the snapshot,  as kvs_get_entry() does for other
+// tables.  The status of the operation is passed back in <status>,  unless
+// NULL was passed in for <status>.
+
+static kvs_data_t _kvs_snapshot_get_entry(kvs_table_s *table,
+                                                 bool copy,
+                                            kvs_key_t key,
+                                             cardinal *size,
+                                                 bool *null_terminated,
+                                         kvs_status_t *status) {
+    const kvs_snapshot_record_s *record;
+    octet_t *new_copy;
+    
+    record = _kvs_snapshot_find(table, key, status);
+    
+    // exit if record not found
+    if (record == NULL)
+        return NULL;
+    
+    // pass back size and null_terminated
+    if (size != NULL)
+        *size = record->size;
+    if (null_terminated != NULL)
+        *null_terminated = record->null_terminated;
+    
+    if /* by reference */ (copy == false)
+        return (kvs_data_t) (table->snapshot + record->value_offset);
+    
+    // allocate storage for a copy of the data
+    new_copy = ALLOCATE(record->size);
+    
+    // exit if allocation failed
+    if (new_copy == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // copy data
+    memcpy(new_copy, table->snapshot + record->value_offset, record->size);
+    
+    return (kvs_data_t) new_copy;
+} // end _kvs_snapshot_get_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_snapshot_load( table, snapshot, status )
+// ---------------------------------------------------------------------------
+//
+// Stores a copy of every record of snapshot table <snapshot>  that has not
+// expired in <table>,  with its deadline.  Fails with status
+// KVS_STATUS_INVALID_SNAPSHOT  if a value lies outside the snapshot,  and with
+// status KVS_STATUS_INVALID_FLAGS  if a record has not yet expired  but the
+// entries of <table> cannot expire.  Returns true if all records have been
+// stored,  otherwise false.  The status of the operation is passed back in
+// <status>.
+
+static bool _kvs_snapshot_load(kvs_table_s *table,
+                               kvs_table_s *snapshot,
+                              kvs_status_t *status) {
+    const kvs_snapshot_header_s *header;
+    const kvs_snapshot_record_s *record;
+    const uint64_t *deadline;
+    kvs_time_t expires = 0;
+    cardinal index;
+    
+    header = (const kvs_snapshot_header_s *) snapshot->snapshot;
+    record = (const kvs_snapshot_record_s *)
+        (snapshot->snapshot + header->record_offset);
+    deadline = _kvs_snapshot_deadlines(snapshot->snapshot);
+    
+    for (index = 0; index < snapshot->entry_count; index++) {
+        
+        if (deadline != NULL) {
+            expires = _kvs_local_deadline(deadline[index]);
+            
+            // skip records which have expired
+            if ((expires != 0) && (expires <= kvs_current_time()))
+                continue;
+            
+            // fail if entries of the table cannot expire
+            if ((expires != 0) &&
+                (table->flags & (KVS_FLAG_CONCURRENT | KVS_FLAG_COMPACT))) {
+                *status = KVS_STATUS_INVALID_FLAGS;
+                return false;
+            } // end if
+        } // end if
+        
+        // the value must lie within the snapshot
+        if ((record[index].size == 0) ||
+            (record[index].value_offset > snapshot->snapshot_size) ||
+            (record[index].size >
+             snapshot->snapshot_size - record[index].value_offset)) {
+            *status = KVS_STATUS_INVALID_SNAPSHOT;
+            return false;
+        } // end if
+        
+        _kvs_add_entry(table, record[index].key,
+                       (kvs_data_t) (snapshot->snapshot +
+                                     record[index].value_offset),
+                       record[index].size, record[index].null_terminated,
+                       true, expires, status);
+        
+        if (*status != KVS_STATUS_SUCCESS)
+            return false;
+    } // end for
+    
+    *status = KVS_STATUS_SUCCESS;
+    return true;
+} // end _kvs_snapshot_load
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_cache_insert( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Links new <entry> into the CLOCK ring of cache table <table>  just behind
+// the hand,  so that the hand visits it last,  and charges its bytes.
+
+static fmacro void _kvs_cache_insert(kvs_table_s *table, kvs_entry entry) {
+    kvs_entry hand = table->clock_hand;
+    
+    if /* ring is empty */ (hand == NULL) {
+        entry->clock_prev = entry;
+        entry->clock_next = entry;
+        table->clock_hand = entry;
+    }
+    else /* ring is not empty */ {
+        entry->clock_prev = hand->clock_prev;
+        entry->clock_next = hand;
+        hand->clock_prev->clock_next = entry;
+        hand->clock_prev = entry;
+    } // end if
+    
+    table->bytes_used = table->bytes_used + _kvs_cache_charge(entry);
+    
+    return;
+} // end _kvs_cache_insert
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_cache_unlink( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Unlinks <entry> from the CLOCK ring of cache table <table>,  advancing the
+// hand if it points to <entry>,  and credits its bytes.
+
+static fmacro void _kvs_cache_unlink(kvs_table_s *table, kvs_entry entry) {
+    
+    if /* last entry on the ring */ (entry->clock_next == entry) {
+        table->clock_hand = NULL;
+    }
+    else {
+        if (table->clock_hand == entry)
+            table->clock_hand = entry->clock_next;
+        entry->clock_prev->clock_next = entry->clock_next;
+        entry->clock_next->clock_prev = entry->clock_prev;
+    } // end if
+    
+    entry->clock_prev = NULL;
+    entry->clock_next = NULL;
+    
+    table->bytes_used = table->bytes_used - _kvs_cache_charge(entry);
+    
+    return;
+} // end _kvs_cache_unlink
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_cache_count( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Counts a retrieval from cache table <table>  as a hit  and sets the
+// referenced bit of <entry>,  or as a miss  if <entry> is NULL or pending
+// removal.
+
+static fmacro void _kvs_cache_count(kvs_table_s *table, kvs_entry entry) {
+    
+    if ((entry != NULL) && NOT(entry->marked_for_removal)) {
+        entry->referenced = true;
+        table->hits++;
+    }
+    else {
+        table->misses++;
+    } // end if
+    
+    return;
+} // end _kvs_cache_count
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_cache_evict( table, keep )
+// ---------------------------------------------------------------------------
+//
+// Evicts entries of cache table <table>  until it holds no more than its byte
+// budget.  The hand sweeps the CLOCK ring,  clearing the referenced bit of
+// entries that have it set  and evicting the first entry found with a clear
+// bit.  Entries with a reference count above one,  entries pending removal
+// and the entry for <keep> are skipped.  The sweep gives up after two turns
+// of the ring,  when every remaining entry must be skipped.
+
+static void _kvs_cache_evict(kvs_table_s *table, kvs_key_t keep) {
+    kvs_entry victim;
+    cardinal visits;
+    
+    visits = 2 * table->entry_count + 1;
+    
+    while ((table->bytes_used > table->byte_budget) &&
+           (table->clock_hand != NULL) && (visits > 0)) {
+        victim = table->clock_hand;
+        table->clock_hand = victim->clock_next;
+        visits--;
+        
+        // never evict pinned entries,  entries pending removal or <keep>
+        if ((victim->key == keep) || (victim->ref_count > 1) ||
+            (victim->marked_for_removal))
+            continue;
+        
+        // give entries retrieved since the last turn a second chance
+        if (victim->referenced) {
+            victim->referenced = false;
+            continue;
+        } // end if
+        
+        // remove the victim,  which unlinks it from the ring
+        _kvs_remove(table, victim->key, victim, NULL);
+        table->evictions++;
+    } // end while
+    
+    return;
+} // end _kvs_cache_evict
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_cache_charge( entry )
+// ---------------------------------------------------------------------------
+//
+// Returns the number of bytes charged to a cache for <entry>,  the size of the
+// entry header  plus  the size of its value unless stored by reference.
+
+static fmacro size_t _kvs_cache_charge(kvs_entry entry) {
+    
+    if (entry->storage == KVS_STORAGE_REFERENCE)
+        return sizeof(kvs_entry_s);
+    else
+        return sizeof(kvs_entry_s) + entry->size;
+    
+} // end _kvs_cache_charge
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_expire_entry( table, entry, status )
+// ---------------------------------------------------------------------------
+//
+// Removes expired <entry> from non-concurrent table <table>  and returns NULL
+// with status KVS_STATUS_ENTRY_NOT_FOUND.  If the entry is still referenced,
+// then it is marked for removal instead  and returned,  so that it can be
+// released.  The status of the operation is passed back in <status>,  unless
+// NULL was passed in for <status>.
+
+static kvs_entry _kvs_expire_entry(kvs_table_s *table,
+                                     kvs_entry entry,
+                                  kvs_status_t *status) {
+    
+    if /* reference count > 1 */ (entry->ref_count > 1) {
+        
+        // don't remove the entry yet, mark it for removal
+        entry->marked_for_removal = true;
+        
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        return entry;
+    } // end if
+    
+    // remove the entry,  which also unlinks it from the timing wheel
+    _kvs_remove(table, entry->key, entry, NULL);
+    
+    _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    return NULL;
+} // end _kvs_expire_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_deadline( ttl )
+// ---------------------------------------------------------------------------
+//
+// Returns the expiry deadline <ttl> milliseconds from now,  or zero if <ttl>
+// is zero.  Deadlines beyond the range of kvs_time_t are clamped.
+
+static fmacro kvs_time_t _kvs_deadline(kvs_time_t ttl) {
+    kvs_time_t now;
+    
+    if (ttl == 0)
+        return 0;
+    
+    now = kvs_current_time();
+    
+    if (ttl > ~(kvs_time_t) 0 - now)
+        return ~(kvs_time_t) 0;
+    
+    return now + ttl;
+} // end _kvs_deadline
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_wall_clock()
+// ---------------------------------------------------------------------------
+//
+// Returns the current time of the real time clock in milliseconds since the
+// epoch.  Deadlines are saved against this clock,  the monotonic clock of
+// kvs_current_time() starts anew with every boot of the system.
+
+static kvs_time_t _kvs_wall_clock(void) {
+    struct timespec now;
+    
+    clock_gettime(CLOCK_REALTIME, &now);
+    
+    return (kvs_time_t) now.tv_sec * 1000 + (kvs_time_t) now.tv_nsec / 1000000;
+} // end _kvs_wall_clock
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_wall_deadline( expires )
+// ---------------------------------------------------------------------------
+//
+// Returns the deadline of the real time clock  that corresponds to deadline
+// <expires> of the monotonic clock,  or zero if <expires> is zero.  Deadlines
+// beyond the range of kvs_time_t are clamped.
+
+static kvs_time_t _kvs_wall_deadline(kvs_time_t expires) {
+    kvs_time_t now, wall;
+    
+    if (expires == 0)
+        return 0;
+    
+    now = kvs_current_time();
+    wall = _kvs_wall_clock();
+    
+    if (expires <= now)
+        return wall;
+    
+    if (expires - now > ~(kvs_time_t) 0 - wall)
+        return ~(kvs_time_t) 0;
+    
+    return wall + (expires - now);
+} // end _kvs_wall_deadline
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_local_deadline( deadline )
+// ---------------------------------------------------------------------------
+//
+// Returns the deadline of the monotonic clock  that corresponds to deadline
+// <deadline> of the real time clock,  or zero if <deadline> is zero.  A
+// deadline that has passed is returned as the current time,  an entry with
+// that deadline has expired.  Deadlines beyond the range of kvs_time_t are
+// clamped.
+
+static kvs_time_t _kvs_local_deadline(kvs_time_t deadline) {
+    kvs_time_t now, wall;
+    
+    if (deadline == 0)
+        return 0;
+    
+    now = kvs_current_time();
+    wall = _kvs_wall_clock();
+    
+    if (deadline <= wall)
+        return MAX(now, 1);
+    
+    if (deadline - wall > ~(kvs_time_t) 0 - now)
+        return ~(kvs_time_t) 0;
+    
+    return now + (deadline - wall);
+} // end _kvs_local_deadline
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_wheel_new()
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns a new empty timing wheel  set to the current time.
+// Returns NULL if allocation failed.
+
+static kvs_wheel_s *_kvs_wheel_new(void) {
+    kvs_wheel_s *new_wheel;
+    cardinal level, index;
+    
+    new_wheel = ALLOCATE(sizeof(kvs_wheel_s));
+    
+    if (new_wheel == NULL)
+        return NULL;
+    
+    new_wheel->now = kvs_current_time();
+    
+    for (level = 0; level < KVS_WHEEL_LEVELS; level++) {
+        new_wheel->occupied[level] = 0;
+        for (index = 0; index < KVS_WHEEL_SLOTS; index++) {
+            new_wheel->slot[level][index] = NULL;
+        } // end for
+    } // end for
+    
+    return new_wheel;
+} // end _kvs_wheel_new
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_wheel_insert( wheel, entry )
+// ---------------------------------------------------------------------------
+//
+// Links <entry> into the slot of <wheel> for its expiry deadline.  The level
+// is the one whose slots span the distance of the deadline from the current
+// time of the wheel.  A deadline that has passed is due at the next tick,  a
+// deadline beyond the span of the wheel is placed at its end.
+
+static void _kvs_wheel_insert(kvs_wheel_s *wheel, kvs_entry entry) {
+    kvs_time_t at, delta;
+    cardinal level, index;
+    kvs_entry *head;
+    
+    at = entry->expires;
+    if (at <= wheel->now)
+        at = wheel->now + 1;
+    
+    delta = at - wheel->now;
+    if (delta >= KVS_WHEEL_SPAN) {
+        delta = KVS_WHEEL_SPAN - 1;
+        at = wheel->now + delta;
+    } // end if
+    
+    // the level is given by the highest set bit of the distance
+    level = (63 - __builtin_clzll(delta)) / KVS_WHEEL_BITS;
+    index = (at >> (level * KVS_WHEEL_BITS)) & (KVS_WHEEL_SLOTS - 1);
+    
+    // link the entry at the head of the slot
+    head = &wheel->slot[level][index];
+    entry->timer_next = *head;
+    entry->timer_link = head;
+    if (*head != NULL)
+        (*head)->timer_link = &entry->timer_next;
+    *head = entry;
+    
+    wheel->occupied[level] |= (uint64_t) 1 << index;
+    
+    return;
+} // end _kvs_wheel_insert
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_wheel_unlink( wheel, entry )
+// ---------------------------------------------------------------------------
+//
+// Unlinks <entry> from its slot of <wheel>,  clearing the occupied bit of the
+// slot if it has become empty.
+
+static void _kvs_wheel_unlink(kvs_wheel_s *wheel, kvs_entry entry) {
+    kvs_entry *link = entry->timer_link;
+    uintptr_t offset;
+    cardinal index;
+    
+    *link = entry->timer_next;
+    if (entry->timer_next != NULL)
+        entry->timer_next->timer_link = link;
+    
+    // the link is a slot if it lies within the slot array
+    offset = (uintptr_t) link - (uintptr_t) &wheel->slot[0][0];
+    if ((offset < sizeof(wheel->slot)) && (*link == NULL)) {
+        index = (cardinal) (offset / sizeof(kvs_entry));
+        wheel->occupied[index / KVS_WHEEL_SLOTS] &=
+            ~((uint64_t) 1 << (index % KVS_WHEEL_SLOTS));
+    } // end if
+    
+    entry->timer_next = NULL;
+    entry->timer_link = NULL;
+    
+    return;
+} // end _kvs_wheel_unlink
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_wheel_take( wheel, level, index )
+// ---------------------------------------------------------------------------
+//
+// Empties slot <index> of <level> of <wheel>  and returns the list of entries
+// it held,  linked by their timer_next fields.  The timer links of the
+// entries are left to the caller.
+
+static kvs_entry _kvs_wheel_take(kvs_wheel_s *wheel,
+                                    cardinal level,
+                                    cardinal index) {
+    kvs_entry list;
+    
+    list = wheel->slot[level][index];
+    wheel->slot[level][index] = NULL;
+    wheel->occupied[level] &= ~((uint64_t) 1 << index);
+    
+    return list;
+} // end _kvs_wheel_take
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_wheel_next( wheel, tick )
+// ---------------------------------------------------------------------------
+//
+// Passes back in <tick> the earliest tick after the current time of <wheel>
+// at which a slot is due,  either to be reaped or to be cascaded,  and
+// returns true.  Returns false and passes back zero if the wheel is empty.
+// Only the occupied bitmaps are examined,  not the slots.
+
+static bool _kvs_wheel_next(kvs_wheel_s *wheel, kvs_time_t *tick) {
+    kvs_time_t span, next, earliest = 0;
+    uint64_t occupied;
+    cardinal level, shift;
+    bool found = false;
+    
+    for (level = 0; level < KVS_WHEEL_LEVELS; level++) {
+        occupied = wheel->occupied[level];
+        
+        if (occupied == 0)
+            continue;
+        
+        // rotate the bitmap so that bit 0 is the slot after the current one
+        span = wheel->now >> (level * KVS_WHEEL_BITS);
+        shift = (cardinal) ((span + 1) & (KVS_WHEEL_SLOTS - 1));
+        if (shift != 0)
+            occupied = (occupied >> shift) |
+                       (occupied << (KVS_WHEEL_SLOTS - shift));
+        
+        next = (span + __builtin_ctzll(occupied) + 1) <<
+               (level * KVS_WHEEL_BITS);
+        
+        if (NOT(found) || (next < earliest))
+            earliest = next;
+        found = true;
+    } // end for
+    
+    *tick = earliest;
+    return found;
+} // end _kvs_wheel_next
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_wheel_advance( table, now )
+// ---------------------------------------------------------------------------
+//
+// Advances the timing wheel of <table> to time <now>,  visiting only the ticks
+// at which a slot is due.  At each such tick,  the slots whose span starts
+// there are cascaded,  highest level first,  and the entries due are expired.
+// Returns the number of entries expired.
+
+static cardinal _kvs_wheel_advance(kvs_table_s *table, kvs_time_t now) {
+    kvs_wheel_s *wheel = table->wheel;
+    kvs_entry due, this_entry, next_entry;
+    cardinal level, count = 0;
+    kvs_time_t tick, span;
+    
+    while ((_kvs_wheel_next(wheel, &tick)) && (tick <= now)) {
+        wheel->now = tick;
+        due = NULL;
+        
+        // cascade the slots whose span starts at this tick
+        for (level = KVS_WHEEL_LEVELS; level > 0; ) {
+            level--;
+            
+            span = (kvs_time_t) 1 << (level * KVS_WHEEL_BITS);
+            if ((tick & (span - 1)) != 0)
+                continue;
+            
+            this_entry = _kvs_wheel_take(wheel, level,
+                (cardinal) (tick >> (level * KVS_WHEEL_BITS)) &
+                (KVS_WHEEL_SLOTS - 1));
+            
+            // entries not yet due move to a lower level
+            while (this_entry != NULL) {
+                next_entry = this_entry->timer_next;
+                
+                if (this_entry->expires <= tick) {
+                    this_entry->timer_link = NULL;
+                    this_entry->timer_next = due;
+                    due = this_entry;
+                }
+                else {
+                    _kvs_wheel_insert(wheel, this_entry);
+                } // end if
+                
+                this_entry = next_entry;
+            } // end while
+        } // end for
+        
+        // expire the entries due,  which are no longer in the wheel
+        while (due != NULL) {
+            next_entry = due->timer_next;
+            due->timer_next = NULL;
+            _kvs_expire_entry(table, due, NULL);
+            count++;
+            due = next_entry;
+        } // end while
+    } // end while
+    
+    if (now > wheel->now)
+        wheel->now = now;
+    
+    return count;
+} // end _kvs_wheel_advance
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_foreach_bucket_count( table )
+// ---------------------------------------------------------------------------
+//
+// Returns the number of buckets iteration visits in <table>.
+
+static cardinal _kvs_foreach_bucket_count(kvs_table_s *table) {
+    
+    if (table->flags & KVS_TABLE_SNAPSHOT)
+        return table->entry_count;
+    
+    if (table->flags & KVS_FLAG_OPEN_ADDRESSING)
+        return table->bucket_count;
+    
+    return (table->old_bucket_count - table->migrated_count) +
+           table->bucket_count;
+} // end _kvs_foreach_bucket_count
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_foreach_head( table, index )
+// ---------------------------------------------------------------------------
+//
+// Returns the first entry of bucket <index> of <table>  as numbered for
+// iteration,  or NULL if the bucket is empty.
+
+static fmacro kvs_entry _kvs_foreach_head(kvs_table_s *table, cardinal index) {
+    cardinal old_count;
+    
+    if (table->flags & KVS_FLAG_OPEN_ADDRESSING)
+        return table->slot[index].entry;
+    
+    if (table->flags & KVS_FLAG_CONCURRENT)
+        return __atomic_load_n(&table->bucket[index], __ATOMIC_ACQUIRE);
+    
+    old_count = table->old_bucket_count - table->migrated_count;
+    
+    if (index < old_count)
+        return table->old_bucket[table->migrated_count + index];
+    
+    return table->bucket[index - old_count];
+} // end _kvs_foreach_head
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_foreach_range( range )
+// ---------------------------------------------------------------------------
+//
+// Calls the action of <range>  for every entry in its range of buckets  that
+// is neither marked for removal nor expired,  and passes back the number of
+// entries visited in the count field of <range>.
+
+static void _kvs_foreach_range(kvs_foreach_s *range) {
+    kvs_table_s *table = range->table;
+    kvs_entry this_entry, ahead;
+    cardinal index;
+    kvs_epoch_t epoch;
+    kvs_time_t now;
+    
+    range->count = 0;
+    range->expires = 0;
+    range->status = KVS_STATUS_SUCCESS;
+    
+    // snapshot tables are visited record by record
+    if (table->flags & KVS_TABLE_SNAPSHOT) {
+        _kvs_foreach_snapshot(range);
+        return;
+    } // end if
+    
+    // frozen tables are visited through their origin or saved chains
+    if (table->flags & KVS_TABLE_FROZEN) {
+        _kvs_foreach_frozen(range);
+        return;
+    } // end if
+    
+    // compact tables are visited through their record indices
+    if (table->flags & KVS_FLAG_COMPACT) {
+        _kvs_foreach_compact(range);
+        return;
+    } // end if
+    
+    epoch = _kvs_read_begin(table);
+    
+    // entries can only have expired if the table has a timing wheel
+    now = (table->wheel != NULL) ? kvs_current_time() : 0;
+    
+    for (index = range->first; index < range->last; index++) {
+        
+        // prefetch the entries ahead,  then the values of those half as far
+        if (index + KVS_FOREACH_PREFETCH_DISTANCE < range->last) {
+            ahead = _kvs_foreach_head(table,
+                index + KVS_FOREACH_PREFETCH_DISTANCE);
+            if (ahead != NULL)
+                __builtin_prefetch(ahead);
+        } // end if
+        if (index + KVS_FOREACH_PREFETCH_DISTANCE / 2 < range->last) {
+            ahead = _kvs_foreach_head(table,
+                index + KVS_FOREACH_PREFETCH_DISTANCE / 2);
+            if (ahead != NULL)
+                __builtin_prefetch(ahead->value);
+        } // end if
+        
+        this_entry = _kvs_foreach_head(table, index);
+        
+        while (this_entry != NULL) {
+            
+            // skip entries pending removal and entries which have expired
+            if ((NOT(_kvs_is_marked(this_entry))) &&
+                ((this_entry->expires == 0) || (this_entry->expires > now))) {
+                range->expires = this_entry->expires;
+                if (this_entry->storage == KVS_STORAGE_CHUNKED) {
+                    _kvs_foreach_chunked(range, this_entry);
+                }
+                else {
+                    range->action(this_entry->key, this_entry->value,
+                                  this_entry->size,
+                                  this_entry->null_terminated,
+                                  range->context);
+                    range->count++;
+                } // end if
+            } // end if
+            
+            // open addressing slots hold a single entry
+            if (table->flags & KVS_FLAG_OPEN_ADDRESSING)
+                this_entry = NULL;
+            else if (table->flags & KVS_FLAG_CONCURRENT)
+                this_entry =
+                    __atomic_load_n(&this_entry->next, __ATOMIC_ACQUIRE);
+            else
+                this_entry = this_entry->next;
+        } // end while
+    } // end for
+    
+    _kvs_read_end(table, epoch);
+    
+    return;
+} // end _kvs_foreach_range
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_foreach_chunked( range, entry )
+// ---------------------------------------------------------------------------
+//
+// Calls the action of <range> for <entry>,  whose value is kept in chunks,
+// with a temporary copy of the value  and counts the entry as visited.  If
+// <range> has a chunked action,  that is called with the entry instead.  If
+// the copy cannot be allocated,  the entry is not visited and the status of
+// <range> is set to KVS_STATUS_ALLOCATION_FAILED.
+
+static void _kvs_foreach_chunked(kvs_foreach_s *range, kvs_entry entry) {
+    kvs_data_t value;
+    
+    // the chunked action takes the entry itself
+    if (range->chunked != NULL) {
+        if (range->chunked(entry, range->context))
+            range->count++;
+        return;
+    } // end if
+    
+    value = _kvs_retrieve_copy(entry, NULL);
+    
+    // bail out if allocation failed
+    if (value == NULL) {
+        range->status = KVS_STATUS_ALLOCATION_FAILED;
+        return;
+    } // end if
+    
+    range->action(entry->key, value, entry->size, entry->null_terminated,
+                  range->context);
+    range->count++;
+    
+    DEALLOCATE(value);
+    
+    return;
+} // end _kvs_foreach_chunked
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_foreach_snapshot( range )
+// ---------------------------------------------------------------------------
+//
+// Calls the action of <range>  for every record in its range of records  of
+// a snapshot table  that has not expired  and  passes back the number of
+// records visited in the count field of <range>.
+
+static void _kvs_foreach_snapshot(kvs_foreach_s *range) {
+    const kvs_snapshot_header_s *header;
+    const kvs_snapshot_record_s *record;
+    const octet_t *snapshot = range->table->snapshot;
+    const uint64_t *deadline;
+    cardinal index;
+    kvs_time_t now;
+    
+    header = (const kvs_snapshot_header_s *) snapshot;
+    record = (const kvs_snapshot_record_s *)
+        (snapshot + header->record_offset);
+    
+    // records can only have expired if the snapshot has deadlines
+    deadline = _kvs_snapshot_deadlines(snapshot);
+    now = (deadline != NULL) ? _kvs_wall_clock() : 0;
+    
+    for (index = range->first; index < range->last; index++) {
+        
+        if (index + KVS_FOREACH_PREFETCH_DISTANCE < range->last)
+            __builtin_prefetch(snapshot +
+                record[index + KVS_FOREACH_PREFETCH_DISTANCE].value_offset);
+        
+        // skip records which have expired
+        if (deadline != NULL) {
+            if ((deadline[index] != 0) && (deadline[index] <= now))
+                continue;
+            range->expires = _kvs_local_deadline(deadline[index]);
+        } // end if
+        
+        range->action(record[index].key,
+                      (kvs_data_t) (snapshot + record[index].value_offset),
+                      record[index].size, record[index].null_terminated,
+                      range->context);
+        range->count++;
+    } // end for
+    
+    return;
+} // end _kvs_foreach_snapshot
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_new( bucket_count )
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns the records of a new compact table  with a bucket
+// array of <bucket_count> empty buckets  and  no chunks.  Returns NULL if
+// allocation failed.
+
+static kvs_compact_s *_kvs_compact_new(cardinal bucket_count) {
+    kvs_compact_s *new_compact;
+    cardinal index;
+    
+    new_compact = ALLOCATE(sizeof(kvs_compact_s));
+    
+    if (new_compact == NULL)
+        return NULL;
+    
+    new_compact->bucket = ALLOCATE(sizeof(uint32_t) * bucket_count);
+    
+    if (new_compact->bucket == NULL) {
+        DEALLOCATE(new_compact);
+        return NULL;
+    } // end if
+    
+    // initialise buckets with index zero
+    for (index = 0; index < bucket_count; index++) {
+        new_compact->bucket[index] = 0;
+    } // end for
+    
+    new_compact->chunk = NULL;
+    new_compact->chunk_count = 0;
+    new_compact->chunk_capacity = 0;
+    new_compact->free_list = 0;
+    
+    // record zero is never used
+    new_compact->unused = 1;
+    
+    return new_compact;
+} // end _kvs_compact_new
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_dispose( compact )
+// ---------------------------------------------------------------------------
+//
+// Deallocates the records of a compact table <compact>  with their chunks and
+// bucket array  and  the values stored by copy that were not taken from the
+// slab of the table.  Values taken from the slab are released with the slab.
+
+static void _kvs_compact_dispose(kvs_compact_s *compact) {
+    kvs_compact_entry_s *record;
+    cardinal chunk_index, index;
+    
+    for (chunk_index = 0; chunk_index < compact->chunk_count; chunk_index++) {
+        
+        for (index = 0; index < KVS_COMPACT_CHUNK_SIZE; index++) {
+            record = &compact->chunk[chunk_index][index];
+            
+            if ((record->key != 0) && (record->state & KVS_COMPACT_COPY) &&
+                (record->size > KVS_INLINE_VALUE_LIMIT))
+                DEALLOCATE(record->value);
+        } // end for
+        
+        DEALLOCATE(compact->chunk[chunk_index]);
+    } // end for
+    
+    DEALLOCATE(compact->chunk);
+    DEALLOCATE(compact->bucket);
+    DEALLOCATE(compact);
+    
+    return;
+} // end _kvs_compact_dispose
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_record( compact, index )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to record <index> of compact table records <compact>.
+
+static fmacro kvs_compact_entry_s *_kvs_compact_record(kvs_compact_s *compact,
+                                                            uint32_t index) {
+    
+    return &compact->chunk[index >> KVS_COMPACT_CHUNK_BITS]
+                          [index & (KVS_COMPACT_CHUNK_SIZE - 1)];
+    
+} // end _kvs_compact_record
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_allocate( compact )
+// ---------------------------------------------------------------------------
+//
+// Returns the index of a free record of <compact>,  taken from the free list
+// first,  then from the records never used.  A new chunk is allocated when
+// the first record of a chunk is reached.  Returns zero if allocation failed
+// or all records are in use.
+
+static uint32_t _kvs_compact_allocate(kvs_compact_s *compact) {
+    kvs_compact_entry_s *new_chunk, **new_chunk_array;
+    cardinal index, capacity;
+    uint32_t record_index;
+    
+    // reuse a released record if there is one
+    if (compact->free_list != 0) {
+        record_index = compact->free_list;
+        compact->free_list =
+            _kvs_compact_record(compact, record_index)->next;
+        return record_index;
+    } // end if
+    
+    record_index = compact->unused;
+    
+    // exit if all record indices are in use
+    if (record_index == 0)
+        return 0;
+    
+    // allocate a new chunk with the first record of a chunk
+    if ((record_index >> KVS_COMPACT_CHUNK_BITS) == compact->chunk_count) {
+        
+        // grow the chunk pointer array if it is full
+        if (compact->chunk_count == compact->chunk_capacity) {
+            capacity = (compact->chunk_capacity == 0) ?
+                16 : compact->chunk_capacity * 2;
+            new_chunk_array = REALLOCATE(compact->chunk,
+                sizeof(kvs_compact_entry_s *) * capacity);
+            
+            if (new_chunk_array == NULL)
+                return 0;
+            
+            compact->chunk = new_chunk_array;
+            compact->chunk_capacity = capacity;
+        } // end if
+        
+        new_chunk =
+            ALLOCATE(sizeof(kvs_compact_entry_s) * KVS_COMPACT_CHUNK_SIZE);
+        
+        if (new_chunk == NULL)
+            return 0;
+        
+        // all records of a new chunk are free
+        for (index = 0; index < KVS_COMPACT_CHUNK_SIZE; index++) {
+            new_chunk[index].key = 0;
+        } // end for
+        
+        compact->chunk[compact->chunk_count] = new_chunk;
+        compact->chunk_count++;
+    } // end if
+    
+    // wraps around to zero after the last record index
+    compact->unused = record_index + 1;
+    
+    return record_index;
+} // end _kvs_compact_allocate
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_free( compact, index )
+// ---------------------------------------------------------------------------
+//
+// Puts record <index> of <compact> on the free list.
+
+static fmacro void _kvs_compact_free(kvs_compact_s *compact, uint32_t index) {
+    kvs_compact_entry_s *record = _kvs_compact_record(compact, index);
+    
+    record->key = 0;
+    record->next = compact->free_list;
+    compact->free_list = index;
+    
+    return;
+} // end _kvs_compact_free
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_find( table, key, link, status )
+// ---------------------------------------------------------------------------
+//
+// If an entry for <key> exists in compact table <table>,  then a pointer to
+// its record is returned,  otherwise NULL.  Unless NULL is passed in for
+// <link>,  a pointer to the bucket or next field holding the index of the
+// record is passed back in <link>,  or if the entry does not exist,  a pointer
+// to the bucket or next field at the end of the chain.  The status of the
+// operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+static kvs_compact_entry_s *_kvs_compact_find(kvs_table_s *table,
+                                                kvs_key_t key,
+                                                 uint32_t **link,
+                                             kvs_status_t *status) {
+    kvs_compact_s *compact = table->compact;
+    kvs_compact_entry_s *record;
+    uint32_t *this_link;
+    cardinal compared = 0;
+    
+    // keys rejected by the filter are not in the table,  unless a link to the
+    // end of the chain is requested
+    if ((link == NULL) && (table->filter != NULL) &&
+        NOT(_kvs_filter_query(table, key))) {
+        _kvs_stats_lookup(table, 0);
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+        return NULL;
+    } // end if
+    
+    this_link = &compact->bucket[_kvs_bucket_index(table, key,
+                                                    table->bucket_count)];
+    
+    // check every record in this bucket for a key match
+    while (*this_link != 0) {
+        record = _kvs_compact_record(compact, *this_link);
+        compared++;
+        
+        if /* key matched */ (record->key == key) {
+            if (link != NULL)
+                *link = this_link;
+            _kvs_stats_lookup(table, compared);
+            _kvs_set_status(status, KVS_STATUS_SUCCESS);
+            return record;
+        } // end if
+        
+        this_link = &record->next;
+    } // end while
+    
+    _kvs_stats_lookup(table, compared);
+    
+    if (link != NULL)
+        *link = this_link;
+    
+    // count keys passed by the filter that are not in the table
+    else if (table->filter != NULL)
+        table->filter->false_positives++;
+    
+    _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    return NULL;
+} // end _kvs_compact_find
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_add_entry( table, key, val, size, nt, ... )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry for <key> to compact table <table>  as _kvs_add_entry()
+// does.  Values stored by copy of up to KVS_INLINE_VALUE_LIMIT bytes are taken
+// from the slab of the table.  The status of the operation is passed back in
+// <status>.
+
+static void _kvs_compact_add_entry(kvs_table_s *table,
+                                     kvs_key_t key,
+                                    kvs_data_t value,
+                                      cardinal size,
+                                          bool null_terminated,
+                                          bool by_copy,
+                                  kvs_status_t *status) {
+    kvs_compact_s *compact = table->compact;
+    kvs_compact_entry_s *record;
+    uint32_t *link, index;
+    void *new_copy = NULL;
+    
+    // do not add a new entry if the key is not unique
+    if (_kvs_compact_find(table, key, &link, NULL) != NULL) {
+        *status = KVS_STATUS_KEY_NOT_UNIQUE;
+        return;
+    } // end if
+    
+    // allocate storage for a copy of the data
+    if (by_copy) {
+        if (size <= KVS_INLINE_VALUE_LIMIT)
+            new_copy = _kvs_slab_allocate(table->slab, size);
+        else
+            new_copy = ALLOCATE(size);
         
         // exit if allocation failed
-        if (new_entry == NULL) {
-            _kvs_set_status(status, _status);
+        if (new_copy == NULL) {
+            *status = KVS_STATUS_ALLOCATION_FAILED;
             return;
         } // end if
+    } // end if
+    
+    index = _kvs_compact_allocate(compact);
+    
+    // exit if allocation failed
+    if (index == 0) {
+        if (new_copy == NULL)
+            ;
+        else if (size <= KVS_INLINE_VALUE_LIMIT)
+            _kvs_slab_release(table->slab, new_copy, size);
+        else
+            DEALLOCATE(new_copy);
+        *status = KVS_STATUS_ALLOCATION_FAILED;
+        return;
+    } // end if
+    
+    record = _kvs_compact_record(compact, index);
+    record->key = key;
+    record->next = 0;
+    record->size = size;
+    record->state = KVS_COMPACT_REF_ONE;
+    
+    if (null_terminated)
+        record->state |= KVS_COMPACT_NULL_TERMINATED;
+    
+    if /* by copy */ (new_copy != NULL) {
+        memcpy(new_copy, value, size);
+        record->value = new_copy;
+        record->state |= KVS_COMPACT_COPY;
+    }
+    else /* by reference */ {
+        record->value = value;
+    } // end if
+    
+    // link the final entry in the chain,  or the empty bucket,  to the record
+    *link = index;
+    
+    if (table->filter != NULL)
+        _kvs_filter_add(table, key);
+    
+    table->entry_count++;
+    
+    *status = KVS_STATUS_SUCCESS;
+    return;
+} // end _kvs_compact_add_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_remove( table, key, expected, status )
+// ---------------------------------------------------------------------------
+//
+// Removes the entry for <key> from compact table <table>  as _kvs_remove()
+// does,  marking it for removal if it is still referenced.  If <expected> is
+// not NULL,  then the entry is only removed if its record is <expected>.  The
+// status of the operation is passed back in <status>,  unless NULL was passed
+// in for <status>.
+
+static void _kvs_compact_remove(kvs_table_s *table,
+                                  kvs_key_t key,
+                        kvs_compact_entry_s *expected,
+                               kvs_status_t *status) {
+    kvs_compact_entry_s *record;
+    uint32_t *link;
+    
+    record = _kvs_compact_find(table, key, &link, status);
+    
+    if /* key did not match */
+       ((record == NULL) || ((expected != NULL) && (record != expected))) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+    }
+    else if /* reference count is 1 or less */
+            (record->state < 2 * KVS_COMPACT_REF_ONE) {
+        _kvs_compact_unlink(table, link);
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    }
+    else /* reference count > 1 */ {
         
-        // link the empty bucket to the new entry
-        this_table->bucket[index] = new_entry;
+        // don't remove the entry yet, mark it for removal
+        record->state |= KVS_COMPACT_MARKED;
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    } // end if
+    
+    return;
+} // end _kvs_compact_remove
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_unlink( table, link )
+// ---------------------------------------------------------------------------
+//
+// Unlinks the record whose index is held by <link>  from its chain in compact
+// table <table>,  deallocates its value if stored by copy  and  puts the
+// record on the free list.
+
+static void _kvs_compact_unlink(kvs_table_s *table, uint32_t *link) {
+    kvs_compact_entry_s *record;
+    uint32_t index = *link;
+    
+    record = _kvs_compact_record(table->compact, index);
+    
+    // link predecessor or bucket to successor
+    *link = record->next;
+    
+    if /* value owned by the table */ (record->state & KVS_COMPACT_COPY) {
         
-        // update the entry counter
-        this_table->entry_count++;
+        // return small values to the slab, deallocate others
+        if (record->size <= KVS_INLINE_VALUE_LIMIT)
+            _kvs_slab_release(table->slab, record->value, record->size);
+        else
+            DEALLOCATE(record->value);
+    } // end if
+    
+    if (table->filter != NULL)
+        _kvs_filter_remove(table, record->key);
+    
+    _kvs_compact_free(table->compact, index);
+    
+    table->entry_count--;
+    
+    return;
+} // end _kvs_compact_unlink
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_get_entry( table, copy, key, size, nt, st )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry for <key> from compact table <table>  as kvs_get_entry()
+// does.  The status of the operation is passed back in <status>,  unless NULL
+// was passed in for <status>.
+
+static kvs_data_t _kvs_compact_get_entry(kvs_table_s *table,
+                                                bool copy,
+                                           kvs_key_t key,
+                                            cardinal *size,
+                                                bool *null_terminated,
+                                        kvs_status_t *status) {
+    kvs_compact_entry_s *record;
+    octet_t *new_copy;
+    
+    record = _kvs_compact_find(table, key, NULL, status);
+    
+    // exit if entry not found
+    if (record == NULL)
+        return NULL;
+    
+    // exit if entry is pending removal
+    if (record->state & KVS_COMPACT_MARKED) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+        return NULL;
+    } // end if
+    
+    // exit if by copy and entry size unknown
+    if ((copy == true) && (record->size == 0)) {
+        _kvs_set_status(status, KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN);
+        return NULL;
+    } // end if
+    
+    // pass back size and null_terminated
+    if (size != NULL)
+        *size = record->size;
+    if (null_terminated != NULL)
+        *null_terminated = (record->state & KVS_COMPACT_NULL_TERMINATED) != 0;
+    
+    if /* by reference */ (copy == false) {
         
-        // set status
-        _kvs_set_status(status, KVS_STATUS_SUCCESS);
-    }
-    else /* bucket is not empty */ {
+        // increment the reference count for entry
+        record->state += KVS_COMPACT_REF_ONE;
         
-        // first entry in this bucket is starting point
-        this_entry = (kvs_entry) this_table->bucket[index];
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        return (kvs_data_t) record->value;
+    } // end if
+    
+    // allocate storage for a copy of the data
+    new_copy = ALLOCATE(record->size);
+    
+    // exit if allocation failed
+    if (new_copy == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // copy data
+    memcpy(new_copy, record->value, record->size);
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return (kvs_data_t) new_copy;
+} // end _kvs_compact_get_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_compact_release( table, entry, status )
+// ---------------------------------------------------------------------------
+//
+// Decrements the reference count of record <entry> of compact table <table>
+// as kvs_release_entry() does,  removing the entry if it has been marked for
+// removal  and  this was its last reference.  The status of the operation is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+static void _kvs_compact_release(kvs_table_s *table,
+                         kvs_compact_entry_s *entry,
+                                kvs_status_t *status) {
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    // the reference held by the table itself is never released
+    if (entry->state < 2 * KVS_COMPACT_REF_ONE)
+        return;
+    
+    entry->state -= KVS_COMPACT_REF_ONE;
+    
+    // remove the entry if this was the last reference to a removed entry
+    if ((entry->state < 2 * KVS_COMPACT_REF_ONE) &&
+        (entry->state & KVS_COMPACT_MARKED))
+        _kvs_compact_remove(table, entry->key, entry, status);
+    
+    return;
+} // end _kvs_compact_release
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_foreach_compact( range )
+// ---------------------------------------------------------------------------
+//
+// Calls the action of <range>  for every entry in its range of buckets  of a
+// compact table  that is not marked for removal  and  passes back the number
+// of entries visited in the count field of <range>.
+
+static void _kvs_foreach_compact(kvs_foreach_s *range) {
+    kvs_compact_s *compact = range->table->compact;
+    kvs_compact_entry_s *record;
+    uint32_t next, ahead;
+    cardinal index;
+    
+    for (index = range->first; index < range->last; index++) {
         
-        // check every entry in this bucket for a key match
-        while ((this_entry->key != key) && (this_entry->next != NULL))
-            this_entry = this_entry->next;
+        // prefetch the records ahead,  then the values of those half as far
+        if (index + KVS_FOREACH_PREFETCH_DISTANCE < range->last) {
+            ahead = compact->bucket[index + KVS_FOREACH_PREFETCH_DISTANCE];
+            if (ahead != 0)
+                __builtin_prefetch(_kvs_compact_record(compact, ahead));
+        } // end if
+        if (index + KVS_FOREACH_PREFETCH_DISTANCE / 2 < range->last) {
+            ahead = compact->bucket[index + KVS_FOREACH_PREFETCH_DISTANCE / 2];
+            if (ahead != 0)
+                __builtin_prefetch(_kvs_compact_record(compact, ahead)->value);
+        } // end if
         
-        // the passed in key is unique if there was no key match
+        next = compact->bucket[index];
         
-        if /* new key is unique */ (this_entry->key != key) {
-            
-            // create a new entry
-            new_entry =
-            _kvs_new_entry_with_copy(key, value, size, null_terminated, &_status);
+        while (next != 0) {
+            record = _kvs_compact_record(compact, next);
             
-            // exit if allocation failed
-            if (new_entry == NULL) {
-                _kvs_set_status(status, _status);
-                return;
+            // skip entries pending removal
+            if (NOT(record->state & KVS_COMPACT_MARKED)) {
+                range->action(record->key, record->value, record->size,
+                    (record->state & KVS_COMPACT_NULL_TERMINATED) != 0,
+                    range->context);
+                range->count++;
             } // end if
             
-            // link the final entry in the chain to the new entry
-            this_entry->next = new_entry;
-            
-            // update the entry counter
-            this_table->entry_count++;
-            
-            // set status
-            _kvs_set_status(status, KVS_STATUS_SUCCESS);
-        }
-        else /* key is not unique */ {
-            
-            // do not add a new entry
-            
-            // set status
-            _kvs_set_status(status, KVS_STATUS_KEY_NOT_UNIQUE);
+            next = record->next;
+        } // end while
+    } // end for
+    
+    return;
+} // end _kvs_foreach_compact
+
+
+#if KVS_USE_THREADS
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_foreach_worker( range_p )
+// ---------------------------------------------------------------------------
+//
+// Thread function of parallel iteration,  visits range <range_p>.
+
+static void *_kvs_foreach_worker(void *range_p) {
+    
+    _kvs_foreach_range((kvs_foreach_s *) range_p);
+    
+    return NULL;
+} // end _kvs_foreach_worker
+
+#endif /* KVS_USE_THREADS */
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_filter_new( bucket_count )
+// ---------------------------------------------------------------------------
+//
+// Allocates and returns a lookup filter with all counters zero  for a table of
+// <bucket_count> buckets.  The number of blocks is the power of two that gives
+// at least KVS_FILTER_COUNTERS_PER_BUCKET counters per bucket.  Returns NULL
+// if allocation failed.
+
+static kvs_filter_s *_kvs_filter_new(cardinal bucket_count) {
+    kvs_filter_s *new_filter;
+    uint64_t counters;
+    cardinal block_count, index;
+    void *block;
+    
+    counters = (uint64_t) bucket_count * KVS_FILTER_COUNTERS_PER_BUCKET;
+    
+    // size must not exceed the largest power of two in range
+    if (counters / KVS_FILTER_BLOCK_COUNTERS >
+        ((cardinal) 1 << (sizeof(cardinal) * 8 - 1)))
+        return NULL;
+    
+    block_count = 1;
+    while ((uint64_t) block_count * KVS_FILTER_BLOCK_COUNTERS < counters)
+        block_count = block_count << 1;
+    
+    new_filter = ALLOCATE(sizeof(kvs_filter_s));
+    
+    if (new_filter == NULL)
+        return NULL;
+    
+    // blocks must be aligned to cache lines
+    block = ALLOCATE((size_t) block_count * KVS_CACHE_LINE_SIZE +
+                     KVS_CACHE_LINE_SIZE);
+    
+    if (block == NULL) {
+        DEALLOCATE(new_filter);
+        return NULL;
+    } // end if
+    
+    new_filter->counter = (uint64_t *)
+        (((uintptr_t) block + KVS_CACHE_LINE_SIZE) &
+         ~(uintptr_t) (KVS_CACHE_LINE_SIZE - 1));
+    new_filter->block = block;
+    new_filter->block_mask = block_count - 1;
+    new_filter->rejections = 0;
+    new_filter->false_positives = 0;
+    
+    for (index = 0; index < block_count * KVS_FILTER_BLOCK_WORDS; index++) {
+        new_filter->counter[index] = 0;
+    } // end for
+    
+    return new_filter;
+} // end _kvs_filter_new
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_filter_dispose( filter )
+// ---------------------------------------------------------------------------
+//
+// Deallocates lookup filter <filter>.  Has no effect if <filter> is NULL.
+
+static void _kvs_filter_dispose(kvs_filter_s *filter) {
+    
+    if (filter == NULL)
+        return;
+    
+    DEALLOCATE(filter->block);
+    DEALLOCATE(filter);
+    
+    return;
+} // end _kvs_filter_dispose
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_filter_block( filter, hash )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the first counter word of the block of <filter> that
+// is selected by the high bits of key hash <hash>.
+
+static fmacro uint64_t *_kvs_filter_block(kvs_filter_s *filter,
+                                              uint64_t hash) {
+    
+    return &filter->counter[((cardinal) (hash >> 32) & filter->block_mask) *
+                            KVS_FILTER_BLOCK_WORDS];
+    
+} // end _kvs_filter_block
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_filter_add( table, key )
+// ---------------------------------------------------------------------------
+//
+// Increments the counters of <key> in the lookup filter of <table>,  counters
+// at their maximum are left unchanged.
+
+static void _kvs_filter_add(kvs_table_s *table, kvs_key_t key) {
+    uint64_t hash, *block;
+    cardinal probe, index, shift;
+    
+    hash = _kvs_hash(table, key);
+    block = _kvs_filter_block(table->filter, hash);
+    
+    for (probe = 0; probe < KVS_FILTER_PROBES; probe++) {
+        index = (cardinal) (hash >> (probe * 8)) &
+                (KVS_FILTER_BLOCK_COUNTERS - 1);
+        shift = (index & 15) * 4;
+        
+        if (((block[index >> 4] >> shift) & KVS_FILTER_COUNTER_MAX) !=
+            KVS_FILTER_COUNTER_MAX)
+            block[index >> 4] += (uint64_t) 1 << shift;
+    } // end for
+    
+    return;
+} // end _kvs_filter_add
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_filter_remove( table, key )
+// ---------------------------------------------------------------------------
+//
+// Decrements the counters of <key> in the lookup filter of <table>,  counters
+// at their maximum are left unchanged.  The key must have been added before.
+
+static void _kvs_filter_remove(kvs_table_s *table, kvs_key_t key) {
+    uint64_t hash, *block, count;
+    cardinal probe, index, shift;
+    
+    hash = _kvs_hash(table, key);
+    block = _kvs_filter_block(table->filter, hash);
+    
+    for (probe = 0; probe < KVS_FILTER_PROBES; probe++) {
+        index = (cardinal) (hash >> (probe * 8)) &
+                (KVS_FILTER_BLOCK_COUNTERS - 1);
+        shift = (index & 15) * 4;
+        count = (block[index >> 4] >> shift) & KVS_FILTER_COUNTER_MAX;
+        
+        if ((count != 0) && (count != KVS_FILTER_COUNTER_MAX))
+            block[index >> 4] -= (uint64_t) 1 << shift;
+    } // end for
+    
+    return;
+} // end _kvs_filter_remove
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_filter_query( table, key )
+// ---------------------------------------------------------------------------
+//
+// Returns false if <key> is certainly not in <table>  according to its lookup
+// filter  and counts the rejection,  otherwise returns true.
+
+static bool _kvs_filter_query(kvs_table_s *table, kvs_key_t key) {
+    uint64_t hash, *block;
+    cardinal probe, index;
+    
+    hash = _kvs_hash(table, key);
+    block = _kvs_filter_block(table->filter, hash);
+    
+    for (probe = 0; probe < KVS_FILTER_PROBES; probe++) {
+        index = (cardinal) (hash >> (probe * 8)) &
+                (KVS_FILTER_BLOCK_COUNTERS - 1);
+        
+        if (((block[index >> 4] >> ((index & 15) * 4)) &
+             KVS_FILTER_COUNTER_MAX) == 0) {
+            table->filter->rejections++;
+            return false;
         } // end if
+    } // end for
+    
+    return true;
+} // end _kvs_filter_query
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_hot_slot( table, key )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the slot of the hot entry cache of <table>  for <key>.
+// Keys are mapped to slots by Fibonacci hashing,  the slot is taken from the
+// high bits of the product  so that sequential keys map to distinct slots.
+
+static fmacro kvs_entry *_kvs_hot_slot(kvs_table_s *table, kvs_key_t key) {
+    
+    return &table->hot[(cardinal) (((uint64_t) key * 0x9E3779B97F4A7C15ULL)
+                                   >> 40) & table->hot_mask];
+    
+} // end _kvs_hot_slot
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_hot_forget( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Removes <entry> from the hot entry cache of <table>  if it is cached.
+
+static fmacro void _kvs_hot_forget(kvs_table_s *table, kvs_entry entry) {
+    kvs_entry *slot = _kvs_hot_slot(table, entry->key);
+    
+    if (*slot == entry)
+        *slot = NULL;
+    
+    return;
+} // end _kvs_hot_forget
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_value_store_new()
+// ---------------------------------------------------------------------------
+//
+// Returns a new empty value store,  returns NULL if allocation failed.
+
+static kvs_value_store_s *_kvs_value_store_new(void) {
+    kvs_value_store_s *new_store;
+    cardinal index;
+    
+    new_store = ALLOCATE(sizeof(kvs_value_store_s));
+    
+    if (new_store == NULL)
+        return NULL;
+    
+    new_store->bucket =
+        ALLOCATE(KVS_VALUE_STORE_INITIAL_SIZE * sizeof(kvs_shared));
+    
+    if (new_store->bucket == NULL) {
+        DEALLOCATE(new_store);
+        return NULL;
     } // end if
     
-    return;
-} // end kvs_store_value
+    for (index = 0; index < KVS_VALUE_STORE_INITIAL_SIZE; index++)
+        new_store->bucket[index] = NULL;
+    
+    new_store->bucket_count = KVS_VALUE_STORE_INITIAL_SIZE;
+    new_store->value_count = 0;
+    
+    return new_store;
+} // end _kvs_value_store_new
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_store_reference( tbl, key, val, siz, null_terminated, stat )
+// private function:  _kvs_value_store_dispose( store )
 // ---------------------------------------------------------------------------
 //
-// Adds a new entry  for key <key>  to table <table>.  The new entry is stored
-// by reference.  No data is copied.  If <size> is zero  and <null_terminated>
-// is true,  then  the size of the referenced data  is calculated  by counting
-// up to  and including  the  first  zero-value byte.  The size of the data is
-// then stored for faster retrieval by-copy of the entry.  Entries  stored  by
-// reference  and for which  the size  is unknown cannot be retrieved by copy.
-// The initial reference count of the new entry will be set to one.
-//
-// Keys must be unique.  Existing entries are not replaced.  Duplicate entries
-// are not added.  The  status  of  the operation  is passed back in <status>,
-// unless NULL was passed in for <status>.
+// Deallocates <store> and any values left in it.  Does nothing if <store> is
+// NULL.
 
-void kvs_store_reference(kvs_table_t table,
-                           kvs_key_t key,
-                          kvs_data_t value,
-                            cardinal size,
-                           bool null_terminated,
-                        kvs_status_t *status) {
+static void _kvs_value_store_dispose(kvs_value_store_s *store) {
+    kvs_shared this_value, next_value;
     cardinal index;
-    kvs_table_s *this_table = (kvs_table_s *) table;
-    kvs_entry_s *new_entry = NULL;
-    kvs_entry_s *this_entry = NULL;
-    kvs_status_t _status;
     
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+    if (store == NULL)
         return;
+    
+    for (index = 0; index < store->bucket_count; index++) {
+        this_value = store->bucket[index];
+        while (this_value != NULL) {
+            next_value = this_value->next;
+            DEALLOCATE(this_value);
+            this_value = next_value;
+        } // end while
+    } // end for
+    
+    DEALLOCATE(store->bucket);
+    DEALLOCATE(store);
+    
+    return;
+} // end _kvs_value_store_dispose
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_value_hash( data, size )
+// ---------------------------------------------------------------------------
+//
+// Returns a 64-bit hash of the <size> bytes at <data>.  The bytes are mixed
+// in a word at a time,  any trailing bytes are mixed in as a partial word.
+
+static uint64_t _kvs_value_hash(const octet_t *data, cardinal size) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size, word;
+    cardinal index = 0;
+    
+    while (index + sizeof(uint64_t) <= size) {
+        memcpy(&word, data + index, sizeof(uint64_t));
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+        index = index + sizeof(uint64_t);
+    } // end while
+    
+    if (index < size) {
+        word = 0;
+        memcpy(&word, data + index, size - index);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
     } // end if
     
-    // key must not be zero
-    if (key == 0) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+    hash ^= hash >> 33;
+    hash = hash * 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    
+    return hash;
+} // end _kvs_value_hash
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_value_intern( store, value, size )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the data of a value in <store>  equal to the <size>
+// bytes at <value>  and counts one more entry sharing it.  If <store> holds
+// no equal value,  a copy of <value> is added to it.  Returns NULL if the
+// allocation of a new value failed.
+
+static void *_kvs_value_intern(kvs_value_store_s *store,
+                                      kvs_data_t value,
+                                        cardinal size) {
+    kvs_shared this_value;
+    uint64_t hash;
+    cardinal index;
+    
+    hash = _kvs_value_hash(value, size);
+    index = (cardinal) hash & (store->bucket_count - 1);
+    
+    // search the bucket for an equal value
+    this_value = store->bucket[index];
+    while (this_value != NULL) {
+        if ((this_value->hash == hash) && (this_value->size == size) &&
+            (memcmp(this_value->data, value, size) == 0)) {
+            this_value->share_count++;
+            return this_value->data;
+        } // end if
+        this_value = this_value->next;
+    } // end while
+    
+    // no equal value,  add a copy
+    this_value = ALLOCATE(sizeof(kvs_shared_s) + size);
+    
+    if (this_value == NULL)
+        return NULL;
+    
+    memcpy(this_value->data, value, size);
+    this_value->hash = hash;
+    this_value->size = size;
+    this_value->share_count = 1;
+    this_value->next = store->bucket[index];
+    store->bucket[index] = this_value;
+    store->value_count++;
+    
+    if (store->value_count > store->bucket_count)
+        _kvs_value_store_grow(store);
+    
+    return this_value->data;
+} // end _kvs_value_intern
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_value_release( store, data )
+// ---------------------------------------------------------------------------
+//
+// Counts one entry less sharing the value in <store>  whose data is <data>.
+// The value is removed from <store> and deallocated  when no entry shares it
+// any longer.
+
+static void _kvs_value_release(kvs_value_store_s *store, opaque_t data) {
+    kvs_shared this_value, *link;
+    
+    // the value header immediately precedes its data
+    this_value = (kvs_shared) ((octet_t *) data - sizeof(kvs_shared_s));
+    
+    this_value->share_count--;
+    
+    if (this_value->share_count > 0)
         return;
-    } // end if
     
-    // value must not be NULL
-    if (value == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+    // unlink the value from its bucket
+    link = &store->bucket[(cardinal) this_value->hash &
+                          (store->bucket_count - 1)];
+    while (*link != this_value)
+        link = &(*link)->next;
+    *link = this_value->next;
+    
+    store->value_count--;
+    DEALLOCATE(this_value);
+    
+    return;
+} // end _kvs_value_release
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_value_store_grow( store )
+// ---------------------------------------------------------------------------
+//
+// Doubles the number of buckets of <store>  and redistributes its values by
+// their stored hashes.  Leaves <store> unchanged if allocation failed,  its
+// chains merely grow longer.
+
+static void _kvs_value_store_grow(kvs_value_store_s *store) {
+    kvs_shared *new_bucket, this_value, next_value;
+    cardinal new_count, index, new_index;
+    
+    new_count = store->bucket_count * 2;
+    new_bucket = ALLOCATE(new_count * sizeof(kvs_shared));
+    
+    if (new_bucket == NULL)
         return;
+    
+    for (index = 0; index < new_count; index++)
+        new_bucket[index] = NULL;
+    
+    for (index = 0; index < store->bucket_count; index++) {
+        this_value = store->bucket[index];
+        while (this_value != NULL) {
+            next_value = this_value->next;
+            new_index = (cardinal) this_value->hash & (new_count - 1);
+            this_value->next = new_bucket[new_index];
+            new_bucket[new_index] = this_value;
+            this_value = next_value;
+        } // end while
+    } // end for
+    
+    DEALLOCATE(store->bucket);
+    store->bucket = new_bucket;
+    store->bucket_count = new_count;
+    
+    return;
+} // end _kvs_value_store_grow
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_grave_for_key( table, key )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the graveyard bucket of <table>  for <key>.  Keys are
+// mapped to buckets by Fibonacci hashing as in the hot entry cache.
+
+static fmacro kvs_entry *_kvs_grave_for_key(kvs_table_s *table, kvs_key_t key) {
+    
+    return &table->grave[(cardinal) (((uint64_t) key * 0x9E3779B97F4A7C15ULL)
+                                     >> 32) & table->grave_mask];
+    
+} // end _kvs_grave_for_key
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_grave_find( table, key )
+// ---------------------------------------------------------------------------
+//
+// Returns the entry for <key> in the graveyard of <table>,  or NULL if there
+// is none.
+
+static kvs_entry _kvs_grave_find(kvs_table_s *table, kvs_key_t key) {
+    kvs_entry this_entry;
+    
+    if (table->grave == NULL)
+        return NULL;
+    
+    this_entry = *_kvs_grave_for_key(table, key);
+    while ((this_entry != NULL) && (this_entry->key != key))
+        this_entry = this_entry->next;
+    
+    return this_entry;
+} // end _kvs_grave_find
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_bury_entry( table, bucket, prev, entry )
+// ---------------------------------------------------------------------------
+//
+// Moves <entry>,  marked for removal,  from <bucket> of non-concurrent chained
+// table <table>,  in which <prev> is its predecessor or NULL if <entry> is
+// first,  to the graveyard of the table.  The entry keeps its place in the
+// entry count,  the lookup filter and the hot entry cache until it is removed.
+// Returns false and leaves the entry in its chain  if the graveyard could not
+// grow.
+
+static bool _kvs_bury_entry(kvs_table_s *table,
+                              kvs_entry *bucket,
+                              kvs_entry prev,
+                              kvs_entry entry) {
+    kvs_entry *grave;
+    
+    // grow the graveyard when it holds as many entries as buckets
+    if (((table->grave == NULL) || (table->grave_count > table->grave_mask)) &&
+        NOT(_kvs_grave_grow(table)))
+        return false;
+    
+    // link predecessor or bucket root to successor
+    if /* first entry */ (prev == NULL)
+        *bucket = entry->next;
+    else /* not first entry */
+        prev->next = entry->next;
+    
+    // link the entry first in its graveyard bucket
+    grave = _kvs_grave_for_key(table, entry->key);
+    entry->next = *grave;
+    *grave = entry;
+    table->grave_count++;
+    
+    return true;
+} // end _kvs_bury_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_grave_grow( table )
+// ---------------------------------------------------------------------------
+//
+// Allocates the graveyard of <table>  with KVS_GRAVEYARD_INITIAL_SIZE buckets,
+// or doubles its buckets  and  redistributes its entries.  Returns false  if
+// allocation failed.
+
+static bool _kvs_grave_grow(kvs_table_s *table) {
+    kvs_entry *old_grave, this_entry, next_entry, *grave;
+    cardinal index, old_count, new_count;
+    
+    old_grave = table->grave;
+    old_count = (old_grave != NULL) ? table->grave_mask + 1 : 0;
+    new_count = (old_grave != NULL) ? old_count * 2 :
+                KVS_GRAVEYARD_INITIAL_SIZE;
+    
+    table->grave = ALLOCATE(new_count * sizeof(kvs_entry));
+    
+    if (table->grave == NULL) {
+        table->grave = old_grave;
+        return false;
     } // end if
     
-    // size must not be NULL if data is not null-terminated
-    if ((size == 0) && (null_terminated == false)) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
-        return;
+    for (index = 0; index < new_count; index++)
+        table->grave[index] = NULL;
+    
+    table->grave_mask = new_count - 1;
+    
+    // redistribute the entries of the old graveyard
+    for (index = 0; index < old_count; index++) {
+        this_entry = old_grave[index];
+        while (this_entry != NULL) {
+            next_entry = this_entry->next;
+            grave = _kvs_grave_for_key(table, this_entry->key);
+            this_entry->next = *grave;
+            *grave = this_entry;
+            this_entry = next_entry;
+        } // end while
+    } // end for
+    
+    DEALLOCATE(old_grave);
+    
+    return true;
+} // end _kvs_grave_grow
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_arena_renew( table )
+// ---------------------------------------------------------------------------
+//
+// Starts to compact the arena of <table>  by making it the old arena  and
+// allocating a new arena  large enough for the live entries of the old one.
+// An arena without live entries is deallocated instead.  Returns false and
+// leaves the arena unchanged if allocation failed,  otherwise true.
+
+static bool _kvs_arena_renew(kvs_table_s *table) {
+    octet_t *new_arena;
+    
+    if /* no live entries */ (table->arena_live == 0) {
+        DEALLOCATE(table->arena);
+        table->arena = NULL;
+        table->arena_size = 0;
+        return true;
     } // end if
     
-    if /* size unknown */ ((size == 0) && (null_terminated)) {
-        // calculate size
-        size = _kvs_calc_null_terminated_data_size(value);
-        if (size == 0) {
-            _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
-            return;
-        } // end if
+    new_arena = ALLOCATE(table->arena_live);
+    
+    if (new_arena == NULL)
+        return false;
+    
+    table->old_arena = table->arena;
+    table->old_arena_size = table->arena_size;
+    table->old_arena_live = table->arena_live;
+    table->arena = new_arena;
+    table->arena_size = table->arena_live;
+    table->arena_live = 0;
+    table->arena_fill = 0;
+    
+    return true;
+} // end _kvs_arena_renew
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_arena_move( table, bucket, prev, entry )
+// ---------------------------------------------------------------------------
+//
+// Moves unreferenced <entry> from the old arena of <table>  to the end of the
+// filled part of its arena  and returns the moved entry.  <prev> is the pre-
+// decessor of <entry> in <bucket>,  or NULL if <entry> is first.  The links
+// to the entry from its chain,  the timing wheel and the hot entry cache are
+// updated.  The old arena is deallocated when its last entry is moved.
+
+static kvs_entry _kvs_arena_move(kvs_table_s *table,
+                                   kvs_entry *bucket,
+                                   kvs_entry prev,
+                                   kvs_entry entry) {
+    kvs_entry new_entry, *slot;
+    size_t size;
+    
+    size = KVS_ARENA_ENTRY_SIZE(entry->size);
+    new_entry = (kvs_entry) (table->arena + table->arena_fill);
+    memcpy(new_entry, entry, size);
+    new_entry->value = new_entry->data;
+    
+    table->arena_fill += size;
+    table->arena_live += size;
+    
+    // link predecessor or bucket root to the moved entry
+    if /* first entry */ (prev == NULL)
+        *bucket = new_entry;
+    else /* not first entry */
+        prev->next = new_entry;
+    
+    // relink the moved entry in the timing wheel
+    if (new_entry->timer_link != NULL) {
+        *new_entry->timer_link = new_entry;
+        if (new_entry->timer_next != NULL)
+            new_entry->timer_next->timer_link = &new_entry->timer_next;
     } // end if
     
-    // calculate the bucket index for key
-    index = key % this_table->bucket_count;
+    // replace the entry in the hot entry cache
+    slot = _kvs_hot_slot(table, entry->key);
+    if (*slot == entry)
+        *slot = new_entry;
+    
+    // the old arena is deallocated with its last entry
+    _kvs_arena_release(table, entry);
+    
+    return new_entry;
+} // end _kvs_arena_move
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_arena_release( table, entry )
+// ---------------------------------------------------------------------------
+//
+// Deducts the bytes of arena entry <entry>  from the live bytes of the arena
+// of <table> which holds it.  The old arena is deallocated when it holds no
+// more live entries.  Arenas of concurrent tables are not accounted,  they
+// are never compacted.
+
+static void _kvs_arena_release(kvs_table_s *table, kvs_entry entry) {
+    size_t size = KVS_ARENA_ENTRY_SIZE(entry->size);
+    
+    if (table->flags & KVS_FLAG_CONCURRENT)
+        return;
     
-    if /* bucket is empty */ (this_table->bucket[index] == NULL) {
+    if /* in the old arena */ ((table->old_arena != NULL) &&
+        ((octet_t *) entry >= table->old_arena) &&
+        ((octet_t *) entry < table->old_arena + table->old_arena_size)) {
         
-        // create a new entry
-        new_entry =
-        _kvs_new_entry_with_ref(key, value, size, null_terminated, &_status);
+        table->old_arena_live -= size;
         
-        // exit if allocation failed
-        if (new_entry == NULL) {
-            _kvs_set_status(status, _status);
-            return;
+        if (table->old_arena_live == 0) {
+            DEALLOCATE(table->old_arena);
+            table->old_arena = NULL;
+            table->old_arena_size = 0;
         } // end if
-        
-        // link the empty bucket to the new entry
-        this_table->bucket[index] = new_entry;
-        
-        // update the entry counter
-        this_table->entry_count++;
-        
-        // set status
-        _kvs_set_status(status, KVS_STATUS_SUCCESS);
     }
-    else /* bucket is not empty */ {
-        
-        // first entry in this bucket is starting point
-        this_entry = (kvs_entry) this_table->bucket[index];
-        
-        // check every entry in this bucket for a key match
-        while ((this_entry->key != key) && (this_entry->next != NULL))
-            this_entry = this_entry->next;
-        
-        // the passed in key is unique if there was no key match
+    else /* in the arena */ {
+        table->arena_live -= size;
+    } // end if
+    
+    return;
+} // end _kvs_arena_release
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_frozen_is_shared( frozen, index )
+// ---------------------------------------------------------------------------
+//
+// Returns true if bucket <index> of the origin is still shared with the
+// snapshot of <frozen>,  otherwise its saved chain holds the bucket.
+
+static fmacro bool _kvs_frozen_is_shared(kvs_frozen_s *frozen, cardinal index) {
+    
+    return ((__atomic_load_n(&frozen->shared[index / 64], __ATOMIC_ACQUIRE) >>
+             (index % 64)) & 1) != 0;
+} // end _kvs_frozen_is_shared
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_frozen_save( frozen, index )
+// ---------------------------------------------------------------------------
+//
+// Copies the entries of shared bucket <index> of the origin of <frozen>  that
+// are not marked for removal  to the saved chain of the bucket  and  ends the
+// sharing of the bucket.  Values stored by reference remain references,  all
+// others are copied.  Returns false if allocation failed,  the bucket then
+// remains shared.  The caller must hold the lock of the origin bucket.
+
+static bool _kvs_frozen_save(kvs_frozen_s *frozen, cardinal index) {
+    kvs_entry this_entry, new_entry, chain = NULL;
+    
+    this_entry = frozen->origin->bucket[index];
+    while (this_entry != NULL) {
         
-        if /* new key is unique */ (this_entry->key != key) {
+        if (NOT(_kvs_is_marked(this_entry))) {
             
-            // create a new entry
-            new_entry =
-            _kvs_new_entry_with_ref(key, value, size, null_terminated, &_status);
+            if (this_entry->storage == KVS_STORAGE_REFERENCE)
+                new_entry = _kvs_new_entry_with_ref(this_entry->key,
+                    this_entry->value, this_entry->size,
+                    this_entry->null_terminated, NULL);
+            else
+                new_entry = _kvs_new_entry_with_copy(frozen->table,
+                    this_entry->key, this_entry->value, this_entry->size,
+                    this_entry->null_terminated, NULL);
             
-            // exit if allocation failed
+            // exit if allocation failed,  discarding the partial chain
             if (new_entry == NULL) {
-                _kvs_set_status(status, _status);
-                return;
+                while (chain != NULL) {
+                    new_entry = chain;
+                    chain = chain->next;
+                    _kvs_dispose_entry(frozen->table, new_entry, NULL);
+                } // end while
+                return false;
             } // end if
             
-            // link the final entry in the chain to the new entry
-            this_entry->next = new_entry;
-            
-            // update the entry counter
-            this_table->entry_count++;
-            
-            // set status
-            _kvs_set_status(status, KVS_STATUS_SUCCESS);
-        }
-        else /* key is not unique */ {
+            new_entry->expires = this_entry->expires;
+            new_entry->next = chain;
+            chain = new_entry;
+        } // end if
+        
+        this_entry = this_entry->next;
+    } // end while
+    
+    frozen->saved[index] = chain;
+    
+    // readers finding the bit cleared read the saved chain without a lock
+    __atomic_fetch_and(&frozen->shared[index / 64],
+                       ~((uint64_t) 1 << (index % 64)), __ATOMIC_RELEASE);
+    __atomic_fetch_sub(&frozen->shared_count, 1, __ATOMIC_RELAXED);
+    
+    return true;
+} // end _kvs_frozen_save
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_frozen_detach( table, bucket )
+// ---------------------------------------------------------------------------
+//
+// Saves <bucket> of <table> in every snapshot of the table that still shares
+// it,  before the caller changes the bucket.  Returns false if allocation
+// failed,  the bucket must then not be changed.  The caller must hold the
+// lock of <bucket>.
+
+static bool _kvs_frozen_detach(kvs_table_s *table, kvs_entry *bucket) {
+    kvs_frozen_s *frozen;
+    cardinal index;
+    
+    for (frozen = table->frozen; frozen != NULL; frozen = frozen->next) {
+        
+        // buckets are only shared while the bucket array is not replaced
+        if (__atomic_load_n(&frozen->shared_count, __ATOMIC_RELAXED) == 0)
+            continue;
+        
+        index = (cardinal) (bucket - table->bucket);
+        if ((_kvs_frozen_is_shared(frozen, index)) &&
+            NOT(_kvs_frozen_save(frozen, index)))
+            return false;
+    } // end for
+    
+    return true;
+} // end _kvs_frozen_detach
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_frozen_detach_all( table )
+// ---------------------------------------------------------------------------
+//
+// Saves every bucket of <table> in every snapshot of the table that still
+// shares it,  before the caller replaces or disposes of the bucket array.
+// Returns false if allocation failed,  some buckets then remain shared.
+
+static bool _kvs_frozen_detach_all(kvs_table_s *table) {
+    kvs_frozen_s *frozen;
+    cardinal index;
+    bool saved;
+    
+    for (frozen = table->frozen; frozen != NULL; frozen = frozen->next) {
+        for (index = 0; index < table->bucket_count; index++) {
             
-            // do not add a new entry
+            if (__atomic_load_n(&frozen->shared_count, __ATOMIC_RELAXED) == 0)
+                break;
             
-            // set status
-            _kvs_set_status(status, KVS_STATUS_KEY_NOT_UNIQUE);
+            if (_kvs_frozen_is_shared(frozen, index)) {
+                _kvs_lock_bucket(table, &table->bucket[index]);
+                saved = NOT(_kvs_frozen_is_shared(frozen, index)) ||
+                    _kvs_frozen_save(frozen, index);
+                _kvs_unlock_bucket(table, &table->bucket[index]);
+                
+                if (NOT(saved))
+                    return false;
+            } // end if
+        } // end for
+    } // end for
+    
+    return true;
+} // end _kvs_frozen_detach_all
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_frozen_open( table, index, detach, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the first entry of bucket <index> of frozen table
+// <table>.  This is the saved chain of the bucket  if the bucket is no longer
+// shared,  otherwise it is the bucket of the origin,  which is then locked
+// until _kvs_frozen_close() is called.  If <detach> is true,  then a shared
+// bucket is saved first  and  the saved chain is returned.  Returns NULL if
+// allocation failed.  The status is only passed back in <status>  if
+// allocation failed,  unless NULL was passed in for <status>.
+
+static kvs_entry *_kvs_frozen_open(kvs_table_s *table,
+                                      cardinal index,
+                                          bool detach,
+                                  kvs_status_t *status) {
+    kvs_frozen_s *frozen = table->frozen;
+    kvs_entry *bucket;
+    
+    // saved chains never change,  they are read without a lock
+    if (NOT(_kvs_frozen_is_shared(frozen, index)))
+        return &frozen->saved[index];
+    
+    bucket = &frozen->origin->bucket[index];
+    _kvs_lock_bucket(frozen->origin, bucket);
+    
+    // the origin may have saved the bucket in the meantime
+    if (_kvs_frozen_is_shared(frozen, index)) {
+        
+        if (NOT(detach))
+            return bucket;
+        
+        // exit if allocation failed
+        if (NOT(_kvs_frozen_save(frozen, index))) {
+            _kvs_unlock_bucket(frozen->origin, bucket);
+            _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+            return NULL;
         } // end if
     } // end if
     
-    return;
-} // end kvs_store_reference
+    _kvs_unlock_bucket(frozen->origin, bucket);
+    
+    return &frozen->saved[index];
+} // end _kvs_frozen_open
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_entry_exists( table, key, status )
+// private function:  _kvs_frozen_close( table, index, chain )
 // ---------------------------------------------------------------------------
 //
-// Returns  true  if a  valid entry  for <key> exists  in  KVS  table <table>,
-// returns false otherwise.  If an entry is found,  valid or invalid,  then it
-// will be cached internally  and a subsequent search request for the same key
-// will check the cached entry first, which is slighly faster than a lookup of
-// a  non-cached entry.  The  reference count  of the entry is  not  modified.
-// The  status  of the operation  is passed back in <status>,  unless NULL was
-// passed in for <status>.
-
-bool kvs_entry_exists(kvs_table_t table,
-                        kvs_key_t key, 
-                     kvs_status_t *status) {
+// Releases the lock of the origin bucket  if <chain>,  returned by
+// _kvs_frozen_open() for bucket <index> of frozen table <table>,  is the
+// bucket of the origin.
 
-    kvs_entry this_entry;
+static fmacro void _kvs_frozen_close(kvs_table_s *table,
+                                        cardinal index,
+                                       kvs_entry *chain) {
     
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return false;
-    } // end if
+    if (chain != &table->frozen->saved[index])
+        _kvs_unlock_bucket(table->frozen->origin, chain);
+    
+    return;
+} // end _kvs_frozen_close
 
-    // try to find entry for key
-    this_entry = _kvs_find_entry(table, key, status);
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_frozen_match( chain, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the entry for <key> in the chain starting with <chain>  if it is
+// neither marked for removal nor expired,  otherwise NULL.  The status of the
+// operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+static kvs_entry _kvs_frozen_match(kvs_entry chain,
+                                   kvs_key_t key,
+                                kvs_status_t *status) {
+    kvs_entry this_entry = chain;
     
-    if /* entry not found */ (this_entry == NULL) {
-        return false;
+    // check every entry in this chain for a key match
+    while ((this_entry != NULL) && (this_entry->key != key))
+        this_entry = this_entry->next;
+    
+    if /* key did not match */ (this_entry == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+        return NULL;
     }
-    else if (this_entry->marked_for_removal) {
+    else if /* pending removal */ (_kvs_is_marked(this_entry)) {
         _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
-        return false;
+        return NULL;
     }
-    else /* entry is valid */ {
-        return true;
+    else if /* expired */ ((this_entry->expires != 0) &&
+             (this_entry->expires <= kvs_current_time())) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+        return NULL;
     } // end if
     
-} // end kvs_entry_exists
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return this_entry;
+} // end _kvs_frozen_match
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_get_entry(table, copy, key, size, null_terminated, status)
+// private function:  _kvs_frozen_find( table, key, found, status )
 // ---------------------------------------------------------------------------
 //
-// Retrieves the table entry stored in <table> for <key>  either by copy or by
-// reference.  If  true  is passed in for <copy>,  then  the  function returns
-// the entry's data by-copy,  otherwise it returns the data by-reference.
-//
-// For by-copy retrieval,  if the entry exists,  a newly allocated copy of its
-// value is created,  and a pointer to it is returned as function result.  The
-// size of the entry's data (in bytes)  is passed back in <size>.  However, if
-// the size of the entry's data is unknown,  then no copy is made and  NULL is
-// returned.  The entry's reference count is never incremented when retrieving
-// by copy.
-//
-// For by-reference retrieval,  if the entry exists,  a pointer to the entry's
-// data  is returned as function result  and  the  entry's reference count  is
-// incremented.  The size of the  entry's data  (in bytes)  is  passed back in
-// <size>.  However,  if the size of the entry's data is  unknown,  then  zero
-// is passed back in <size>.
-//
-// If the entry's data is null-terminated,  then  true  will be passed back in
-// <null_terminated>,  otherwise  false  will be passed back.
-//
-// If the entry has been successfully retrieved,  then it is cached within the
-// table,  regardless of whether it was returned by copy or by reference.
-//
-// If the entry does not exist,  or,  if it has been marked for removal,  then
-// NULL  is  returned,  no  data  is copied,  no table meta data  is modified,
-// no entry meta data is modified.
-//
-// The  status  of the operation  is passed back in <status>,  unless NULL was
-// passed in for <status>.
+// Returns true if frozen table <table> holds an entry for <key>  and  copies
+// its key,  value,  size and null_terminated fields to <found>,  otherwise
+// returns false.  The status of the operation is passed back in <status>,
+// unless NULL was passed in for <status>.
 
-kvs_data_t kvs_get_entry(kvs_table_t table,
-                                bool copy,
-                           kvs_key_t key,
-                            cardinal *size,
-                                bool *null_terminated,
-                        kvs_status_t *status) {
-    /* octet_t *retrieved_value = NULL; */
-    kvs_entry this_entry;
+static bool _kvs_frozen_find(kvs_table_s *table,
+                               kvs_key_t key,
+                       kvs_frozen_item_s *found,
+                            kvs_status_t *status) {
+    kvs_entry this_entry, *chain;
+    cardinal index;
     
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return NULL;
+    index = _kvs_bucket_index(table, key, table->bucket_count);
+    chain = _kvs_frozen_open(table, index, false, status);
+    
+    this_entry = _kvs_frozen_match(*chain, key, status);
+    if (this_entry != NULL) {
+        found->key = this_entry->key;
+        found->value = this_entry->value;
+        found->size = this_entry->size;
+        found->null_terminated = this_entry->null_terminated;
     } // end if
     
-    // try to find entry for key
-    this_entry = _kvs_find_entry(table, key, status);
+    _kvs_frozen_close(table, index, chain);
     
-    if /* entry found */ (this_entry != NULL) {
-        
-        // check if entry is pending removal
-        if (this_entry->marked_for_removal) {
-        
-            // set status and return NULL
-            _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
-            return NULL;
-        }
-        else if /* by copy */ (copy == true) {
-            
-            if /* entry size unknown */ (this_entry->size == 0) {
-                
-                // set status and return NULL
-                _kvs_set_status(status, KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN);
-                return NULL;
-            }
-            else /* entry not pending removal and size known */ {
-                
-                // pass back size and null_terminated
-                if (size != NULL)
-                    *size = this_entry->size;
-                if (null_terminated != NULL)
-                    *null_terminated = this_entry->null_terminated;
-                
-                // make a copy and return it
-                return _kvs_retrieve_copy(this_entry, status);
-            } // end if
-        }
-        else /* by reference */ {
-            
-            // pass back size and null_terminated
-            if (size != NULL)
-                *size = this_entry->size;
-            if (null_terminated != NULL)
-                *null_terminated = this_entry->null_terminated;
+    return (this_entry != NULL);
+} // end _kvs_frozen_find
 
-            // increment the reference count for entry
-            this_entry->ref_count++;
-            
-            // set status and return reference
-            _kvs_set_status(status, KVS_STATUS_SUCCESS);
-            return (kvs_data_t) this_entry->value;
-        } // end if
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_frozen_get_entry( table, copy, key, size, nt, st )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry for <key> from frozen table <table>  as kvs_get_entry()
+// does.  Before an entry is returned by reference,  its bucket is saved  so
+// that the value is owned by the snapshot.  The status of the operation is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+static kvs_data_t _kvs_frozen_get_entry(kvs_table_s *table,
+                                               bool copy,
+                                          kvs_key_t key,
+                                           cardinal *size,
+                                               bool *null_terminated,
+                                       kvs_status_t *status) {
+    kvs_data_t result = NULL;
+    kvs_entry this_entry, *chain;
+    cardinal index;
+    
+    index = _kvs_bucket_index(table, key, table->bucket_count);
+    chain = _kvs_frozen_open(table, index, NOT(copy), status);
+    
+    // exit if the bucket could not be saved
+    if (chain == NULL)
+        return NULL;
+    
+    this_entry = _kvs_frozen_match(*chain, key, status);
+    
+    if /* entry not found */ (this_entry == NULL) {
+        result = NULL;
     }
-    else /* entry not found */ {
+    else if /* by copy of unknown size */
+            ((copy == true) && (this_entry->size == 0)) {
+        _kvs_set_status(status, KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN);
+    }
+    else {
         
-        // set status and return NULL
-        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
-        return NULL;
+        // pass back size and null_terminated
+        if (size != NULL)
+            *size = this_entry->size;
+        if (null_terminated != NULL)
+            *null_terminated = this_entry->null_terminated;
+        
+        if (copy == true)
+            result = _kvs_retrieve_copy(this_entry, status);
+        else
+            result = (kvs_data_t) this_entry->value;
     } // end if
-
-} // end kvs_get_entry
+    
+    _kvs_frozen_close(table, index, chain);
+    
+    return result;
+} // end _kvs_frozen_get_entry
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_value_for_key( table, key, status )
+// private function:  _kvs_foreach_frozen( range )
 // ---------------------------------------------------------------------------
 //
-// Retrieves the entry stored in table <table> for <key> and returns a pointer
-// to a  newly  allocated  copy  of the  entry's value.  The entry's reference
-// count is NOT incremented.  Entries that have been stored  by reference  and
-// are not null-terminated can  only  be retrieved by value if their data size
-// was  explicitly  passed in  when  they  were  stored.  If  no entry  exists
-// for <key>  or if the entry is pending removal  or  if the size of the entry
-// is unknown,  then  NULL  is  returned.  The  status  of  the  operation  is
-// passed  back in <status>,  unless  NULL  was passed in for <status>.
+// Calls the action of <range>  for every entry in its range of buckets  of
+// a frozen table  that is neither marked for removal nor expired,  and passes
+// back the number of entries visited in the count field of <range>.  Actions
+// are not called under the lock of a shared bucket,  up to
+// KVS_FROZEN_BATCH_SIZE entries are copied from it under the lock,  longer
+// chains are saved.  Actions must not modify the origin of the table.
 
-kvs_data_t kvs_value_for_key(kvs_table_t table,
-                               kvs_key_t key,
-                            kvs_status_t *status) {
-    kvs_entry this_entry;
+static void _kvs_foreach_frozen(kvs_foreach_s *range) {
+    kvs_table_s *table = range->table;
+    kvs_table_s *origin = table->frozen->origin;
+    kvs_frozen_item_s batch[KVS_FROZEN_BATCH_SIZE];
+    kvs_entry this_entry, *chain;
+    cardinal index, item, count;
+    kvs_epoch_t epoch = 0;
+    kvs_time_t now;
     
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return NULL;
-    } // end if
+    // values unlinked from the origin are kept while they may be visited
+    if (origin != NULL)
+        epoch = _kvs_read_begin(origin);
     
-    // try to find entry for key
-    this_entry = _kvs_find_entry(table, key, status);
+    now = kvs_current_time();
     
-    if /* entry found */ (this_entry != NULL) {
+    for (index = range->first; index < range->last; index++) {
         
-        if /* pending removal */ (this_entry->marked_for_removal) {
+        chain = _kvs_frozen_open(table, index, false, NULL);
+        this_entry = *chain;
+        count = 0;
+        
+        if /* shared */ (chain != &table->frozen->saved[index]) {
             
-            // set status and return NULL
-            _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
-            return NULL;
-        }
-        else if /* entry's size is unknown */ (this_entry->size == 0) {
+            // copy the entries of the bucket visited
+            while ((this_entry != NULL) && (count < KVS_FROZEN_BATCH_SIZE)) {
+                if ((NOT(_kvs_is_marked(this_entry))) &&
+                    ((this_entry->expires == 0) ||
+                     (this_entry->expires > now))) {
+                    batch[count].key = this_entry->key;
+                    batch[count].value = this_entry->value;
+                    batch[count].size = this_entry->size;
+                    batch[count].null_terminated =
+                        this_entry->null_terminated;
+                    batch[count].expires = this_entry->expires;
+                    count++;
+                } // end if
+                this_entry = this_entry->next;
+            } // end while
             
-            // set status and return NULL
-            _kvs_set_status(status, KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN);
-            return NULL;
-        }
-        else /* entry not pending removal and size known */ {
+            // save a longer chain,  or visit the rest under the lock
+            if ((this_entry != NULL) &&
+                (_kvs_frozen_save(table->frozen, index))) {
+                count = 0;
+                this_entry = table->frozen->saved[index];
+            }
+            else {
+                while (this_entry != NULL) {
+                    if ((NOT(_kvs_is_marked(this_entry))) &&
+                        ((this_entry->expires == 0) ||
+                         (this_entry->expires > now))) {
+                        range->expires = this_entry->expires;
+                        range->action(this_entry->key, this_entry->value,
+                                      this_entry->size,
+                                      this_entry->null_terminated,
+                                      range->context);
+                        range->count++;
+                    } // end if
+                    this_entry = this_entry->next;
+                } // end while
+            } // end if
             
-            // make a copy and return it
-            return _kvs_retrieve_copy(this_entry, status);
+            _kvs_frozen_close(table, index, chain);
         } // end if
-    }
-    else /* entry not found */ {
         
-        // set status and return NULL
-        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
-        return NULL;
+        // visit the entries copied from a shared bucket
+        for (item = 0; item < count; item++) {
+            range->expires = batch[item].expires;
+            range->action(batch[item].key, batch[item].value,
+                          batch[item].size, batch[item].null_terminated,
+                          range->context);
+        } // end for
+        range->count = range->count + count;
+        
+        // visit the entries of a saved chain
+        while (this_entry != NULL) {
+            if ((this_entry->expires == 0) || (this_entry->expires > now)) {
+                range->expires = this_entry->expires;
+                range->action(this_entry->key, this_entry->value,
+                              this_entry->size, this_entry->null_terminated,
+                              range->context);
+                range->count++;
+            } // end if
+            this_entry = this_entry->next;
+        } // end while
+    } // end for
+    
+    if (origin != NULL)
+        _kvs_read_end(origin, epoch);
+    
+    return;
+} // end _kvs_foreach_frozen
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_frozen_dispose( table )
+// ---------------------------------------------------------------------------
+//
+// Unlinks frozen table <table> from its origin  and disposes of its saved
+// chains and frozen state,  but not of the table base.
+
+static void _kvs_frozen_dispose(kvs_table_s *table) {
+    kvs_frozen_s *frozen = table->frozen, **link;
+    kvs_entry this_entry, next_entry;
+    cardinal index;
+    
+    // unlink the snapshot from its origin while no bucket can change
+    if (frozen->origin != NULL) {
+        _kvs_lock_all(frozen->origin);
+        link = &frozen->origin->frozen;
+        while (*link != frozen)
+            link = &(*link)->next;
+        *link = frozen->next;
+        _kvs_unlock_all(frozen->origin);
     } // end if
     
-} // end kvs_value_for_key
+    // dispose of the saved chains
+    for (index = 0; index < table->bucket_count; index++) {
+        this_entry = frozen->saved[index];
+        while (this_entry != NULL) {
+            next_entry = this_entry->next;
+            _kvs_dispose_entry(table, this_entry, NULL);
+            this_entry = next_entry;
+        } // end while
+    } // end for
+    
+    DEALLOCATE(frozen->shared);
+    DEALLOCATE(frozen->saved);
+    DEALLOCATE(frozen);
+    
+    return;
+} // end _kvs_frozen_dispose
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_reference_for_key( table, key, status )
+// private function:  _kvs_stats_walk( table, stats )
 // ---------------------------------------------------------------------------
 //
-// Retrieves the entry stored in table <table> for <key> and returns a pointer
-// to the  entry's value  in the table  and  increments the  entry's reference
-// count.  If  no entry exists  for <key>  or if the entry is pending removal,
-// then  NULL  is returned.  The  status  of  the  operation  is  passed  back
-// in <status>,  unless  NULL  was passed in for <status>.
+// Adds the chain lengths,  entries and bytes of all buckets of chained or open
+// addressing table <table>,  of its graveyard  and  of its value store  to
+// <stats>.  Entries in the graveyard are not part of any chain.
 
-kvs_data_t kvs_reference_for_key(kvs_table_t table,
-                                   kvs_key_t key,
-                                kvs_status_t *status) {
+static void _kvs_stats_walk(kvs_table_s *table, kvs_stats_t *stats) {
     kvs_entry this_entry;
+    kvs_shared this_value;
+    cardinal index, length, bucket_count;
+    kvs_epoch_t epoch;
     
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return NULL;
-    } // end if
+    epoch = _kvs_read_begin(table);
     
-    // try to find entry for key
-    this_entry = _kvs_find_entry(table, key, status);
+    bucket_count = _kvs_foreach_bucket_count(table);
     
-    if /* entry found */ (this_entry != NULL) {
+    for (index = 0; index < bucket_count; index++) {
+        length = 0;
+        this_entry = _kvs_foreach_head(table, index);
         
-        if /* pending removal */ (this_entry->marked_for_removal) {
-            
-            // set status and return NULL
-            _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
-            return NULL;
-        }
-        else /* not pending removal */ {
+        while (this_entry != NULL) {
+            _kvs_stats_entry(stats, this_entry);
+            length++;
             
-            // increment the reference count
-            this_entry->ref_count++;
-                        
-            // set status and return reference
-            _kvs_set_status(status, KVS_STATUS_SUCCESS);
-            return (kvs_data_t) this_entry->value;
-        } // end if
-    }
-    else /* entry not found */ {
+            // open addressing slots hold a single entry
+            if (table->flags & KVS_FLAG_OPEN_ADDRESSING)
+                this_entry = NULL;
+            else if (table->flags & KVS_FLAG_CONCURRENT)
+                this_entry =
+                    __atomic_load_n(&this_entry->next, __ATOMIC_ACQUIRE);
+            else
+                this_entry = this_entry->next;
+        } // end while
         
-        // set status and return NULL
-        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
-        return NULL;
+        _kvs_stats_chain(stats, length);
+    } // end for
+    
+    // entries moved to the graveyard
+    if (table->grave != NULL) {
+        for (index = 0; index <= table->grave_mask; index++) {
+            this_entry = table->grave[index];
+            while (this_entry != NULL) {
+                _kvs_stats_entry(stats, this_entry);
+                this_entry = this_entry->next;
+            } // end while
+        } // end for
     } // end if
     
-} // end kvs_reference_for_key
+    // values shared by content are counted once
+    if (table->values != NULL) {
+        for (index = 0; index < table->values->bucket_count; index++) {
+            this_value = table->values->bucket[index];
+            while (this_value != NULL) {
+                stats->value_bytes +=
+                    sizeof(kvs_shared_s) + this_value->size;
+                this_value = this_value->next;
+            } // end while
+        } // end for
+    } // end if
+    
+    _kvs_read_end(table, epoch);
+    
+    return;
+} // end _kvs_stats_walk
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_size_for_key( table, key, status )
+// private function:  _kvs_stats_walk_compact( table, stats )
 // ---------------------------------------------------------------------------
 //
-// Returns  the size of the data of the entry stored in <table> for <key>.  If
-// no entry exists for <key>,  then  zero  is  returned.  The  status  of  the
-// operation  is  passed  back  in  <status>,  unless   NULL   was  passed  in
-// for <status>.
+// Adds the chain lengths,  records and bytes of all buckets of compact table
+// <table> to <stats>.
 
-cardinal kvs_size_for_key(kvs_table_t table,
-                          kvs_key_t key,
-                          kvs_status_t *status) {
-    kvs_entry this_entry;
-    
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return 0;
-    } // end if
+static void _kvs_stats_walk_compact(kvs_table_s *table, kvs_stats_t *stats) {
+    kvs_compact_s *compact = table->compact;
+    kvs_compact_entry_s *record;
+    cardinal index, length;
+    uint32_t next;
     
-    this_entry = _kvs_find_entry(table, key, status);
+    for (index = 0; index < table->bucket_count; index++) {
+        length = 0;
+        next = compact->bucket[index];
+        
+        while (next != 0) {
+            record = _kvs_compact_record(compact, next);
+            
+            stats->entry_count++;
+            stats->entry_bytes += sizeof(kvs_compact_entry_s);
+            if (record->state & KVS_COMPACT_MARKED)
+                stats->marked_count++;
+            if (record->state & KVS_COMPACT_COPY)
+                stats->value_bytes += record->size;
+            
+            length++;
+            next = record->next;
+        } // end while
+        
+        _kvs_stats_chain(stats, length);
+    } // end for
     
-    if /* entry found */ (this_entry != NULL)
-        return this_entry->size;
-    else /* entry not found */
-        return 0;
-} // end kvs_size_for_key
+    return;
+} // end _kvs_stats_walk_compact
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_data_for_key_is_null_terminated( table, key, status )
+// private function:  _kvs_stats_walk_snapshot( table, stats )
 // ---------------------------------------------------------------------------
 //
-// Returns the  null-terminated flag of the entry stored in <table> for <key>.
-// If no entry exists for <key>,  then  false  is returned.  The status of the
-// operation  is  passed  back  in  <status>,  unless   NULL   was  passed  in
-// for <status>.
+// Adds the chain lengths,  records and value bytes of all buckets of snapshot
+// table <table> to <stats>.  Buckets with an invalid record range are counted
+// as empty.
 
-bool kvs_data_for_key_is_null_terminated(kvs_table_t table,
-                                           kvs_key_t key,
-                                        kvs_status_t *status) {
-    kvs_entry this_entry;
+static void _kvs_stats_walk_snapshot(kvs_table_s *table, kvs_stats_t *stats) {
+    const kvs_snapshot_header_s *header;
+    const kvs_snapshot_record_s *record;
+    const uint32_t *start;
+    cardinal index, first, last;
     
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return false;
-    } // end if
+    header = (const kvs_snapshot_header_s *) table->snapshot;
+    start = (const uint32_t *) (table->snapshot + header->start_offset);
+    record = (const kvs_snapshot_record_s *)
+        (table->snapshot + header->record_offset);
     
-    this_entry = _kvs_find_entry(table, key, status);
+    for (index = 0; index < table->bucket_count; index++) {
+        first = start[index];
+        last = start[index + 1];
+        
+        if ((first > last) || (last > table->entry_count))
+            last = first;
+        
+        _kvs_stats_chain(stats, last - first);
+    } // end for
     
-    if /* entry found */ (this_entry != NULL)
-        return this_entry->null_terminated;
-    else /* entry not found */
-        return false;
-} // end kvs_data_for_key_is_null_terminated
+    for (index = 0; index < table->entry_count; index++) {
+        stats->value_bytes += record[index].size;
+    } // end for
+    
+    stats->entry_count = table->entry_count;
+    stats->entry_bytes = sizeof(kvs_snapshot_record_s) * table->entry_count;
+    
+    return;
+} // end _kvs_stats_walk_snapshot
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_reference_count_for_key( table, key, status )
+// private function:  _kvs_stats_entry( stats, entry )
 // ---------------------------------------------------------------------------
 //
-// Returns the  reference count  of the entry stored in <table> for <key>.  If
-// no entry exists for <key>,  then  zero  is returned.  Valid entries  always
-// have a  reference count  greater than zero.  The status of the operation is
-// passed back in <status>,  unless  NULL  was passed in for <status>.
+// Adds <entry>  and the bytes of its value,  unless stored by reference or
+// shared by content,  to <stats>.
 
-cardinal kvs_reference_count_for_key(kvs_table_t table,
-                                       kvs_key_t key,
-                                    kvs_status_t *status) {
-    kvs_entry this_entry;
+static void _kvs_stats_entry(kvs_stats_t *stats, kvs_entry entry) {
+    kvs_chunk this_chunk;
     
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return 0;
-    } // end if
+    stats->entry_count++;
+    stats->entry_bytes += sizeof(kvs_entry_s);
     
-    this_entry = _kvs_find_entry(table, key, status);
+    if (_kvs_is_marked(entry))
+        stats->marked_count++;
     
-    if /* entry found */ (this_entry != NULL)
-        return this_entry->ref_count;
-    else /* entry not found */
-        return 0;
-} // end kvs_reference_count_for_key
+    if /* chunked */ (entry->storage == KVS_STORAGE_CHUNKED) {
+        this_chunk = (kvs_chunk) entry->value;
+        while (this_chunk != NULL) {
+            stats->value_bytes += sizeof(kvs_chunk_s) + this_chunk->size;
+            this_chunk = this_chunk->next;
+        } // end while
+    }
+    else if /* owned by the entry */ ((entry->storage == KVS_STORAGE_COPY) ||
+             (entry->storage == KVS_STORAGE_INLINE) ||
+             (entry->storage == KVS_STORAGE_ARENA)) {
+        stats->value_bytes += entry->size;
+    } // end if
+    
+    return;
+} // end _kvs_stats_entry
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_release_entry( table, key, status )
+// private function:  _kvs_stats_chain( stats, length )
 // ---------------------------------------------------------------------------
 //
-// Decrements the reference count of entry stored in <table> for <key> by one.
-// If the entry has previously been marked for removal and its reference count
-// reaches one  as a result of this release,  then  the entry will be removed.
-// The status of the operation  is passed back in <status>,  unless  NULL  was
-// passed in for <status>.
+// Adds a bucket holding <length> entries to the histogram of <stats>.
 
-void kvs_release_entry(kvs_table_t table,
-                         kvs_key_t key,
-                      kvs_status_t *status) {
-    kvs_entry this_entry;
-    
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return;
-    } // end if
+static fmacro void _kvs_stats_chain(kvs_stats_t *stats, cardinal length) {
     
-    this_entry = _kvs_find_entry(table, key, status);
-        
-    if (this_entry != NULL) {
-        if (this_entry->ref_count > 1) {
-            this_entry->ref_count--;
-            
-            if ((this_entry->ref_count == 1) &&
-                (this_entry->marked_for_removal)) {
-                
-                kvs_remove_entry(table, key, status);
-                
-            } // end if
-        } // end if
-    } // end if
+    stats->bucket_count++;
+    stats->chain_length[MIN(length, KVS_STATS_CHAIN_LENGTHS - 1)]++;
+    stats->longest_chain = MAX(stats->longest_chain, length);
     
     return;
-} // end kvs_release_entry
+} // end _kvs_stats_chain
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_remove_entry(table, key, status)
+// private function:  _kvs_log_checksum( record, deadline, value, size )
 // ---------------------------------------------------------------------------
 //
-// Marks the entry stored in <table> for <key> as removed.  An entry which has
-// been marked as removed can no longer be retrieved  and will be removed when
-// its  reference count  reaches  zero.  The status of the operation is passed
-// back in <status>,  unless  NULL  was passed in for <status>.
+// Returns the 32-bit FNV-1a hash of the header fields of <record>  following
+// its checksum field,  of the deadline at <deadline>  unless NULL was passed
+// in for <deadline>,  and of the <size> bytes at <value>.
 
-void kvs_remove_entry(kvs_table_t table,
-                        kvs_key_t key,
-                     kvs_status_t *status) {
+static uint32_t _kvs_log_checksum(const kvs_log_record_s *record,
+                                           const uint64_t *deadline,
+                                               const void *value,
+                                                 cardinal size) {
+    const octet_t *octet;
+    uint32_t hash = 2166136261u;
     cardinal index;
-    kvs_entry prev_entry, this_entry;
-    kvs_table_s *this_table = (kvs_table_s *) table;
     
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return;
-    } // end if
+    octet = (const octet_t *) record;
+    for (index = sizeof(uint32_t); index < sizeof(kvs_log_record_s); index++) {
+        hash = (hash ^ octet[index]) * 16777619u;
+    } // end for
     
-    // key must not be zero
-    if (key == 0) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
-        return;
+    // the deadline of an expiring store precedes its value
+    if (deadline != NULL) {
+        octet = (const octet_t *) deadline;
+        for (index = 0; index < sizeof(uint64_t); index++) {
+            hash = (hash ^ octet[index]) * 16777619u;
+        } // end for
     } // end if
     
-    // calculate the bucket index for key
-    index = key % this_table->bucket_count;
-
-    if /* bucket is empty */ (this_table->bucket[index] == NULL) {
+    octet = (const octet_t *) value;
+    for (index = 0; index < size; index++) {
+        hash = (hash ^ octet[index]) * 16777619u;
+    } // end for
     
-        // entry not found
-        
-        // set status
-        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND); 
-    }
-    else /* bucket not empty */ {
-        
-        // starting point
-        this_entry = this_table->bucket[index];
-        prev_entry = this_entry;
-        
-        // move to next entry until key matches or last entry is reached
-        while ((this_entry->key != key) && (this_entry->next != NULL)) {
-            prev_entry = this_entry;
-            this_entry = this_entry->next;
-        } // end while
-
-        if /* key matched */ (this_entry->key == key) {
-            
-            // only remove if reference count is 1 (or less, just in case)
-            if (this_entry->ref_count <= 1) {
-                
-                // if chached, remove the entry from the cache
-                if (this_table->last_retrieved_entry == this_entry)
-                    this_table->last_retrieved_entry = NULL;
-                
-                // remove the entry from the bucket
-                if /* first entry */ (this_table->bucket[index] == this_entry) {
-                    // link bucket root to successor
-                    this_table->bucket[index] = this_entry->next;
-                }
-                else /* not first entry */ {
-                    // link predecessor to successor
-                    prev_entry->next = this_entry->next;
-                } // end if
-            
-                // deallocate the entry
-                _kvs_dispose_entry(this_entry, status);
-                        
-                // update the entry counter
-                this_table->entry_count--;
-            }
-            else /* reference count > 1 */ {
-            
-                // don't remove the entry yet, mark it for removal
-                this_entry->marked_for_removal = true;
-                
-                // set status
-                _kvs_set_status(status, KVS_STATUS_SUCCESS);
-                
-            } // end if
-        }
-        else /* key did not match any key in the bucket */ {
-            
-            // entry not found
-            
-            // set status
-            _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND); 
-
-        } // end if
-    } // end if
+    return hash;
+} // end _kvs_log_checksum
 
-    return;
-} // end kvs_remove_entry
 
+#if KVS_USE_LOG
 
 // ---------------------------------------------------------------------------
-// function:  kvs_number_of_buckets( table )
+// private function:  _kvs_log_open( path, window, status )
 // ---------------------------------------------------------------------------
 //
-// Returns  the number of buckets  of KVS table <table>,  returns zero if NULL
-// is passed in for <table>.
-
-cardinal kvs_number_of_buckets(kvs_table_t table) {
-    kvs_table_s *this_table = (kvs_table_s *) table;
+// Opens or creates the log file at <path> for appending  and returns a new log
+// with a commit window of <window> microseconds.  A flusher thread is started
+// for a non-zero window.  Returns NULL if the file could not be opened or
+// allocation failed.  The status of the operation is passed back in <status>.
 
-    if (table != NULL) return this_table->bucket_count;
-    else return 0;
+static kvs_log_s *_kvs_log_open(const char *path,
+                                  cardinal window,
+                              kvs_status_t *status) {
+    kvs_log_s *new_log;
+    int fd;
     
-} // end kvs_number_of_buckets
+    fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    
+    if (fd < 0) {
+        *status = KVS_STATUS_FILE_ERROR;
+        return NULL;
+    } // end if
+    
+    new_log = ALLOCATE(sizeof(kvs_log_s));
+    
+    if (new_log != NULL) {
+        new_log->buffer = ALLOCATE(KVS_LOG_BUFFER_SIZE);
+        
+        if (new_log->buffer == NULL) {
+            DEALLOCATE(new_log);
+            new_log = NULL;
+        } // end if
+    } // end if
+    
+    if (new_log == NULL) {
+        close(fd);
+        *status = KVS_STATUS_ALLOCATION_FAILED;
+        return NULL;
+    } // end if
+    
+    new_log->fd = fd;
+    new_log->fill = 0;
+    new_log->window = window;
+    new_log->last_sync = _kvs_log_now();
+    new_log->dirty = false;
+    new_log->failed = false;
+    new_log->stop = false;
+    new_log->has_flusher = false;
+    
+#if KVS_USE_THREADS
+    pthread_mutex_init(&new_log->lock, NULL);
+    pthread_cond_init(&new_log->wake, NULL);
+    
+    // without a flusher thread,  appends sync once the window has elapsed
+    if (window > 0)
+        new_log->has_flusher = (pthread_create(&new_log->flusher, NULL,
+                                               _kvs_log_flusher,
+                                               new_log) == 0);
+#endif
+    
+    *status = KVS_STATUS_SUCCESS;
+    return new_log;
+} // end _kvs_log_open
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_number_of_entries( table )
+// private function:  _kvs_log_close( log )
 // ---------------------------------------------------------------------------
 //
-// Returns  the number of entries  stored in KVS table <table>,  returns  zero
-// if NULL is passed in for <table>.
-
-cardinal kvs_number_of_entries(kvs_table_t table) {
-    kvs_table_s *this_table = (kvs_table_s *) table;
+// Stops the flusher thread of <log>,  syncs and closes the log file  and
+// deallocates <log>.  Returns true if all records have been synced,  false if
+// any write or sync of the log has failed.
 
-    if (table != NULL) return this_table->entry_count;
-    else return 0;        
+static bool _kvs_log_close(kvs_log_s *log) {
+    bool success;
     
-} // end kvs_number_of_entries
+#if KVS_USE_THREADS
+    if (log->has_flusher) {
+        pthread_mutex_lock(&log->lock);
+        log->stop = true;
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+        pthread_join(log->flusher, NULL);
+    } // end if
+#endif
+    
+    success = NOT(log->failed) && _kvs_log_sync(log);
+    
+    if (close(log->fd) != 0)
+        success = false;
+    
+#if KVS_USE_THREADS
+    pthread_cond_destroy(&log->wake);
+    pthread_mutex_destroy(&log->lock);
+#endif
+    
+    DEALLOCATE(log->buffer);
+    DEALLOCATE(log);
+    
+    return success;
+} // end _kvs_log_close
 
 
 // ---------------------------------------------------------------------------
-// function:  kvs_dispose_table( table, status )
+// private function:  _kvs_log_append( log, type, key, value, size, nt, exp )
 // ---------------------------------------------------------------------------
 //
-// Disposes of  KVS table object <table>,  deallocating  all its entries.  The
-// table and its entries are disposed of  regardless of any references held to
-// any values stored in the table.  The status of the operation is passed back
-// in <status>,  unless  NULL  was passed in for <status>.
-
-void kvs_dispose_table(kvs_table_t table, kvs_status_t *status) {
-    cardinal index;
-    kvs_entry prev_entry, this_entry;
-    kvs_table_s *this_table = (kvs_table_s *) table;
+// Appends a record of <type> for <key>  with <size> bytes of <value>  to the
+// buffer of <log>,  writing out the buffer first if the record does not fit.
+// A store whose monotonic deadline <expires> is not zero is appended as an
+// expiring store,  its deadline converted to the real time clock.  Records
+// larger than the buffer are written directly.  The log is synced if its
+// commit window is zero,  or without a flusher thread,  if the window has
+// elapsed since the last sync.  Returns false if a write or sync has failed,
+// the log then accepts no further records.
 
-    // table must not be NULL
-    if (table == NULL) {
-        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
-        return;
+static bool _kvs_log_append(kvs_log_s *log,
+                              octet_t type,
+                            kvs_key_t key,
+                           const void *value,
+                             cardinal size,
+                                 bool null_terminated,
+                           kvs_time_t expires) {
+    kvs_log_record_s record;
+    uint64_t deadline = 0;
+    cardinal prefix = 0;
+    bool success;
+    
+    // clear reserved fields  and the padding before a 64 bit key
+    memset(&record, 0, sizeof(kvs_log_record_s));
+    
+    // an expiring store carries its deadline ahead of the value
+    if (expires != 0) {
+        deadline = _kvs_wall_deadline(expires);
+        prefix = sizeof(uint64_t);
+        type = KVS_LOG_RECORD_STORE_EXPIRING;
     } // end if
     
-    if (this_table->entry_count != 0) {
-        
-        for (index = 0; index < this_table->entry_count; index++) {
-        
-            this_entry = this_table->bucket[index];
-            
-            while (this_entry != NULL) {
-                prev_entry = this_entry;
-                this_entry = this_entry->next;
-                _kvs_dispose_entry(prev_entry, NULL);
-            } // end while
-            
-            this_table->bucket[index] = NULL;
-            
-        } // end for
+    record.key = key;
+    record.size = prefix + size;
+    record.type = type;
+    record.null_terminated = (null_terminated) ? 1 : 0;
+    record.checksum = _kvs_log_checksum(&record,
+        (prefix > 0) ? &deadline : NULL, value, size);
+    
+#if KVS_USE_THREADS
+    pthread_mutex_lock(&log->lock);
+#endif
+    
+    success = NOT(log->failed);
+    
+    // write out the buffer if the record does not fit
+    if ((success) && (log->fill + sizeof(kvs_log_record_s) + record.size >
+                      KVS_LOG_BUFFER_SIZE)) {
+        success = _kvs_log_write(log, log->buffer, log->fill);
+        log->fill = 0;
+    } // end if
+    
+    if /* record fits into the buffer */
+       ((success) &&
+        (sizeof(kvs_log_record_s) + record.size <= KVS_LOG_BUFFER_SIZE)) {
+        memcpy(log->buffer + log->fill, &record, sizeof(kvs_log_record_s));
+        log->fill = log->fill + sizeof(kvs_log_record_s);
+        if (prefix > 0)
+            memcpy(log->buffer + log->fill, &deadline, prefix);
+        log->fill = log->fill + prefix;
+        if (size > 0)
+            memcpy(log->buffer + log->fill, value, size);
+        log->fill = log->fill + size;
+    }
+    else if /* record is larger than the buffer */ (success) {
+        success = _kvs_log_write(log, &record, sizeof(kvs_log_record_s)) &&
+                  _kvs_log_write(log, &deadline, prefix) &&
+                  _kvs_log_write(log, value, size);
+    } // end if
+    
+    if (success) {
+        log->dirty = true;
         
+        // sync now unless the flusher thread will
+        if ((log->window == 0) ||
+            (NOT(log->has_flusher) &&
+             (_kvs_log_now() - log->last_sync >= log->window)))
+            success = _kvs_log_sync(log);
     } // end if
     
-    // dispose table base
-    DEALLOCATE(this_table);
+    if (NOT(success))
+        log->failed = true;
     
-    // set status
-    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+#if KVS_USE_THREADS
+    pthread_mutex_unlock(&log->lock);
+#endif
     
-    return;
-} // end kvs_dispose_table
-
-
-// ===========================================================================
-// P R I V A T E   F U N C T I O N   I M P L E M E N T A T I O N S
-// ===========================================================================
+    return success;
+} // end _kvs_log_append
 
 
 // ---------------------------------------------------------------------------
-// private function:  _kvs_find_entry( table, key, status )
+// private function:  _kvs_log_commit( log )
 // ---------------------------------------------------------------------------
 //
-// If an entry for <key> exists in <table> then the function returns a pointer
-// to the entry,  otherwise  it returns NULL.  If the entry is found,  then it
-// will be cached within the table,  and a subsequent request to find the same
-// same entry  will then return the  cached entry pointer,  which is  slightly
-// faster than a lookup of a  non-cached  entry.  The  reference count  of the
-// entry is  not  incremented by this function.  The  status  of the operation
-// is passed back in <status>,  unless NULL was passed in for <status>.
+// Writes out the buffer of <log>  and syncs the log file.  Returns false if a
+// write or sync of the log has failed.
 
-static kvs_entry _kvs_find_entry(kvs_table_t table,
-                                   kvs_key_t key,
-                                kvs_status_t *status) {
-    cardinal index;
-    kvs_entry this_entry;
-    kvs_table_s *this_table = (kvs_table_s *) table;
+static bool _kvs_log_commit(kvs_log_s *log) {
+    bool success;
     
-    // check if the entry has been cached
-    if ((this_table->last_retrieved_entry != NULL) &&
-        (key == this_table->last_retrieved_entry->key)) {
-        
-        // entry has been cached by previous lookup
-        
-        // set status
-        _kvs_set_status(status, KVS_STATUS_SUCCESS);
-        
-        // return pointer to the cached entry
-        return this_table->last_retrieved_entry;
-    } // end if
+#if KVS_USE_THREADS
+    pthread_mutex_lock(&log->lock);
+#endif
     
-    // calculate the bucket index for key
-    index = key % this_table->bucket_count;
-
-    if /* bucket is empty */ (this_table->bucket[index] == NULL) {
-        
-        // set status
-        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
-        
-        // return null, indicating entry not found
-        return NULL;
-    }
-    else /* bucket not empty */ {
+    success = NOT(log->failed) && _kvs_log_sync(log);
     
-        // first entry in this bucket is starting point
-        this_entry = this_table->bucket[index];
-        
-        // check every entry in this bucket for a key match
-        while ((this_entry->key != key) && (this_entry->next != NULL))
-            this_entry = this_entry->next;
-
-        // the entry is found if there was a key match
-
-        if /* key matched */ (this_entry->key == key) {
-            
-            // cache the entry for faster subsequent lookup
-            this_table->last_retrieved_entry = this_entry;
-            
-            // set status
-            _kvs_set_status(status, KVS_STATUS_SUCCESS);
-            
-            // return pointer to entry found
-            return this_entry;
-        }
-        else /* key did not match */ {
-            
-            // entry not found
-            
-            // set status
-            _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
-            
-            // return null, indicating entry not found
-            return NULL;
-        } // end if
-    } // end if
-} // end _kvs_find_entry
+    if (NOT(success))
+        log->failed = true;
+    
+#if KVS_USE_THREADS
+    pthread_mutex_unlock(&log->lock);
+#endif
+    
+    return success;
+} // end _kvs_log_commit
 
 
 // ---------------------------------------------------------------------------
-// private function:  _kvs_calc_null_terminated_data_size( data )
+// private function:  _kvs_log_truncate( path, length )
 // ---------------------------------------------------------------------------
 //
-// Returns the size of null-terminated data <data>.
+// Truncates the log file at <path> to <length> bytes.  Returns true if the
+// file has been truncated,  otherwise false.
 
-static fmacro cardinal _kvs_calc_null_terminated_data_size(kvs_data_t data) {
-    octet_t *_data = (octet_t *) &data;
-    cardinal index = 0;
+static bool _kvs_log_truncate(const char *path, uint64_t length) {
     
-    while (_data[index] != 0) {
-        if (index < KVS_MAX_STRING_SIZE)
-            index++;
-        else
-            return 0;
-    } // end while
+    return (truncate(path, (off_t) length) == 0);
     
-    return index;
-} // end _kvs_calc_null_terminated_data_size
+} // end _kvs_log_truncate
 
 
 // ---------------------------------------------------------------------------
-// private function:  _kvs_new_entry_with_copy( key, value, size, nt, status )
+// private function:  _kvs_log_write( log, data, size )
 // ---------------------------------------------------------------------------
 //
-// Allocates and returns a new table entry initalised with a copy of the data
-// at address <value>.  The  status  of  the  operation  is  passed  back  in
-// <status>,  unless  NULL  was passed in for <status>.
-//
-// pre-conditions:
-//
-//  This function DOES NOT CHECK pre-conditions.  The caller MUST ENFORCE pre-
-//  conditions before calling this function:
-// 
-//  o  key must never be 0
-//  o  size must never be 0
-//  o  value must never be NULL
-//
-// post-conditions:
-//
-//  o  a new entry has been allocated
-//  o  additional space for <size> bytes has been allocated
-//  o  entry's key field contains key
-//  o  entry's value field contains pointer to newly allocated copy of
-//     <size> number of bytes starting at address <value>
-//  o  entry's size field contains size
-//  o  entry's null_terminated flas contains null_terminated
-//  o  entry's pending_removal flag contains false
-//  o  entry's next field contains NULL
-//  o  KVS_STATUS_SUCCESS is passed back in <status>
-//  o  pointer to entry is returned
-//
-// error-conditions:
-//
-//  if memory allocation fails:
-//  o  any partial allocation is rolled back
-//  o  KVS_STATUS_ALLOCATION_FAILED is passed back in <status>
-//  o  NULL is returned
-
-static fmacro kvs_entry _kvs_new_entry_with_copy(kvs_key_t key,
-                                                kvs_data_t value,
-                                                  cardinal size,
-                                                 bool null_terminated,
-                                              kvs_status_t *status) {
-    kvs_entry_s *new_entry;
-    octet_t *source, *target;
-    cardinal index;
+// Writes <size> bytes at <data> to the file of <log>,  resuming interrupted
+// and partial writes.  Returns true if all bytes have been written.
 
-    // allocate storage for new entry
-    new_entry = ALLOCATE(sizeof(kvs_entry_s));
-    
-    // exit if allocation failed
-    if (new_entry == NULL) {
-        
-        // set status and return NULL
-        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
-        return NULL;
-    } // end if
+static fmacro bool _kvs_log_write(kvs_log_s *log,
+                                 const void *data,
+                                     size_t size) {
+    const octet_t *next = (const octet_t *) data;
+    ssize_t written;
     
-    // store key
-    new_entry->key = key;
-
-    // initialise meta data
-    new_entry->size = size;
-    new_entry->next = NULL;
-    new_entry->ref_count = 1;
-    new_entry->null_terminated = null_terminated;
-    new_entry->marked_for_removal = false;
-            
-    // allocate storage for a copy of the data
-    new_entry->value = ALLOCATE(size);
-        
-    // exit if allocation failed
-    if (new_entry->value == NULL) {
+    while (size > 0) {
+        written = write(log->fd, next, size);
         
-        // undo allocation for entry
-        DEALLOCATE(new_entry);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        } // end if
         
-        // set status and return NULL
-        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
-        return NULL;
-    } // end if
+        next = next + written;
+        size = size - (size_t) written;
+    } // end while
     
-    // copy data
-    index = 0;
-    source = value;
-    target = new_entry->value;
-    while (index <= size) {
-        target[index] = source[index];
-        index++;
-    } // end for
-        
-    // set status and return
-    _kvs_set_status(status, KVS_STATUS_SUCCESS);
-    return new_entry;
-} // end _kvs_new_entry_with_copy
+    return true;
+} // end _kvs_log_write
 
 
 // ---------------------------------------------------------------------------
-// private function:  _kvs_new_entry_with_ref( key, value, size, nt, status )
+// private function:  _kvs_log_sync( log )
 // ---------------------------------------------------------------------------
 //
-// Allocates and returns a new table entry  initalised with a reference to the
-// data at address <value>.  The  status of the operation  is  passed back  in
-// <status>,  unless  NULL  was passed in for <status>.
-//
-// pre-conditions:
-//
-//  This function DOES NOT CHECK pre-conditions.  The caller MUST ENFORCE pre-
-//  conditions before calling this function:
-// 
-//  o  key must never be 0
-//  o  size must never be 0
-//  o  value must never be NULL
-//
-// post-conditions:
-//
-//  o  a new entry has been allocated
-//  o  entry's key field contains key
-//  o  entry's value field contains <value>
-//  o  entry's size field contains size
-//  o  entry's null_terminated flas contains null_terminated
-//  o  entry's pending_removal flag contains false
-//  o  entry's next field contains NULL
-//  o  KVS_STATUS_SUCCESS is passed back in <status>
-//  o  pointer to entry is returned
-//
-// error-conditions:
-//
-//  if memory allocation fails:
-//  o  KVS_STATUS_ALLOCATION_FAILED is passed back in <status>
-//  o  NULL is returned
+// Writes out the buffer of <log>  and syncs the log file.  The caller must
+// hold the lock of <log>.  Returns true if the log file has been synced.
 
-static fmacro kvs_entry _kvs_new_entry_with_ref(kvs_key_t key,
-                                               kvs_data_t value,
-                                                 cardinal size,
-                                                bool null_terminated,
-                                             kvs_status_t *status) {
-    kvs_entry_s *new_entry;
+static bool _kvs_log_sync(kvs_log_s *log) {
+    bool success;
     
-    // allocate storage for new entry
-    new_entry = ALLOCATE(sizeof(kvs_entry_s));
+    success = _kvs_log_write(log, log->buffer, log->fill);
+    log->fill = 0;
     
-    // exit if allocation failed
-    if (new_entry == NULL) {
-        
-        // set status and return NULL
-        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
-        return NULL;
-    } // end if
+    if (success)
+        success = (fsync(log->fd) == 0);
     
-    // store key and value
-    new_entry->key = key;
-    new_entry->value = value;
+    log->dirty = false;
+    log->last_sync = _kvs_log_now();
     
-    // initialise meta data
-    new_entry->size = size;
-    new_entry->next = NULL;
-    new_entry->ref_count = 1;
-    new_entry->null_terminated = null_terminated;
-    new_entry->marked_for_removal = false;
-        
-    // set status and return
-    _kvs_set_status(status, KVS_STATUS_SUCCESS);
-    return new_entry;
-} // end _kvs_new_entry_with_ref
+    return success;
+} // end _kvs_log_sync
 
 
-static fmacro kvs_data_t _kvs_retrieve_copy(kvs_entry_s *entry,
-                                           kvs_status_t *status) {
-    kvs_entry_s *new_entry;
-    octet_t *source, *new_copy;
-    cardinal index, size;
-    
-    // allocate storage for a copy of the data
-    new_copy = ALLOCATE(entry->size);
-    
-    // exit if allocation failed
-    if (new_copy == NULL) {
-        
-        // set status and return NULL
-        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
-        return NULL;
-    } // end if
+// ---------------------------------------------------------------------------
+// private function:  _kvs_log_now()
+// ---------------------------------------------------------------------------
+//
+// Returns the time of a monotonic clock in microseconds.
+
+static fmacro uint64_t _kvs_log_now(void) {
+    struct timespec now;
     
-    // copy data
-    index = 0;
-    size = entry->size;
-    source = new_entry->value;
-    while (index <= size) {
-        new_copy[index] = source[index];
-        index++;
-    } // end for
+    clock_gettime(CLOCK_MONOTONIC, &now);
     
-    // set status and return
-    _kvs_set_status(status, KVS_STATUS_SUCCESS);
-    return (kvs_data_t) new_copy;
-} // end _kvs_retrieve_copy
+    return (uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000;
+} // end _kvs_log_now
+
 
+#if KVS_USE_THREADS
 
 // ---------------------------------------------------------------------------
-// private function:  _kvs_dispose_entry( entry, status )
+// private function:  _kvs_log_flusher( log )
 // ---------------------------------------------------------------------------
 //
-// Deallocates <entry>. Status passed back in <status> unless NULL passed in.
+// Thread function of the flusher thread of <log>.  Wakes up once per commit
+// window  and syncs the log if records have been appended since the last
+// sync.  The buffer is written out under the lock of the log,  but the lock
+// is released during fsync()  so that appends continue meanwhile.  Terminates
+// when the stop flag of the log is set.
 
-static fmacro void _kvs_dispose_entry(kvs_entry entry, kvs_status_t *status) {
-
-    // don't try to free any null pointers for entry
-    if (entry == NULL) {
-    
-        // set status
-        _kvs_set_status(status, KVS_STATUS_INVALID_ENTRY);
-        
-        // exit
-        return;
-    } // end if
+static void *_kvs_log_flusher(void *log_p) {
+    kvs_log_s *log = (kvs_log_s *) log_p;
+    struct timespec deadline;
+    uint64_t usec;
+    bool success;
     
-    // don't try to free any null pointers for value either, just in case
-    if (entry->value != NULL) {
+    pthread_mutex_lock(&log->lock);
     
-        // deallocate entry's value
-        DEALLOCATE(entry->value);
+    while (NOT(log->stop)) {
         
-        // set status
-        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        // sleep for one window or until woken up to stop
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        usec = (uint64_t) deadline.tv_nsec / 1000 + log->window;
+        deadline.tv_sec = deadline.tv_sec + (time_t) (usec / 1000000);
+        deadline.tv_nsec = (long) (usec % 1000000) * 1000;
+        pthread_cond_timedwait(&log->wake, &log->lock, &deadline);
         
-        // don't exit here, the entry itself still needs to be deallocated
-    } // end if
+        if ((log->dirty) && NOT(log->failed)) {
+            success = _kvs_log_write(log, log->buffer, log->fill);
+            log->fill = 0;
+            log->dirty = false;
+            
+            pthread_mutex_unlock(&log->lock);
+            if (success)
+                success = (fsync(log->fd) == 0);
+            pthread_mutex_lock(&log->lock);
+            
+            log->last_sync = _kvs_log_now();
+            if (NOT(success))
+                log->failed = true;
+        } // end if
+    } // end while
     
-    // deallocate the entry itself
-    DEALLOCATE(entry);
+    pthread_mutex_unlock(&log->lock);
     
-    return;
-} // end _kvs_dispose_entry
+    return NULL;
+} // end _kvs_log_flusher
+
+#endif /* KVS_USE_THREADS */
+
+#else /* NOT KVS_USE_LOG */
+
+// Logs cannot be attached,  the following are never called  except for
+// truncation,  which is not needed when nothing is appended to a log.
+
+static kvs_log_s *_kvs_log_open(const char *path,
+                                  cardinal window,
+                              kvs_status_t *status) {
+    (void) path; (void) window;
+    *status = KVS_STATUS_FILE_ERROR; return NULL;
+}
+    
+static bool _kvs_log_close(kvs_log_s *log) { (void) log; return true; }
+    
+static bool _kvs_log_append(kvs_log_s *log,
+                              octet_t type,
+                            kvs_key_t key,
+                           const void *value,
+                             cardinal size,
+                                 bool null_terminated,
+                           kvs_time_t expires) {
+    (void) log; (void) type; (void) key;
+    (void) value; (void) size; (void) null_terminated; (void) expires;
+    return false;
+}
+    
+static bool _kvs_log_commit(kvs_log_s *log) { (void) log; return true; }
+    
+static bool _kvs_log_truncate(const char *path, uint64_t length) {
+    (void) path; (void) length; return true;
+}
+    
+#endif /* KVS_USE_LOG */
 
 
 // END OF FILE
@@ -51,6 +51,12 @@
  */
 
 
+#ifndef KVS_H
+#define KVS_H
+
+
+#include <stddef.h>
+
 #include "../common/common.h"
 
 
@@ -61,6 +67,20 @@
 #define KVS_DEFAULT_TABLE_SIZE 20011
 
 
+// ---------------------------------------------------------------------------
+// Load factor threshold for resizable tables, in percent
+// ---------------------------------------------------------------------------
+
+#define KVS_RESIZE_LOAD_FACTOR 100
+
+
+// ---------------------------------------------------------------------------
+// Number of buckets migrated per operation while a table is being resized
+// ---------------------------------------------------------------------------
+
+#define KVS_RESIZE_MIGRATION_STEP 4
+
+
 // ---------------------------------------------------------------------------
 // Maximum size for null-terminated values
 // ---------------------------------------------------------------------------
@@ -68,6 +88,76 @@
 #define KVS_MAX_STRING_SIZE (64*1024) /* 64 KBytes */
 
 
+// ---------------------------------------------------------------------------
+// Maximum size for inline values taken from a table's slab
+// ---------------------------------------------------------------------------
+
+#define KVS_INLINE_VALUE_LIMIT 64
+
+
+// ---------------------------------------------------------------------------
+// Number of keys prefetched together by batch operations
+// ---------------------------------------------------------------------------
+
+#define KVS_BATCH_GROUP_SIZE 16
+
+
+// ---------------------------------------------------------------------------
+// Number of buckets ahead of the current one prefetched by iteration
+// ---------------------------------------------------------------------------
+
+#define KVS_FOREACH_PREFETCH_DISTANCE 8
+
+
+// ---------------------------------------------------------------------------
+// Maximum number of threads used by parallel iteration
+// ---------------------------------------------------------------------------
+
+#define KVS_FOREACH_MAX_THREADS 64
+
+
+// ---------------------------------------------------------------------------
+// Maximum number of slots of the hot entry cache of a table
+// ---------------------------------------------------------------------------
+
+#define KVS_HOT_CACHE_MAX_SLOTS (64*1024)
+
+
+// ---------------------------------------------------------------------------
+// Number of counters of the lookup filter of a table per bucket
+// ---------------------------------------------------------------------------
+
+#define KVS_FILTER_COUNTERS_PER_BUCKET 16
+
+
+// ---------------------------------------------------------------------------
+// Size of the record buffer of a write-ahead log
+// ---------------------------------------------------------------------------
+
+#define KVS_LOG_BUFFER_SIZE (64*1024) /* 64 KBytes */
+
+
+// ---------------------------------------------------------------------------
+// Size above which values stored by copy are kept in chunks,  if chunked
+// ---------------------------------------------------------------------------
+
+#define KVS_CHUNK_THRESHOLD (256*1024) /* 256 KBytes */
+
+
+// ---------------------------------------------------------------------------
+// Size of the chunks of values kept in chunks
+// ---------------------------------------------------------------------------
+
+#define KVS_CHUNK_SIZE (64*1024) /* 64 KBytes */
+
+
+// ---------------------------------------------------------------------------
+// Number of chain lengths counted by the histogram of table statistics
+// ---------------------------------------------------------------------------
+
+#define KVS_STATS_CHAIN_LENGTHS 16
+
+
 // ---------------------------------------------------------------------------
 // Opaque key-value table handle type
 // ---------------------------------------------------------------------------
@@ -84,10 +174,149 @@ typedef opaque_t kvs_table_t;
 
 
 // ---------------------------------------------------------------------------
-// Key type
+// Table flags type
 // ---------------------------------------------------------------------------
+//
+// Flags are passed to kvs_new_table_with_flags() to select the storage scheme
+// and optional behaviour of a new table.  Flags may be combined by bitwise OR.
+
+typedef uint32_t kvs_flags_t;
 
+
+// ---------------------------------------------------------------------------
+// Table flags
+// ---------------------------------------------------------------------------
+//
+// KVS_FLAGS_NONE
+//  default table,  entries are kept in separately chained buckets.
+//
+// KVS_FLAG_OPEN_ADDRESSING
+//  keys are kept in an open addressing table  with one control byte per slot.
+//  Lookups probe 16 control bytes at once  and  only dereference an entry on
+//  a key match.  The table grows automatically at a load factor of 7/8.
+//
+// KVS_FLAG_INCREMENTAL_RESIZE
+//  the number of buckets  of a chained table  is doubled when the number of
+//  entries exceeds KVS_RESIZE_LOAD_FACTOR percent of the number of buckets.
+//  Chains are then migrated  KVS_RESIZE_MIGRATION_STEP  buckets at a time on
+//  every subsequent store and lookup operation until the resize is complete.
+//  Entries are relinked, not reallocated.  Not valid with open addressing.
+//
+// KVS_FLAG_INLINE_VALUES
+//  values stored by copy are placed directly after their entry  within  the
+//  same allocation.  Entries with values of up to KVS_INLINE_VALUE_LIMIT bytes
+//  are taken from per-table slabs  by size class  and are recycled on removal.
+//  All slabs are released at once when the table is disposed of.
+//
+// KVS_FLAG_CONCURRENT
+//  the table may be used by multiple threads at once.  Lookups take no locks,
+//  stores and removals lock one of a fixed number of bucket lock stripes.  The
+//  reference count and the removal mark of entries are updated atomically, an
+//  entry pinned by a by-reference lookup is never removed  until released.
+//  Unlinked entries are deallocated once no reader can still access them.
+//  Retrieved entries are not cached.  A table may only be disposed of when no
+//  other thread uses it.  Not valid with any other flag,  not available when
+//  built with KVS_NO_THREADS.
+//
+// KVS_FLAG_POWER_OF_TWO_BUCKETS
+//  the number of buckets is rounded up to a power of two  and keys are mixed
+//  by a hash function  seeded randomly for each table  before the bucket index
+//  is masked off.  This avoids a division per lookup,  spreads sequential and
+//  strided keys evenly,  and prevents chosen key sets from forcing long chains.
+//  Without this flag,  the bucket index is the key modulo the number of
+//  buckets.  Not valid with open addressing,  which is always hashed so.
+//
+// KVS_FLAG_COMPACT
+//  entries are kept in fixed size records  within chunks owned by the table,
+//  instead of an allocation each,  and refer to each other by 32 bit record
+//  indices instead of pointers.  The bucket array holds 32 bit indices and
+//  the flags of an entry are packed into the low bits of its reference count.
+//  An entry then takes 24 bytes on LP64 platforms,  32 bytes with 64 bit
+//  keys,  plus its value.  Values stored by copy of up to
+//  KVS_INLINE_VALUE_LIMIT bytes are taken from a slab.  Entries of compact
+//  tables cannot expire.  Only valid with power of two buckets among the
+//  other flags,  compact tables cannot be caches.
+//
+// KVS_FLAG_FILTER
+//  every lookup first queries a counting Bloom filter  which rejects most keys
+//  not stored in the table  after reading a single cache line,  without a walk
+//  of the chain or probe sequence.  The filter holds four bit counters,  it is
+//  sized to KVS_FILTER_COUNTERS_PER_BUCKET counters per bucket of the initial
+//  number of buckets  and is updated when entries are added and removed.  Its
+//  false positive rate grows if the table holds many more entries than it had
+//  buckets initially,  the rate is reported by kvs_get_filter_stats().  Not
+//  valid with concurrent access.
+//
+// KVS_FLAG_DEDUP
+//  values stored by copy are kept once per distinct content.  Every value is
+//  hashed and looked up in a store of values,  an entry whose value is equal
+//  to one already stored shares it  instead of a copy of its own.  Shared
+//  values are reference counted  and are deallocated with the last entry
+//  sharing them.  Retrieval is unchanged,  but data retrieved by reference
+//  may be shared with other keys  and must not be modified.  Not valid with
+//  inline values,  concurrent access or compact tables.
+//
+// KVS_FLAG_CHUNKED_VALUES
+//  values stored by copy  that are larger than KVS_CHUNK_THRESHOLD bytes are
+//  kept in a list of chunks of up to KVS_CHUNK_SIZE bytes each,  instead of a
+//  single allocation.  Such values are read piece by piece  through a stream
+//  opened by kvs_stream_open()  without being copied.  Retrieval by copy puts
+//  the chunks together into one allocation.  Retrieval by reference and views
+//  fail with status KVS_STATUS_VALUE_CHUNKED for chunked values,  iteration
+//  passes them as a temporary copy.  Not valid with inline values,  compact
+//  tables or deduplication,  kvs_snapshot() cannot be taken of such tables.
+
+#define KVS_FLAGS_NONE 0
+
+#define KVS_FLAG_OPEN_ADDRESSING (1 << 0)
+
+#define KVS_FLAG_INCREMENTAL_RESIZE (1 << 1)
+
+#define KVS_FLAG_INLINE_VALUES (1 << 2)
+
+#define KVS_FLAG_CONCURRENT (1 << 3)
+
+#define KVS_FLAG_POWER_OF_TWO_BUCKETS (1 << 4)
+
+#define KVS_FLAG_COMPACT (1 << 5)
+
+#define KVS_FLAG_FILTER (1 << 6)
+
+#define KVS_FLAG_DEDUP (1 << 7)
+
+#define KVS_FLAG_CHUNKED_VALUES (1 << 8)
+
+
+// ---------------------------------------------------------------------------
+// Key type
+// ---------------------------------------------------------------------------
+//
+// Keys are 32 bit unsigned integers,  or 64 bit unsigned integers  if built
+// with KVS_KEY_BITS defined as 64.  The key width is fixed for a build  and
+// must be the same for the library and its clients.  Zero is not a valid key
+// at either width.  Snapshots record the key width  and can only be opened by
+// a build of the same key width.  Logs cannot be replayed across key widths.
+
+#ifndef KVS_KEY_BITS
+#define KVS_KEY_BITS 32
+#endif
+
+#if (KVS_KEY_BITS == 64)
+typedef uint64_t kvs_key_t;
+#elif (KVS_KEY_BITS == 32)
 typedef uint32_t kvs_key_t;
+#else
+#error "Fatal error: KVS_KEY_BITS must be 32 or 64."
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Time type
+// ---------------------------------------------------------------------------
+//
+// Points in time and time spans for expiring entries,  in milliseconds.
+
+typedef uint64_t kvs_time_t;
 
 
 // ---------------------------------------------------------------------------
@@ -97,6 +326,102 @@ typedef uint32_t kvs_key_t;
 typedef void *kvs_data_t;
 
 
+// ---------------------------------------------------------------------------
+// Read view type
+// ---------------------------------------------------------------------------
+//
+// A pinned view of an entry's value,  filled in by kvs_get_view()  and given
+// back by kvs_view_release().  The value must not be modified  and remains
+// valid until the view is released.  The table and entry fields are private.
+
+typedef struct /* kvs_view_t */ {
+    kvs_data_t value; // the entry's value in the table
+      cardinal size; // size of the value in bytes,  zero if unknown
+          bool null_terminated; // whether the value is null-terminated
+   kvs_table_t table; // private:  table the view was taken from
+      opaque_t entry; // private:  pinned entry,  NULL if none
+} kvs_view_t;
+
+
+// ---------------------------------------------------------------------------
+// Value stream type
+// ---------------------------------------------------------------------------
+//
+// A pinned entry whose value is read piece by piece,  opened by
+// kvs_stream_open(),  read by kvs_stream_next()  and closed by
+// kvs_stream_close().  The view and chunk fields are private.
+
+typedef struct /* kvs_stream_t */ {
+      cardinal size; // size of the whole value in bytes,  zero if unknown
+          bool null_terminated; // whether the value is null-terminated
+    kvs_view_t view; // private:  pinned entry and unread contiguous value
+      opaque_t chunk; // private:  next chunk to be read,  NULL if none
+} kvs_stream_t;
+
+
+// ---------------------------------------------------------------------------
+// Cache statistics type
+// ---------------------------------------------------------------------------
+//
+// Counters of a table created by kvs_new_cache(),  passed back by
+// kvs_get_cache_stats().
+
+typedef struct /* kvs_cache_stats_t */ {
+    uint64_t hits; // retrievals that found an entry
+    uint64_t misses; // retrievals that found no entry
+    uint64_t evictions; // entries evicted to stay within the byte budget
+      size_t bytes_used; // bytes held by entries and their copied values
+      size_t byte_budget; // bytes the table may hold before evicting
+} kvs_cache_stats_t;
+
+
+// ---------------------------------------------------------------------------
+// Filter statistics type
+// ---------------------------------------------------------------------------
+//
+// Counters of the lookup filter of a table created with KVS_FLAG_FILTER,
+// passed back by kvs_get_filter_stats().
+
+typedef struct /* kvs_filter_stats_t */ {
+    uint64_t rejections; // lookups rejected by the filter
+    uint64_t false_positives; // lookups passed by the filter finding no entry
+      double false_positive_rate; // false positives per lookup of absent keys
+      size_t size; // bytes held by the filter counters
+} kvs_filter_stats_t;
+
+
+// ---------------------------------------------------------------------------
+// Table statistics type
+// ---------------------------------------------------------------------------
+//
+// Counters and figures of a table,  passed back by kvs_get_stats().  Element
+// n of the chain length histogram counts the buckets holding n entries,  the
+// last element counts all buckets holding at least as many.  The lookup
+// counters are only maintained when built with KVS_STATS defined.
+
+typedef struct /* kvs_stats_t */ {
+    uint64_t lookups; // searches for a key
+    uint64_t compares; // entries whose key was compared by searches
+    uint64_t hot_hits; // searches answered by the hot entry cache
+      double compares_per_lookup; // compares per lookup,  zero if none
+      double hot_hit_rate; // hot hits per lookup,  zero if none
+      size_t entry_bytes; // bytes held by entries
+      size_t value_bytes; // bytes held by values owned by the table
+    cardinal entry_count; // entries walked,  including those marked
+    cardinal marked_count; // entries marked for removal  awaiting release
+    cardinal bucket_count; // buckets walked
+    cardinal longest_chain; // entries in the longest chain
+    cardinal chain_length[KVS_STATS_CHAIN_LENGTHS]; // histogram of buckets
+} kvs_stats_t;
+
+
+// ---------------------------------------------------------------------------
+// Action callback function type
+// ---------------------------------------------------------------------------
+
+typedef void (*kvs_action_f)(kvs_key_t, kvs_data_t, cardinal, bool, void *);
+
+
 // ---------------------------------------------------------------------------
 // Status codes
 // ---------------------------------------------------------------------------
@@ -112,7 +437,12 @@ typedef /* kvs_status_t */ enum {
     KVS_STATUS_INVALID_ENTRY,
     KVS_STATUS_ENTRY_NOT_FOUND,
     KVS_STATUS_ENTRY_PENDING_REMOVAL,
-    KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN
+    KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN,
+    KVS_STATUS_INVALID_FLAGS,
+    KVS_STATUS_TABLE_READ_ONLY,
+    KVS_STATUS_FILE_ERROR,
+    KVS_STATUS_INVALID_SNAPSHOT,
+    KVS_STATUS_VALUE_CHUNKED
 } kvs_status_t;
 
 
@@ -131,6 +461,93 @@ typedef /* kvs_status_t */ enum {
 kvs_table_t kvs_new_table(cardinal size, kvs_status_t *status);
 
 
+// ---------------------------------------------------------------------------
+// function:  kvs_new_table_with_flags( size, flags, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new KVS table object  with  <size>  number of buckets
+// and the storage scheme and options selected by <flags>.  If zero is passed in
+// <size>,  then  the default table size  is used.  For open addressing tables,
+// <size> is rounded up to the next power of two,  but not less than 16.  For
+// tables with power of two buckets,  <size> is rounded up to the next power of
+// two.  If the flags are unknown or mutually exclusive,  then no table is
+// created  and NULL is returned.  Passing KVS_FLAGS_NONE is equivalent to
+// calling kvs_new_table().
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_new_table_with_flags(cardinal size,
+                                  kvs_flags_t flags,
+                                 kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_cache( size, flags, byte_budget, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new KVS table  as kvs_new_table_with_flags() does,
+// which acts as a cache holding at most <byte_budget> bytes.  The bytes held
+// by an entry are the size of its entry header  plus  the size of its value
+// if stored by copy.  Whenever a store makes the table exceed its budget,
+// entries are evicted in CLOCK order:  entries are kept on a ring  in the
+// order they were added,  a retrieval sets an entry's referenced bit,  and
+// eviction sweeps the ring,  evicting entries whose bit is clear  and clearing
+// the bit of those it passes.  Entries retrieved by reference and not yet
+// released,  entries pending removal  and  the entry just stored  are never
+// evicted,  the table may then exceed its budget  until a later store.
+// The ring is kept within the entries,  no separate structure is allocated.
+// Evictions are not written to an attached log.  Retrievals count as hits or
+// misses.  Caches cannot be concurrent or compact tables.  If zero is passed
+// in for <byte_budget>,  then no table is created  and  NULL is returned.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_new_cache(cardinal size,
+                       kvs_flags_t flags,
+                            size_t byte_budget,
+                      kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_table_from_arrays( keys, vals, sizes, nt, count, ... )
+// ---------------------------------------------------------------------------
+//
+// Creates and returns a new KVS table  as kvs_new_table_with_flags() does and
+// stores the <count> number of keys in array <keys>  by value,  taking the
+// value of each key from array <values> at the same index.  If NULL is passed
+// in for <sizes>,  then all values must be null-terminated  and
+// <null_terminated> must be true,  otherwise the size of each value is taken
+// from array <sizes>,  a size of zero then requires a null-terminated value.
+// Keys that are zero  and  values that are NULL  or  of unknown size  are
+// skipped.  Of a key that occurs more than once  only the first is stored,
+// the others are skipped.  The number of keys skipped  is passed back  in
+// <skipped>,  unless NULL was passed in for <skipped>.
+//
+// The number of buckets is chosen for <count> entries  at the load factor
+// KVS_RESIZE_LOAD_FACTOR.  All entries are built with their values following
+// them  in one allocation  in which the entries of every bucket are adjacent,
+// and every chain is linked once,  instead of <count> separate stores with
+// two allocations each.  Entries built so are only deallocated  when the
+// table is disposed of.  Not valid with open addressing,  compact,  inline
+// values,  deduplication or chunked values tables,  no table is then created
+// and status KVS_STATUS_INVALID_FLAGS is passed back.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.  The status is KVS_STATUS_SUCCESS  if the table was
+// created,  even if some entries were skipped.
+
+kvs_table_t kvs_new_table_from_arrays(const kvs_key_t *keys,
+                                     const kvs_data_t *values,
+                                       const cardinal *sizes,
+                                                 bool null_terminated,
+                                             cardinal count,
+                                          kvs_flags_t flags,
+                                             cardinal *skipped,
+                                         kvs_status_t *status);
+
+
 // ---------------------------------------------------------------------------
 // function:  kvs_store_value( table, key, val, size, null_terminated, stat )
 // ---------------------------------------------------------------------------
@@ -180,15 +597,64 @@ void kvs_store_reference(kvs_table_t table,
                         kvs_status_t *status);
 
 
+// ---------------------------------------------------------------------------
+// function:  kvs_store_value_ttl( tbl, key, val, siz, nt, ttl, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to table <table>  by value  as
+// kvs_store_value() does,  which expires <ttl> milliseconds after the current
+// time as returned by kvs_current_time().  An expired entry can no longer be
+// retrieved,  it is removed when it is next looked up  or  when kvs_expire()
+// reaps it,  whichever comes first.  As for kvs_remove_entry(),  an expired
+// entry that is still referenced is only marked for removal  and is removed
+// when released.  If zero is passed in for <ttl>,  then the entry does not
+// expire.  Expiry deadlines are saved in snapshots  and  written to logs  on
+// the real time clock,  so that they survive a restart of the system.
+// Entries cannot expire in concurrent or compact tables,  a non-zero <ttl>
+// then fails with status KVS_STATUS_INVALID_FLAGS.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_store_value_ttl(kvs_table_t table,
+                           kvs_key_t key,
+                          kvs_data_t value,
+                            cardinal size,
+                                bool null_terminated,
+                          kvs_time_t ttl,
+                        kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_store_reference_ttl( tbl, key, val, siz, nt, ttl, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to table <table>  by reference  as
+// kvs_store_reference() does,  which expires <ttl> milliseconds after the
+// current time  as kvs_store_value_ttl() describes.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_store_reference_ttl(kvs_table_t table,
+                               kvs_key_t key,
+                              kvs_data_t value,
+                                cardinal size,
+                                    bool null_terminated,
+                              kvs_time_t ttl,
+                            kvs_status_t *status);
+
+
 // ---------------------------------------------------------------------------
 // function:  kvs_entry_exists( table, key, status )
 // ---------------------------------------------------------------------------
 //
 // Returns  true  if a  valid entry  for <key> exists  in  KVS  table <table>,
 // returns false otherwise.  If an entry is found,  valid or invalid,  then it
-// will be cached internally  and a subsequent search request for the same key
-// will check the cached entry first, which is slighly faster than a lookup of
-// a  non-cached entry.  The  reference count  of the entry is  not  modified.
+// will be cached in the hot entry cache of the table  and a subsequent search
+// request for the same key  will check the cache first,  which is faster than
+// a lookup of a non-cached entry.  The reference count of the entry is  not
+// modified.
 // The  status  of the operation  is passed back in <status>,  unless NULL was
 // passed in for <status>.
 
@@ -216,7 +682,8 @@ bool kvs_entry_exists(kvs_table_t table,
 // data  is returned as function result  and  the  entry's reference count  is
 // incremented.  The size of the  entry's data  (in bytes)  is  passed back in
 // <size>.  However,  if the size of the entry's data is  unknown,  then  zero
-// is passed back in <size>.
+// is passed back in <size>.  Values kept in chunks  cannot be retrieved by
+// reference,  NULL is then returned with status KVS_STATUS_VALUE_CHUNKED.
 //
 // If the entry's data is null-terminated,  then  true  will be passed back in
 // <null_terminated>,  otherwise  false  will be passed back.
@@ -272,6 +739,90 @@ kvs_data_t kvs_reference_for_key(kvs_table_t table,
                                 kvs_status_t *status);
 
 
+// ---------------------------------------------------------------------------
+// function:  kvs_get_view( table, key, view, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in <table> for <key>  and fills in <view> with a
+// pointer to the entry's value in the table,  its size  and  null-terminated
+// flag,  then pins the entry  by incrementing its reference count.  No memory
+// is allocated and no data is copied.  Returns  true  if a view was taken.
+// The view must be given back with kvs_view_release(),  which releases the
+// entry without looking up its key again.
+//
+// If no entry exists for <key>,  or if it is pending removal,  then  false is
+// returned and <view> is cleared.  Values kept in chunks cannot be viewed,
+// false is then returned with status KVS_STATUS_VALUE_CHUNKED.  The status of
+// the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+bool kvs_get_view(kvs_table_t table,
+                    kvs_key_t key,
+                   kvs_view_t *view,
+                 kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_view_release( view, status )
+// ---------------------------------------------------------------------------
+//
+// Releases the entry pinned by <view>  as kvs_release_entry() does  and clears
+// <view>.  If the entry has been marked for removal  and this was its last
+// reference,  then it is removed.  Releasing a cleared view has no effect.
+// The status of the operation is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+void kvs_view_release(kvs_view_t *view, kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_stream_open( table, key, stream, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in <table> for <key>,  pins it as kvs_get_view()
+// does  and opens <stream> on its value,  which kvs_stream_next() then reads
+// piece by piece.  A value kept in chunks is read one chunk at a time,  any
+// other value in a single piece.  No memory is allocated and no data is
+// copied.  Returns  true  if the stream was opened.  The stream must be closed
+// with kvs_stream_close().
+//
+// If no entry exists for <key>,  or if it is pending removal,  then  false is
+// returned and <stream> is cleared.  The status of the operation is passed
+// back in <status>,  unless NULL was passed in for <status>.
+
+bool kvs_stream_open(kvs_table_t table,
+                       kvs_key_t key,
+                    kvs_stream_t *stream,
+                    kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_stream_next( stream, size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the next piece of the value read by <stream>  and
+// passes its size back in <size>.  The piece must not be modified  and remains
+// valid until the stream is closed.  Once the whole value has been read,  NULL
+// is returned and zero is passed back in <size>.  The status of the operation
+// is passed back in <status>,  unless NULL was passed in for <status>.
+
+kvs_data_t kvs_stream_next(kvs_stream_t *stream,
+                               cardinal *size,
+                           kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_stream_close( stream, status )
+// ---------------------------------------------------------------------------
+//
+// Releases the entry pinned by <stream>  as kvs_view_release() does  and
+// clears <stream>.  Closing a cleared stream has no effect.  The status of
+// the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+void kvs_stream_close(kvs_stream_t *stream, kvs_status_t *status);
+
+
 // ---------------------------------------------------------------------------
 // function:  kvs_size_for_key( table, key, status )
 // ---------------------------------------------------------------------------
@@ -343,12 +894,455 @@ void kvs_remove_entry(kvs_table_t table,
                      kvs_status_t *status);
 
 
+// ---------------------------------------------------------------------------
+// function:  kvs_expire( table, now, status )
+// ---------------------------------------------------------------------------
+//
+// Removes all entries of <table>  whose expiry deadline is not later than
+// <now>,  and returns their number.  Referenced entries are marked for
+// removal instead.  Deadlines are kept in a hierarchical timing wheel,  the
+// cost of a call is proportional to the number of entries expired,  not to
+// the number of entries in the table  or  the time passed since the last call.
+// <now> is normally the result of kvs_current_time().
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+cardinal kvs_expire(kvs_table_t table, kvs_time_t now, kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_current_time()
+// ---------------------------------------------------------------------------
+//
+// Returns the current time of a monotonic clock in milliseconds,  the clock
+// against which expiry deadlines are set and checked.
+
+kvs_time_t kvs_current_time(void);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_compact( table, budget, status )
+// ---------------------------------------------------------------------------
+//
+// Performs one step of compaction of chained table <table>,  visiting no more
+// than <budget> buckets,  and returns the number of buckets migrated  and
+// entries moved.  A step first continues an ongoing incremental resize,  then
+// visits buckets from where the previous step stopped.  Entries marked for
+// removal  are moved from their chains  to a graveyard of the table,  where
+// they remain until released,  so that lookups no longer step over them.
+// kvs_remove_entry() moves an entry there when it marks it,  a step moves
+// entries marked on expiry.  When more than half of the bytes of the arena of
+// a table built by kvs_new_table_from_arrays() are held by removed entries,
+// its live entries are moved to a new arena  in the order of their chains and
+// the old arena is deallocated once it holds no more entries.  Referenced
+// entries are not moved to a new arena.  A step is intended to be taken from
+// an idle loop,  its cost is bounded by <budget>.
+//
+// Open addressing,  concurrent,  compact and snapshot tables  are not compacted
+// and KVS_STATUS_INVALID_FLAGS is passed back.  The status of the operation is
+// passed back in <status>,  unless NULL was passed in for <status>.  The status
+// is KVS_STATUS_SUCCESS  if the step was completed,  KVS_STATUS_INVALID_TABLE
+// if NULL was passed in for <table>,  and KVS_STATUS_ALLOCATION_FAILED  if the
+// graveyard or a new arena could not be allocated,  the step then continues
+// with the entries concerned left in place.
+
+cardinal kvs_compact(kvs_table_t table,
+                        cardinal budget,
+                    kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_many( table, copy, keys, values, sizes, count, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entries  stored in <table>  for the <count> number of keys in
+// array <keys>  either by copy or by reference  as kvs_get_entry() does and
+// passes them back in array <values>  at the same index as their keys.  If an
+// entry does not exist,  is pending removal,  or cannot be retrieved,  then
+// NULL is passed back for the entry.  Unless NULL is passed in for <sizes>,
+// the size of each entry's data  is  passed back in array <sizes>,  or zero if
+// no entry was retrieved.  Returns the number of entries retrieved.
+//
+// Keys are processed in groups of KVS_BATCH_GROUP_SIZE.  The buckets and first
+// entries of a group are prefetched before any of its keys are looked up,  so
+// that cache misses of the keys within a group overlap.
+//
+// The  status  of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.  The status is KVS_STATUS_SUCCESS  if the arguments
+// were valid,  even if some entries were not retrieved.
+
+cardinal kvs_get_many(kvs_table_t table,
+                             bool copy,
+                  const kvs_key_t *keys,
+                       kvs_data_t *values,
+                         cardinal *sizes,
+                         cardinal count,
+                     kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_store_many( table, keys, vals, sizes, nt, count, status )
+// ---------------------------------------------------------------------------
+//
+// Adds new entries  for the <count> number of keys  in array <keys>  to table
+// <table>  by value  as kvs_store_value() does,  taking the value of each key
+// from array <values>  at the same index.  If NULL is passed in for <sizes>,
+// then all values must be null-terminated and <null_terminated> must be true,
+// otherwise the size of each value is taken from array <sizes>.  Keys that are
+// not unique  or  values that are invalid  are skipped.  Returns  the number
+// of entries added.
+//
+// Keys are processed in groups of KVS_BATCH_GROUP_SIZE.  The buckets and first
+// entries of a group are prefetched before any of its keys are stored.
+//
+// The  status  of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.  The status is KVS_STATUS_SUCCESS  if the arguments
+// were valid,  even if some entries were not added.
+
+cardinal kvs_store_many(kvs_table_t table,
+                    const kvs_key_t *keys,
+                   const kvs_data_t *values,
+                     const cardinal *sizes,
+                               bool null_terminated,
+                           cardinal count,
+                       kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_foreach( table, action, context, status )
+// ---------------------------------------------------------------------------
+//
+// Calls <action> once for every entry of <table>  that is neither marked for
+// removal nor expired,  and returns the number of entries visited.  Buckets
+// are walked in memory order.  While a bucket is visited,  the entries of the
+// bucket KVS_FOREACH_PREFETCH_DISTANCE buckets ahead  and  the values of the
+// entries half as far ahead  are prefetched.  The order in which entries are
+// visited is unspecified.
+//
+// Each time <action> is called,  the following parameters are passed to it:
+//
+// o  first parameter :  the key of the visited entry
+// o  second parameter:  the value of the visited entry,  not a copy
+// o  third parameter :  the size of the value,  zero if unknown
+// o  fourth parameter:  the null-terminated flag of the value
+// o  fifth parameter :  the pointer passed in for <context>
+//
+// A value kept in chunks  is passed as a temporary copy put together for the
+// call,  which is deallocated when <action> returns.  Such an entry is not
+// visited if its copy cannot be allocated,  the iteration continues  but  the
+// status KVS_STATUS_ALLOCATION_FAILED is passed back.
+//
+// <action> must not modify <table>.  Entries added to or removed from a
+// concurrent table by other threads while it is iterated may or may not be
+// visited.  The function fails and returns zero  if NULL is passed in for
+// <table> or <action>.  The status of the operation  is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+cardinal kvs_foreach(kvs_table_t table,
+                    kvs_action_f action,
+                            void *context,
+                    kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_parallel_foreach( table, action, context, threads, status )
+// ---------------------------------------------------------------------------
+//
+// Visits the entries of <table> as kvs_foreach() does,  but splits the buckets
+// into <threads> contiguous ranges  of which all but the first are visited by
+// threads of their own,  at most KVS_FOREACH_MAX_THREADS in all.  The calling
+// thread visits the first range and waits for the others.  <action> is called
+// from several threads at once  and  must be safe to call that way.  If zero
+// or one is passed in for <threads>,  or if the library is built without
+// thread support,  then all entries are visited by the calling thread.
+//
+// The function fails and returns zero  if NULL is passed in for <table> or
+// <action>.  The status of the operation  is passed back in <status>,  unless
+// NULL was passed in for <status>.
+
+cardinal kvs_parallel_foreach(kvs_table_t table,
+                             kvs_action_f action,
+                                     void *context,
+                                 cardinal threads,
+                             kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_save_snapshot( table, path, status )
+// ---------------------------------------------------------------------------
+//
+// Writes all entries of <table>  that are not marked for removal  to a new
+// snapshot file at <path>,  replacing any existing file.  The snapshot stores
+// bucket index,  entry headers and value bytes in a position-independent layout
+// that kvs_open_snapshot() maps into memory without deserialising it.  Entries
+// stored by reference are saved with the data they reference.  If any entry
+// to be saved has an unknown size,  then no snapshot is written.  The expiry
+// deadlines of expiring entries are saved with them.  Other threads may modify
+// a concurrent table while it is saved,  entries they store or remove meanwhile
+// may or may not be saved.  A table returned by kvs_snapshot() for the table
+// can be saved instead to save a consistent state.  Tables opened from a
+// snapshot cannot be saved again.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_save_snapshot(kvs_table_t table,
+                        const char *path,
+                      kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_open_snapshot( path, status )
+// ---------------------------------------------------------------------------
+//
+// Opens the snapshot file at <path>  saved by kvs_save_snapshot()  and returns
+// a read-only KVS table that serves lookups directly from the file mapped into
+// memory.  Nothing is deserialised,  pages of the file are read on first use.
+// Entries retrieved by reference point into the mapping  and must not be
+// written to.  Reference counts are not tracked,  every entry has a reference
+// count of one and releasing an entry has no effect.  Stores and removals fail
+// with status KVS_STATUS_TABLE_READ_ONLY.  The file is unmapped when the table
+// is disposed of.  Entries whose saved deadline has passed are not served.
+// Returns NULL if the file cannot be read or is not a valid snapshot.
+// Snapshot tables may be read by multiple threads at once.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_open_snapshot(const char *path, kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_snapshot( table, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a read-only KVS table  that holds the entries of <table>  as they
+// are at the time of the call.  No entries are copied  when the snapshot is
+// taken,  the snapshot shares the bucket array and entries of <table>.  When
+// <table> is later modified,  only the buckets touched are copied,  into the
+// snapshot,  before they change.  Growing <table> copies all buckets still
+// shared.  Entries retrieved by reference from the snapshot point to values
+// owned by the snapshot  which remain valid until it is disposed of.
+// Reference counts are not tracked,  every entry has a reference count of
+// one and releasing an entry has no effect.  Stores and removals fail with
+// status KVS_STATUS_TABLE_READ_ONLY.  Snapshots of concurrent tables may be
+// read by multiple threads at once  while other threads modify <table>.  If
+// <table> is disposed of before its snapshots,  then the buckets they still
+// share are copied into them first.
+//
+// Snapshots cannot be taken of open addressing,  compact,  read-only  and
+// chunked tables,  the call then fails with status KVS_STATUS_INVALID_FLAGS.
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_snapshot(kvs_table_t table, kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_attach_log( table, path, commit_window, status )
+// ---------------------------------------------------------------------------
+//
+// Opens or creates the write-ahead log file at <path>  and attaches it to
+// <table>.  From then on,  every store and every removal requested for the
+// table is appended to the log as a compact binary record  once it has been
+// applied.  Records are buffered and written to the file in groups.  If zero
+// is passed in <commit_window>,  then the log is synced to stable storage
+// after every record.  Otherwise the log is synced at most once every
+// <commit_window> microseconds,  and an operation is durable only after the
+// next sync.  Releases are not logged,  an entry removed while referenced is
+// logged as removed when the removal is requested.  Any log attached before
+// is detached first.  Logs cannot be attached to snapshot tables,  nor when
+// built with KVS_NO_LOG.  A log must not be attached to a concurrent table
+// while other threads use it.  If a record cannot be written,  then the
+// operation remains applied  but passes back KVS_STATUS_FILE_ERROR.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_attach_log(kvs_table_t table,
+                     const char *path,
+                       cardinal commit_window,
+                   kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sync_log( table, status )
+// ---------------------------------------------------------------------------
+//
+// Writes all buffered records of the write-ahead log attached to <table> to
+// the log file  and syncs it to stable storage  without waiting for the end
+// of the commit window.  Has no effect if no log is attached.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_sync_log(kvs_table_t table, kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_detach_log( table, status )
+// ---------------------------------------------------------------------------
+//
+// Syncs and closes the write-ahead log attached to <table>.  Has no effect if
+// no log is attached.  Disposing of a table detaches its log.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_detach_log(kvs_table_t table, kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_replay_log( table, path, status )
+// ---------------------------------------------------------------------------
+//
+// Applies the records of the write-ahead log file at <path>  to <table>  in
+// the order they were written and returns the number of records applied.  A
+// logged store replaces any entry stored for the same key,  a logged removal
+// removes it,  so that a log may be replayed on top of a snapshot saved while
+// the log was being written.  Replay stops at the first incomplete or corrupt
+// record,  as left behind by a crash,  and the file is truncated to the valid
+// records before it  so that logging may resume at its end.  A log file that
+// does not exist is treated as empty.  Replayed records are not logged again.
+// A logged store of an expiring entry keeps its deadline,  a store whose
+// deadline has passed is applied as a removal.  If an entry that has not yet
+// expired is replayed into a concurrent or compact table,  then replay stops
+// with status KVS_STATUS_INVALID_FLAGS.
+//
+// An entry that is still referenced cannot be replaced,  it keeps its key
+// until it is released.  Replay then stops at the store for its key with
+// status KVS_STATUS_ENTRY_PENDING_REMOVAL,  the entry is marked for removal
+// and the file is left unchanged.  Replaying the log again  once the entry
+// has been released  applies all of its records.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+cardinal kvs_replay_log(kvs_table_t table,
+                         const char *path,
+                       kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_recover_table( snapshot_path, log_path, size, flags, status )
+// ---------------------------------------------------------------------------
+//
+// Creates a new KVS table as kvs_new_table_with_flags() does,  loads all
+// entries of the snapshot file at <snapshot_path>  and then replays the
+// write-ahead log file at <log_path>  as kvs_replay_log() does.  Either path
+// may be NULL  to start from an empty table or to skip the log.  Entries are
+// stored by copy,  expired entries of the snapshot are skipped.  Unexpired
+// entries cannot be loaded into a concurrent or compact table,  the call then
+// fails with status KVS_STATUS_INVALID_FLAGS.  No log is attached to the new
+// table.  Returns NULL if the
+// table cannot be created  or the snapshot or log cannot be read.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_table_t kvs_recover_table(const char *snapshot_path,
+                              const char *log_path,
+                                cardinal size,
+                             kvs_flags_t flags,
+                            kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_set_hot_cache( table, slots, status )
+// ---------------------------------------------------------------------------
+//
+// Sets the number of slots of the hot entry cache of <table>  to <slots>,
+// rounded up to a power of two  and  limited to KVS_HOT_CACHE_MAX_SLOTS.  The
+// cache holds entries recently found by lookups,  direct-mapped by key,  and
+// is checked before the table itself is searched.  A new table has a cache of
+// one slot,  which only serves repeated lookups of the same key.  A larger
+// cache serves lookups of a set of frequently retrieved keys  without walking
+// their chains or probe sequences.  Zero is taken as one.  The entries cached
+// before are forgotten.  Removed entries are always evicted from the cache.
+// Concurrent,  compact and snapshot tables do not cache entries,  the call
+// then fails with status KVS_STATUS_INVALID_FLAGS.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_set_hot_cache(kvs_table_t table,
+                          cardinal slots,
+                      kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_cache_stats( table, stats, status )
+// ---------------------------------------------------------------------------
+//
+// Passes back the hit,  miss and eviction counters,  the bytes held and the
+// byte budget of cache table <table> in <stats>.  Retrievals by any of the
+// functions kvs_get_entry(),  kvs_value_for_key(),  kvs_reference_for_key()
+// and kvs_get_many() are counted,  existence and size queries are not.  Fails
+// with status KVS_STATUS_INVALID_TABLE  if <table> is not a cache.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_get_cache_stats(kvs_table_t table,
+                   kvs_cache_stats_t *stats,
+                        kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_filter_stats( table, stats, status )
+// ---------------------------------------------------------------------------
+//
+// Passes back the counters of the lookup filter of <table>,  created with flag
+// KVS_FLAG_FILTER,  in <stats>.  Every lookup of a key is counted,  including
+// lookups by existence and size queries.  The false positive rate is the share
+// of lookups of keys not in the table  that were not rejected by the filter,
+// it is zero until such a lookup has been made.  Fails with status
+// KVS_STATUS_INVALID_TABLE  if <table> has no filter.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_get_filter_stats(kvs_table_t table,
+                   kvs_filter_stats_t *stats,
+                         kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_get_stats( table, stats, status )
+// ---------------------------------------------------------------------------
+//
+// Passes back the statistics of <table> in <stats>.  The chain length
+// histogram,  the entries marked for removal and the bytes held by entries
+// and values are taken by a walk of all buckets on every call.  Open
+// addressing tables count their slots as buckets,  tables opened from a
+// snapshot count records and value bytes of the file.  Values stored by
+// reference are not counted,  deduplicated values are counted once.  The
+// figures of a concurrent table that other threads modify while it is walked
+// are approximate.
+//
+// The lookup counters are running totals since the table was created  and
+// are only maintained when the library is built with KVS_STATS defined,
+// otherwise they are zero.  Every retrieval,  existence and size query is
+// counted,  as are the searches stores make in open addressing and compact
+// tables.  Fails with status
+// KVS_STATUS_INVALID_TABLE  if <table> was returned by kvs_snapshot().
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+void kvs_get_stats(kvs_table_t table,
+                   kvs_stats_t *stats,
+                  kvs_status_t *status);
+
+
 // ---------------------------------------------------------------------------
 // function:  kvs_number_of_buckets( table )
 // ---------------------------------------------------------------------------
 //
 // Returns  the number of buckets  of KVS table <table>,  returns zero if NULL
-// is passed in for <table>.
+// is passed in for <table>.  For open addressing tables,  the number of slots
+// is returned.
 
 cardinal kvs_number_of_buckets(kvs_table_t table);
 
@@ -369,10 +1363,15 @@ cardinal kvs_number_of_entries(kvs_table_t table);
 //
 // Disposes of  KVS table object <table>,  deallocating  all its entries.  The
 // table and its entries are disposed of  regardless of any references held to
-// any values stored in the table.  The status of the operation is passed back
-// in <status>,  unless  NULL  was passed in for <status>.
+// any values stored in the table.  Buckets still shared with snapshots taken
+// by kvs_snapshot() are copied into the snapshots first,  if they cannot be
+// copied,  then nothing is disposed of and KVS_STATUS_ALLOCATION_FAILED is
+// passed back.  The status of the operation is passed back in <status>,
+// unless  NULL  was passed in for <status>.
 
 void kvs_dispose_table(kvs_table_t table, kvs_status_t *status);
 
 
+#endif /* KVS_H */
+
 // END OF FILE
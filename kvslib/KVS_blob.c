@@ -0,0 +1,1131 @@
+/* Key Value Storage Library
+ *
+ *  @file KVS_blob.c
+ *  Blob-keyed KVS implementation
+ *
+ *  Universal Associative Array, keyed by strings and blobs
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <string.h>
+#include <time.h>
+
+#include "../common/alloc.h"
+#include "KVS_blob.h"
+
+
+// ---------------------------------------------------------------------------
+// Alignment of values stored within their entry
+// ---------------------------------------------------------------------------
+
+#define KVS_BLOB_VALUE_ALIGNMENT 16
+
+
+// ---------------------------------------------------------------------------
+// Blob-keyed table entry pointer type
+// ---------------------------------------------------------------------------
+
+struct _kvs_blob_entry_s; /* FORWARD */
+
+typedef struct _kvs_blob_entry_s *kvs_blob_entry;
+
+
+// ---------------------------------------------------------------------------
+// Blob-keyed table entry type
+// ---------------------------------------------------------------------------
+//
+// The key is stored directly after the entry.  Values stored by copy follow
+// the key within the same allocation,  aligned to KVS_BLOB_VALUE_ALIGNMENT.
+
+struct _kvs_blob_entry_s {
+          uint64_t hash; // full 64 bit hash of the key
+    kvs_blob_entry next; // next entry in same bucket
+          opaque_t value; // pointer to stored data
+          cardinal key_size; // key size in bytes
+          cardinal size; // data size in bytes
+          cardinal ref_count; // entry's reference count
+           octet_t null_terminated; // must be true or false
+           octet_t marked_for_removal; // must be true or false
+           octet_t by_copy; // must be true or false
+           octet_t key[0]; // key bytes
+};
+
+typedef struct _kvs_blob_entry_s kvs_blob_entry_s;
+
+
+// ---------------------------------------------------------------------------
+// Blob-keyed table type
+// ---------------------------------------------------------------------------
+
+typedef struct /* kvs_blob_table_s */ {
+    kvs_blob_entry last_retrieved_entry;
+          cardinal entry_count;
+          cardinal bucket_count; // always a power of two
+          uint64_t seed; // random seed of the key hash
+    kvs_blob_entry *bucket;
+} kvs_blob_table_s;
+
+
+// ---------------------------------------------------------------------------
+// Private function prototypes
+// ---------------------------------------------------------------------------
+
+#define _kvs_set_status(_status_p,_code) \
+    { if (_status_p != NULL) *_status_p = _code; }
+
+static fmacro bool _kvs_blob_valid_key(const void *key, cardinal key_size);
+
+static kvs_blob_entry _kvs_blob_find_entry
+    (kvs_blob_table_s *table, const void *key, cardinal key_size,
+     kvs_blob_entry *prev, kvs_status_t *status);
+
+static void _kvs_blob_add_entry
+    (kvs_blob_table_s *table, const void *key, cardinal key_size,
+     kvs_data_t value, cardinal size, bool null_terminated, bool by_copy,
+     kvs_status_t *status);
+
+static void _kvs_blob_remove
+    (kvs_blob_table_s *table, const void *key, cardinal key_size,
+     kvs_status_t *status);
+
+static void _kvs_blob_grow(kvs_blob_table_s *table);
+
+static uint64_t _kvs_blob_hash
+    (const void *key, cardinal key_size, uint64_t seed);
+
+static uint64_t _kvs_blob_new_seed(kvs_blob_table_s *table);
+
+static fmacro cardinal _kvs_blob_calc_null_terminated_data_size
+    (kvs_data_t data);
+
+static fmacro kvs_data_t _kvs_blob_retrieve_copy
+    (kvs_blob_entry entry, kvs_status_t *status);
+
+
+// ===========================================================================
+// P U B L I C   F U N C T I O N   I M P L E M E N T A T I O N S
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_blob_table( size, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new blob-keyed table object  with <size>  number of
+// buckets,  rounded up to the next power of two.  If zero is passed in <size>,
+// then the new table will be created with the default table size  as defined
+// by KVS_DEFAULT_TABLE_SIZE.  Returns NULL if the table could not be created.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_blob_table_t kvs_new_blob_table(cardinal size, kvs_status_t *status) {
+    kvs_blob_table_s *new_table;
+    cardinal index, bucket_count;
+    
+    if (size == 0)
+        size = KVS_DEFAULT_TABLE_SIZE;
+    
+    // size must not exceed the largest power of two in range
+    if (size > ((cardinal) 1 << (sizeof(cardinal) * 8 - 1))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+        return NULL;
+    } // end if
+    
+    // round up to a power of two
+    bucket_count = 1;
+    while (bucket_count < size) bucket_count = bucket_count << 1;
+    
+    // allocate table base
+    new_table = ALLOCATE(sizeof(kvs_blob_table_s));
+    
+    // exit if allocation failed
+    if (new_table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // allocate bucket array
+    new_table->bucket = ALLOCATE(sizeof(kvs_blob_entry) * bucket_count);
+    
+    // exit if allocation failed
+    if (new_table->bucket == NULL) {
+        DEALLOCATE(new_table);
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // initialise buckets with NULL pointers
+    for (index = 0; index < bucket_count; index++) {
+        new_table->bucket[index] = NULL;
+    } // end for
+    
+    // initialise table meta data
+    new_table->last_retrieved_entry = NULL;
+    new_table->entry_count = 0;
+    new_table->bucket_count = bucket_count;
+    new_table->seed = _kvs_blob_new_seed(new_table);
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    // return a reference to the new table
+    return (kvs_blob_table_t) new_table;
+} // end kvs_new_blob_table
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_store_value( tbl, key, ksize, val, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry for the <key_size> bytes at <key>  to blob-keyed table
+// <table>.  The new entry is stored by value  as kvs_store_value() does.  The
+// key is copied into the entry.  Keys must be unique.  The  status  of  the
+// operation  is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+void kvs_blob_store_value(kvs_blob_table_t table,
+                                const void *key,
+                                  cardinal key_size,
+                                kvs_data_t value,
+                                  cardinal size,
+                                      bool null_terminated,
+                              kvs_status_t *status) {
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return;
+    } // end if
+    
+    // value must not be NULL
+    if (value == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    if /* size unknown */ (size == 0) {
+        if /* data is null-terminated */ (null_terminated) {
+            // calculate size
+            size = _kvs_blob_calc_null_terminated_data_size(value);
+            if (size == 0) {
+                _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+                return;
+            } // end if
+        }
+        else /* data is not null-terminated */ {
+            _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+            return;
+        } // end if
+    } // end if
+    
+    // add a new entry by copy, fails if key is not unique
+    _kvs_blob_add_entry(table, key, key_size, value, size, null_terminated,
+                        true, status);
+    
+    return;
+} // end kvs_blob_store_value
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_store_reference( tbl, key, ksize, val, size, nt, st )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry for the <key_size> bytes at <key>  to blob-keyed table
+// <table>.  The new entry is stored by reference  as kvs_store_reference()
+// does.  The key is copied into the entry.  Keys must be unique.  The  status
+// of the operation  is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+void kvs_blob_store_reference(kvs_blob_table_t table,
+                                    const void *key,
+                                      cardinal key_size,
+                                    kvs_data_t value,
+                                      cardinal size,
+                                          bool null_terminated,
+                                  kvs_status_t *status) {
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return;
+    } // end if
+    
+    // value must not be NULL
+    if (value == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_DATA);
+        return;
+    } // end if
+    
+    // size must not be NULL if data is not null-terminated
+    if ((size == 0) && (null_terminated == false)) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+        return;
+    } // end if
+    
+    if /* size unknown */ ((size == 0) && (null_terminated)) {
+        // calculate size
+        size = _kvs_blob_calc_null_terminated_data_size(value);
+        if (size == 0) {
+            _kvs_set_status(status, KVS_STATUS_INVALID_SIZE);
+            return;
+        } // end if
+    } // end if
+    
+    // add a new entry by reference, fails if key is not unique
+    _kvs_blob_add_entry(table, key, key_size, value, size, null_terminated,
+                        false, status);
+    
+    return;
+} // end kvs_blob_store_reference
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_entry_exists( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns true if a valid entry for the <key_size> bytes at <key>  exists in
+// blob-keyed table <table>,  returns false otherwise.  The  status  of  the
+// operation  is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+bool kvs_blob_entry_exists(kvs_blob_table_t table,
+                                 const void *key,
+                                   cardinal key_size,
+                               kvs_status_t *status) {
+    kvs_blob_entry this_entry;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return false;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return false;
+    } // end if
+    
+    this_entry = _kvs_blob_find_entry(table, key, key_size, NULL, status);
+    
+    return ((this_entry != NULL) && (this_entry->marked_for_removal == false));
+} // end kvs_blob_entry_exists
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_get_entry( tbl, copy, key, ksize, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in blob-keyed table <table>  for the <key_size>
+// bytes at <key>  either by copy or by reference  as kvs_get_entry() does.
+// The status of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+kvs_data_t kvs_blob_get_entry(kvs_blob_table_t table,
+                                          bool copy,
+                                    const void *key,
+                                      cardinal key_size,
+                                      cardinal *size,
+                                          bool *null_terminated,
+                                  kvs_status_t *status) {
+    kvs_blob_entry this_entry;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return NULL;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return NULL;
+    } // end if
+    
+    // try to find entry for key
+    this_entry = _kvs_blob_find_entry(table, key, key_size, NULL, status);
+    
+    // exit if entry not found
+    if (this_entry == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+        return NULL;
+    } // end if
+    
+    // exit if entry is pending removal
+    if (this_entry->marked_for_removal) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_PENDING_REMOVAL);
+        return NULL;
+    } // end if
+    
+    // exit if a copy is requested and the size of the entry is unknown
+    if ((copy == true) && (this_entry->size == 0)) {
+        _kvs_set_status(status, KVS_STATUS_SIZE_OF_ENTRY_UNKNOWN);
+        return NULL;
+    } // end if
+    
+    // pass back size and null_terminated
+    if (size != NULL)
+        *size = this_entry->size;
+    if (null_terminated != NULL)
+        *null_terminated = this_entry->null_terminated;
+    
+    if /* by copy */ (copy == true) {
+        return _kvs_blob_retrieve_copy(this_entry, status);
+    }
+    else /* by reference */ {
+        this_entry->ref_count++;
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        return (kvs_data_t) this_entry->value;
+    } // end if
+} // end kvs_blob_get_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_value_for_key( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to a newly allocated copy of the value of the entry stored
+// in blob-keyed table <table>  for the <key_size> bytes at <key>  as
+// kvs_value_for_key() does.  The status of the operation is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+kvs_data_t kvs_blob_value_for_key(kvs_blob_table_t table,
+                                        const void *key,
+                                          cardinal key_size,
+                                      kvs_status_t *status) {
+    
+    return kvs_blob_get_entry(table, true, key, key_size, NULL, NULL, status);
+    
+} // end kvs_blob_value_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_reference_for_key( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the value of the entry stored in blob-keyed table
+// <table>  for the <key_size> bytes at <key>  and increments its reference
+// count  as kvs_reference_for_key() does.  The status of the operation is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+kvs_data_t kvs_blob_reference_for_key(kvs_blob_table_t table,
+                                            const void *key,
+                                              cardinal key_size,
+                                          kvs_status_t *status) {
+    
+    return kvs_blob_get_entry(table, false, key, key_size, NULL, NULL, status);
+    
+} // end kvs_blob_reference_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_size_for_key( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the size of the data of the entry stored in blob-keyed table <table>
+// for the <key_size> bytes at <key>.  If no entry exists for the key,  then
+// zero is returned.  The status of the operation is passed back in <status>,
+// unless NULL was passed in for <status>.
+
+cardinal kvs_blob_size_for_key(kvs_blob_table_t table,
+                                     const void *key,
+                                       cardinal key_size,
+                                   kvs_status_t *status) {
+    kvs_blob_entry this_entry;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return 0;
+    } // end if
+    
+    this_entry = _kvs_blob_find_entry(table, key, key_size, NULL, status);
+    
+    if (this_entry == NULL)
+        return 0;
+    
+    return this_entry->size;
+} // end kvs_blob_size_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_data_for_key_is_null_terminated( tbl, key, ksize, st )
+// ---------------------------------------------------------------------------
+//
+// Returns the null-terminated flag of the entry stored in blob-keyed table
+// <table>  for the <key_size> bytes at <key>.  If no entry exists for the key,
+// then false is returned.  The status of the operation is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+bool kvs_blob_data_for_key_is_null_terminated(kvs_blob_table_t table,
+                                                    const void *key,
+                                                      cardinal key_size,
+                                                  kvs_status_t *status) {
+    kvs_blob_entry this_entry;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return false;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return false;
+    } // end if
+    
+    this_entry = _kvs_blob_find_entry(table, key, key_size, NULL, status);
+    
+    if (this_entry == NULL)
+        return false;
+    
+    return this_entry->null_terminated;
+} // end kvs_blob_data_for_key_is_null_terminated
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_reference_count_for_key( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the reference count of the entry stored in blob-keyed table <table>
+// for the <key_size> bytes at <key>.  If no entry exists for the key,  then
+// zero is returned.  The status of the operation is passed back in <status>,
+// unless NULL was passed in for <status>.
+
+cardinal kvs_blob_reference_count_for_key(kvs_blob_table_t table,
+                                                const void *key,
+                                                  cardinal key_size,
+                                              kvs_status_t *status) {
+    kvs_blob_entry this_entry;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return 0;
+    } // end if
+    
+    this_entry = _kvs_blob_find_entry(table, key, key_size, NULL, status);
+    
+    if (this_entry == NULL)
+        return 0;
+    
+    return this_entry->ref_count;
+} // end kvs_blob_reference_count_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_release_entry( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Decrements the reference count of the entry stored in blob-keyed table
+// <table>  for the <key_size> bytes at <key>  as kvs_release_entry() does.
+// The status of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+void kvs_blob_release_entry(kvs_blob_table_t table,
+                                  const void *key,
+                                    cardinal key_size,
+                                kvs_status_t *status) {
+    kvs_blob_entry this_entry;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return;
+    } // end if
+    
+    this_entry = _kvs_blob_find_entry(table, key, key_size, NULL, status);
+    
+    if ((this_entry != NULL) && (this_entry->ref_count > 1)) {
+        this_entry->ref_count--;
+        
+        // remove the entry if this was the last reference to a removed entry
+        if ((this_entry->ref_count == 1) && (this_entry->marked_for_removal))
+            _kvs_blob_remove(table, key, key_size, status);
+        
+    } // end if
+    
+    return;
+} // end kvs_blob_release_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_remove_entry( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Removes or marks for removal the entry stored in blob-keyed table <table>
+// for the <key_size> bytes at <key>  as kvs_remove_entry() does.  The status
+// of the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+void kvs_blob_remove_entry(kvs_blob_table_t table,
+                                 const void *key,
+                                   cardinal key_size,
+                               kvs_status_t *status) {
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // key must not be NULL or empty
+    if (NOT(_kvs_blob_valid_key(key, key_size))) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_KEY);
+        return;
+    } // end if
+    
+    _kvs_blob_remove(table, key, key_size, status);
+    
+    return;
+} // end kvs_blob_remove_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_number_of_buckets( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the number of buckets  of blob-keyed table <table>,  returns zero
+// if NULL is passed in for <table>.
+
+cardinal kvs_blob_number_of_buckets(kvs_blob_table_t table) {
+    
+    if (table == NULL)
+        return 0;
+    
+    return ((kvs_blob_table_s *)table)->bucket_count;
+} // end kvs_blob_number_of_buckets
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_number_of_entries( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the number of entries  stored in blob-keyed table <table>,  returns
+// zero if NULL is passed in for <table>.
+
+cardinal kvs_blob_number_of_entries(kvs_blob_table_t table) {
+    
+    if (table == NULL)
+        return 0;
+    
+    return ((kvs_blob_table_s *)table)->entry_count;
+} // end kvs_blob_number_of_entries
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_dispose_table( table, status )
+// ---------------------------------------------------------------------------
+//
+// Disposes of blob-keyed table object <table>,  deallocating all its entries
+// regardless of any references held to any values stored in the table.  The
+// status of the operation is passed back in <status>,  unless NULL was passed
+// in for <status>.
+
+void kvs_blob_dispose_table(kvs_blob_table_t table, kvs_status_t *status) {
+    kvs_blob_table_s *this_table = (kvs_blob_table_s *) table;
+    kvs_blob_entry this_entry, next_entry;
+    cardinal index;
+    
+    // table must not be NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // dispose of all entries,  keys and values by copy are part of the entry
+    for (index = 0; index < this_table->bucket_count; index++) {
+        this_entry = this_table->bucket[index];
+        while (this_entry != NULL) {
+            next_entry = this_entry->next;
+            DEALLOCATE(this_entry);
+            this_entry = next_entry;
+        } // end while
+    } // end for
+    
+    // dispose of bucket array and table base
+    DEALLOCATE(this_table->bucket);
+    DEALLOCATE(this_table);
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return;
+} // end kvs_blob_dispose_table
+
+
+// ===========================================================================
+// P R I V A T E   F U N C T I O N   I M P L E M E N T A T I O N S
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_valid_key( key, key_size )
+// ---------------------------------------------------------------------------
+//
+// Returns true if <key> is not NULL  and  <key_size> is neither zero nor
+// larger than KVS_BLOB_MAX_KEY_SIZE,  otherwise false.
+
+static fmacro bool _kvs_blob_valid_key(const void *key, cardinal key_size) {
+    
+    return ((key != NULL) && (key_size > 0) &&
+            (key_size <= KVS_BLOB_MAX_KEY_SIZE));
+    
+} // end _kvs_blob_valid_key
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_find_entry( table, key, key_size, prev, st )
+// ---------------------------------------------------------------------------
+//
+// If an entry for the <key_size> bytes at <key> exists in <table>,  then a
+// pointer to the entry is returned,  otherwise NULL.  Entries are compared by
+// hash and key size first,  key bytes are only compared if both are equal.
+// If <prev> is not NULL,  then the predecessor of the entry in its bucket is
+// passed back in <prev>,  or NULL if the entry is first in its bucket,  and
+// the cached last retrieved entry is not consulted.  A found entry is cached.
+// The status of the operation is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+static kvs_blob_entry _kvs_blob_find_entry(kvs_blob_table_s *table,
+                                                  const void *key,
+                                                    cardinal key_size,
+                                              kvs_blob_entry *prev,
+                                                kvs_status_t *status) {
+    kvs_blob_entry prev_entry, this_entry;
+    uint64_t hash;
+    
+    hash = _kvs_blob_hash(key, key_size, table->seed);
+    
+    // check the cached entry first
+    this_entry = table->last_retrieved_entry;
+    if ((prev == NULL) && (this_entry != NULL) &&
+        (this_entry->hash == hash) && (this_entry->key_size == key_size) &&
+        (memcmp(this_entry->key, key, key_size) == 0)) {
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        return this_entry;
+    } // end if
+    
+    // check every entry in this bucket for a match
+    prev_entry = NULL;
+    this_entry = table->bucket[hash & (table->bucket_count - 1)];
+    while ((this_entry != NULL) &&
+           ((this_entry->hash != hash) ||
+            (this_entry->key_size != key_size) ||
+            (memcmp(this_entry->key, key, key_size) != 0))) {
+        prev_entry = this_entry;
+        this_entry = this_entry->next;
+    } // end while
+    
+    if (prev != NULL)
+        *prev = prev_entry;
+    
+    if /* key did not match */ (this_entry == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ENTRY_NOT_FOUND);
+        return NULL;
+    } // end if
+    
+    // cache the entry
+    table->last_retrieved_entry = this_entry;
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return this_entry;
+} // end _kvs_blob_find_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_add_entry( table, key, ksize, val, size, ... )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry for the <key_size> bytes at <key> to <table>,  storing
+// <value> by copy if <by_copy> is true,  otherwise by reference.  The key and
+// a value by copy are placed within the allocation of the entry.  The table
+// grows when its load factor exceeds KVS_RESIZE_LOAD_FACTOR.  The status of
+// the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+static void _kvs_blob_add_entry(kvs_blob_table_s *table,
+                                      const void *key,
+                                        cardinal key_size,
+                                      kvs_data_t value,
+                                        cardinal size,
+                                            bool null_terminated,
+                                            bool by_copy,
+                                    kvs_status_t *status) {
+    kvs_blob_entry new_entry, *bucket;
+    uintptr_t value_addr;
+    uint64_t hash;
+    cardinal alloc_size;
+    
+    hash = _kvs_blob_hash(key, key_size, table->seed);
+    bucket = &table->bucket[hash & (table->bucket_count - 1)];
+    
+    // do not add a new entry if the key is not unique
+    new_entry = *bucket;
+    while (new_entry != NULL) {
+        if ((new_entry->hash == hash) && (new_entry->key_size == key_size) &&
+            (memcmp(new_entry->key, key, key_size) == 0)) {
+            _kvs_set_status(status, KVS_STATUS_KEY_NOT_UNIQUE);
+            return;
+        } // end if
+        new_entry = new_entry->next;
+    } // end while
+    
+    // allocate entry with key and value by copy
+    alloc_size = sizeof(kvs_blob_entry_s) + key_size;
+    if (by_copy)
+        alloc_size = alloc_size + KVS_BLOB_VALUE_ALIGNMENT - 1 + size;
+    
+    new_entry = ALLOCATE(alloc_size);
+    
+    // exit if allocation failed
+    if (new_entry == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return;
+    } // end if
+    
+    // initialise the new entry
+    new_entry->hash = hash;
+    new_entry->key_size = key_size;
+    new_entry->size = size;
+    new_entry->ref_count = 1;
+    new_entry->null_terminated = null_terminated;
+    new_entry->marked_for_removal = false;
+    new_entry->by_copy = by_copy;
+    memcpy(new_entry->key, key, key_size);
+    
+    if /* by copy */ (by_copy) {
+        value_addr = ((uintptr_t) new_entry->key + key_size +
+                      KVS_BLOB_VALUE_ALIGNMENT - 1) &
+                     ~(uintptr_t) (KVS_BLOB_VALUE_ALIGNMENT - 1);
+        new_entry->value = (opaque_t) value_addr;
+        memcpy(new_entry->value, value, size);
+    }
+    else /* by reference */ {
+        new_entry->value = value;
+    } // end if
+    
+    // link the new entry at the head of its bucket
+    new_entry->next = *bucket;
+    *bucket = new_entry;
+    
+    // update the entry counter
+    table->entry_count++;
+    
+    // grow the table if the load factor is exceeded
+    if ((uint64_t) table->entry_count * 100 >
+        (uint64_t) table->bucket_count * KVS_RESIZE_LOAD_FACTOR)
+        _kvs_blob_grow(table);
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return;
+} // end _kvs_blob_add_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_remove( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Removes the entry for the <key_size> bytes at <key> from <table>  if its
+// reference count is one or less,  otherwise marks the entry for removal.  The
+// status of the operation is passed back in <status>,  unless NULL was passed
+// in for <status>.
+
+static void _kvs_blob_remove(kvs_blob_table_s *table,
+                                   const void *key,
+                                     cardinal key_size,
+                                 kvs_status_t *status) {
+    kvs_blob_entry prev_entry, this_entry;
+    
+    this_entry = _kvs_blob_find_entry(table, key, key_size, &prev_entry,
+                                      status);
+    
+    // exit if entry not found
+    if (this_entry == NULL)
+        return;
+    
+    if /* reference count > 1 */ (this_entry->ref_count > 1) {
+        
+        // don't remove the entry yet, mark it for removal
+        this_entry->marked_for_removal = true;
+        
+        _kvs_set_status(status, KVS_STATUS_SUCCESS);
+        return;
+    } // end if
+    
+    // if cached, remove the entry from the cache
+    if (table->last_retrieved_entry == this_entry)
+        table->last_retrieved_entry = NULL;
+    
+    // link predecessor or bucket root to successor
+    if /* first entry */ (prev_entry == NULL)
+        table->bucket[this_entry->hash & (table->bucket_count - 1)] =
+            this_entry->next;
+    else /* not first entry */
+        prev_entry->next = this_entry->next;
+    
+    // deallocate the entry,  key and value by copy are part of it
+    DEALLOCATE(this_entry);
+    
+    // update the entry counter
+    table->entry_count--;
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return;
+} // end _kvs_blob_remove
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_grow( table )
+// ---------------------------------------------------------------------------
+//
+// Doubles the number of buckets of <table>.  Entries are relinked using their
+// stored hash,  keys are not hashed again.  If the new bucket array cannot be
+// allocated,  the table is left unchanged  and growth is attempted again on a
+// subsequent insertion.
+
+static void _kvs_blob_grow(kvs_blob_table_s *table) {
+    kvs_blob_entry this_entry, next_entry, *new_bucket;
+    cardinal index, new_count;
+    
+    // bucket count must remain in range
+    if (table->bucket_count > ((cardinal) 1 << (sizeof(cardinal) * 8 - 2)))
+        return;
+    new_count = table->bucket_count * 2;
+    
+    new_bucket = ALLOCATE(sizeof(kvs_blob_entry) * new_count);
+    
+    // exit if allocation failed
+    if (new_bucket == NULL)
+        return;
+    
+    for (index = 0; index < new_count; index++) {
+        new_bucket[index] = NULL;
+    } // end for
+    
+    // relink every entry into the new bucket array
+    for (index = 0; index < table->bucket_count; index++) {
+        this_entry = table->bucket[index];
+        while (this_entry != NULL) {
+            next_entry = this_entry->next;
+            this_entry->next = new_bucket[this_entry->hash & (new_count - 1)];
+            new_bucket[this_entry->hash & (new_count - 1)] = this_entry;
+            this_entry = next_entry;
+        } // end while
+    } // end for
+    
+    DEALLOCATE(table->bucket);
+    table->bucket = new_bucket;
+    table->bucket_count = new_count;
+    
+    return;
+} // end _kvs_blob_grow
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_hash( key, key_size, seed )
+// ---------------------------------------------------------------------------
+//
+// Returns a 64 bit hash value for the <key_size> bytes at <key>,  seeded with
+// <seed>.  The key is consumed eight bytes at a time,  each word is scrambled
+// and folded into the hash  as in the body of 64 bit MurmurHash3,  and the
+// trailing bytes are zero-padded into a final word.  The result is passed
+// through the MurmurHash3 finaliser.  Words are loaded with memcpy so that
+// keys need not be aligned.
+
+static uint64_t _kvs_blob_hash(const void *key,
+                                 cardinal key_size,
+                                 uint64_t seed) {
+    const octet_t *data = (const octet_t *) key;
+    uint64_t hash, word;
+    cardinal remaining = key_size;
+    
+    hash = seed ^ ((uint64_t) key_size * 0x9e3779b97f4a7c15ULL);
+    
+    // fold full words
+    while (remaining >= sizeof(uint64_t)) {
+        memcpy(&word, data, sizeof(uint64_t));
+        word *= 0x87c37b91114253d5ULL;
+        word = (word << 31) | (word >> 33);
+        word *= 0x4cf5ad432745937fULL;
+        hash ^= word;
+        hash = (hash << 27) | (hash >> 37);
+        hash = hash * 5 + 0x52dce729;
+        data += sizeof(uint64_t);
+        remaining -= sizeof(uint64_t);
+    } // end while
+    
+    // fold trailing bytes
+    if (remaining > 0) {
+        word = 0;
+        memcpy(&word, data, remaining);
+        word *= 0x87c37b91114253d5ULL;
+        word = (word << 31) | (word >> 33);
+        word *= 0x4cf5ad432745937fULL;
+        hash ^= word;
+    } // end if
+    
+    // mix all bits
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    
+    return hash;
+} // end _kvs_blob_hash
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_new_seed( table )
+// ---------------------------------------------------------------------------
+//
+// Returns a new random seed for <table>,  derived from the time,  the
+// processor clock,  the address of the table and a process wide counter.  It
+// is not suitable for cryptographic purposes.
+
+static uint64_t _kvs_blob_new_seed(kvs_blob_table_s *table) {
+    static cardinal counter = 0;
+    uint64_t seed;
+    
+    seed = (uint64_t) time(NULL);
+    seed ^= (uint64_t) clock() << 32;
+    seed ^= (uint64_t) (uintptr_t) table;
+    seed ^= (uint64_t) __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED) *
+            0x9e3779b97f4a7c15ULL;
+    
+    // mix all bits
+    seed ^= seed >> 33;
+    seed *= 0xff51afd7ed558ccdULL;
+    seed ^= seed >> 33;
+    seed *= 0xc4ceb9fe1a85ec53ULL;
+    seed ^= seed >> 33;
+    
+    return seed;
+} // end _kvs_blob_new_seed
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_calc_null_terminated_data_size( data )
+// ---------------------------------------------------------------------------
+//
+// Returns the size of null-terminated <data>  including the terminating zero,
+// or zero if no zero byte is found within KVS_MAX_STRING_SIZE bytes.
+
+static fmacro cardinal _kvs_blob_calc_null_terminated_data_size
+    (kvs_data_t data) {
+    octet_t *_data = (octet_t *) data;
+    cardinal index = 0;
+    
+    while (_data[index] != 0) {
+        if (index < KVS_MAX_STRING_SIZE - 1)
+            index++;
+        else
+            return 0;
+    } // end while
+    
+    return index + 1;
+} // end _kvs_blob_calc_null_terminated_data_size
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_blob_retrieve_copy( entry, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a newly allocated copy of the value of <entry>.  The status of the
+// operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+static fmacro kvs_data_t _kvs_blob_retrieve_copy(kvs_blob_entry entry,
+                                                   kvs_status_t *status) {
+    octet_t *new_copy;
+    
+    // allocate storage for a copy of the data
+    new_copy = ALLOCATE(entry->size);
+    
+    // exit if allocation failed
+    if (new_copy == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // copy data
+    memcpy(new_copy, entry->value, entry->size);
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return (kvs_data_t) new_copy;
+} // end _kvs_blob_retrieve_copy
+
+
+// END OF FILE
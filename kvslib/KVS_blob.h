@@ -0,0 +1,312 @@
+/* Key Value Storage Library
+ *
+ *  @file KVS_blob.h
+ *  Blob-keyed KVS interface
+ *
+ *  Universal Associative Array, keyed by strings and blobs
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef KVS_BLOB_H
+#define KVS_BLOB_H
+
+
+#include "KVS.h"
+
+
+// ---------------------------------------------------------------------------
+// Maximum key size for blob-keyed tables
+// ---------------------------------------------------------------------------
+
+#define KVS_BLOB_MAX_KEY_SIZE (64*1024) /* 64 KBytes */
+
+
+// ---------------------------------------------------------------------------
+// Opaque blob-keyed table handle type
+// ---------------------------------------------------------------------------
+//
+// WARNING:  Objects of this opaque type should  only be accessed through this
+// public interface.  DO NOT EVER attempt to bypass the public interface.
+//
+// The internal data structure of this opaque type is  HIDDEN  and  MAY CHANGE
+// at any time WITHOUT NOTICE.  Accessing the internal data structure directly
+// other than  through the  functions  in this public interface is  UNSAFE and
+// may result in an inconsistent program state or a crash.
+//
+// A blob-keyed table is keyed by arbitrary byte sequences such as strings,
+// rather than by integers.  Keys are copied into the table  and hashed with a
+// seeded 64 bit hash function that consumes eight bytes per step.  The full
+// hash is stored in every entry,  the bytes of two keys are only compared if
+// their hashes and sizes are equal.  The number of buckets is a power of two
+// and grows when the load factor exceeds KVS_RESIZE_LOAD_FACTOR.
+
+typedef opaque_t kvs_blob_table_t;
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_blob_table( size, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new blob-keyed table object  with <size>  number of
+// buckets,  rounded up to the next power of two.  If zero is passed in <size>,
+// then the new table will be created with the default table size  as defined
+// by KVS_DEFAULT_TABLE_SIZE.  Returns NULL if the table could not be created.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_blob_table_t kvs_new_blob_table(cardinal size, kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_store_value( tbl, key, ksize, val, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry for the <key_size> bytes at <key>  to blob-keyed table
+// <table>.  The new entry is stored by value  as kvs_store_value() does.  The
+// key is copied into the entry.  Keys must be unique.  The  status  of  the
+// operation  is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+void kvs_blob_store_value(kvs_blob_table_t table,
+                                const void *key,
+                                  cardinal key_size,
+                                kvs_data_t value,
+                                  cardinal size,
+                                      bool null_terminated,
+                              kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_store_reference( tbl, key, ksize, val, size, nt, st )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry for the <key_size> bytes at <key>  to blob-keyed table
+// <table>.  The new entry is stored by reference  as kvs_store_reference()
+// does.  The key is copied into the entry.  Keys must be unique.  The  status
+// of the operation  is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+void kvs_blob_store_reference(kvs_blob_table_t table,
+                                    const void *key,
+                                      cardinal key_size,
+                                    kvs_data_t value,
+                                      cardinal size,
+                                          bool null_terminated,
+                                  kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_entry_exists( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns true if a valid entry for the <key_size> bytes at <key>  exists in
+// blob-keyed table <table>,  returns false otherwise.  The  status  of  the
+// operation  is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+bool kvs_blob_entry_exists(kvs_blob_table_t table,
+                                 const void *key,
+                                   cardinal key_size,
+                               kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_get_entry( tbl, copy, key, ksize, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in blob-keyed table <table>  for the <key_size>
+// bytes at <key>  either by copy or by reference  as kvs_get_entry() does.
+// The status of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+kvs_data_t kvs_blob_get_entry(kvs_blob_table_t table,
+                                          bool copy,
+                                    const void *key,
+                                      cardinal key_size,
+                                      cardinal *size,
+                                          bool *null_terminated,
+                                  kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_value_for_key( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to a newly allocated copy of the value of the entry stored
+// in blob-keyed table <table>  for the <key_size> bytes at <key>  as
+// kvs_value_for_key() does.  The status of the operation is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+kvs_data_t kvs_blob_value_for_key(kvs_blob_table_t table,
+                                        const void *key,
+                                          cardinal key_size,
+                                      kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_reference_for_key( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the value of the entry stored in blob-keyed table
+// <table>  for the <key_size> bytes at <key>  and increments its reference
+// count  as kvs_reference_for_key() does.  The status of the operation is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+kvs_data_t kvs_blob_reference_for_key(kvs_blob_table_t table,
+                                            const void *key,
+                                              cardinal key_size,
+                                          kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_size_for_key( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the size of the data of the entry stored in blob-keyed table <table>
+// for the <key_size> bytes at <key>.  If no entry exists for the key,  then
+// zero is returned.  The status of the operation is passed back in <status>,
+// unless NULL was passed in for <status>.
+
+cardinal kvs_blob_size_for_key(kvs_blob_table_t table,
+                                     const void *key,
+                                       cardinal key_size,
+                                   kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_data_for_key_is_null_terminated( tbl, key, ksize, st )
+// ---------------------------------------------------------------------------
+//
+// Returns the null-terminated flag of the entry stored in blob-keyed table
+// <table>  for the <key_size> bytes at <key>.  If no entry exists for the key,
+// then false is returned.  The status of the operation is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+bool kvs_blob_data_for_key_is_null_terminated(kvs_blob_table_t table,
+                                                    const void *key,
+                                                      cardinal key_size,
+                                                  kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_reference_count_for_key( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the reference count of the entry stored in blob-keyed table <table>
+// for the <key_size> bytes at <key>.  If no entry exists for the key,  then
+// zero is returned.  The status of the operation is passed back in <status>,
+// unless NULL was passed in for <status>.
+
+cardinal kvs_blob_reference_count_for_key(kvs_blob_table_t table,
+                                                const void *key,
+                                                  cardinal key_size,
+                                              kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_release_entry( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Decrements the reference count of the entry stored in blob-keyed table
+// <table>  for the <key_size> bytes at <key>  as kvs_release_entry() does.
+// The status of the operation  is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+void kvs_blob_release_entry(kvs_blob_table_t table,
+                                  const void *key,
+                                    cardinal key_size,
+                                kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_remove_entry( table, key, key_size, status )
+// ---------------------------------------------------------------------------
+//
+// Removes or marks for removal the entry stored in blob-keyed table <table>
+// for the <key_size> bytes at <key>  as kvs_remove_entry() does.  The status
+// of the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+void kvs_blob_remove_entry(kvs_blob_table_t table,
+                                 const void *key,
+                                   cardinal key_size,
+                               kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_number_of_buckets( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the number of buckets  of blob-keyed table <table>,  returns zero
+// if NULL is passed in for <table>.
+
+cardinal kvs_blob_number_of_buckets(kvs_blob_table_t table);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_number_of_entries( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the number of entries  stored in blob-keyed table <table>,  returns
+// zero if NULL is passed in for <table>.
+
+cardinal kvs_blob_number_of_entries(kvs_blob_table_t table);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_blob_dispose_table( table, status )
+// ---------------------------------------------------------------------------
+//
+// Disposes of blob-keyed table object <table>,  deallocating all its entries
+// regardless of any references held to any values stored in the table.  The
+// status of the operation is passed back in <status>,  unless NULL was passed
+// in for <status>.
+
+void kvs_blob_dispose_table(kvs_blob_table_t table, kvs_status_t *status);
+
+
+#endif /* KVS_BLOB_H */
+
+// END OF FILE
@@ -0,0 +1,710 @@
+/* Key Value Storage Library
+ *
+ *  @file KVS_sharded.c
+ *  Sharded KVS implementation
+ *
+ *  Universal Associative Array, sharded for concurrent use
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include "../common/alloc.h"
+#include "KVS_sharded.h"
+
+
+// ---------------------------------------------------------------------------
+// Thread support
+// ---------------------------------------------------------------------------
+//
+// Shards are locked with POSIX threads mutexes.  Define KVS_NO_THREADS to
+// build without thread support,  shards are then not locked.
+
+#if !defined(KVS_NO_THREADS)
+#include <pthread.h>
+#define KVS_USE_THREADS 1
+#else
+#define KVS_USE_THREADS 0
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Cache line size
+// ---------------------------------------------------------------------------
+
+#ifndef KVS_CACHE_LINE_SIZE
+#define KVS_CACHE_LINE_SIZE 64
+#endif
+
+
+// ---------------------------------------------------------------------------
+// KVS shard type
+// ---------------------------------------------------------------------------
+//
+// Every shard is padded to a multiple of the cache line size  so that locking
+// one shard does not invalidate the cache line of a neighbouring shard.
+
+#if KVS_USE_THREADS
+#define KVS_SHARD_PAYLOAD (sizeof(pthread_mutex_t) + sizeof(kvs_table_t))
+#else
+#define KVS_SHARD_PAYLOAD (sizeof(kvs_table_t))
+#endif
+
+#define KVS_SHARD_PADDING \
+    ((KVS_CACHE_LINE_SIZE - KVS_SHARD_PAYLOAD % KVS_CACHE_LINE_SIZE) % \
+     KVS_CACHE_LINE_SIZE)
+
+typedef struct /* kvs_shard_s */ {
+#if KVS_USE_THREADS
+    pthread_mutex_t lock;
+#endif
+    kvs_table_t table;
+    octet_t padding[KVS_SHARD_PADDING];
+} kvs_shard_s;
+
+
+// ---------------------------------------------------------------------------
+// Sharded KVS table type
+// ---------------------------------------------------------------------------
+
+typedef struct /* kvs_sharded_table_s */ {
+    kvs_shard_s *shard; // cache line aligned shard array
+       cardinal shard_count; // always a power of two
+           void *block; // unaligned allocation holding the shard array
+} kvs_sharded_table_s;
+
+
+// ---------------------------------------------------------------------------
+// Private function prototypes
+// ---------------------------------------------------------------------------
+
+#define _kvs_set_status(_status_p,_code) \
+    { if (_status_p != NULL) *_status_p = _code; }
+
+static fmacro kvs_shard_s *_kvs_shard_for_key
+    (kvs_sharded_table_s *table, kvs_key_t key);
+
+static fmacro void _kvs_lock_shard(kvs_shard_s *shard);
+
+static fmacro void _kvs_unlock_shard(kvs_shard_s *shard);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_sharded_table( shards, size, flags, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new sharded KVS table object  with <shards>  number
+// of shards  and  a total of  <size>  number of buckets  divided evenly among
+// them.  Every shard is created with the storage scheme and options selected
+// by <flags>  as kvs_new_table_with_flags() does.  The number of shards is
+// rounded up to the next power of two,  but not more than
+// KVS_SHARDED_MAX_SHARD_COUNT.  If zero is passed in <shards>,  then the
+// default  as  defined  by  KVS_SHARDED_DEFAULT_SHARD_COUNT  is used.  If zero
+// is passed in <size>,  then every shard is created with the default table
+// size.  Returns NULL if the sharded table object could not be created.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_sharded_table_t kvs_new_sharded_table(cardinal shards,
+                                          cardinal size,
+                                       kvs_flags_t flags,
+                                      kvs_status_t *status) {
+    kvs_sharded_table_s *new_table;
+    cardinal shard_count, shard_size, index;
+    kvs_status_t _status = KVS_STATUS_SUCCESS;
+    void *block;
+    
+    if (shards == 0)
+        shards = KVS_SHARDED_DEFAULT_SHARD_COUNT;
+    else if (shards > KVS_SHARDED_MAX_SHARD_COUNT)
+        shards = KVS_SHARDED_MAX_SHARD_COUNT;
+    
+    // round the number of shards up to a power of two
+    shard_count = 1;
+    while (shard_count < shards)
+        shard_count = shard_count << 1;
+    
+    // divide the buckets among the shards
+    if (size == 0)
+        shard_size = 0;
+    else
+        shard_size = MAX(1, size / shard_count);
+    
+    // allocate new table
+    new_table = ALLOCATE(sizeof(kvs_sharded_table_s));
+    
+    // exit if allocation failed
+    if (new_table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    // allocate shard array,  aligned to cache lines
+    block = ALLOCATE(sizeof(kvs_shard_s) * shard_count + KVS_CACHE_LINE_SIZE);
+    
+    // exit if allocation failed
+    if (block == NULL) {
+        DEALLOCATE(new_table);
+        _kvs_set_status(status, KVS_STATUS_ALLOCATION_FAILED);
+        return NULL;
+    } // end if
+    
+    new_table->block = block;
+    new_table->shard = (kvs_shard_s *)
+        (((uintptr_t) block + KVS_CACHE_LINE_SIZE) &
+         ~(uintptr_t) (KVS_CACHE_LINE_SIZE - 1));
+    new_table->shard_count = shard_count;
+    
+    // create shards
+    for (index = 0; index < shard_count; index++) {
+        new_table->shard[index].table =
+            kvs_new_table_with_flags(shard_size, flags, &_status);
+        
+        if (new_table->shard[index].table == NULL)
+            break;
+        
+#if KVS_USE_THREADS
+        if (pthread_mutex_init(&new_table->shard[index].lock, NULL) != 0) {
+            kvs_dispose_table(new_table->shard[index].table, NULL);
+            _status = KVS_STATUS_ALLOCATION_FAILED;
+            break;
+        } // end if
+#endif
+    } // end for
+    
+    // exit if any shard could not be created
+    if (index < shard_count) {
+        while (index > 0) {
+            index--;
+            kvs_dispose_table(new_table->shard[index].table, NULL);
+#if KVS_USE_THREADS
+            pthread_mutex_destroy(&new_table->shard[index].lock);
+#endif
+        } // end while
+        DEALLOCATE(block);
+        DEALLOCATE(new_table);
+        _kvs_set_status(status, _status);
+        return NULL;
+    } // end if
+    
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    return (kvs_sharded_table_t) new_table;
+} // end kvs_new_sharded_table
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_store_value( tbl, key, val, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to sharded table <table>  by value  as
+// kvs_store_value() does.  The  status  of  the operation  is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+void kvs_sharded_store_value(kvs_sharded_table_t table,
+                                       kvs_key_t key,
+                                      kvs_data_t value,
+                                        cardinal size,
+                                            bool null_terminated,
+                                    kvs_status_t *status) {
+    kvs_shard_s *shard;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    kvs_store_value(shard->table, key, value, size, null_terminated, status);
+    _kvs_unlock_shard(shard);
+    
+    return;
+} // end kvs_sharded_store_value
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_store_reference( tbl, key, val, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to sharded table <table>  by reference  as
+// kvs_store_reference() does.  The status of the operation  is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+void kvs_sharded_store_reference(kvs_sharded_table_t table,
+                                           kvs_key_t key,
+                                          kvs_data_t value,
+                                            cardinal size,
+                                                bool null_terminated,
+                                        kvs_status_t *status) {
+    kvs_shard_s *shard;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    kvs_store_reference(shard->table, key, value, size, null_terminated,
+                        status);
+    _kvs_unlock_shard(shard);
+    
+    return;
+} // end kvs_sharded_store_reference
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_entry_exists( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns  true  if a  valid entry  for <key> exists  in sharded table <table>,
+// returns false otherwise.  The  status  of the operation  is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+bool kvs_sharded_entry_exists(kvs_sharded_table_t table,
+                                        kvs_key_t key,
+                                     kvs_status_t *status) {
+    kvs_shard_s *shard;
+    bool result;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return false;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    result = kvs_entry_exists(shard->table, key, status);
+    _kvs_unlock_shard(shard);
+    
+    return result;
+} // end kvs_sharded_entry_exists
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_get_entry( tbl, copy, key, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in sharded table <table> for <key>  either by copy
+// or by reference  as kvs_get_entry() does.  The status of the operation  is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+kvs_data_t kvs_sharded_get_entry(kvs_sharded_table_t table,
+                                                bool copy,
+                                           kvs_key_t key,
+                                            cardinal *size,
+                                                bool *null_terminated,
+                                        kvs_status_t *status) {
+    kvs_shard_s *shard;
+    kvs_data_t result;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return NULL;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    result = kvs_get_entry(shard->table, copy, key, size, null_terminated,
+                           status);
+    _kvs_unlock_shard(shard);
+    
+    return result;
+} // end kvs_sharded_get_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_value_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to a newly allocated copy of the value of the entry stored
+// in sharded table <table> for <key>  as kvs_value_for_key() does.  The status
+// of the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+kvs_data_t kvs_sharded_value_for_key(kvs_sharded_table_t table,
+                                               kvs_key_t key,
+                                            kvs_status_t *status) {
+    
+    return kvs_sharded_get_entry(table, true, key, NULL, NULL, status);
+    
+} // end kvs_sharded_value_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_reference_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the value of the entry stored in sharded table <table>
+// for <key>  and increments its reference count  as kvs_reference_for_key()
+// does.  The status of the operation is passed back in <status>,  unless NULL
+// was passed in for <status>.
+
+kvs_data_t kvs_sharded_reference_for_key(kvs_sharded_table_t table,
+                                                   kvs_key_t key,
+                                                kvs_status_t *status) {
+    
+    return kvs_sharded_get_entry(table, false, key, NULL, NULL, status);
+    
+} // end kvs_sharded_reference_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_size_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns  the size of the data of the entry stored in sharded table <table>
+// for <key>.  If no entry exists for <key>,  then zero is returned.  The status
+// of the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+cardinal kvs_sharded_size_for_key(kvs_sharded_table_t table,
+                                            kvs_key_t key,
+                                         kvs_status_t *status) {
+    kvs_shard_s *shard;
+    cardinal result;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    result = kvs_size_for_key(shard->table, key, status);
+    _kvs_unlock_shard(shard);
+    
+    return result;
+} // end kvs_sharded_size_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_data_for_key_is_null_terminated( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the  null-terminated flag of the entry stored in sharded table
+// <table> for <key>.  If no entry exists for <key>,  then  false  is returned.
+// The status of the operation is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+bool kvs_sharded_data_for_key_is_null_terminated(kvs_sharded_table_t table,
+                                                           kvs_key_t key,
+                                                        kvs_status_t *status) {
+    kvs_shard_s *shard;
+    bool result;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return false;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    result = kvs_data_for_key_is_null_terminated(shard->table, key, status);
+    _kvs_unlock_shard(shard);
+    
+    return result;
+} // end kvs_sharded_data_for_key_is_null_terminated
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_reference_count_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the  reference count  of the entry stored in sharded table <table>
+// for <key>.  If no entry exists for <key>,  then zero is returned.  The status
+// of the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+cardinal kvs_sharded_reference_count_for_key(kvs_sharded_table_t table,
+                                                       kvs_key_t key,
+                                                    kvs_status_t *status) {
+    kvs_shard_s *shard;
+    cardinal result;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return 0;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    result = kvs_reference_count_for_key(shard->table, key, status);
+    _kvs_unlock_shard(shard);
+    
+    return result;
+} // end kvs_sharded_reference_count_for_key
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_release_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Decrements the reference count of the entry stored in sharded table <table>
+// for <key>  as kvs_release_entry() does.  The status of the operation  is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+void kvs_sharded_release_entry(kvs_sharded_table_t table,
+                                         kvs_key_t key,
+                                      kvs_status_t *status) {
+    kvs_shard_s *shard;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    kvs_release_entry(shard->table, key, status);
+    _kvs_unlock_shard(shard);
+    
+    return;
+} // end kvs_sharded_release_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_remove_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Removes or marks for removal the entry stored in sharded table <table> for
+// <key>  as kvs_remove_entry() does.  The status of the operation  is passed
+// back in <status>,  unless NULL was passed in for <status>.
+
+void kvs_sharded_remove_entry(kvs_sharded_table_t table,
+                                        kvs_key_t key,
+                                     kvs_status_t *status) {
+    kvs_shard_s *shard;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    shard = _kvs_shard_for_key(table, key);
+    
+    _kvs_lock_shard(shard);
+    kvs_remove_entry(shard->table, key, status);
+    _kvs_unlock_shard(shard);
+    
+    return;
+} // end kvs_sharded_remove_entry
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_number_of_shards( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the number of shards  of sharded table <table>,  returns zero if
+// NULL is passed in for <table>.
+
+cardinal kvs_sharded_number_of_shards(kvs_sharded_table_t table) {
+    
+    if (table == NULL)
+        return 0;
+    
+    return ((kvs_sharded_table_s *)table)->shard_count;
+} // end kvs_sharded_number_of_shards
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_number_of_buckets( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the total number of buckets  of all shards of sharded table
+// <table>,  returns zero if NULL is passed in for <table>.
+
+cardinal kvs_sharded_number_of_buckets(kvs_sharded_table_t table) {
+    kvs_sharded_table_s *this_table = (kvs_sharded_table_s *) table;
+    cardinal index, count = 0;
+    
+    if (table == NULL)
+        return 0;
+    
+    for (index = 0; index < this_table->shard_count; index++) {
+        _kvs_lock_shard(&this_table->shard[index]);
+        count = count + kvs_number_of_buckets(this_table->shard[index].table);
+        _kvs_unlock_shard(&this_table->shard[index]);
+    } // end for
+    
+    return count;
+} // end kvs_sharded_number_of_buckets
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_number_of_entries( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the total number of entries  stored in all shards of sharded table
+// <table>,  returns zero if NULL is passed in for <table>.  Every shard is
+// counted under its lock,  but shards are counted one after another.
+
+cardinal kvs_sharded_number_of_entries(kvs_sharded_table_t table) {
+    kvs_sharded_table_s *this_table = (kvs_sharded_table_s *) table;
+    cardinal index, count = 0;
+    
+    if (table == NULL)
+        return 0;
+    
+    for (index = 0; index < this_table->shard_count; index++) {
+        _kvs_lock_shard(&this_table->shard[index]);
+        count = count + kvs_number_of_entries(this_table->shard[index].table);
+        _kvs_unlock_shard(&this_table->shard[index]);
+    } // end for
+    
+    return count;
+} // end kvs_sharded_number_of_entries
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_dispose_table( table, status )
+// ---------------------------------------------------------------------------
+//
+// Disposes of sharded table object <table>  and all its shards,  deallocating
+// all entries  regardless of any references held.  No other thread may use the
+// table  while it is disposed of.  The status of the operation is passed back
+// in <status>,  unless  NULL  was passed in for <status>.
+
+void kvs_sharded_dispose_table(kvs_sharded_table_t table,
+                                      kvs_status_t *status) {
+    kvs_sharded_table_s *this_table = (kvs_sharded_table_s *) table;
+    cardinal index;
+    
+    // bail out if table is NULL
+    if (table == NULL) {
+        _kvs_set_status(status, KVS_STATUS_INVALID_TABLE);
+        return;
+    } // end if
+    
+    // dispose of shards
+    for (index = 0; index < this_table->shard_count; index++) {
+        kvs_dispose_table(this_table->shard[index].table, NULL);
+#if KVS_USE_THREADS
+        pthread_mutex_destroy(&this_table->shard[index].lock);
+#endif
+    } // end for
+    
+    // dispose of shard array and table base
+    DEALLOCATE(this_table->block);
+    DEALLOCATE(this_table);
+    
+    // set status
+    _kvs_set_status(status, KVS_STATUS_SUCCESS);
+    
+    return;
+} // end kvs_sharded_dispose_table
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_shard_for_key( table, key )
+// ---------------------------------------------------------------------------
+//
+// Returns the shard of <table> for <key>.  Keys are scrambled by Fibonacci
+// hashing  and the shard is selected by the upper half of the product,  so
+// that the lower bits which select the bucket within each shard are not the
+// same for all keys of a shard.
+
+static fmacro kvs_shard_s *_kvs_shard_for_key(kvs_sharded_table_s *table,
+                                                          kvs_key_t key) {
+    uint64_t hash;
+    
+    hash = (uint64_t) key * 0x9E3779B97F4A7C15ULL;
+    
+    return &table->shard[(hash >> 32) & (table->shard_count - 1)];
+} // end _kvs_shard_for_key
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_lock_shard( shard )
+// ---------------------------------------------------------------------------
+//
+// Acquires the lock of <shard>.  Does nothing when built without threads.
+
+static fmacro void _kvs_lock_shard(kvs_shard_s *shard) {
+    
+#if KVS_USE_THREADS
+    pthread_mutex_lock(&shard->lock);
+#else
+    (void) shard;
+#endif
+    
+    return;
+} // end _kvs_lock_shard
+
+
+// ---------------------------------------------------------------------------
+// private function:  _kvs_unlock_shard( shard )
+// ---------------------------------------------------------------------------
+//
+// Releases the lock of <shard>.  Does nothing when built without threads.
+
+static fmacro void _kvs_unlock_shard(kvs_shard_s *shard) {
+    
+#if KVS_USE_THREADS
+    pthread_mutex_unlock(&shard->lock);
+#else
+    (void) shard;
+#endif
+    
+    return;
+} // end _kvs_unlock_shard
+
+
+// END OF FILE
@@ -0,0 +1,320 @@
+/* Key Value Storage Library
+ *
+ *  @file KVS_sharded.h
+ *  Sharded KVS interface
+ *
+ *  Universal Associative Array, sharded for concurrent use
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef KVS_SHARDED_H
+#define KVS_SHARDED_H
+
+
+#include "KVS.h"
+
+
+// ---------------------------------------------------------------------------
+// Default number of shards
+// ---------------------------------------------------------------------------
+
+#define KVS_SHARDED_DEFAULT_SHARD_COUNT 16
+
+
+// ---------------------------------------------------------------------------
+// Maximum number of shards
+// ---------------------------------------------------------------------------
+
+#define KVS_SHARDED_MAX_SHARD_COUNT 1024
+
+
+// ---------------------------------------------------------------------------
+// Opaque sharded key-value table handle type
+// ---------------------------------------------------------------------------
+//
+// WARNING:  Objects of this opaque type should  only be accessed through this
+// public interface.  DO NOT EVER attempt to bypass the public interface.
+//
+// The internal data structure of this opaque type is  HIDDEN  and  MAY CHANGE
+// at any time WITHOUT NOTICE.  Accessing the internal data structure directly
+// other than  through the  functions  in this public interface is  UNSAFE and
+// may result in an inconsistent program state or a crash.
+//
+// A sharded table distributes its keys over a number of independent KVS tables
+// called shards.  Every shard has its own lock  and its own cache of the last
+// retrieved entry,  and shards are aligned to cache lines.  Threads operating
+// on keys in different shards do not contend with one another.  Unless built
+// with KVS_NO_THREADS,  all functions except kvs_sharded_dispose_table() may
+// be called by multiple threads at once.
+
+typedef opaque_t kvs_sharded_table_t;
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_new_sharded_table( shards, size, flags, status )
+// ---------------------------------------------------------------------------
+//
+// Creates  and returns  a new sharded KVS table object  with <shards>  number
+// of shards  and  a total of  <size>  number of buckets  divided evenly among
+// them.  Every shard is created with the storage scheme and options selected
+// by <flags>  as kvs_new_table_with_flags() does.  The number of shards is
+// rounded up to the next power of two,  but not more than
+// KVS_SHARDED_MAX_SHARD_COUNT.  If zero is passed in <shards>,  then the
+// default  as  defined  by  KVS_SHARDED_DEFAULT_SHARD_COUNT  is used.  If zero
+// is passed in <size>,  then every shard is created with the default table
+// size.  Returns NULL if the sharded table object could not be created.
+//
+// The status of the operation  is passed back in <status>,  unless  NULL  was
+// passed in for <status>.
+
+kvs_sharded_table_t kvs_new_sharded_table(cardinal shards,
+                                          cardinal size,
+                                       kvs_flags_t flags,
+                                      kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_store_value( tbl, key, val, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to sharded table <table>  by value  as
+// kvs_store_value() does.  The  status  of  the operation  is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+void kvs_sharded_store_value(kvs_sharded_table_t table,
+                                       kvs_key_t key,
+                                      kvs_data_t value,
+                                        cardinal size,
+                                            bool null_terminated,
+                                    kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_store_reference( tbl, key, val, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Adds a new entry  for key <key>  to sharded table <table>  by reference  as
+// kvs_store_reference() does.  The status of the operation  is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+void kvs_sharded_store_reference(kvs_sharded_table_t table,
+                                           kvs_key_t key,
+                                          kvs_data_t value,
+                                            cardinal size,
+                                                bool null_terminated,
+                                        kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_entry_exists( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns  true  if a  valid entry  for <key> exists  in sharded table <table>,
+// returns false otherwise.  The  status  of the operation  is passed back in
+// <status>,  unless NULL was passed in for <status>.
+
+bool kvs_sharded_entry_exists(kvs_sharded_table_t table,
+                                        kvs_key_t key,
+                                     kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_get_entry( tbl, copy, key, size, nt, status )
+// ---------------------------------------------------------------------------
+//
+// Retrieves the entry stored in sharded table <table> for <key>  either by copy
+// or by reference  as kvs_get_entry() does.  The status of the operation  is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+kvs_data_t kvs_sharded_get_entry(kvs_sharded_table_t table,
+                                                bool copy,
+                                           kvs_key_t key,
+                                            cardinal *size,
+                                                bool *null_terminated,
+                                        kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_value_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to a newly allocated copy of the value of the entry stored
+// in sharded table <table> for <key>  as kvs_value_for_key() does.  The status
+// of the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+kvs_data_t kvs_sharded_value_for_key(kvs_sharded_table_t table,
+                                               kvs_key_t key,
+                                            kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_reference_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns a pointer to the value of the entry stored in sharded table <table>
+// for <key>  and increments its reference count  as kvs_reference_for_key()
+// does.  The status of the operation is passed back in <status>,  unless NULL
+// was passed in for <status>.
+
+kvs_data_t kvs_sharded_reference_for_key(kvs_sharded_table_t table,
+                                                   kvs_key_t key,
+                                                kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_size_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns  the size of the data of the entry stored in sharded table <table>
+// for <key>.  If no entry exists for <key>,  then zero is returned.  The status
+// of the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+cardinal kvs_sharded_size_for_key(kvs_sharded_table_t table,
+                                            kvs_key_t key,
+                                         kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_data_for_key_is_null_terminated( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the  null-terminated flag of the entry stored in sharded table
+// <table> for <key>.  If no entry exists for <key>,  then  false  is returned.
+// The status of the operation is passed back in <status>,  unless NULL was
+// passed in for <status>.
+
+bool kvs_sharded_data_for_key_is_null_terminated(kvs_sharded_table_t table,
+                                                           kvs_key_t key,
+                                                        kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_reference_count_for_key( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Returns the  reference count  of the entry stored in sharded table <table>
+// for <key>.  If no entry exists for <key>,  then zero is returned.  The status
+// of the operation is passed back in <status>,  unless NULL was passed in for
+// <status>.
+
+cardinal kvs_sharded_reference_count_for_key(kvs_sharded_table_t table,
+                                                       kvs_key_t key,
+                                                    kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_release_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Decrements the reference count of the entry stored in sharded table <table>
+// for <key>  as kvs_release_entry() does.  The status of the operation  is
+// passed back in <status>,  unless NULL was passed in for <status>.
+
+void kvs_sharded_release_entry(kvs_sharded_table_t table,
+                                         kvs_key_t key,
+                                      kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_remove_entry( table, key, status )
+// ---------------------------------------------------------------------------
+//
+// Removes or marks for removal the entry stored in sharded table <table> for
+// <key>  as kvs_remove_entry() does.  The status of the operation  is passed
+// back in <status>,  unless NULL was passed in for <status>.
+
+void kvs_sharded_remove_entry(kvs_sharded_table_t table,
+                                        kvs_key_t key,
+                                     kvs_status_t *status);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_number_of_shards( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the number of shards  of sharded table <table>,  returns zero if
+// NULL is passed in for <table>.
+
+cardinal kvs_sharded_number_of_shards(kvs_sharded_table_t table);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_number_of_buckets( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the total number of buckets  of all shards of sharded table
+// <table>,  returns zero if NULL is passed in for <table>.
+
+cardinal kvs_sharded_number_of_buckets(kvs_sharded_table_t table);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_number_of_entries( table )
+// ---------------------------------------------------------------------------
+//
+// Returns  the total number of entries  stored in all shards of sharded table
+// <table>,  returns zero if NULL is passed in for <table>.  Every shard is
+// counted under its lock,  but shards are counted one after another.
+
+cardinal kvs_sharded_number_of_entries(kvs_sharded_table_t table);
+
+
+// ---------------------------------------------------------------------------
+// function:  kvs_sharded_dispose_table( table, status )
+// ---------------------------------------------------------------------------
+//
+// Disposes of sharded table object <table>  and all its shards,  deallocating
+// all entries  regardless of any references held.  No other thread may use the
+// table  while it is disposed of.  The status of the operation is passed back
+// in <status>,  unless  NULL  was passed in for <status>.
+
+void kvs_sharded_dispose_table(kvs_sharded_table_t table,
+                                      kvs_status_t *status);
+
+
+#endif /* KVS_SHARDED_H */
+
+// END OF FILE
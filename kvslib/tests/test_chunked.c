@@ -0,0 +1,325 @@
+/* Key Value Storage Library
+ *
+ *  @file test_chunked.c
+ *  Chunked value test
+ *
+ *  Tests iteration and snapshots of KVS tables holding chunked values
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+// ---------------------------------------------------------------------------
+// Build
+// ---------------------------------------------------------------------------
+//
+//  cc -std=c99 test_chunked.c -lpthread
+//
+// The library is included  so that its allocation macros can be replaced  to
+// make copies of chunked values fail  and to gather pinned entries directly.
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+
+#define ALLOC_H
+
+static size_t largest_allowed = (size_t) -1;
+
+#define ALLOCATE(_size) \
+    (((size_t) (_size) > largest_allowed) ? NULL : malloc(_size))
+#define REALLOCATE(_pointer, _size) realloc(_pointer, _size)
+#define DEALLOCATE(_pointer) free(_pointer)
+
+#include "../KVS.c"
+#include "test.h"
+
+
+// ---------------------------------------------------------------------------
+// Test parameters
+// ---------------------------------------------------------------------------
+
+#define SNAPSHOT_PATH "kvs_test_chunked.tmp"
+
+#define LARGE_COUNT 5
+
+#define LARGE_SIZE (300 * 1024)
+
+#define COPY_LIMIT (200 * 1024) /* allocations larger than this fail */
+
+#define SMALL_KEY 100
+
+#define FLAG_SET_COUNT 3
+
+static const kvs_flags_t flag_set[FLAG_SET_COUNT] = {
+    KVS_FLAG_CHUNKED_VALUES,
+    KVS_FLAG_CHUNKED_VALUES | KVS_FLAG_CONCURRENT,
+    KVS_FLAG_CHUNKED_VALUES | KVS_FLAG_OPEN_ADDRESSING
+};
+
+static char large_value[LARGE_SIZE];
+
+
+// ---------------------------------------------------------------------------
+// private function:  new_chunked_table( flags )
+// ---------------------------------------------------------------------------
+//
+// Returns a new table with <flags>  holding LARGE_COUNT chunked values under
+// keys 1 and up  and one small value under key SMALL_KEY.
+
+static kvs_table_t new_chunked_table(kvs_flags_t flags) {
+    kvs_table_t table;
+    kvs_status_t status;
+    kvs_key_t key;
+    
+    table = kvs_new_table_with_flags(64, flags, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    for (key = 1; key <= LARGE_COUNT; key++) {
+        kvs_store_value(table, key, large_value, LARGE_SIZE, true, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    } // end for
+    
+    kvs_store_value(table, SMALL_KEY, "small", 0, true, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    return table;
+} // end new_chunked_table
+
+
+// ---------------------------------------------------------------------------
+// private function:  count_entry( key, value, size, null_terminated, count )
+// ---------------------------------------------------------------------------
+//
+// Iteration action that counts the entries visited in <count>.
+
+static void count_entry(kvs_key_t key,
+                       kvs_data_t value,
+                         cardinal size,
+                             bool null_terminated,
+                             void *count) {
+    
+    (void) key;
+    (void) value;
+    (void) size;
+    (void) null_terminated;
+    __atomic_add_fetch((cardinal *) count, 1, __ATOMIC_RELAXED);
+    
+    return;
+} // end count_entry
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_failed_copies( flags )
+// ---------------------------------------------------------------------------
+//
+// Iterates over a table with <flags>  while the copies of its chunked values
+// cannot be allocated.  Checks that the entries not copied are skipped  and
+// that the failure is passed back.
+
+static void test_failed_copies(kvs_flags_t flags) {
+    kvs_table_t table;
+    kvs_status_t status;
+    cardinal count, visited;
+    
+    table = new_chunked_table(flags);
+    
+    count = 0;
+    largest_allowed = COPY_LIMIT;
+    visited = kvs_foreach(table, count_entry, &count, &status);
+    largest_allowed = (size_t) -1;
+    TEST_CHECK(status == KVS_STATUS_ALLOCATION_FAILED);
+    TEST_CHECK((visited == 1) && (count == 1));
+    
+    count = 0;
+    largest_allowed = COPY_LIMIT;
+    visited = kvs_parallel_foreach(table, count_entry, &count, 4, &status);
+    largest_allowed = (size_t) -1;
+    TEST_CHECK(status == KVS_STATUS_ALLOCATION_FAILED);
+    TEST_CHECK((visited == 1) && (count == 1));
+    
+    kvs_dispose_table(table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    return;
+} // end test_failed_copies
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_save_in_place( flags )
+// ---------------------------------------------------------------------------
+//
+// Saves a table with <flags>  while the copies of its chunked values cannot
+// be allocated.  Checks that the chunks are written in place,  that all pins
+// are released afterwards  and that the snapshot holds every value.
+
+static void test_save_in_place(kvs_flags_t flags) {
+    kvs_table_t table, snapshot;
+    kvs_status_t status;
+    cardinal size;
+    bool null_terminated;
+    kvs_key_t key;
+    char *value;
+    
+    table = new_chunked_table(flags);
+    
+    largest_allowed = COPY_LIMIT;
+    kvs_save_snapshot(table, SNAPSHOT_PATH, &status);
+    largest_allowed = (size_t) -1;
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    for (key = 1; key <= LARGE_COUNT; key++) {
+        TEST_CHECK(kvs_reference_count_for_key(table, key, &status) == 1);
+    } // end for
+    
+    snapshot = kvs_open_snapshot(SNAPSHOT_PATH, &status);
+    TEST_CHECK(snapshot != NULL);
+    TEST_CHECK(kvs_number_of_entries(snapshot) == LARGE_COUNT + 1);
+    
+    for (key = 1; key <= LARGE_COUNT; key++) {
+        value = kvs_get_entry(snapshot, false, key, &size,
+                              &null_terminated, &status);
+        TEST_CHECK(value != NULL);
+        TEST_CHECK(size == LARGE_SIZE);
+        TEST_CHECK(memcmp(value, large_value, LARGE_SIZE) == 0);
+    } // end for
+    
+    kvs_dispose_table(snapshot, NULL);
+    kvs_dispose_table(table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    remove(SNAPSHOT_PATH);
+    
+    return;
+} // end test_save_in_place
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_removed_while_pinned( flags )
+// ---------------------------------------------------------------------------
+//
+// Gathers the entries of a table with <flags>  as a save does  and removes
+// the chunked ones  before their chunks would be written.  Checks that the
+// chunks of the pinned entries remain intact  and that the entries are only
+// removed once the gathered items are released.
+
+static void test_removed_while_pinned(kvs_flags_t flags) {
+    kvs_table_t table;
+    kvs_table_s *this_table;
+    kvs_snapshot_item_s *item;
+    kvs_status_t status;
+    cardinal index, count, offset;
+    kvs_chunk this_chunk;
+    kvs_key_t key;
+    
+    table = new_chunked_table(flags);
+    this_table = (kvs_table_s *) table;
+    
+    item = _kvs_snapshot_collect(this_table, &count, &status);
+    TEST_CHECK(item != NULL);
+    TEST_CHECK(count == LARGE_COUNT + 1);
+    
+    for (key = 1; key <= LARGE_COUNT; key++) {
+        kvs_remove_entry(table, key, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    } // end for
+    TEST_CHECK(kvs_number_of_entries(table) == LARGE_COUNT + 1);
+    
+    // the chunks of removed entries are kept while pinned
+    for (index = 0; index < count; index++) {
+        if (item[index].key == SMALL_KEY) {
+            TEST_CHECK(item[index].entry == NULL);
+            continue;
+        } // end if
+        
+        TEST_CHECK(item[index].entry != NULL);
+        TEST_CHECK(item[index].size == LARGE_SIZE);
+        
+        offset = 0;
+        this_chunk = (kvs_chunk) item[index].entry->value;
+        while (this_chunk != NULL) {
+            TEST_CHECK(offset + this_chunk->size <= LARGE_SIZE);
+            TEST_CHECK(memcmp(this_chunk->data, large_value + offset,
+                              this_chunk->size) == 0);
+            offset = offset + this_chunk->size;
+            this_chunk = this_chunk->next;
+        } // end while
+        TEST_CHECK(offset == LARGE_SIZE);
+    } // end for
+    
+    _kvs_snapshot_release(this_table, item, count);
+    DEALLOCATE(item);
+    TEST_CHECK(kvs_number_of_entries(table) == 1);
+    
+    kvs_dispose_table(table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    return;
+} // end test_removed_while_pinned
+
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+int main(void) {
+    cardinal index;
+    
+    for (index = 0; index < LARGE_SIZE - 1; index++) {
+        large_value[index] = 'a' + index % 26;
+    } // end for
+    large_value[LARGE_SIZE - 1] = 0;
+    
+    for (index = 0; index < FLAG_SET_COUNT; index++) {
+        test_failed_copies(flag_set[index]);
+        test_save_in_place(flag_set[index]);
+        test_removed_while_pinned(flag_set[index]);
+    } // end for
+    
+    TEST_PASSED("test_chunked");
+    
+    return EXIT_SUCCESS;
+} // end main
+
+// END OF FILE
@@ -0,0 +1,244 @@
+/* Key Value Storage Library
+ *
+ *  @file test_concurrent.c
+ *  Concurrent table test
+ *
+ *  Tests epoch reclamation of concurrent KVS tables when memory runs out
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+// ---------------------------------------------------------------------------
+// Build
+// ---------------------------------------------------------------------------
+//
+//  cc -std=c99 test_concurrent.c -lpthread
+//
+// The library is included  so that its allocation macros can be replaced  to
+// make limbo lists fail to grow  and to count the blocks still allocated.
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define ALLOC_H
+
+static long live_blocks = 0;
+
+static int fail_reallocate = 0;
+
+static void *test_allocate(size_t size) {
+    void *block;
+    
+    block = malloc(size);
+    if (block != NULL)
+        __atomic_add_fetch(&live_blocks, 1, __ATOMIC_RELAXED);
+    
+    return block;
+} // end test_allocate
+
+static void *test_reallocate(void *pointer, size_t size) {
+    void *block;
+    
+    if (__atomic_load_n(&fail_reallocate, __ATOMIC_RELAXED))
+        return NULL;
+    
+    block = realloc(pointer, size);
+    if ((block != NULL) && (pointer == NULL))
+        __atomic_add_fetch(&live_blocks, 1, __ATOMIC_RELAXED);
+    
+    return block;
+} // end test_reallocate
+
+static void test_deallocate(void *pointer) {
+    
+    if (pointer != NULL)
+        __atomic_sub_fetch(&live_blocks, 1, __ATOMIC_RELAXED);
+    free(pointer);
+    
+    return;
+} // end test_deallocate
+
+#define ALLOCATE(_size) test_allocate(_size)
+#define REALLOCATE(_pointer, _size) test_reallocate(_pointer, _size)
+#define DEALLOCATE(_pointer) test_deallocate(_pointer)
+
+#include "../KVS.c"
+#include "test.h"
+
+
+// ---------------------------------------------------------------------------
+// Test parameters
+// ---------------------------------------------------------------------------
+
+#define READER_COUNT 4
+
+#define KEY_COUNT 2000
+
+#define ROUND_COUNT 20
+
+#define TIMEOUT 120 /* seconds,  a stalled writer fails the test */
+
+
+// ---------------------------------------------------------------------------
+// private function:  reader( argument )
+// ---------------------------------------------------------------------------
+//
+// Looks up all keys of the shared table over and over  until told to stop,
+// so that readers are active in every epoch.
+
+static kvs_table_t shared_table;
+
+static int stop_readers = 0;
+
+static void *reader(void *argument) {
+    kvs_status_t status;
+    kvs_key_t key;
+    
+    (void) argument;
+    
+    while (NOT(__atomic_load_n(&stop_readers, __ATOMIC_RELAXED))) {
+        for (key = 1; key <= KEY_COUNT; key++) {
+            kvs_size_for_key(shared_table, key, &status);
+        } // end for
+    } // end while
+    
+    return NULL;
+} // end reader
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_limbo_overflow()
+// ---------------------------------------------------------------------------
+//
+// Removes entries from a concurrent table  while readers are active,  with
+// the limbo lists unable to grow in every other round.  Every second entry
+// is pinned when removed  and retired by its release,  from within the epoch
+// of the releasing thread.  Checks that no writer waits for the readers  and
+// that every entry retired is deallocated by the time the table is disposed
+// of.
+
+static void test_limbo_overflow(void) {
+    pthread_t thread[READER_COUNT];
+    kvs_concurrency_s *cc;
+    kvs_status_t status;
+    cardinal index, round;
+    bool overflowed = false;
+    kvs_key_t key;
+    char value[32];
+    
+    shared_table =
+        kvs_new_table_with_flags(1024, KVS_FLAG_CONCURRENT, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    cc = ((kvs_table_s *) shared_table)->cc;
+    
+    for (index = 0; index < READER_COUNT; index++) {
+        TEST_CHECK(pthread_create(&thread[index], NULL, reader, NULL) == 0);
+    } // end for
+    
+    for (round = 0; round < ROUND_COUNT; round++) {
+        for (key = 1; key <= KEY_COUNT; key++) {
+            sprintf(value, "value %u", (unsigned) key);
+            kvs_store_value(shared_table, key, value, 0, true, &status);
+            TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        } // end for
+        
+        __atomic_store_n(&fail_reallocate, round % 2, __ATOMIC_RELAXED);
+        
+        for (key = 1; key <= KEY_COUNT; key++) {
+            if (key % 2 == 0) {
+                TEST_CHECK(kvs_reference_for_key(shared_table, key, &status)
+                           != NULL);
+                kvs_remove_entry(shared_table, key, &status);
+                TEST_CHECK(status == KVS_STATUS_SUCCESS);
+                kvs_release_entry(shared_table, key, &status);
+            }
+            else {
+                kvs_remove_entry(shared_table, key, &status);
+            } // end if
+            TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        } // end for
+        
+        for (index = 0; index < 3; index++) {
+            if (cc->limbo_overflow[index] != NULL)
+                overflowed = true;
+        } // end for
+        
+        __atomic_store_n(&fail_reallocate, 0, __ATOMIC_RELAXED);
+        TEST_CHECK(kvs_number_of_entries(shared_table) == 0);
+    } // end for
+    
+    __atomic_store_n(&stop_readers, 1, __ATOMIC_RELAXED);
+    for (index = 0; index < READER_COUNT; index++) {
+        pthread_join(thread[index], NULL);
+    } // end for
+    
+    // the overflow lists must have been used  and emptied
+    TEST_CHECK(overflowed);
+    kvs_dispose_table(shared_table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    TEST_CHECK(live_blocks == 0);
+    
+    return;
+} // end test_limbo_overflow
+
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+int main(void) {
+    
+    alarm(TIMEOUT);
+    
+    test_limbo_overflow();
+    
+    TEST_PASSED("test_concurrent");
+    
+    return EXIT_SUCCESS;
+} // end main
+
+// END OF FILE
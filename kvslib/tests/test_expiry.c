@@ -0,0 +1,244 @@
+/* Key Value Storage Library
+ *
+ *  @file test_expiry.c
+ *  Expiry persistence test
+ *
+ *  Tests that expiry deadlines survive logs and snapshots of KVS tables
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+// ---------------------------------------------------------------------------
+// Build
+// ---------------------------------------------------------------------------
+//
+//  cc -std=c99 test_expiry.c ../KVS.c -lpthread
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../KVS.h"
+#include "test.h"
+
+
+// ---------------------------------------------------------------------------
+// Test parameters
+// ---------------------------------------------------------------------------
+
+#define LOG_PATH "kvs_test_expiry_log.tmp"
+
+#define SNAPSHOT_PATH "kvs_test_expiry_snapshot.tmp"
+
+#define SHORT_TTL 50 /* milliseconds */
+
+#define LONG_TTL 3600000 /* milliseconds */
+
+
+// ---------------------------------------------------------------------------
+// private function:  wait_for_short_ttl()
+// ---------------------------------------------------------------------------
+//
+// Sleeps until entries stored with SHORT_TTL have expired.
+
+static void wait_for_short_ttl(void) {
+    struct timespec delay;
+    
+    delay.tv_sec = 0;
+    delay.tv_nsec = 2 * SHORT_TTL * 1000000L;
+    nanosleep(&delay, NULL);
+    
+    return;
+} // end wait_for_short_ttl
+
+
+// ---------------------------------------------------------------------------
+// private function:  store_entries( table )
+// ---------------------------------------------------------------------------
+//
+// Stores an entry that expires soon for key 1,  one that expires much later
+// for key 2  and one that does not expire for key 3 into <table>.
+
+static void store_entries(kvs_table_t table) {
+    kvs_status_t status;
+    
+    kvs_store_value_ttl(table, 1, "short", 0, true, SHORT_TTL, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    kvs_store_value_ttl(table, 2, "long", 0, true, LONG_TTL, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    kvs_store_value(table, 3, "none", 0, true, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    return;
+} // end store_entries
+
+
+// ---------------------------------------------------------------------------
+// private function:  check_recovered( table )
+// ---------------------------------------------------------------------------
+//
+// Checks that <table>,  recovered after the short TTL has passed,  holds the
+// entries for keys 2 and 3 only  and that the entry for key 2 still expires.
+
+static void check_recovered(kvs_table_t table) {
+    kvs_status_t status;
+    
+    TEST_CHECK(NOT(kvs_entry_exists(table, 1, &status)));
+    TEST_CHECK(kvs_entry_exists(table, 2, &status));
+    TEST_CHECK(kvs_entry_exists(table, 3, &status));
+    
+    // only the entry for key 2 is due an hour from now
+    TEST_CHECK(kvs_expire(table, kvs_current_time() + LONG_TTL, &status) == 1);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    TEST_CHECK(NOT(kvs_entry_exists(table, 2, &status)));
+    TEST_CHECK(kvs_entry_exists(table, 3, &status));
+    
+    return;
+} // end check_recovered
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_log_deadlines()
+// ---------------------------------------------------------------------------
+//
+// Checks that stores logged with a TTL are replayed with their deadlines  and
+// that a store whose deadline has passed is replayed as a removal.
+
+static void test_log_deadlines(void) {
+    kvs_table_t table, recovered;
+    kvs_status_t status;
+    
+    remove(LOG_PATH);
+    
+    table = kvs_new_table(0, &status);
+    TEST_CHECK(table != NULL);
+    kvs_attach_log(table, LOG_PATH, 0, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    store_entries(table);
+    kvs_dispose_table(table, NULL);
+    
+    wait_for_short_ttl();
+    
+    recovered = kvs_recover_table(NULL, LOG_PATH, 0, KVS_FLAGS_NONE, &status);
+    TEST_CHECK(recovered != NULL);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    check_recovered(recovered);
+    kvs_dispose_table(recovered, NULL);
+    
+    // entries that have not expired cannot be replayed into concurrent tables
+    recovered =
+        kvs_recover_table(NULL, LOG_PATH, 0, KVS_FLAG_CONCURRENT, &status);
+    TEST_CHECK(recovered == NULL);
+    TEST_CHECK(status == KVS_STATUS_INVALID_FLAGS);
+    
+    remove(LOG_PATH);
+    
+    return;
+} // end test_log_deadlines
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_snapshot_deadlines()
+// ---------------------------------------------------------------------------
+//
+// Checks that entries saved with a TTL keep their deadlines  in a snapshot
+// and in tables loaded from it,  and that expired entries are not served.
+
+static void test_snapshot_deadlines(void) {
+    kvs_table_t table, snapshot, recovered;
+    kvs_status_t status;
+    
+    table = kvs_new_table(0, &status);
+    TEST_CHECK(table != NULL);
+    store_entries(table);
+    kvs_save_snapshot(table, SNAPSHOT_PATH, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    kvs_dispose_table(table, NULL);
+    
+    wait_for_short_ttl();
+    
+    snapshot = kvs_open_snapshot(SNAPSHOT_PATH, &status);
+    TEST_CHECK(snapshot != NULL);
+    TEST_CHECK(NOT(kvs_entry_exists(snapshot, 1, &status)));
+    TEST_CHECK(kvs_entry_exists(snapshot, 2, &status));
+    TEST_CHECK(kvs_entry_exists(snapshot, 3, &status));
+    kvs_dispose_table(snapshot, NULL);
+    
+    recovered =
+        kvs_recover_table(SNAPSHOT_PATH, NULL, 0, KVS_FLAGS_NONE, &status);
+    TEST_CHECK(recovered != NULL);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    check_recovered(recovered);
+    kvs_dispose_table(recovered, NULL);
+    
+    // entries that have not expired cannot be loaded into concurrent tables
+    recovered =
+        kvs_recover_table(SNAPSHOT_PATH, NULL, 0, KVS_FLAG_CONCURRENT, &status);
+    TEST_CHECK(recovered == NULL);
+    TEST_CHECK(status == KVS_STATUS_INVALID_FLAGS);
+    
+    remove(SNAPSHOT_PATH);
+    
+    return;
+} // end test_snapshot_deadlines
+
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+int main(void) {
+    
+    test_log_deadlines();
+    test_snapshot_deadlines();
+    
+    TEST_PASSED("test_expiry");
+    
+    return EXIT_SUCCESS;
+} // end main
+
+// END OF FILE
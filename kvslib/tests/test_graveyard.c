@@ -0,0 +1,300 @@
+/* Key Value Storage Library
+ *
+ *  @file test_graveyard.c
+ *  Graveyard test
+ *
+ *  Tests removal and release of KVS entries that are still referenced
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+// ---------------------------------------------------------------------------
+// Build
+// ---------------------------------------------------------------------------
+//
+//  cc -std=c99 test_graveyard.c -lpthread
+//
+// The library is included  so that the graveyard of a table can be checked.
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "../KVS.c"
+#include "test.h"
+
+
+// ---------------------------------------------------------------------------
+// Test parameters
+// ---------------------------------------------------------------------------
+
+#define BUCKET_COUNT 7
+
+#define KEY_COUNT 200
+
+#define ROUND_COUNT 200
+
+#define PINNER_COUNT 3
+
+
+// ---------------------------------------------------------------------------
+// private function:  check_value( table, key, round )
+// ---------------------------------------------------------------------------
+//
+// Checks that <table> holds the value stored for <key> in round <round>.
+
+static void check_value(kvs_table_t table, kvs_key_t key, cardinal round) {
+    kvs_status_t status;
+    char expected[32];
+    char *value;
+    
+    sprintf(expected, "value %u.%u", (unsigned) key, (unsigned) round);
+    value = kvs_value_for_key(table, key, &status);
+    TEST_CHECK(value != NULL);
+    TEST_CHECK(strcmp(value, expected) == 0);
+    free(value);
+    
+    return;
+} // end check_value
+
+
+// ---------------------------------------------------------------------------
+// private function:  store_value( table, key, round )
+// ---------------------------------------------------------------------------
+//
+// Stores the value for <key> in round <round> into <table>.
+
+static void store_value(kvs_table_t table, kvs_key_t key, cardinal round) {
+    kvs_status_t status;
+    char value[32];
+    
+    sprintf(value, "value %u.%u", (unsigned) key, (unsigned) round);
+    kvs_store_value(table, key, value, 0, true, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    return;
+} // end store_value
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_graveyard_release()
+// ---------------------------------------------------------------------------
+//
+// Removes referenced entries from long chains  so that they are moved to the
+// graveyard,  then releases them  in an order that takes them from the head
+// as well as the middle of their graveyard chains.  Checks that every entry
+// released leaves the graveyard  and that the live chains stay intact while
+// the graveyard holds entries.
+
+static void test_graveyard_release(void) {
+    kvs_table_t table;
+    kvs_table_s *this_table;
+    kvs_status_t status;
+    cardinal index;
+    kvs_key_t key;
+    
+    table = kvs_new_table(BUCKET_COUNT, &status);
+    TEST_CHECK(table != NULL);
+    this_table = (kvs_table_s *) table;
+    
+    for (key = 1; key <= KEY_COUNT; key++) {
+        store_value(table, key, 0);
+        TEST_CHECK(kvs_reference_for_key(table, key, &status) != NULL);
+    } // end for
+    
+    // referenced entries are buried,  they keep their keys until released
+    for (key = 1; key <= KEY_COUNT; key++) {
+        kvs_remove_entry(table, key, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        TEST_CHECK(NOT(kvs_entry_exists(table, key, &status)));
+    } // end for
+    TEST_CHECK(this_table->grave_count == KEY_COUNT);
+    
+    kvs_store_value(table, 1, "value", 0, true, &status);
+    TEST_CHECK(status == KVS_STATUS_KEY_NOT_UNIQUE);
+    
+    // removing a buried entry again leaves it in the graveyard
+    for (key = 1; key <= KEY_COUNT; key = key + 5) {
+        kvs_remove_entry(table, key, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    } // end for
+    TEST_CHECK(this_table->grave_count == KEY_COUNT);
+    
+    // release every odd key,  most recently buried first,  and store it again
+    for (index = KEY_COUNT / 2; index > 0; index--) {
+        key = index * 2 - 1;
+        kvs_release_entry(table, key, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        store_value(table, key, 1);
+    } // end for
+    TEST_CHECK(this_table->grave_count == KEY_COUNT / 2);
+    
+    // the live chains hold the odd keys only
+    for (key = 1; key <= KEY_COUNT; key++) {
+        if (key % 2 == 1)
+            check_value(table, key, 1);
+        else
+            TEST_CHECK(NOT(kvs_entry_exists(table, key, &status)));
+    } // end for
+    
+    // release every even key,  least recently buried first
+    for (key = 2; key <= KEY_COUNT; key = key + 2) {
+        kvs_release_entry(table, key, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    } // end for
+    TEST_CHECK(this_table->grave_count == 0);
+    TEST_CHECK(kvs_number_of_entries(table) == KEY_COUNT / 2);
+    
+    for (key = 2; key <= KEY_COUNT; key = key + 2) {
+        store_value(table, key, 2);
+    } // end for
+    for (key = 1; key <= KEY_COUNT; key++) {
+        check_value(table, key, (key % 2 == 1) ? 1 : 2);
+    } // end for
+    
+    kvs_dispose_table(table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    return;
+} // end test_graveyard_release
+
+
+// ---------------------------------------------------------------------------
+// private function:  pinner( argument )
+// ---------------------------------------------------------------------------
+//
+// Pins and releases the entries of the shared table over and over  until told
+// to stop,  so that removals race with the release of the last reference.
+
+static kvs_table_t shared_table;
+
+static int stop_pinners = 0;
+
+static void *pinner(void *argument) {
+    kvs_status_t status;
+    kvs_key_t key;
+    
+    (void) argument;
+    
+    while (NOT(__atomic_load_n(&stop_pinners, __ATOMIC_RELAXED))) {
+        for (key = 1; key <= KEY_COUNT; key++) {
+            if (kvs_reference_for_key(shared_table, key, &status) != NULL)
+                kvs_release_entry(shared_table, key, &status);
+        } // end for
+    } // end while
+    
+    return NULL;
+} // end pinner
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_release_race()
+// ---------------------------------------------------------------------------
+//
+// Removes entries of a concurrent table  while other threads pin and release
+// them,  so that removals find entries whose last other reference is released
+// just after they have been marked.  Checks that every entry removed is gone
+// once no thread references it  and that stores of its key succeed again.
+
+static void test_release_race(void) {
+    pthread_t thread[PINNER_COUNT];
+    kvs_status_t status;
+    cardinal index, round;
+    kvs_key_t key;
+    
+    shared_table =
+        kvs_new_table_with_flags(BUCKET_COUNT, KVS_FLAG_CONCURRENT, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    for (index = 0; index < PINNER_COUNT; index++) {
+        TEST_CHECK(pthread_create(&thread[index], NULL, pinner, NULL) == 0);
+    } // end for
+    
+    for (round = 0; round < ROUND_COUNT; round++) {
+        for (key = 1; key <= KEY_COUNT; key++) {
+            kvs_store_value(shared_table, key, "value", 0, true, &status);
+            TEST_CHECK((status == KVS_STATUS_SUCCESS) ||
+                       (status == KVS_STATUS_KEY_NOT_UNIQUE));
+        } // end for
+        
+        for (key = 1; key <= KEY_COUNT; key++) {
+            kvs_remove_entry(shared_table, key, &status);
+            TEST_CHECK((status == KVS_STATUS_SUCCESS) ||
+                       (status == KVS_STATUS_ENTRY_NOT_FOUND));
+        } // end for
+    } // end for
+    
+    __atomic_store_n(&stop_pinners, 1, __ATOMIC_RELAXED);
+    for (index = 0; index < PINNER_COUNT; index++) {
+        pthread_join(thread[index], NULL);
+    } // end for
+    
+    // all entries were removed or released by now
+    TEST_CHECK(kvs_number_of_entries(shared_table) == 0);
+    for (key = 1; key <= KEY_COUNT; key++) {
+        store_value(shared_table, key, 3);
+        check_value(shared_table, key, 3);
+    } // end for
+    
+    kvs_dispose_table(shared_table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    return;
+} // end test_release_race
+
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+int main(void) {
+    
+    test_graveyard_release();
+    test_release_race();
+    
+    TEST_PASSED("test_graveyard");
+    
+    return EXIT_SUCCESS;
+} // end main
+
+// END OF FILE
@@ -0,0 +1,382 @@
+/* Key Value Storage Library
+ *
+ *  @file test_log.c
+ *  Write-ahead log test
+ *
+ *  Tests group commit,  replay and recovery of KVS tables
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+// ---------------------------------------------------------------------------
+// Build
+// ---------------------------------------------------------------------------
+//
+//  cc -std=c99 test_log.c -lpthread
+//
+// The library is included  so that its allocation macros can be replaced  to
+// observe the allocations made during replay.
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define ALLOC_H
+
+static size_t largest_request = 0;
+
+static void test_record(size_t size) {
+    
+    if (size > largest_request)
+        largest_request = size;
+    
+    return;
+} // end test_record
+
+#define ALLOCATE(_size) (test_record(_size), malloc(_size))
+#define REALLOCATE(_pointer, _size) \
+    (test_record(_size), realloc(_pointer, _size))
+#define DEALLOCATE(_pointer) free(_pointer)
+
+#include "../KVS.c"
+#include "test.h"
+
+
+// ---------------------------------------------------------------------------
+// Test parameters
+// ---------------------------------------------------------------------------
+
+#define LOG_PATH "kvs_test_log.tmp"
+
+#define WRITER_COUNT 4
+
+#define KEY_COUNT 4000
+
+#define COMMIT_WINDOW 200 /* microseconds */
+
+
+// ---------------------------------------------------------------------------
+// private function:  check_value( table, key, expected )
+// ---------------------------------------------------------------------------
+//
+// Checks that <table> holds the null-terminated value <expected> for <key>.
+
+static void check_value(kvs_table_t table,
+                          kvs_key_t key,
+                         const char *expected) {
+    kvs_status_t status;
+    char *value;
+    
+    value = kvs_get_entry(table, true, key, NULL, NULL, &status);
+    TEST_CHECK(value != NULL);
+    TEST_CHECK(strcmp(value, expected) == 0);
+    free(value);
+    
+    return;
+} // end check_value
+
+
+// ---------------------------------------------------------------------------
+// private function:  file_length( path )
+// ---------------------------------------------------------------------------
+//
+// Returns the length of the file at <path>.
+
+static long file_length(const char *path) {
+    FILE *file;
+    long length;
+    
+    file = fopen(path, "rb");
+    TEST_CHECK(file != NULL);
+    TEST_CHECK(fseek(file, 0, SEEK_END) == 0);
+    length = ftell(file);
+    fclose(file);
+    
+    return length;
+} // end file_length
+
+
+// ---------------------------------------------------------------------------
+// private function:  writer( argument )
+// ---------------------------------------------------------------------------
+//
+// Stores the keys of one writer into a logged table  and removes every third
+// of them again.
+
+static kvs_table_t logged_table;
+
+static void *writer(void *argument) {
+    kvs_key_t key, first = (kvs_key_t) (uintptr_t) argument;
+    kvs_status_t status;
+    char value[32];
+    
+    for (key = first; key <= KEY_COUNT; key = key + WRITER_COUNT) {
+        sprintf(value, "value %u", (unsigned) key);
+        kvs_store_value(logged_table, key, value, 0, true, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        
+        if (key % 3 == 0) {
+            kvs_remove_entry(logged_table, key, &status);
+            TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        } // end if
+    } // end for
+    
+    return NULL;
+} // end writer
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_group_commit()
+// ---------------------------------------------------------------------------
+//
+// Logs the stores and removals of concurrent writers with group commit  and
+// checks that a table recovered from the log holds the same entries.
+
+static void test_group_commit(void) {
+    pthread_t thread[WRITER_COUNT];
+    kvs_table_t recovered;
+    kvs_status_t status;
+    char expected[32];
+    kvs_key_t key;
+    uintptr_t index;
+    
+    remove(LOG_PATH);
+    logged_table = kvs_new_table_with_flags(0, KVS_FLAG_CONCURRENT, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    kvs_attach_log(logged_table, LOG_PATH, COMMIT_WINDOW, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    for (index = 0; index < WRITER_COUNT; index++)
+        pthread_create(&thread[index], NULL, writer, (void *) (index + 1));
+    for (index = 0; index < WRITER_COUNT; index++)
+        pthread_join(thread[index], NULL);
+    
+    kvs_detach_log(logged_table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    recovered = kvs_recover_table(NULL, LOG_PATH, 0, 0, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    TEST_CHECK(kvs_number_of_entries(recovered) ==
+               kvs_number_of_entries(logged_table));
+    
+    for (key = 1; key <= KEY_COUNT; key++) {
+        if (key % 3 == 0) {
+            TEST_CHECK(NOT(kvs_entry_exists(recovered, key, NULL)));
+        }
+        else {
+            sprintf(expected, "value %u", (unsigned) key);
+            check_value(recovered, key, expected);
+        } // end if
+    } // end for
+    
+    kvs_dispose_table(recovered, NULL);
+    kvs_dispose_table(logged_table, NULL);
+    remove(LOG_PATH);
+    
+    return;
+} // end test_group_commit
+
+
+// ---------------------------------------------------------------------------
+// private function:  write_replace_log()
+// ---------------------------------------------------------------------------
+//
+// Writes a log that stores key 5,  stores and removes key 6  and stores key 7
+// and returns its length.
+
+static long write_replace_log(void) {
+    kvs_status_t status;
+    kvs_table_t table;
+    
+    remove(LOG_PATH);
+    table = kvs_new_table(0, &status);
+    kvs_attach_log(table, LOG_PATH, 0, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    kvs_store_value(table, 5, "new five", 0, true, &status);
+    kvs_store_value(table, 6, "six", 0, true, &status);
+    kvs_remove_entry(table, 6, &status);
+    kvs_store_value(table, 7, "seven", 0, true, &status);
+    
+    kvs_detach_log(table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    kvs_dispose_table(table, NULL);
+    
+    return file_length(LOG_PATH);
+} // end write_replace_log
+
+
+// ---------------------------------------------------------------------------
+// private function:  check_replaced( table )
+// ---------------------------------------------------------------------------
+//
+// Checks that <table> holds the entries of the log of write_replace_log().
+
+static void check_replaced(kvs_table_t table) {
+    
+    check_value(table, 5, "new five");
+    TEST_CHECK(NOT(kvs_entry_exists(table, 6, NULL)));
+    check_value(table, 7, "seven");
+    
+    return;
+} // end check_replaced
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_replay_existing_keys()
+// ---------------------------------------------------------------------------
+//
+// Replays a log onto tables of every layout that already hold entries for
+// the logged keys.  Unreferenced entries are replaced.  A referenced entry
+// stops replay with KVS_STATUS_ENTRY_PENDING_REMOVAL  and leaves the file
+// unchanged,  replay succeeds once the entry has been released.
+
+static void test_replay_existing_keys(void) {
+    kvs_flags_t flags[] = { 0, KVS_FLAG_CONCURRENT,
+                            KVS_FLAG_OPEN_ADDRESSING, KVS_FLAG_COMPACT };
+    kvs_status_t status;
+    kvs_table_t table;
+    cardinal index;
+    long length;
+    
+    length = write_replace_log();
+    
+    for (index = 0; index < sizeof(flags) / sizeof(flags[0]); index++) {
+        
+        // unreferenced entries are replaced
+        table = kvs_new_table_with_flags(0, flags[index], &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        kvs_store_value(table, 5, "old five", 0, true, &status);
+        kvs_store_value(table, 6, "old six", 0, true, &status);
+        
+        TEST_CHECK(kvs_replay_log(table, LOG_PATH, &status) == 4);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        check_replaced(table);
+        kvs_dispose_table(table, NULL);
+        
+        // a referenced entry cannot be replaced
+        table = kvs_new_table_with_flags(0, flags[index], &status);
+        kvs_store_value(table, 5, "old five", 0, true, &status);
+        TEST_CHECK(kvs_reference_for_key(table, 5, &status) != NULL);
+        
+        TEST_CHECK(kvs_replay_log(table, LOG_PATH, &status) == 0);
+        TEST_CHECK(status == KVS_STATUS_ENTRY_PENDING_REMOVAL);
+        TEST_CHECK(file_length(LOG_PATH) == length);
+        
+        // the marked entry is removed by its release
+        kvs_release_entry(table, 5, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        TEST_CHECK(NOT(kvs_entry_exists(table, 5, NULL)));
+        
+        TEST_CHECK(kvs_replay_log(table, LOG_PATH, &status) == 4);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        check_replaced(table);
+        kvs_dispose_table(table, NULL);
+    } // end for
+    
+    remove(LOG_PATH);
+    
+    return;
+} // end test_replay_existing_keys
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_torn_size()
+// ---------------------------------------------------------------------------
+//
+// Appends a torn record whose header is plausible but whose value size runs
+// far past the end of the file.  Replay must truncate the torn record without
+// allocating a buffer of that size.
+
+static void test_torn_size(void) {
+    kvs_log_record_s record;
+    kvs_status_t status;
+    kvs_table_t table;
+    long length;
+    FILE *file;
+    
+    length = write_replace_log();
+    
+    // a header with a valid type and a huge size
+    file = fopen(LOG_PATH, "r+b");
+    TEST_CHECK(file != NULL);
+    TEST_CHECK(fread(&record, sizeof(record), 1, file) == 1);
+    record.size = 0xF0000000;
+    TEST_CHECK(fseek(file, 0, SEEK_END) == 0);
+    TEST_CHECK(fwrite(&record, sizeof(record), 1, file) == 1);
+    fclose(file);
+    
+    largest_request = 0;
+    table = kvs_new_table(0, &status);
+    TEST_CHECK(kvs_replay_log(table, LOG_PATH, &status) == 4);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    TEST_CHECK(largest_request < 0x100000);
+    TEST_CHECK(file_length(LOG_PATH) == length);
+    check_replaced(table);
+    kvs_dispose_table(table, NULL);
+    
+    remove(LOG_PATH);
+    
+    return;
+} // end test_torn_size
+
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+int main(void) {
+    
+    test_group_commit();
+    test_replay_existing_keys();
+    test_torn_size();
+    
+    TEST_PASSED("test_log");
+    
+    return EXIT_SUCCESS;
+} // end main
+
+// END OF FILE
@@ -0,0 +1,206 @@
+/* Key Value Storage Library
+ *
+ *  @file test_snapshot.c
+ *  Snapshot test
+ *
+ *  Tests saving snapshots of KVS tables that other threads modify
+ *
+ *  Author: Benjamin Kowarsch
+ *
+ *  Copyright (C) 2009 Benjamin Kowarsch. All rights reserved.
+ *
+ *  License:
+ *
+ *  Redistribution  and  use  in source  and  binary forms,  with  or  without
+ *  modification, are permitted provided that the following conditions are met
+ *
+ *  1) NO FEES may be charged for the provision of the software.  The software
+ *     may  NOT  be published  on websites  that contain  advertising,  unless
+ *     specific  prior  written  permission has been obtained.
+ *
+ *  2) Redistributions  of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  3) Redistributions  in binary form  must  reproduce  the  above  copyright
+ *     notice,  this list of conditions  and  the following disclaimer  in the
+ *     documentation and other materials provided with the distribution.
+ *
+ *  4) Neither the author's name nor the names of any contributors may be used
+ *     to endorse  or  promote  products  derived  from this software  without
+ *     specific prior written permission.
+ *
+ *  5) Where this list of conditions  or  the following disclaimer, in part or
+ *     as a whole is overruled  or  nullified by applicable law, no permission
+ *     is granted to use the software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY  AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+ * CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA,  OR PROFITS; OR BUSINESS
+ * INTERRUPTION)  HOWEVER  CAUSED  AND ON ANY THEORY OF LIABILITY,  WHETHER IN
+ * CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+// ---------------------------------------------------------------------------
+// Build
+// ---------------------------------------------------------------------------
+//
+//  cc -std=c99 test_snapshot.c ../KVS.c -lpthread
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../KVS.h"
+#include "test.h"
+
+
+// ---------------------------------------------------------------------------
+// Test parameters
+// ---------------------------------------------------------------------------
+
+#define SNAPSHOT_PATH "kvs_test_snapshot.tmp"
+
+#define WRITER_COUNT 3
+
+#define KEY_COUNT 20000
+
+#define SAVE_COUNT 20
+
+
+// ---------------------------------------------------------------------------
+// private function:  format_value( value, key )
+// ---------------------------------------------------------------------------
+//
+// Writes the value stored for <key> to <value>.
+
+static void format_value(char *value, kvs_key_t key) {
+    
+    sprintf(value, "value %u of the snapshot test", (unsigned) key);
+    
+    return;
+} // end format_value
+
+
+// ---------------------------------------------------------------------------
+// private function:  writer( argument )
+// ---------------------------------------------------------------------------
+//
+// Stores and removes keys of the shared table at random  until told to stop.
+// Every removal retires an entry  whose value a save may have gathered.
+
+static kvs_table_t shared_table;
+
+static int stop_writers = 0;
+
+static void *writer(void *argument) {
+    unsigned seed = (unsigned) (uintptr_t) argument;
+    kvs_status_t status;
+    kvs_key_t key;
+    char value[64];
+    
+    while (NOT(__atomic_load_n(&stop_writers, __ATOMIC_RELAXED))) {
+        for (key = 1; key <= KEY_COUNT; key++) {
+            seed = seed * 1103515245 + 12345;
+            if (seed & 0x10000)
+                kvs_remove_entry(shared_table, key, &status);
+            else {
+                format_value(value, key);
+                kvs_store_value(shared_table, key, value, 0, true, &status);
+            } // end if
+        } // end for
+    } // end while
+    
+    return NULL;
+} // end writer
+
+
+// ---------------------------------------------------------------------------
+// private function:  test_concurrent_save()
+// ---------------------------------------------------------------------------
+//
+// Saves a concurrent table over and over  while writers store and remove its
+// entries.  Checks that every save succeeds  and that every entry saved has
+// the value stored for its key,  none was deallocated while being written.
+
+static void test_concurrent_save(void) {
+    pthread_t thread[WRITER_COUNT];
+    kvs_table_t snapshot;
+    kvs_status_t status;
+    cardinal index, size;
+    bool null_terminated;
+    kvs_key_t key;
+    char expected[64];
+    char *value;
+    
+    shared_table =
+        kvs_new_table_with_flags(4096, KVS_FLAG_CONCURRENT, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    for (key = 1; key <= KEY_COUNT; key++) {
+        format_value(expected, key);
+        kvs_store_value(shared_table, key, expected, 0, true, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    } // end for
+    
+    for (index = 0; index < WRITER_COUNT; index++) {
+        TEST_CHECK(pthread_create(&thread[index], NULL, writer,
+                                  (void *) (uintptr_t) (index + 1)) == 0);
+    } // end for
+    
+    for (index = 0; index < SAVE_COUNT; index++) {
+        kvs_save_snapshot(shared_table, SNAPSHOT_PATH, &status);
+        TEST_CHECK(status == KVS_STATUS_SUCCESS);
+        
+        snapshot = kvs_open_snapshot(SNAPSHOT_PATH, &status);
+        TEST_CHECK(snapshot != NULL);
+        
+        for (key = 1; key <= KEY_COUNT; key++) {
+            value = kvs_get_entry(snapshot, false, key, &size,
+                                  &null_terminated, &status);
+            if (value != NULL) {
+                format_value(expected, key);
+                TEST_CHECK(size == strlen(expected) + 1);
+                TEST_CHECK(strcmp(value, expected) == 0);
+            } // end if
+        } // end for
+        
+        kvs_dispose_table(snapshot, NULL);
+    } // end for
+    
+    __atomic_store_n(&stop_writers, 1, __ATOMIC_RELAXED);
+    for (index = 0; index < WRITER_COUNT; index++) {
+        pthread_join(thread[index], NULL);
+    } // end for
+    
+    kvs_dispose_table(shared_table, &status);
+    TEST_CHECK(status == KVS_STATUS_SUCCESS);
+    
+    remove(SNAPSHOT_PATH);
+    
+    return;
+} // end test_concurrent_save
+
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+int main(void) {
+    
+    test_concurrent_save();
+    
+    TEST_PASSED("test_snapshot");
+    
+    return EXIT_SUCCESS;
+} // end main
+
+// END OF FILE